@@ -0,0 +1,694 @@
+#include "broker-bench.h"
+
+static t_list* queues;
+static int state = BENCH_PREPARANDO;
+static uint32_t id_base;
+static uint64_t inicio;
+static uint64_t fin_publicacion;
+
+int main(int argc, char *argv[]) {
+	if (bench_load(argc > 1 ? argv[1] : CONFIG_FILE_PATH) < 0)
+		return EXIT_FAILURE;
+
+	int response = bench_run();
+	if (response == 0) {
+		bool stdout_output = string_equals_ignore_case(bench_config->salida, "-");
+		FILE* out = stdout_output ? stdout : fopen(bench_config->salida, "w");
+		if (out == NULL) {
+			bench_logger_error("No se pudo abrir %s", bench_config->salida);
+			response = -1;
+		} else {
+			bench_report(out);
+			if (!stdout_output)
+				fclose(out);
+		}
+	}
+
+	bench_exit();
+	return response < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static uint64_t bench_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static double bench_seconds(uint64_t from, uint64_t to) {
+	return to > from ? (to - from) / 1e9 : 0;
+}
+
+static double bench_rate(int count, uint64_t from, uint64_t to) {
+	double seconds = bench_seconds(from, to);
+	return seconds > 0 ? count / seconds : 0;
+}
+
+static t_protocol bench_protocol_of(t_cola cola) {
+	switch (cola) {
+	case NEW_QUEUE:
+		return NEW_POKEMON;
+	case APPEARED_QUEUE:
+		return APPEARED_POKEMON;
+	case LOCALIZED_QUEUE:
+		return LOCALIZED_POKEMON;
+	case GET_QUEUE:
+		return GET_POKEMON;
+	case CATCH_QUEUE:
+		return CATCH_POKEMON;
+	default:
+		return CAUGHT_POKEMON;
+	}
+}
+
+// Solo GET y CATCH reciben MESSAGE_ID
+static bool bench_expects_id(t_cola cola) {
+	return cola == GET_QUEUE || cola == CATCH_QUEUE;
+}
+
+static uint32_t bench_tag_id(t_bench_publisher* publisher, int seq) {
+	return id_base + publisher->index * publisher->queue->mensajes + seq;
+}
+
+// Los GET llevan la marca en el nombre. El resto comparte un nombre por
+// tamaño, asi el broker no junta una especie nueva por mensaje
+static char* bench_name(t_bench_publisher* publisher, int seq) {
+	int largo = bench_config->nombre_min;
+	if (bench_config->nombre_max > bench_config->nombre_min)
+		largo += rand_r(&publisher->seed)
+				% (bench_config->nombre_max - bench_config->nombre_min + 1);
+
+	char* name = publisher->queue->cola == GET_QUEUE ?
+			string_from_format(BENCH_PREFIJO "-%d-%d-", publisher->index, seq) :
+			string_duplicate(BENCH_PREFIJO);
+	int falta = largo - (int) strlen(name);
+	if (falta > 0) {
+		char* relleno = string_repeat('x', falta);
+		string_append(&name, relleno);
+		free(relleno);
+	}
+	return name;
+}
+
+static t_list* bench_positions(t_bench_publisher* publisher) {
+	int cantidad = bench_config->posiciones_min;
+	if (bench_config->posiciones_max > bench_config->posiciones_min)
+		cantidad += rand_r(&publisher->seed)
+				% (bench_config->posiciones_max - bench_config->posiciones_min
+						+ 1);
+
+	t_list* posiciones = list_create();
+	for (int i = 0; i < cantidad; i++) {
+		t_position* position = malloc(sizeof(t_position));
+		position->pos_x = rand_r(&publisher->seed) % 100;
+		position->pos_y = rand_r(&publisher->seed) % 100;
+		list_add(posiciones, position);
+	}
+	return posiciones;
+}
+
+static void* bench_message_create(t_bench_publisher* publisher, int seq) {
+	switch (publisher->queue->cola) {
+	case NEW_QUEUE: {
+		t_new_pokemon* new_snd = malloc(sizeof(t_new_pokemon));
+		new_snd->nombre_pokemon = bench_name(publisher, seq);
+		new_snd->tamanio_nombre = strlen(new_snd->nombre_pokemon) + 1;
+		new_snd->cantidad = 1;
+		new_snd->pos_x = publisher->index;
+		new_snd->pos_y = seq;
+		new_snd->id_correlacional = 0;
+		return new_snd;
+	}
+	case APPEARED_QUEUE: {
+		t_appeared_pokemon* appeared_snd = malloc(sizeof(t_appeared_pokemon));
+		appeared_snd->nombre_pokemon = bench_name(publisher, seq);
+		appeared_snd->tamanio_nombre = strlen(appeared_snd->nombre_pokemon) + 1;
+		appeared_snd->pos_x = publisher->index;
+		appeared_snd->pos_y = seq;
+		appeared_snd->id_correlacional = bench_tag_id(publisher, seq);
+		return appeared_snd;
+	}
+	case LOCALIZED_QUEUE: {
+		t_localized_pokemon* loc_snd = malloc(sizeof(t_localized_pokemon));
+		loc_snd->id_correlacional = bench_tag_id(publisher, seq);
+		loc_snd->nombre_pokemon = bench_name(publisher, seq);
+		loc_snd->tamanio_nombre = strlen(loc_snd->nombre_pokemon) + 1;
+		loc_snd->posiciones = bench_positions(publisher);
+		loc_snd->coordenadas = NULL;
+		loc_snd->cant_elem = list_size(loc_snd->posiciones);
+		return loc_snd;
+	}
+	case GET_QUEUE: {
+		t_get_pokemon* get_snd = malloc(sizeof(t_get_pokemon));
+		get_snd->id_correlacional = seq + 1;
+		get_snd->nombre_pokemon = bench_name(publisher, seq);
+		get_snd->tamanio_nombre = strlen(get_snd->nombre_pokemon) + 1;
+		return get_snd;
+	}
+	case CATCH_QUEUE: {
+		t_catch_pokemon* catch_snd = malloc(sizeof(t_catch_pokemon));
+		catch_snd->id_correlacional = seq + 1;
+		catch_snd->nombre_pokemon = bench_name(publisher, seq);
+		catch_snd->tamanio_nombre = strlen(catch_snd->nombre_pokemon) + 1;
+		catch_snd->pos_x = publisher->index;
+		catch_snd->pos_y = seq;
+		return catch_snd;
+	}
+	default: {
+		t_caught_pokemon* caught_snd = malloc(sizeof(t_caught_pokemon));
+		caught_snd->id_correlacional = bench_tag_id(publisher, seq);
+		caught_snd->result = 1;
+		return caught_snd;
+	}
+	}
+}
+
+static void bench_message_destroy(t_protocol protocol, void* message) {
+	switch (protocol) {
+	case NEW_POKEMON:
+		free(((t_new_pokemon*) message)->nombre_pokemon);
+		break;
+	case APPEARED_POKEMON:
+		free(((t_appeared_pokemon*) message)->nombre_pokemon);
+		break;
+	case GET_POKEMON:
+		free(((t_get_pokemon*) message)->nombre_pokemon);
+		break;
+	case CATCH_POKEMON:
+		free(((t_catch_pokemon*) message)->nombre_pokemon);
+		break;
+	case LOCALIZED_POKEMON:
+		utils_localized_destroy(message);
+		return;
+	default:
+		break;
+	}
+	free(message);
+}
+
+static uint32_t bench_message_id(t_protocol protocol, void* message) {
+	switch (protocol) {
+	case NEW_POKEMON:
+		return ((t_new_pokemon*) message)->id_correlacional;
+	case APPEARED_POKEMON:
+		return ((t_appeared_pokemon*) message)->id_correlacional;
+	case GET_POKEMON:
+		return ((t_get_pokemon*) message)->id_correlacional;
+	case CATCH_POKEMON:
+		return ((t_catch_pokemon*) message)->id_correlacional;
+	case LOCALIZED_POKEMON:
+		return ((t_localized_pokemon*) message)->id_correlacional;
+	case CAUGHT_POKEMON:
+		return ((t_caught_pokemon*) message)->id_correlacional;
+	default:
+		return 0;
+	}
+}
+
+// Recupera (publicador, numero) de un mensaje entregado
+static bool bench_untag(t_bench_queue* queue, t_protocol protocol,
+		void* message, int* publisher, int* seq) {
+	if (protocol != bench_protocol_of(queue->cola))
+		return false;
+
+	switch (protocol) {
+	case NEW_POKEMON:
+		*publisher = ((t_new_pokemon*) message)->pos_x;
+		*seq = ((t_new_pokemon*) message)->pos_y;
+		return true;
+	case CATCH_POKEMON:
+		*publisher = ((t_catch_pokemon*) message)->pos_x;
+		*seq = ((t_catch_pokemon*) message)->pos_y;
+		return true;
+	case GET_POKEMON:
+		return sscanf(((t_get_pokemon*) message)->nombre_pokemon,
+				BENCH_PREFIJO "-%d-%d-", publisher, seq) == 2;
+	default: {
+		uint32_t id = bench_message_id(protocol, message);
+		if (id < id_base || id - id_base >= BENCH_ID_RANGO)
+			return false;
+		*publisher = (id - id_base) / queue->mensajes;
+		*seq = (id - id_base) % queue->mensajes;
+		return true;
+	}
+	}
+}
+
+static void bench_subscriber_count(t_bench_subscriber* subscriber,
+		t_protocol protocol, void* message, uint64_t now) {
+	// Lo que quedo en la cola de corridas anteriores llega al suscribirse
+	if (__atomic_load_n(&state, __ATOMIC_ACQUIRE) == BENCH_PREPARANDO) {
+		subscriber->previos++;
+		return;
+	}
+
+	t_bench_queue* queue = subscriber->queue;
+	int index, seq;
+	if (!bench_untag(queue, protocol, message, &index, &seq) || index < 0
+			|| index >= list_size(queue->publishers) || seq < 0
+			|| seq >= queue->mensajes) {
+		subscriber->ajenos++;
+		return;
+	}
+
+	t_bench_publisher* publisher = list_get(queue->publishers, index);
+	uint64_t sent = __atomic_load_n(&publisher->enviado[seq], __ATOMIC_ACQUIRE);
+	if (sent == 0) {
+		subscriber->ajenos++;
+		return;
+	}
+
+	int bit = index * queue->mensajes + seq;
+	if (subscriber->vistos[bit / 8] & (1 << (bit % 8))) {
+		subscriber->duplicados++;
+		return;
+	}
+	subscriber->vistos[bit / 8] |= 1 << (bit % 8);
+
+	bench_histogram_record(subscriber->entrega,
+			now > sent ? (now - sent) / 1000 : 0);
+	subscriber->ultimo = now;
+	__atomic_add_fetch(&subscriber->recibidos, 1, __ATOMIC_RELEASE);
+}
+
+static void* bench_subscriber_loop(void* arg) {
+	t_bench_subscriber* subscriber = arg;
+	t_ack ack;
+	ack.queue = subscriber->queue->cola;
+	ack.sender_name = PROGRAM_NAME;
+	ack.ip = bench_config->ip_bench;
+	ack.port = subscriber->puerto;
+
+	t_frame_reader* reader = framing_reader_create(subscriber->fd, 0);
+	int protocol;
+	void* message;
+	while (utils_receive_message(reader, &protocol, &message) == FRAMING_OK) {
+		if (message == NULL)
+			continue;
+		uint64_t now = bench_now();
+		ack.id_corr_msg = bench_message_id(protocol, message);
+		utils_serialize_and_send(subscriber->fd, ACK, &ack);
+		bench_subscriber_count(subscriber, protocol, message, now);
+		bench_message_destroy(protocol, message);
+	}
+	framing_reader_destroy(reader);
+	return NULL;
+}
+
+// Lee los MESSAGE_ID de los GET/CATCH: request_id es el numero + 1
+static void* bench_publisher_reader(void* arg) {
+	t_bench_publisher* publisher = arg;
+	t_frame_reader* reader = framing_reader_create(publisher->fd, 0);
+	int protocol;
+	void* message;
+	while (utils_receive_message(reader, &protocol, &message) == FRAMING_OK) {
+		if (message == NULL)
+			continue;
+		if (protocol == MESSAGE_ID) {
+			uint64_t now = bench_now();
+			int seq = ((t_message_id*) message)->request_id - 1;
+			uint64_t sent = seq >= 0 && seq < publisher->queue->mensajes ?
+					__atomic_load_n(&publisher->enviado[seq], __ATOMIC_ACQUIRE) : 0;
+			if (sent != 0) {
+				bench_histogram_record(publisher->id,
+						now > sent ? (now - sent) / 1000 : 0);
+				__atomic_add_fetch(&publisher->ids, 1, __ATOMIC_RELEASE);
+			}
+			free(message);
+		} else {
+			bench_message_destroy(protocol, message);
+		}
+	}
+	framing_reader_destroy(reader);
+	return NULL;
+}
+
+static void bench_sleep_until(uint64_t instant) {
+	uint64_t now = bench_now();
+	if (instant <= now)
+		return;
+	struct timespec pause;
+	pause.tv_sec = (instant - now) / 1000000000;
+	pause.tv_nsec = (instant - now) % 1000000000;
+	nanosleep(&pause, NULL);
+}
+
+static void* bench_publisher_loop(void* arg) {
+	t_bench_publisher* publisher = arg;
+	t_protocol protocol = bench_protocol_of(publisher->queue->cola);
+	uint64_t intervalo =
+			bench_config->ritmo > 0 ? 1000000000 / bench_config->ritmo : 0;
+	uint64_t start = bench_now();
+
+	for (int seq = 0; seq < publisher->queue->mensajes; seq++) {
+		// Con RITMO la latencia se mide desde el instante planeado, asi un
+		// broker lento no se esconde atrasando los envios siguientes
+		uint64_t planned = start + seq * intervalo;
+		if (intervalo > 0)
+			bench_sleep_until(planned);
+
+		void* message = bench_message_create(publisher, seq);
+		uint64_t before = bench_now();
+		__atomic_store_n(&publisher->enviado[seq],
+				intervalo > 0 ? planned : before, __ATOMIC_RELEASE);
+		int sent = utils_serialize_and_send(publisher->fd, protocol, message);
+		uint64_t after = bench_now();
+		bench_message_destroy(protocol, message);
+
+		if (sent < 0) {
+			__atomic_store_n(&publisher->enviado[seq], 0, __ATOMIC_RELEASE);
+			publisher->errores++;
+			bench_logger_error("Publicador %d de %s: se perdio la conexion",
+					publisher->index,
+					bench_config_queue_name(publisher->queue->cola));
+			break;
+		}
+		bench_histogram_record(publisher->envio, (after - before) / 1000);
+		publisher->enviados++;
+	}
+	return NULL;
+}
+
+int bench_load(char* config_path) {
+	int response = bench_logger_create();
+	if (response < 0)
+		return response;
+
+	response = bench_config_load(config_path);
+	if (response < 0) {
+		bench_logger_destroy();
+		return response;
+	}
+
+	return 0;
+}
+
+static int bench_check_config() {
+	if (list_is_empty(bench_config->colas)) {
+		bench_logger_error("COLAS no tiene ninguna cola valida");
+		return -1;
+	}
+	if (bench_config->publicadores <= 0 || bench_config->suscriptores < 0) {
+		bench_logger_error("PUBLICADORES tiene que ser positivo");
+		return -1;
+	}
+	for (int i = 0; i < list_size(bench_config->colas); i++) {
+		t_bench_queue_config* queue = list_get(bench_config->colas, i);
+		if (queue->mensajes <= 0 || (long) queue->mensajes
+				* bench_config->publicadores > BENCH_ID_RANGO) {
+			bench_logger_error("%s: PUBLICADORES x MENSAJES tiene que ir de 1 a %d",
+					bench_config_queue_name(queue->cola), BENCH_ID_RANGO);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static t_bench_queue* bench_queue_create(t_bench_queue_config* config,
+		int* puerto) {
+	t_bench_queue* queue = malloc(sizeof(t_bench_queue));
+	queue->cola = config->cola;
+	queue->mensajes = config->mensajes;
+	queue->publishers = list_create();
+	queue->subscribers = list_create();
+
+	for (int i = 0; i < bench_config->publicadores; i++) {
+		t_bench_publisher* publisher = calloc(1, sizeof(t_bench_publisher));
+		publisher->index = i;
+		publisher->queue = queue;
+		publisher->fd = -1;
+		publisher->enviado = calloc(queue->mensajes, sizeof(uint64_t));
+		publisher->envio = bench_histogram_create();
+		publisher->id = bench_histogram_create();
+		publisher->seed = (queue->cola << 16) ^ i ^ (unsigned int) time(NULL);
+		list_add(queue->publishers, publisher);
+	}
+
+	int bits = bench_config->publicadores * queue->mensajes;
+	for (int i = 0; i < bench_config->suscriptores; i++) {
+		t_bench_subscriber* subscriber = calloc(1, sizeof(t_bench_subscriber));
+		subscriber->index = i;
+		subscriber->puerto = (*puerto)++;
+		subscriber->queue = queue;
+		subscriber->fd = -1;
+		subscriber->vistos = calloc(bits / 8 + 1, 1);
+		subscriber->entrega = bench_histogram_create();
+		list_add(queue->subscribers, subscriber);
+	}
+	return queue;
+}
+
+static int bench_start_subscriber(t_bench_subscriber* subscriber) {
+	subscriber->fd = cluster_connect(bench_config->cluster,
+			subscriber->queue->cola);
+	if (subscriber->fd < 0)
+		return -1;
+
+	t_subscribe sub_snd;
+	sub_snd.ip = bench_config->ip_bench;
+	sub_snd.puerto = subscriber->puerto;
+	sub_snd.proceso = TEAM;
+	sub_snd.cola = subscriber->queue->cola;
+	sub_snd.f_desc = 0;
+	sub_snd.seconds = 0;
+	sub_snd.especies = NULL;
+	if (utils_serialize_and_send(subscriber->fd, SUBSCRIBE, &sub_snd) < 0)
+		return -1;
+
+	if (pthread_create(&subscriber->thread, NULL, bench_subscriber_loop,
+			subscriber) != 0)
+		return -1;
+	subscriber->running = true;
+	return 0;
+}
+
+static int bench_start_publisher(t_bench_publisher* publisher) {
+	publisher->fd = cluster_connect(bench_config->cluster,
+			publisher->queue->cola);
+	if (publisher->fd < 0)
+		return -1;
+
+	if (bench_expects_id(publisher->queue->cola)) {
+		if (pthread_create(&publisher->reader, NULL, bench_publisher_reader,
+				publisher) != 0)
+			return -1;
+		publisher->reading = true;
+	}
+	if (pthread_create(&publisher->thread, NULL, bench_publisher_loop,
+			publisher) != 0)
+		return -1;
+	publisher->running = true;
+	return 0;
+}
+
+// Entregas y MESSAGE_ID que todavia no llegaron
+static int bench_pending() {
+	int pending = 0;
+	for (int i = 0; i < list_size(queues); i++) {
+		t_bench_queue* queue = list_get(queues, i);
+		int enviados = 0;
+		for (int j = 0; j < list_size(queue->publishers); j++) {
+			t_bench_publisher* publisher = list_get(queue->publishers, j);
+			enviados += publisher->enviados;
+			if (bench_expects_id(queue->cola))
+				pending += publisher->enviados
+						- __atomic_load_n(&publisher->ids, __ATOMIC_ACQUIRE);
+		}
+		for (int j = 0; j < list_size(queue->subscribers); j++) {
+			t_bench_subscriber* subscriber = list_get(queue->subscribers, j);
+			if (subscriber->running)
+				pending += enviados - __atomic_load_n(&subscriber->recibidos,
+						__ATOMIC_ACQUIRE);
+		}
+	}
+	return pending;
+}
+
+int bench_run() {
+	if (bench_check_config() < 0)
+		return -1;
+
+	id_base = BENCH_ID_BASE + (time(NULL) % BENCH_ID_CORRIDAS) * BENCH_ID_RANGO;
+	queues = list_create();
+	int puerto = bench_config->puerto_bench;
+	for (int i = 0; i < list_size(bench_config->colas); i++)
+		list_add(queues, bench_queue_create(list_get(bench_config->colas, i),
+				&puerto));
+
+	int response = 0;
+	for (int i = 0; i < list_size(queues) && response == 0; i++) {
+		t_bench_queue* queue = list_get(queues, i);
+		for (int j = 0; j < list_size(queue->subscribers) && response == 0; j++) {
+			response = bench_start_subscriber(list_get(queue->subscribers, j));
+			if (response < 0)
+				bench_logger_error("No se pudo suscribir a la cola %s",
+						bench_config_queue_name(queue->cola));
+		}
+	}
+	if (response == 0)
+		usleep(BENCH_ARRANQUE);
+
+	__atomic_store_n(&state, BENCH_CORRIENDO, __ATOMIC_RELEASE);
+	inicio = bench_now();
+	bench_logger_info("Publicando");
+
+	for (int i = 0; i < list_size(queues) && response == 0; i++) {
+		t_bench_queue* queue = list_get(queues, i);
+		for (int j = 0; j < list_size(queue->publishers) && response == 0; j++) {
+			t_bench_publisher* publisher = list_get(queue->publishers, j);
+			response = bench_start_publisher(publisher);
+			if (response < 0) {
+				bench_logger_error("No se pudo conectar el publicador de %s",
+						bench_config_queue_name(queue->cola));
+			}
+		}
+	}
+
+	for (int i = 0; i < list_size(queues); i++) {
+		t_bench_queue* queue = list_get(queues, i);
+		for (int j = 0; j < list_size(queue->publishers); j++) {
+			t_bench_publisher* publisher = list_get(queue->publishers, j);
+			if (publisher->running)
+				pthread_join(publisher->thread, NULL);
+		}
+	}
+	fin_publicacion = bench_now();
+	bench_logger_info("Publicacion terminada, esperando entregas");
+
+	uint64_t limite = fin_publicacion + (uint64_t) bench_config->espera * 1000000000;
+	while (response == 0 && bench_pending() > 0 && bench_now() < limite)
+		usleep(BENCH_ESPERA_PASO);
+
+	// Cortar las conexiones despierta a los hilos que estan en recv
+	__atomic_store_n(&state, BENCH_TERMINADO, __ATOMIC_RELEASE);
+	for (int i = 0; i < list_size(queues); i++) {
+		t_bench_queue* queue = list_get(queues, i);
+		for (int j = 0; j < list_size(queue->publishers); j++) {
+			t_bench_publisher* publisher = list_get(queue->publishers, j);
+			if (publisher->fd >= 0)
+				shutdown(publisher->fd, SHUT_RDWR);
+			if (publisher->reading)
+				pthread_join(publisher->reader, NULL);
+		}
+		for (int j = 0; j < list_size(queue->subscribers); j++) {
+			t_bench_subscriber* subscriber = list_get(queue->subscribers, j);
+			if (subscriber->fd >= 0)
+				shutdown(subscriber->fd, SHUT_RDWR);
+			if (subscriber->running)
+				pthread_join(subscriber->thread, NULL);
+		}
+	}
+	return response;
+}
+
+static void bench_report_queue(FILE* out, t_bench_queue* queue,
+		uint64_t* ultimo, int* publicados_total, int* entregados_total) {
+	t_bench_histogram* envio = bench_histogram_create();
+	t_bench_histogram* id = bench_histogram_create();
+	t_bench_histogram* entrega = bench_histogram_create();
+	int publicados = 0, errores = 0, entregados = 0, duplicados = 0;
+	int ajenos = 0, previos = 0;
+	uint64_t ultima_entrega = inicio;
+
+	for (int i = 0; i < list_size(queue->publishers); i++) {
+		t_bench_publisher* publisher = list_get(queue->publishers, i);
+		bench_histogram_merge(envio, publisher->envio);
+		bench_histogram_merge(id, publisher->id);
+		publicados += publisher->enviados;
+		errores += publisher->errores;
+	}
+	for (int i = 0; i < list_size(queue->subscribers); i++) {
+		t_bench_subscriber* subscriber = list_get(queue->subscribers, i);
+		bench_histogram_merge(entrega, subscriber->entrega);
+		entregados += subscriber->recibidos;
+		duplicados += subscriber->duplicados;
+		ajenos += subscriber->ajenos;
+		previos += subscriber->previos;
+		if (subscriber->ultimo > ultima_entrega)
+			ultima_entrega = subscriber->ultimo;
+	}
+	int esperados = publicados * list_size(queue->subscribers);
+
+	fprintf(out, "    {\"cola\": \"%s\", \"mensajes_por_publicador\": %d, "
+			"\"publicados\": %d, \"errores\": %d, \"entregas_esperadas\": %d, "
+			"\"entregados\": %d, \"perdidos\": %d, \"duplicados\": %d, "
+			"\"ajenos\": %d, \"previos\": %d,\n",
+			bench_config_queue_name(queue->cola), queue->mensajes, publicados,
+			errores, esperados, entregados, esperados - entregados, duplicados,
+			ajenos, previos);
+	fprintf(out, "     \"publicacion_msg_s\": %.1f, \"entrega_msg_s\": %.1f,\n",
+			bench_rate(publicados, inicio, fin_publicacion),
+			bench_rate(entregados, inicio, ultima_entrega));
+	fprintf(out, "     \"latencia_us\": {\n      \"envio\": ");
+	bench_histogram_print_json(out, envio);
+	fprintf(out, ",\n      \"id\": ");
+	if (bench_expects_id(queue->cola))
+		bench_histogram_print_json(out, id);
+	else
+		fprintf(out, "null");
+	fprintf(out, ",\n      \"entrega\": ");
+	bench_histogram_print_json(out, entrega);
+	fprintf(out, "}}");
+
+	if (ultima_entrega > *ultimo)
+		*ultimo = ultima_entrega;
+	*publicados_total += publicados;
+	*entregados_total += entregados;
+	bench_histogram_destroy(envio);
+	bench_histogram_destroy(id);
+	bench_histogram_destroy(entrega);
+}
+
+void bench_report(FILE* out) {
+	fprintf(out, "{\n  \"config\": {\"brokers\": %d, \"publicadores\": %d, "
+			"\"suscriptores\": %d, \"ritmo\": %d, \"tamanio_nombre\": [%d, %d], "
+			"\"posiciones\": [%d, %d]},\n", list_size(bench_config->cluster->nodes),
+			bench_config->publicadores, bench_config->suscriptores,
+			bench_config->ritmo, bench_config->nombre_min,
+			bench_config->nombre_max, bench_config->posiciones_min,
+			bench_config->posiciones_max);
+	fprintf(out, "  \"colas\": [\n");
+
+	uint64_t ultimo = inicio;
+	int publicados = 0, entregados = 0;
+	for (int i = 0; i < list_size(queues); i++) {
+		bench_report_queue(out, list_get(queues, i), &ultimo, &publicados,
+				&entregados);
+		fprintf(out, i + 1 < list_size(queues) ? ",\n" : "\n");
+	}
+
+	fprintf(out, "  ],\n  \"total\": {\"publicados\": %d, \"entregados\": %d, "
+			"\"duracion_publicacion_s\": %.3f, \"duracion_entrega_s\": %.3f, "
+			"\"publicacion_msg_s\": %.1f, \"entrega_msg_s\": %.1f}\n}\n",
+			publicados, entregados, bench_seconds(inicio, fin_publicacion),
+			bench_seconds(inicio, ultimo),
+			bench_rate(publicados, inicio, fin_publicacion),
+			bench_rate(entregados, inicio, ultimo));
+}
+
+static void bench_queue_destroy(t_bench_queue* queue) {
+	void publisher_destroy(t_bench_publisher* publisher) {
+		socket_close_conection(publisher->fd);
+		free(publisher->enviado);
+		bench_histogram_destroy(publisher->envio);
+		bench_histogram_destroy(publisher->id);
+		free(publisher);
+	}
+	void subscriber_destroy(t_bench_subscriber* subscriber) {
+		socket_close_conection(subscriber->fd);
+		free(subscriber->vistos);
+		bench_histogram_destroy(subscriber->entrega);
+		free(subscriber);
+	}
+	list_destroy_and_destroy_elements(queue->publishers,
+			(void*) publisher_destroy);
+	list_destroy_and_destroy_elements(queue->subscribers,
+			(void*) subscriber_destroy);
+	free(queue);
+}
+
+void bench_exit() {
+	if (queues != NULL)
+		list_destroy_and_destroy_elements(queues, (void*) bench_queue_destroy);
+	bench_config_free();
+	bench_logger_destroy();
+}
@@ -0,0 +1,91 @@
+#ifndef BROKER_BENCH_H_
+#define BROKER_BENCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <commons/string.h>
+#include <commons/collections/list.h>
+
+#include "config/bench_config.h"
+#include "logger/bench_logger.h"
+#include "histogram/bench_histogram.h"
+#include "../../shared-common/common/sockets.h"
+#include "../../shared-common/common/framing.h"
+#include "../../shared-common/common/utils.h"
+
+// El broker guarda APPEARED, LOCALIZED y CAUGHT con el id_correlacional que
+// traen. Cada corrida usa su propio rango de BENCH_ID_RANGO ids a partir de
+// BENCH_ID_BASE para no pisar los de otra corrida ni los que asigna el broker
+#define BENCH_ID_BASE		0x40000000
+#define BENCH_ID_RANGO		(1 << 20)
+#define BENCH_ID_CORRIDAS	512
+// Tiempo para que los SUBSCRIBE lleguen antes de publicar, en microsegundos
+#define BENCH_ARRANQUE		1000000
+#define BENCH_ESPERA_PASO	10000
+#define BENCH_PREFIJO		"bench"
+
+typedef enum {
+	BENCH_PREPARANDO,
+	BENCH_CORRIENDO,
+	BENCH_TERMINADO
+} e_bench_state;
+
+typedef struct t_bench_queue t_bench_queue;
+
+// Cada mensaje lleva (publicador, numero) para que el suscriptor encuentre
+// cuando salio: en pos_x/pos_y (NEW, CATCH), en el nombre (GET) o en el
+// id_correlacional (APPEARED, LOCALIZED, CAUGHT)
+typedef struct {
+	int index;
+	t_bench_queue* queue;
+	int fd;
+	// Instante de envio de cada mensaje en ns, 0 si todavia no salio
+	uint64_t* enviado;
+	int enviados;
+	int errores;
+	int ids;
+	// Tiempo del send y, en GET/CATCH, hasta el MESSAGE_ID
+	t_bench_histogram* envio;
+	t_bench_histogram* id;
+	unsigned int seed;
+	pthread_t thread;
+	pthread_t reader;
+	bool running;
+	bool reading;
+} t_bench_publisher;
+
+typedef struct {
+	int index;
+	int puerto;
+	t_bench_queue* queue;
+	int fd;
+	// Un bit por (publicador, numero) para contar duplicados
+	uint8_t* vistos;
+	int recibidos;
+	int duplicados;
+	int previos;
+	int ajenos;
+	uint64_t ultimo;
+	t_bench_histogram* entrega;
+	pthread_t thread;
+	bool running;
+} t_bench_subscriber;
+
+struct t_bench_queue {
+	t_cola cola;
+	int mensajes;
+	t_list* publishers;
+	t_list* subscribers;
+};
+
+int bench_load(char* config_path);
+int bench_run();
+void bench_report(FILE* out);
+void bench_exit();
+
+#endif /* BROKER_BENCH_H_ */
@@ -0,0 +1,126 @@
+#include "bench_config.h"
+
+void read_config(t_config* config_file);
+void print_config();
+
+static char* queue_names[] = { "NEW", "APPEARED", "LOCALIZED", "GET", "CATCH",
+		"CAUGHT" };
+
+int bench_config_load(char* path)
+{
+	return config_load(bench_log_get(), path, read_config, print_config);
+}
+
+void bench_config_free()
+{
+	free(bench_config->ip_broker);
+	free(bench_config->ip_bench);
+	free(bench_config->salida);
+	list_destroy_and_destroy_elements(bench_config->colas, free);
+	cluster_destroy(bench_config->cluster);
+	free(bench_config);
+}
+
+char* bench_config_queue_name(t_cola cola)
+{
+	return queue_names[cola];
+}
+
+static int bench_config_queue(char* name)
+{
+	for (int i = 0; i < 6; i++) {
+		if (string_equals_ignore_case(name, queue_names[i]))
+			return i;
+	}
+	return -1;
+}
+
+static int bench_config_int(t_config* config_file, char* key, int value)
+{
+	if (config_has_property(config_file, key))
+		return config_get_int_value(config_file, key);
+	return value;
+}
+
+// "[min,max]", o un solo valor para un tamaño fijo
+static void bench_config_range(t_config* config_file, char* key, int* min, int* max)
+{
+	if (!config_has_property(config_file, key))
+		return;
+	char** range = config_get_array_value(config_file, key);
+	if (range[0] != NULL) {
+		*min = atoi(range[0]);
+		*max = range[1] != NULL ? atoi(range[1]) : *min;
+	}
+	utils_free_array(range);
+}
+
+// COLAS=[NEW,GET] y MENSAJES=[1000,200] van en paralelo. Sin MENSAJES para una
+// cola se usan 1000
+static void bench_config_queues(t_config* config_file)
+{
+	bench_config->colas = list_create();
+	char** colas = config_get_array_value(config_file, "COLAS");
+	char** mensajes = config_has_property(config_file, "MENSAJES") ?
+			config_get_array_value(config_file, "MENSAJES") : NULL;
+
+	bool sin_mensajes = mensajes == NULL;
+	for (int i = 0; colas[i] != NULL; i++) {
+		int cola = bench_config_queue(colas[i]);
+		if (cola < 0) {
+			bench_logger_warn("Cola desconocida en COLAS: %s", colas[i]);
+		} else {
+			t_bench_queue_config* queue = malloc(sizeof(t_bench_queue_config));
+			queue->cola = cola;
+			queue->mensajes = 1000;
+			if (!sin_mensajes && mensajes[i] != NULL)
+				queue->mensajes = atoi(mensajes[i]);
+			else
+				sin_mensajes = true;
+			list_add(bench_config->colas, queue);
+		}
+	}
+	utils_free_array(colas);
+	if (mensajes != NULL)
+		utils_free_array(mensajes);
+}
+
+void read_config(t_config* config_file)
+{
+	bench_config = malloc(sizeof(t_bench_config));
+	bench_config->ip_broker = string_duplicate(config_get_string_value(config_file, "IP_BROKER"));
+	bench_config->puerto_broker = config_get_int_value(config_file, "PUERTO_BROKER");
+	bench_config->ip_bench = string_duplicate(config_get_string_value(config_file, "IP_BENCH"));
+	bench_config->puerto_bench = config_get_int_value(config_file, "PUERTO_BENCH");
+	bench_config->publicadores = bench_config_int(config_file, "PUBLICADORES", 1);
+	bench_config->suscriptores = bench_config_int(config_file, "SUSCRIPTORES", 1);
+	bench_config_queues(config_file);
+	bench_config->nombre_min = 8;
+	bench_config->nombre_max = 8;
+	bench_config_range(config_file, "TAMANIO_NOMBRE", &bench_config->nombre_min, &bench_config->nombre_max);
+	bench_config->posiciones_min = 1;
+	bench_config->posiciones_max = 1;
+	bench_config_range(config_file, "POSICIONES", &bench_config->posiciones_min, &bench_config->posiciones_max);
+	bench_config->ritmo = bench_config_int(config_file, "RITMO", 0);
+	bench_config->espera = bench_config_int(config_file, "ESPERA", 10);
+	bench_config->salida = string_duplicate(config_has_property(config_file, "SALIDA") ?
+			config_get_string_value(config_file, "SALIDA") : "-");
+	// Opcional: sin CLUSTER_BROKERS todo va a IP_BROKER:PUERTO_BROKER
+	bench_config->cluster = cluster_create(config_file, bench_config->ip_broker, bench_config->puerto_broker);
+}
+
+void print_config()
+{
+	bench_logger_info("IP_BROKER: %s", bench_config->ip_broker);
+	bench_logger_info("PUERTO_BROKER: %d", bench_config->puerto_broker);
+	bench_logger_info("BROKERS EN EL CLUSTER: %d", list_size(bench_config->cluster->nodes));
+	bench_logger_info("PUBLICADORES: %d", bench_config->publicadores);
+	bench_logger_info("SUSCRIPTORES: %d", bench_config->suscriptores);
+	for (int i = 0; i < list_size(bench_config->colas); i++) {
+		t_bench_queue_config* queue = list_get(bench_config->colas, i);
+		bench_logger_info("COLA %s: %d mensajes por publicador",
+				bench_config_queue_name(queue->cola), queue->mensajes);
+	}
+	bench_logger_info("TAMANIO_NOMBRE: %d a %d", bench_config->nombre_min, bench_config->nombre_max);
+	bench_logger_info("RITMO: %d", bench_config->ritmo);
+}
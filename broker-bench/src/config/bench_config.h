@@ -0,0 +1,57 @@
+#ifndef CONFIG_BENCH_CONFIG_H_
+#define CONFIG_BENCH_CONFIG_H_
+
+#include <stdlib.h>
+#include <commons/config.h>
+#include <commons/string.h>
+#include <commons/collections/list.h>
+
+#include "../../../shared-common/common/config.h"
+#include "../../../shared-common/common/cluster.h"
+#include "../../../shared-common/common/utils.h"
+
+#include "../logger/bench_logger.h"
+
+#define CONFIG_FILE_PATH "broker-bench.config"
+
+// Cola a ejercitar y cuantos mensajes le envia cada publicador
+typedef struct {
+	t_cola cola;
+	int mensajes;
+} t_bench_queue_config;
+
+typedef struct
+{
+	char* ip_broker;
+	int puerto_broker;
+	// Los suscriptores se presentan como ip_bench:puerto_bench + i
+	char* ip_bench;
+	int puerto_bench;
+	int publicadores;
+	int suscriptores;
+	t_list* colas;
+	int nombre_min;
+	int nombre_max;
+	int posiciones_min;
+	int posiciones_max;
+	// Mensajes por segundo de cada publicador, 0 es sin limite
+	int ritmo;
+	// Segundos a esperar las entregas que faltan despues de publicar
+	int espera;
+	char* salida;
+	t_cluster* cluster;
+
+} t_bench_config;
+
+t_bench_config* bench_config;
+
+int bench_config_load(char* path);
+void bench_config_free();
+
+/**
+ * @NAME: bench_config_queue_name
+ * @DESC: Nombre de la cola como se escribe en COLAS y en el reporte.
+ */
+char* bench_config_queue_name(t_cola cola);
+
+#endif /* CONFIG_BENCH_CONFIG_H_ */
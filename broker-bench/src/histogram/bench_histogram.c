@@ -0,0 +1,81 @@
+#include "bench_histogram.h"
+
+t_bench_histogram* bench_histogram_create() {
+	t_bench_histogram* histogram = calloc(1, sizeof(t_bench_histogram));
+	histogram->min = UINT64_MAX;
+	return histogram;
+}
+
+static int bench_histogram_index(uint64_t value) {
+	if (value < (1 << BENCH_HISTOGRAM_SUB_BITS))
+		return value;
+	int shift = (63 - __builtin_clzll(value)) - (BENCH_HISTOGRAM_SUB_BITS - 1);
+	return (shift + 1) * BENCH_HISTOGRAM_HALF + (value >> shift)
+			- BENCH_HISTOGRAM_HALF;
+}
+
+static uint64_t bench_histogram_upper(int index) {
+	if (index < (1 << BENCH_HISTOGRAM_SUB_BITS))
+		return index;
+	int shift = index / BENCH_HISTOGRAM_HALF - 1;
+	uint64_t sub = index % BENCH_HISTOGRAM_HALF + BENCH_HISTOGRAM_HALF;
+	return ((sub + 1) << shift) - 1;
+}
+
+void bench_histogram_record(t_bench_histogram* histogram, uint64_t value) {
+	histogram->counts[bench_histogram_index(value)]++;
+	histogram->total++;
+	histogram->sum += value;
+	if (value < histogram->min)
+		histogram->min = value;
+	if (value > histogram->max)
+		histogram->max = value;
+}
+
+void bench_histogram_merge(t_bench_histogram* into, t_bench_histogram* from) {
+	for (int i = 0; i < BENCH_HISTOGRAM_SIZE; i++)
+		into->counts[i] += from->counts[i];
+	into->total += from->total;
+	into->sum += from->sum;
+	if (from->min < into->min)
+		into->min = from->min;
+	if (from->max > into->max)
+		into->max = from->max;
+}
+
+uint64_t bench_histogram_percentile(t_bench_histogram* histogram,
+		double percentile) {
+	if (histogram->total == 0)
+		return 0;
+
+	uint64_t target = (uint64_t) (histogram->total * percentile / 100.0 + 0.5);
+	if (target < 1)
+		target = 1;
+
+	uint64_t seen = 0;
+	for (int i = 0; i < BENCH_HISTOGRAM_SIZE; i++) {
+		seen += histogram->counts[i];
+		if (seen >= target) {
+			uint64_t upper = bench_histogram_upper(i);
+			return upper > histogram->max ? histogram->max : upper;
+		}
+	}
+	return histogram->max;
+}
+
+void bench_histogram_print_json(FILE* out, t_bench_histogram* histogram) {
+	bool empty = histogram->total == 0;
+	fprintf(out, "{\"count\": %" PRIu64 ", \"min\": %" PRIu64
+			", \"mean\": %.1f, \"p50\": %" PRIu64 ", \"p90\": %" PRIu64
+			", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64 ", \"max\": %"
+			PRIu64 "}", histogram->total, empty ? 0 : histogram->min,
+			empty ? 0.0 : (double) histogram->sum / histogram->total,
+			bench_histogram_percentile(histogram, 50),
+			bench_histogram_percentile(histogram, 90),
+			bench_histogram_percentile(histogram, 99),
+			bench_histogram_percentile(histogram, 99.9), histogram->max);
+}
+
+void bench_histogram_destroy(t_bench_histogram* histogram) {
+	free(histogram);
+}
@@ -0,0 +1,68 @@
+#ifndef HISTOGRAM_BENCH_HISTOGRAM_H_
+#define HISTOGRAM_BENCH_HISTOGRAM_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+
+// Histograma log-lineal al estilo HDR: los valores menores a
+// 2^BENCH_HISTOGRAM_SUB_BITS se cuentan exactos y de ahi en mas cada potencia
+// de dos se parte en 2^(BENCH_HISTOGRAM_SUB_BITS - 1) cubetas iguales. El
+// error relativo queda por debajo de 1/64 para cualquier valor de 64 bits,
+// con un arreglo fijo y sin reservar memoria al registrar.
+#define BENCH_HISTOGRAM_SUB_BITS	7
+#define BENCH_HISTOGRAM_HALF		(1 << (BENCH_HISTOGRAM_SUB_BITS - 1))
+#define BENCH_HISTOGRAM_SIZE		((64 - BENCH_HISTOGRAM_SUB_BITS + 2) * BENCH_HISTOGRAM_HALF)
+
+typedef struct {
+	uint64_t counts[BENCH_HISTOGRAM_SIZE];
+	uint64_t total;
+	uint64_t min;
+	uint64_t max;
+	double sum;
+} t_bench_histogram;
+
+/**
+ * @NAME: bench_histogram_create
+ * @DESC: Crea un histograma vacio.
+ */
+t_bench_histogram* bench_histogram_create();
+
+/**
+ * @NAME: bench_histogram_record
+ * @DESC: Cuenta un valor. No es thread safe: cada hilo registra en el suyo y
+ * 		al final se juntan con bench_histogram_merge.
+ */
+void bench_histogram_record(t_bench_histogram* histogram, uint64_t value);
+
+/**
+ * @NAME: bench_histogram_merge
+ * @DESC: Suma los valores de from en into.
+ */
+void bench_histogram_merge(t_bench_histogram* into, t_bench_histogram* from);
+
+/**
+ * @NAME: bench_histogram_percentile
+ * @DESC: Valor por debajo del cual queda el percentil pedido (0 a 100). Se
+ * 		devuelve el limite superior de la cubeta, acotado al maximo visto.
+ */
+uint64_t bench_histogram_percentile(t_bench_histogram* histogram,
+		double percentile);
+
+/**
+ * @NAME: bench_histogram_print_json
+ * @DESC: Escribe un objeto JSON con count, min, mean, max y los percentiles
+ * 		50, 90, 99 y 99.9.
+ */
+void bench_histogram_print_json(FILE* out, t_bench_histogram* histogram);
+
+/**
+ * @NAME: bench_histogram_destroy
+ * @DESC: Libera el histograma.
+ */
+void bench_histogram_destroy(t_bench_histogram* histogram);
+
+#endif /* HISTOGRAM_BENCH_HISTOGRAM_H_ */
@@ -0,0 +1,56 @@
+#include "bench_logger.h"
+
+int bench_logger_create()
+{
+	// Sin consola: el reporte sale por stdout
+	bench_log = log_create(LOG_FILE, PROGRAM_NAME, false, LOG_LEVEL_TRACE);
+	if (bench_log == NULL || bench_log < 0)
+	{
+		return -1;
+	}
+
+	logger_print_header(bench_log, PROGRAM_NAME);
+
+	return 0;
+}
+
+void bench_logger_info(char* message, ...)
+{
+	va_list arguments;
+	va_start(arguments, message);
+	char* formated_message = string_from_vformat(message, arguments);
+	log_info(bench_log, formated_message);
+	free(formated_message);
+	va_end(arguments);
+}
+
+void bench_logger_warn(char* message, ...)
+{
+	va_list arguments;
+	va_start(arguments, message);
+	char* formated_message = string_from_vformat(message, arguments);
+	log_warning(bench_log, formated_message);
+	free(formated_message);
+	va_end(arguments);
+}
+
+void bench_logger_error(char* message, ...)
+{
+	va_list arguments;
+	va_start(arguments, message);
+	char* formated_message = string_from_vformat(message, arguments);
+	log_error(bench_log, formated_message);
+	free(formated_message);
+	va_end(arguments);
+}
+
+void bench_logger_destroy()
+{
+	logger_print_footer(bench_log, PROGRAM_NAME);
+	logger_destroy(bench_log);
+}
+
+t_log* bench_log_get()
+{
+	return bench_log;
+}
@@ -0,0 +1,22 @@
+#ifndef LOGGER_BENCH_LOGGER_H_
+#define LOGGER_BENCH_LOGGER_H_
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <commons/string.h>
+#include <commons/log.h>
+#include "../../../shared-common/common/logger.h"
+
+#define LOG_FILE "/home/utnso/log_broker_bench.txt"
+#define PROGRAM_NAME "BROKER_BENCH"
+
+int  bench_logger_create();
+void bench_logger_info(char* message, ...);
+void bench_logger_warn(char* message, ...);
+void bench_logger_error(char* message, ...);
+void bench_logger_destroy();
+t_log* bench_log_get();
+
+t_log* bench_log;
+#endif /* LOGGER_BENCH_LOGGER_H_ */
@@ -14,6 +14,11 @@ C_DEPS :=
 # Every subdirectory with source files must be described here
 SUBDIRS := \
 src \
+src/codec \
+src/delivery \
 src/config \
+src/log \
 src/logger \
+src/replica \
+src/trace \
 
@@ -1,64 +1,44 @@
 #include "broker.h"
 
-struct buddy {
-	uint32_t size;
-	uint32_t longest[1];
-};
-
-static inline int left_child(int index) {
-	// index * 2^1 + 1
-	return ((index << 1) + 1);
-}
-
-static inline int right_child(int index) {
-	// index * 2^1 + 2
-	return ((index << 1) + 2);
-}
-
-static inline int parent(int index) {
-	// (index+1)/2^1 - 1
-	return (((index + 1) >> 1) - 1);
-}
-
-static inline bool is_power_of_2(int index) {
-	return !(index & (index - 1));
-}
-
-static inline unsigned next_power_of_2(int size) {
-	size -= 1;
-	size |= (size >> 1);
-	size |= (size >> 2);
-	size |= (size >> 4);
-	size |= (size >> 8);
-	size |= (size >> 16);
-	return size + 1;
-}
-
 void signal_handler(int signum) {
 	if (signum == SIGUSR1) {
 		broker_logger_info(
 				"Signal SIGUSR1 received. Dumping memory contents into memdump.txt");
-		if (!is_buddy()) {
-			dump_partition();
-		} else {
-			dump();
-		}
+		dump();
 	}
 }
 
 int main(int argc, char *argv[]) {
 	initialize_queue();
-	if (broker_load() < 0)
+	broker_codec_init();
+	broker_delivery_init();
+	// Con varios brokers en la misma maquina cada uno lleva su config
+	if (broker_load(argc > 1 ? argv[1] : CONFIG_FILE_PATH) < 0)
 		return EXIT_FAILURE;
-	memory = malloc(broker_config->tamano_memoria);
-	memset(memory, '\0', broker_config->tamano_memoria);
+	broker_log_init(broker_config->retransmision_timeout,
+			broker_config->retransmision_timeout_maximo,
+			broker_config->retransmision_intentos,
+			broker_config->mensajes_en_vuelo);
+	t_cluster_node* replica = cluster_replica_of(broker_config->cluster,
+			broker_config->ip_broker, broker_config->puerto_broker);
+	if (replica != NULL) {
+		broker_replica_init(replica->ip, replica->port,
+				broker_config->ip_broker, broker_config->puerto_broker,
+				replica_snapshot);
+	}
+	t_allocator_config memory_config = {
+		.tamano = broker_config->tamano_memoria,
+		.tamano_minimo = broker_config->tamano_minimo_particion,
+		.estrategia = broker_config->estrategia_memoria,
+		.reemplazo = broker_config->algoritmo_reemplazo,
+		.particion_libre = broker_config->algoritmo_particion_libre,
+		.frecuencia_compactacion = broker_config->frecuencia_compactacion
+	};
+	allocator = allocator_create(memory_config, broker_log_get(),
+			evict_message, NULL);
+	if (broker_config->traza_memoria != NULL)
+		broker_trace_init(broker_config->traza_memoria);
 
-	if (broker_config->estrategia_memoria == 0) {
-		// Init buddy system structure
-		buddy = buddy_new(broker_config->tamano_memoria);
-	}
-
-	pointer = 0;
 	id = 1;
 	broker_server_init();
 	broker_exit();
@@ -66,145 +46,9 @@ int main(int argc, char *argv[]) {
 	return EXIT_SUCCESS;
 }
 
-// Buddy-related code
-
-/** Allocate a new buddy structure
- * @param total_mem total memory to be managed
- * @return pointer to the allocated buddy structure */
-struct buddy *buddy_new(int total_mem) {
-	struct buddy *self = NULL;
-	uint32_t node_size;
-
-	int i;
-
-	if (!is_power_of_2(total_mem)) {
-		total_mem = next_power_of_2(total_mem);
-	}
-
-	// Allocate an array to represent a complete binary tree
-	self = (struct buddy *) malloc(
-			sizeof(struct buddy) + 2 * total_mem * sizeof(uint32_t));
-	self->size = total_mem;
-	node_size = total_mem * 2;
-
-	/* Initialize longest array for buddy structure */
-	int iter_end = total_mem * 2 - 1;
-	for (i = 0; i < iter_end; i++) {
-		if (is_power_of_2(i + 1)) {
-			node_size >>= 1;
-		}
-		self->longest[i] = node_size;
-	}
-
-	return self;
-}
-
-void buddy_destroy(struct buddy *self) {
-	free(self);
-}
-
-// Choose smallest child greater than size
-unsigned choose_better_child(struct buddy *self, int index, uint32_t size) {
-	struct compound {
-		uint32_t size;
-		int index;
-	} children[2];
-
-	children[0].index = left_child(index);
-	children[0].size = self->longest[children[0].index];
-	children[1].index = right_child(index);
-	children[1].size = self->longest[children[1].index];
-
-	int min_idx = (children[0].size <= children[1].size) ? 0 : 1;
-
-	if (size > children[min_idx].size) {
-		min_idx = 1 - min_idx;
-	}
-
-	return children[min_idx].index;
-}
-
-/** @param size to alloc
- * @param self source buddy system
- * @return the offset from the beginning of memory to be managed */
-int buddy_alloc(struct buddy *self, uint32_t size) {
-	if (self == NULL || self->size < size) {
-		/* broker_logger_error(
-		 "Data couldn't be stored. Reason: Insufficient memory");
-		 */
-		return -1;
-	}
-	size = next_power_of_2(size);
-
-	uint32_t index = 0;
-	while (self->longest[index] < size) {
-		/* broker_logger_error(
-		 "Data couldn't be stored. Reason: External fragmentation");
-		 broker_logger_info("Freeing memory...");
-		 */
-		purge_msg();
-	}
-
-	// Search recursively for the child
-	uint32_t node_size = 0;
-	for (node_size = self->size; node_size != size; node_size >>= 1) {
-		index = choose_better_child(self, index, size);
-	}
-
-	// Update the longest value back
-	self->longest[index] = 0;
-	int offset = (index + 1) * node_size - self->size;
-
-	while (index) {
-		index = parent(index);
-		self->longest[index] = max(self->longest[left_child(index)],
-				self->longest[right_child(index)]);
-	}
-
-	return offset;
-}
-
-void buddy_free(struct buddy *self, int offset) {
-	if (self == NULL || offset < 0 || offset > self->size) {
-		// broker_logger_error("Error: value out of bounds");
-		return;
-	}
-
-	uint32_t node_size;
-	uint32_t index;
-
-	// Get the corresponding index from offset
-	node_size = 1;
-	index = offset + self->size - 1;
-
-	for (; self->longest[index] != 0; index = parent(index)) {
-		node_size <<= 1; // node_size *= 2
-
-		if (index == 0) {
-			break;
-		}
-	}
-
-	self->longest[index] = node_size;
-
-	while (index) {
-		index = parent(index);
-		node_size <<= 1;
-
-		uint32_t left_longest = self->longest[left_child(index)];
-		uint32_t right_longest = self->longest[right_child(index)];
-
-		if (left_longest + right_longest == node_size) {
-			self->longest[index] = node_size;
-		} else {
-			self->longest[index] = max(left_longest, right_longest);
-		}
-	}
-}
-
 // Broker init
-int broker_load() {
-	int response = broker_config_load();
+int broker_load(char* config_path) {
+	int response = broker_config_load(config_path);
 
 	if (response < 0)
 		return response;
@@ -216,29 +60,10 @@ int broker_load() {
 	}
 	broker_print_config();
 
-	// Create mutex for pointer
-	if (!is_buddy()) {
-		t_nodo_memory *nodo_memory = malloc(sizeof(t_nodo_memory));
-		nodo_memory->pointer = 0;
-		nodo_memory->libre = true;
-		nodo_memory->size = broker_config->tamano_memoria;
-		nodo_memory->timestamp = (unsigned) time(NULL);
-		list_add(list_memory, nodo_memory);
-		pointer = 0;
-	}
-
-	if (pthread_mutex_init(&mpointer, NULL) != 0) {
-		printf("\n mutex init failed\n");
-		return 1;
-	}
 	if (pthread_mutex_init(&mid, NULL) != 0) {
 		printf("\n mutex init failed\n");
 		return 1;
 	}
-	if (pthread_mutex_init(&msubs, NULL) != 0) {
-		printf("\n mutex init failed\n");
-		return 1;
-	}
 	if (pthread_mutex_init(&msave, NULL) != 0) {
 		printf("\n mutex init failed\n");
 		return 1;
@@ -267,13 +92,44 @@ int broker_load() {
 		printf("\n mutex init failed\n");
 		return 1;
 	}
-	if (pthread_mutex_init(&mmem, NULL) != 0) {
-		printf("\n mutex init failed\n");
-		return 1;
-	}
 	return 0;
 }
 
+// Con CLUSTER_BROKERS cada broker atiende solo sus colas. Lo que llega de un
+// cliente con otra tabla no se atiende: los suscriptores de esa cola estan
+// conectados a otro broker y no lo van a recibir
+static bool check_queue_owner(int protocol, void* message) {
+	int cola = protocol == SUBSCRIBE ?
+			(int) ((t_subscribe*) message)->cola : cluster_queue_of(protocol);
+	if (cola < 0 || cluster_owns(broker_config->cluster, cola,
+			broker_config->ip_broker, broker_config->puerto_broker))
+		return true;
+	t_cluster_node* owner = cluster_node(broker_config->cluster, cola);
+	broker_logger_error("La cola %s corresponde al broker %s:%d, se cierra la "
+			"conexion", get_protocol_name(cola), owner->ip, owner->port);
+	return false;
+}
+
+// ACK y SUBSCRIBE traen la cola del cliente y con ella se indexan los logs y
+// las listas de suscriptores: fuera de rango se descartan
+static bool check_queue_range(int protocol, void* message) {
+	int cola;
+	switch (protocol) {
+	case ACK:
+		cola = (int) ((t_ack*) message)->queue;
+		break;
+	case SUBSCRIBE:
+		cola = (int) ((t_subscribe*) message)->cola;
+		break;
+	default:
+		return true;
+	}
+	if (cola >= NEW_QUEUE && cola <= CAUGHT_QUEUE)
+		return true;
+	broker_logger_warn("Se descarta un mensaje con la cola invalida %d", cola);
+	return false;
+}
+
 void broker_server_init() {
 	base_time = time(NULL);
 	broker_socket = socket_create_listener(broker_config->ip_broker,
@@ -285,9 +141,25 @@ void broker_server_init() {
 
 	signal(SIGUSR1, signal_handler);
 	broker_logger_info("Server creado correctamente!! Esperando conexiones...");
+	bool atiende = false;
+	for (t_cola cola = NEW_QUEUE; cola <= CAUGHT_QUEUE; cola++) {
+		if (cluster_owns(broker_config->cluster, cola, broker_config->ip_broker,
+				broker_config->puerto_broker)) {
+			broker_logger_info("Cola %s atendida por este broker",
+					get_protocol_name(cola));
+			atiende = true;
+		}
+	}
+	// Las colas se reparten en CLUSTER_GROUPS grupos: los nodos de mas no
+	// reciben ninguna
+	if (!atiende) {
+		broker_logger_warn("Este broker no atiende ninguna cola: el cluster "
+				"reparte %d grupos", CLUSTER_GROUPS);
+	}
 
-	struct sockaddr_in client_info;
-	socklen_t addrlen = sizeof client_info;
+	pthread_t retransmission_tid;
+	pthread_create(&retransmission_tid, NULL, retransmission_loop, NULL);
+	pthread_detach(retransmission_tid);
 
 	pthread_attr_t attrs;
 	pthread_attr_init(&attrs);
@@ -297,8 +169,7 @@ void broker_server_init() {
 	for (;;) {
 
 		pthread_t tid;
-		if ((accepted_fd = accept(broker_socket,
-				(struct sockaddr *) &client_info, &addrlen)) != -1) {
+		if ((accepted_fd = socket_accept_conection(broker_socket)) != -1) {
 
 			/* broker_logger_info(
 			 "Creando un hilo para atender una conexión en el socket %d",
@@ -326,48 +197,135 @@ static void *handle_connection(void *arg) {
 
 	// broker_logger_info("Conexion establecida con cliente: %d", client_fd);
 
-	int received_bytes;
+	t_frame_reader* reader = framing_reader_create(client_fd, 0);
 	int protocol;
+	void* message;
+	// Quien envia los GET/CATCH por esta conexion, si se identifico
+	t_handshake* requester = NULL;
+	// La conexion es el log de un broker primario: los IDs ya vienen
+	// asignados y nadie espera MESSAGE_ID
+	bool replica_stream = false;
+	// Entre el primer REPLICA y el segundo llega la copia del estado del
+	// primario. Cuenta cuantas veces llego cada "cola:id" para no volver a
+	// guardar lo que ya esta en el log
+	t_dictionary* snapshot = NULL;
+	void free_requester() {
+		if (requester != NULL) {
+			free(requester->ip);
+			free(requester);
+			requester = NULL;
+		}
+	}
+	void close_connection() {
+		framing_reader_destroy(reader);
+		free_requester();
+		if (snapshot != NULL)
+			dictionary_destroy(snapshot);
+		handle_disconnection(client_fd);
+	}
+	bool already_stored() {
+		int cola = cluster_queue_of(protocol);
+		if (snapshot == NULL || message == NULL || cola < 0)
+			return false;
+		uint32_t message_id = get_message_id(protocol, message);
+		char* key = string_from_format("%d:%u", cola, message_id);
+		int veces = (intptr_t) dictionary_get(snapshot, key) + 1;
+		dictionary_put(snapshot, key, (void*) (intptr_t) veces);
+		free(key);
+		return veces <= broker_log_count(cola, message_id);
+	}
+	// En la copia del estado el HANDSHAKE antes de un LOCALIZED/CAUGHT es su
+	// dueño
+	void route_reply(t_cola pedido, uint32_t reply_id) {
+		if (replica_stream && requester != NULL) {
+			broker_log_route(pedido, reply_id, requester->ip,
+					requester->puerto);
+			free_requester();
+		}
+	}
 	while (true) {
-		received_bytes = recv(client_fd, &protocol, sizeof(int), 0);
-
-		if (received_bytes <= 0) {
+		if (utils_receive_message(reader, &protocol, &message) <= 0) {
 			// broker_logger_error("Se perdio la conexion");
-			handle_disconnection(client_fd);
+			close_connection();
+			return NULL;
+		}
+		if (message != NULL && !check_queue_range(protocol, message)) {
+			utils_message_destroy(protocol, message);
+			continue;
+		}
+		// Cortar la conexion hace fallar enseguida los GET/CATCH del cliente
+		// en lugar de dejarlos esperando un MESSAGE_ID
+		if (!replica_stream && message != NULL
+				&& !check_queue_owner(protocol, message)) {
+			utils_message_destroy(protocol, message);
+			close_connection();
 			return NULL;
 		}
+		if (already_stored()) {
+			utils_message_destroy(protocol, message);
+			free_requester();
+			continue;
+		}
 		switch (protocol) {
 
+		case REPLICA: {
+			t_handshake* primary = message;
+			if (!replica_stream) {
+				broker_logger_info("Copiando el estado del broker primario %s:%d",
+						primary->ip, primary->puerto);
+				replica_stream = true;
+				snapshot = dictionary_create();
+			} else if (snapshot != NULL) {
+				broker_logger_info("Recibiendo el log del broker primario %s:%d",
+						primary->ip, primary->puerto);
+				dictionary_destroy(snapshot);
+				snapshot = NULL;
+			}
+			free(primary->ip);
+			free(primary);
+			break;
+		}
+
+		case HANDSHAKE: {
+			if (message != NULL) {
+				if (requester != NULL) {
+					free(requester->ip);
+					free(requester);
+				}
+				requester = message;
+			}
+			break;
+		}
+
 		case ACK: {
-			pthread_mutex_lock(&msubs);
-			t_ack* ack_rcv = utils_receive_and_deserialize(client_fd, protocol);
+			t_ack* ack_rcv = message;
 			broker_logger_info(
 					"Received ACK for msg with ID %d Protocol %s from process %s",
 					ack_rcv->id_corr_msg, get_protocol_name(ack_rcv->queue),
 					ack_rcv->sender_name);
 			if (ack_rcv->id_corr_msg == 0) {
+				utils_message_destroy(protocol, ack_rcv);
 				break;
 			}
-			_Bool node_matches_received_queue(t_subscribe_message_node* node) {
-				return node->id == ack_rcv->id_corr_msg
-						&& node->cola == ack_rcv->queue;
-			}
-
-			_Bool subscriber_listed_for_ack(t_subscribe_ack_node* n) {
-				return string_equals_ignore_case(n->subscribe->ip, ack_rcv->ip)
-						&& n->subscribe->puerto == ack_rcv->port;
+			broker_trace_record(TRACE_ACK, ack_rcv->queue, ack_rcv->id_corr_msg,
+					0);
+			// Dentro de msave, asi el ACK queda en la copia del estado para la
+			// replica o se le envia despues de ella
+			t_list* deliveries = list_create();
+			pthread_mutex_lock(&msave);
+			broker_log_ack(ack_rcv->queue, ack_rcv->id_corr_msg, ack_rcv->ip,
+					ack_rcv->port);
+			broker_replica_ship(ACK, ack_rcv);
+
+			// Libero un lugar en vuelo: si habia mensajes esperando salen ya
+			t_subscribe_nodo* sub = check_already_subscribed(ack_rcv->ip,
+					ack_rcv->port, get_queue_list(ack_rcv->queue));
+			if (sub != NULL) {
+				send_due_messages(sub, ack_rcv->queue, deliveries);
 			}
-
-			t_subscribe_message_node* node_ack = list_find(list_msg_subscribers,
-					(void*) node_matches_received_queue);
-
-			/* broker_logger_warn("ID %d Cola: %s", node_ack->id,
-			 get_queue_name(node_ack->cola));
-			 */
-			t_subscribe_ack_node* node_subscriber = list_find(node_ack->list,
-					(void*) subscriber_listed_for_ack);
-			node_subscriber->ack = true;
-			pthread_mutex_unlock(&msubs);
+			pthread_mutex_unlock(&msave);
+			broker_delivery_send(deliveries);
+			utils_message_destroy(protocol, ack_rcv);
 
 			usleep(50000);
 			break;
@@ -376,9 +334,11 @@ static void *handle_connection(void *arg) {
 		case NEW_POKEMON: {
 
 			broker_logger_info("NEW RECEIVED");
-			t_new_pokemon *new_receive = utils_receive_and_deserialize(
-					client_fd, protocol);
-			new_receive->id_correlacional = generar_id();
+			t_new_pokemon *new_receive = message;
+			if (replica_stream)
+				avanzar_id(new_receive->id_correlacional);
+			else
+				new_receive->id_correlacional = generar_id();
 			/* broker_logger_info("ID Correlacional: %d",
 			 new_receive->id_correlacional);
 			 broker_logger_info("Cantidad: %d", new_receive->cantidad);
@@ -389,36 +349,31 @@ static void *handle_connection(void *arg) {
 			 broker_logger_info("Posicion Y: %d", new_receive->pos_y);
 			 */
 			usleep(100000);
-			t_message_to_void *message_void = convert_to_void(protocol,
-					new_receive);
 			pthread_mutex_lock(&msave);
-			int from = 0;
-			if (is_buddy()) {
-				from = save_on_memory(message_void);
-				save_node_list_memory(from, message_void->size_message,
-						NEW_QUEUE, new_receive->id_correlacional);
-			} else {
-				from = save_on_memory_pd(message_void, NEW_QUEUE,
-						new_receive->id_correlacional);
+			uint32_t seq;
+			t_new_pokemon* new_snd = store_message(protocol,
+					new_receive, NEW_QUEUE, new_receive->id_correlacional,
+					new_receive->nombre_pokemon, &seq);
+			if (new_snd == NULL) {
+				pthread_mutex_unlock(&msave);
+				broker_codec_free(protocol, new_receive);
+				break;
 			}
-
-			broker_logger_info("STARTING POSITION FOR NEW_POKEMON: %d", from);
-			t_new_pokemon* new_snd = get_from_memory(protocol, from, memory);
 			new_snd->id_correlacional = new_receive->id_correlacional;
-			create_message_ack(new_snd->id_correlacional, new_queue, NEW_QUEUE);
+			broker_replica_ship(protocol, new_snd);
 
 			// To GC
 			new_protocol = NEW_POKEMON;
 			broker_logger_info("NEW SENT");
 
-			for (int i = 0; i < list_size(new_queue); i++) {
-				t_subscribe_nodo* node = list_get(new_queue, i);
-				if (node->f_desc > 0) {
-					utils_serialize_and_send(node->f_desc, new_protocol,
-							new_snd);
-				}
-			}
+			t_list* deliveries = list_create();
+			send_to_subscribers(new_queue, NEW_QUEUE, deliveries, seq,
+					new_snd->id_correlacional, new_snd->nombre_pokemon, new_protocol,
+					new_snd);
 			pthread_mutex_unlock(&msave);
+			broker_delivery_send(deliveries);
+			broker_codec_free(protocol, new_snd);
+			broker_codec_free(protocol, new_receive);
 			usleep(50000);
 			break;
 		}
@@ -427,8 +382,7 @@ static void *handle_connection(void *arg) {
 		case APPEARED_POKEMON: {
 
 			broker_logger_info("APPEARED RECEIVED");
-			t_appeared_pokemon *appeared_rcv = utils_receive_and_deserialize(
-					client_fd, protocol);
+			t_appeared_pokemon *appeared_rcv = message;
 			/* broker_logger_info("ID correlacional: %d",
 			 appeared_rcv->id_correlacional);
 			 broker_logger_info("Nombre Pokemon: %s",
@@ -438,42 +392,32 @@ static void *handle_connection(void *arg) {
 			 broker_logger_info("Posicion X: %d", appeared_rcv->pos_x);
 			 broker_logger_info("Posicion Y: %d", appeared_rcv->pos_y);
 			 */
-			t_message_to_void *message_void = convert_to_void(protocol,
-					appeared_rcv);
 			pthread_mutex_lock(&msave);
-			int from = 0;
-			if (is_buddy()) {
-				from = save_on_memory(message_void);
-				save_node_list_memory(from, message_void->size_message,
-						APPEARED_QUEUE, appeared_rcv->id_correlacional);
-			} else {
-				from = save_on_memory_pd(message_void, APPEARED_QUEUE,
-						appeared_rcv->id_correlacional);
+			uint32_t seq;
+			t_appeared_pokemon* appeared_snd = store_message(protocol,
+					appeared_rcv, APPEARED_QUEUE, appeared_rcv->id_correlacional,
+					appeared_rcv->nombre_pokemon, &seq);
+			if (appeared_snd == NULL) {
+				pthread_mutex_unlock(&msave);
+				broker_codec_free(protocol, appeared_rcv);
+				break;
 			}
 
-			broker_logger_info("STARTING POSITION FOR APPEARED_POKEMON: %d", from);
-			t_appeared_pokemon* appeared_snd = get_from_memory(protocol, from,
-					memory);
-			create_message_ack(appeared_rcv->id_correlacional, appeared_queue,
-					APPEARED_QUEUE);
-
 			appeared_snd->id_correlacional = appeared_rcv->id_correlacional;
+			broker_replica_ship(protocol, appeared_snd);
 
 			// To Team
 			appeared_protocol = APPEARED_POKEMON;
 			broker_logger_info("APPEARED SENT");
 
-			create_message_ack(appeared_rcv->id_correlacional, appeared_queue,
-					APPEARED_QUEUE);
-
-			for (int i = 0; i < list_size(appeared_queue); i++) {
-				t_subscribe_nodo* node = list_get(appeared_queue, i);
-				if (node->f_desc > 0) {
-					utils_serialize_and_send(node->f_desc, appeared_protocol,
-							appeared_snd);
-				}
-			}
+			t_list* deliveries = list_create();
+			send_to_subscribers(appeared_queue, APPEARED_QUEUE, deliveries, seq,
+					appeared_snd->id_correlacional, appeared_snd->nombre_pokemon,
+					appeared_protocol, appeared_snd);
 			pthread_mutex_unlock(&msave);
+			broker_delivery_send(deliveries);
+			broker_codec_free(protocol, appeared_snd);
+			broker_codec_free(protocol, appeared_rcv);
 			usleep(500000);
 			break;
 		}
@@ -481,8 +425,7 @@ static void *handle_connection(void *arg) {
 			// From team
 		case GET_POKEMON: {
 			broker_logger_info("GET RECEIVED");
-			t_get_pokemon *get_rcv = utils_receive_and_deserialize(client_fd,
-					protocol);
+			t_get_pokemon *get_rcv = message;
 			/*
 			 broker_logger_info("Nombre Pokemon: %s", get_rcv->nombre_pokemon);
 			 broker_logger_info("Largo nombre: %d", get_rcv->tamanio_nombre);
@@ -490,41 +433,58 @@ static void *handle_connection(void *arg) {
 			 broker_logger_info("ID correlacional: %d",
 			 get_rcv->id_correlacional);
 			 */
-			get_rcv->id_correlacional = generar_id();
+			t_message_id get_id;
+			get_id.request_id = get_rcv->id_correlacional;
+			if (replica_stream)
+				avanzar_id(get_rcv->id_correlacional);
+			else
+				get_rcv->id_correlacional = generar_id();
+			get_id.id = get_rcv->id_correlacional;
+			if (requester != NULL) {
+				broker_log_route(GET_QUEUE, get_id.id, requester->ip,
+						requester->puerto);
+			}
 			usleep(50000);
 
-			t_message_to_void *message_void = convert_to_void(protocol,
-					get_rcv);
 			pthread_mutex_lock(&msave);
-			int from = 0;
-			if (is_buddy()) {
-				from = save_on_memory(message_void);
-				save_node_list_memory(from, message_void->size_message,
-						GET_QUEUE, get_rcv->id_correlacional);
-			} else {
-				from = save_on_memory_pd(message_void, GET_QUEUE,
-						get_rcv->id_correlacional);
+			uint32_t seq;
+			t_get_pokemon* get_snd = store_message(protocol,
+					get_rcv, GET_QUEUE, get_rcv->id_correlacional,
+					get_rcv->nombre_pokemon, &seq);
+			if (get_snd == NULL) {
+				pthread_mutex_unlock(&msave);
+				broker_codec_free(protocol, get_rcv);
+				break;
 			}
-			broker_logger_info("STARTING POSITION FOR GET_POKEMON: %d", from);
-			t_get_pokemon* get_snd = get_from_memory(protocol, from, memory);
 			get_snd->id_correlacional = get_rcv->id_correlacional;
 
-			send(client_fd, &get_rcv->id_correlacional, sizeof(uint32_t), 0);
-
-			create_message_ack(get_rcv->id_correlacional, get_queue, GET_QUEUE);
+			// Sale despues de soltar msave, antes que los envios a suscriptores
+			t_list* deliveries = list_create();
+			if (!replica_stream)
+				broker_delivery_add(deliveries, client_fd, MESSAGE_ID, &get_id);
+
+			// Dentro de msave, asi nada se mete entre el HANDSHAKE y el GET
+			if (requester != NULL)
+				broker_replica_ship(HANDSHAKE, requester);
+			broker_replica_ship(protocol, get_snd);
+			// En el log el HANDSHAKE vale solo para el GET/CATCH que le sigue
+			if (replica_stream && requester != NULL) {
+				free(requester->ip);
+				free(requester);
+				requester = NULL;
+			}
 
 			// To GC
 			get_protocol = GET_POKEMON;
 			broker_logger_info("GET SENT");
 
-			for (int i = 0; i < list_size(get_queue); i++) {
-				t_subscribe_nodo* node = list_get(get_queue, i);
-				if (node->f_desc > 0) {
-					utils_serialize_and_send(node->f_desc, get_protocol,
-							get_snd);
-				}
-			}
+			send_to_subscribers(get_queue, GET_QUEUE, deliveries, seq,
+					get_snd->id_correlacional, get_snd->nombre_pokemon, get_protocol,
+					get_snd);
 			pthread_mutex_unlock(&msave);
+			broker_delivery_send(deliveries);
+			broker_codec_free(protocol, get_snd);
+			broker_codec_free(protocol, get_rcv);
 			usleep(500000);
 			break;
 		}
@@ -532,8 +492,7 @@ static void *handle_connection(void *arg) {
 			// From team
 		case CATCH_POKEMON: {
 			broker_logger_info("CATCH RECEIVED");
-			t_catch_pokemon *catch_rcv = utils_receive_and_deserialize(
-					client_fd, protocol);
+			t_catch_pokemon *catch_rcv = message;
 			/*
 			 broker_logger_info("Nombre Pokemon: %s", catch_rcv->nombre_pokemon);
 			 broker_logger_info("Largo nombre: %d", catch_rcv->tamanio_nombre);
@@ -543,44 +502,57 @@ static void *handle_connection(void *arg) {
 			 broker_logger_info("ID correlacional: %d",
 			 catch_rcv->id_correlacional);
 			 */
-			catch_rcv->id_correlacional = generar_id();
+			t_message_id catch_id;
+			catch_id.request_id = catch_rcv->id_correlacional;
+			if (replica_stream)
+				avanzar_id(catch_rcv->id_correlacional);
+			else
+				catch_rcv->id_correlacional = generar_id();
+			catch_id.id = catch_rcv->id_correlacional;
+			if (requester != NULL) {
+				broker_log_route(CATCH_QUEUE, catch_id.id, requester->ip,
+						requester->puerto);
+			}
 
 			usleep(50000);
 
-			t_message_to_void *message_void = convert_to_void(protocol,
-					catch_rcv);
 			pthread_mutex_lock(&msave);
-			int from = 0;
-			if (is_buddy()) {
-				from = save_on_memory(message_void);
-				save_node_list_memory(from, message_void->size_message,
-						CATCH_QUEUE, catch_rcv->id_correlacional);
-			} else {
-				from = save_on_memory_pd(message_void, CATCH_QUEUE,
-						catch_rcv->id_correlacional);
+			uint32_t seq;
+			t_catch_pokemon* catch_send = store_message(protocol,
+					catch_rcv, CATCH_QUEUE, catch_rcv->id_correlacional,
+					catch_rcv->nombre_pokemon, &seq);
+			if (catch_send == NULL) {
+				pthread_mutex_unlock(&msave);
+				broker_codec_free(protocol, catch_rcv);
+				break;
 			}
-			broker_logger_info("STARTING POSITION FOR CATCH_POKEMON: %d", from);
-			t_catch_pokemon* catch_send = get_from_memory(protocol, from,
-					memory);
 			catch_send->id_correlacional = catch_rcv->id_correlacional;
 
-			send(client_fd, &catch_rcv->id_correlacional, sizeof(uint32_t), 0);
-
-			create_message_ack(catch_rcv->id_correlacional, catch_queue,
-					CATCH_QUEUE);
+			// Sale despues de soltar msave, antes que los envios a suscriptores
+			t_list* deliveries = list_create();
+			if (!replica_stream)
+				broker_delivery_add(deliveries, client_fd, MESSAGE_ID, &catch_id);
+
+			if (requester != NULL)
+				broker_replica_ship(HANDSHAKE, requester);
+			broker_replica_ship(protocol, catch_send);
+			if (replica_stream && requester != NULL) {
+				free(requester->ip);
+				free(requester);
+				requester = NULL;
+			}
 
 			// To GC
 			catch_protocol = CATCH_POKEMON;
 			broker_logger_info("CATCH SENT");
 
-			for (int i = 0; i < list_size(catch_queue); i++) {
-				t_subscribe_nodo* node = list_get(catch_queue, i);
-				if (node->f_desc > 0) {
-					utils_serialize_and_send(node->f_desc, catch_protocol,
-							catch_send);
-				}
-			}
+			send_to_subscribers(catch_queue, CATCH_QUEUE, deliveries, seq,
+					catch_send->id_correlacional, catch_send->nombre_pokemon,
+					catch_protocol, catch_send);
 			pthread_mutex_unlock(&msave);
+			broker_delivery_send(deliveries);
+			broker_codec_free(protocol, catch_send);
+			broker_codec_free(protocol, catch_rcv);
 			usleep(500000);
 			break;
 		}
@@ -588,8 +560,8 @@ static void *handle_connection(void *arg) {
 			// From GC
 		case LOCALIZED_POKEMON: {
 			broker_logger_info("LOCALIZED RECEIVED");
-			t_localized_pokemon *loc_rcv = utils_receive_and_deserialize(
-					client_fd, protocol);
+			t_localized_pokemon *loc_rcv = message;
+			route_reply(GET_QUEUE, loc_rcv->id_correlacional);
 			/*
 			 broker_logger_info("ID correlacional: %d",
 			 loc_rcv->id_correlacional);
@@ -607,42 +579,32 @@ static void *handle_connection(void *arg) {
 			 }
 			 */
 
-			t_message_to_void *message_void = convert_to_void(protocol,
-					loc_rcv);
 			pthread_mutex_lock(&msave);
-			int from = 0;
-			if (is_buddy()) {
-				from = save_on_memory(message_void);
-				save_node_list_memory(from, message_void->size_message,
-						LOCALIZED_QUEUE, loc_rcv->id_correlacional);
-			} else {
-				from = save_on_memory_pd(message_void, LOCALIZED_QUEUE,
-						loc_rcv->id_correlacional);
+			uint32_t seq;
+			t_localized_pokemon* loc_snd = store_message(protocol,
+					loc_rcv, LOCALIZED_QUEUE, loc_rcv->id_correlacional,
+					loc_rcv->nombre_pokemon, &seq);
+			if (loc_snd == NULL) {
+				pthread_mutex_unlock(&msave);
+				broker_codec_free(protocol, loc_rcv);
+				break;
 			}
 
-			broker_logger_info("STARTING POSITION FOR LOCALIZED_POKEMON: %d", from);
-
-			t_localized_pokemon* loc_snd = get_from_memory(protocol, from,
-					memory);
-
-			create_message_ack(loc_rcv->id_correlacional, localized_queue,
-					LOCALIZED_QUEUE);
-
 			loc_snd->id_correlacional = loc_rcv->id_correlacional;
+			broker_replica_ship(protocol, loc_snd);
 
 			// To team
 			localized_protocol = LOCALIZED_POKEMON;
 			broker_logger_info("LOCALIZED SENT");
-			loc_snd->posiciones = loc_rcv->posiciones;
 
-			for (int i = 0; i < list_size(localized_queue); i++) {
-				t_subscribe_nodo* node = list_get(localized_queue, i);
-				if (node->f_desc > 0) {
-					utils_serialize_and_send(node->f_desc, localized_protocol,
-							loc_snd);
-				}
-			}
+			t_list* deliveries = list_create();
+			send_to_subscribers(localized_queue, LOCALIZED_QUEUE, deliveries, seq,
+					loc_snd->id_correlacional, loc_snd->nombre_pokemon,
+					localized_protocol, loc_snd);
 			pthread_mutex_unlock(&msave);
+			broker_delivery_send(deliveries);
+			broker_codec_free(protocol, loc_snd);
+			broker_codec_free(protocol, loc_rcv);
 			usleep(50000);
 			break;
 		}
@@ -650,12 +612,24 @@ static void *handle_connection(void *arg) {
 			// From Team or GC
 		case SUBSCRIBE: {
 			broker_logger_info("SUBSCRIBE RECEIVED");
-			t_subscribe *sub_rcv = utils_receive_and_deserialize(client_fd,
-					protocol);
+			t_subscribe *sub_rcv = message;
+			broker_trace_record(TRACE_SUSCRIPCION, sub_rcv->cola,
+					sub_rcv->puerto, 0);
+			t_list* deliveries = list_create();
 			pthread_mutex_lock(&msave);
-			sub_rcv->f_desc = client_fd;
-			search_queue(sub_rcv);
+			if (replica_stream) {
+				// Solo el cursor: el suscriptor esta conectado al primario
+				broker_log_subscribe(sub_rcv->cola, sub_rcv->ip,
+						sub_rcv->puerto, sub_rcv->especies);
+			} else {
+				broker_replica_ship(protocol, sub_rcv);
+				sub_rcv->f_desc = client_fd;
+				search_queue(sub_rcv, deliveries);
+			}
 			pthread_mutex_unlock(&msave);
+			broker_delivery_send(deliveries);
+			// Los suscriptores y el cursor se quedan con copias
+			utils_message_destroy(protocol, sub_rcv);
 			usleep(50000);
 			break;
 		}
@@ -663,46 +637,38 @@ static void *handle_connection(void *arg) {
 			// From GC or GB
 		case CAUGHT_POKEMON: {
 			broker_logger_info("CAUGHT RECEIVED");
-			t_caught_pokemon *caught_rcv = utils_receive_and_deserialize(
-					client_fd, protocol);
+			t_caught_pokemon *caught_rcv = message;
+			route_reply(CATCH_QUEUE, caught_rcv->id_correlacional);
 			/* broker_logger_info("ID correlacional: %d",
 			 caught_rcv->id_correlacional);
 			 broker_logger_info("Resultado (0/1): %d", caught_rcv->result);
 			 */
 			usleep(50000);
-			t_message_to_void *message_void = convert_to_void(protocol,
-					caught_rcv);
 			pthread_mutex_lock(&msave);
-			int from = 0;
-			if (is_buddy()) {
-				from = save_on_memory(message_void);
-				save_node_list_memory(from, message_void->size_message,
-						CAUGHT_QUEUE, caught_rcv->id_correlacional);
-			} else {
-				from = save_on_memory_pd(message_void, CAUGHT_QUEUE,
-						caught_rcv->id_correlacional);
+			uint32_t seq;
+			t_caught_pokemon* caught_snd = store_message(protocol,
+					caught_rcv, CAUGHT_QUEUE, caught_rcv->id_correlacional,
+					NULL, &seq);
+			if (caught_snd == NULL) {
+				pthread_mutex_unlock(&msave);
+				broker_codec_free(protocol, caught_rcv);
+				break;
 			}
-			broker_logger_info("STARTING POSITION FOR CAUGHT_POKEMON: %d", from);
-
-			t_caught_pokemon* caught_snd = get_from_memory(protocol, from,
-					memory);
-			create_message_ack(caught_rcv->id_correlacional, caught_queue,
-					CAUGHT_QUEUE);
 
 			caught_snd->id_correlacional = caught_rcv->id_correlacional;
+			broker_replica_ship(protocol, caught_snd);
 
 			// To Team
 			caught_protocol = CAUGHT_POKEMON;
 			broker_logger_info("CAUGHT SENT");
 
-			for (int i = 0; i < list_size(caught_queue); i++) {
-				t_subscribe_nodo* node = list_get(caught_queue, i);
-				if (node->f_desc > 0) {
-					utils_serialize_and_send(node->f_desc, caught_protocol,
-							caught_snd);
-				}
-			}
+			t_list* deliveries = list_create();
+			send_to_subscribers(caught_queue, CAUGHT_QUEUE, deliveries, seq,
+					caught_snd->id_correlacional, NULL, caught_protocol, caught_snd);
 			pthread_mutex_unlock(&msave);
+			broker_delivery_send(deliveries);
+			broker_codec_free(protocol, caught_snd);
+			broker_codec_free(protocol, caught_rcv);
 			usleep(50000);
 			break;
 		}
@@ -711,6 +677,7 @@ static void *handle_connection(void *arg) {
 			break;
 		}
 	}
+	framing_reader_destroy(reader);
 	socket_close_conection(client_fd);
 }
 
@@ -722,8 +689,6 @@ void initialize_queue() {
 	caught_queue = list_create();
 	catch_queue = list_create();
 	localized_queue = list_create();
-	list_memory = list_create();
-	list_msg_subscribers = list_create();
 }
 
 t_subscribe_nodo* check_already_subscribed(char *ip, uint32_t puerto,
@@ -746,9 +711,14 @@ void remove_after_n_secs(t_subscribe_nodo* sub, t_list* q, int n) {
 
 			t_empty* noop = malloc(sizeof(t_empty));
 			t_protocol noop_protocol = NOOP;
-			utils_serialize_and_send(sub->f_desc, noop_protocol, noop);
-			free(noop);
+			t_list* deliveries = list_create();
+			pthread_mutex_lock(&msave);
+			if (sub->f_desc > 0)
+				broker_delivery_add(deliveries, sub->f_desc, noop_protocol, noop);
 			list_remove_by_condition(q, (void*) is_gb_subscriber);
+			pthread_mutex_unlock(&msave);
+			broker_delivery_send(deliveries);
+			free(noop);
 			broker_logger_info("Game boy subscription timed out");
 			return;
 		}
@@ -756,33 +726,22 @@ void remove_after_n_secs(t_subscribe_nodo* sub, t_list* q, int n) {
 	}
 }
 
-void add_to(t_list *list, t_subscribe* subscriber) {
-	void add_sub_to_msg(t_subscribe_nodo* sub_node) {
-		for (int k = 0; k < list_size(list_msg_subscribers); k++) {
-			t_subscribe_message_node* node_m = list_get(list_msg_subscribers,
-					k);
-			for (int t = 0; t < list_size(node_m->list); t++) {
-				t_subscribe_ack_node *node_ack = list_get(node_m->list, t);
-				if (string_equals_ignore_case(node_ack->subscribe->ip,
-						subscriber->ip)
-						&& node_ack->subscribe->puerto == subscriber->puerto) {
-					return;
-				}
-			}
-		}
-		for (int i = 0; i < list_size(list_msg_subscribers); ++i) {
-			t_subscribe_message_node* node = list_get(list_msg_subscribers, i);
-
-			t_subscribe_ack_node* ack_node = malloc(
-					sizeof(t_subscribe_ack_node));
-			ack_node->ack = false;
-			ack_node->subscribe = sub_node;
+typedef struct {
+	t_subscribe_nodo* nodo;
+	t_list* list;
+	int seconds;
+} t_removal_args;
+
+// El hilo no puede usar nada de quien lo crea: el SUBSCRIBE se libera al
+// volver
+static void* broker_handle_removal(void* arg) {
+	t_removal_args* args = arg;
+	remove_after_n_secs(args->nodo, args->list, args->seconds);
+	free(args);
+	return NULL;
+}
 
-			if (node->cola == subscriber->cola) {
-				list_add(node->list, ack_node);
-			}
-		}
-	}
+void add_to(t_list *list, t_subscribe* subscriber) {
 	t_subscribe_nodo* node = check_already_subscribed(subscriber->ip,
 			subscriber->puerto, list);
 	if (node == NULL) {
@@ -791,10 +750,6 @@ void add_to(t_list *list, t_subscribe* subscriber) {
 
 		nodo->puerto = subscriber->puerto;
 
-		void broker_handle_removal() {
-			remove_after_n_secs(nodo, list, subscriber->seconds);
-		}
-
 		if (subscriber->proceso == GAME_BOY) {
 			nodo->endtime = time(NULL) + subscriber->seconds;
 		} else {
@@ -803,13 +758,14 @@ void add_to(t_list *list, t_subscribe* subscriber) {
 
 		nodo->f_desc = subscriber->f_desc;
 		list_add(list, nodo);
-		pthread_mutex_lock(&msubs);
-		add_sub_to_msg(nodo);
-		pthread_mutex_unlock(&msubs);
 
 		if (nodo->endtime != -1) {
+			t_removal_args* args = malloc(sizeof(t_removal_args));
+			args->nodo = nodo;
+			args->list = list;
+			args->seconds = subscriber->seconds;
 			pthread_t sub_tid;
-			pthread_create(&sub_tid, NULL, (void*) broker_handle_removal, NULL);
+			pthread_create(&sub_tid, NULL, broker_handle_removal, args);
 			pthread_detach(sub_tid);
 			usleep(100000);
 		}
@@ -817,9 +773,11 @@ void add_to(t_list *list, t_subscribe* subscriber) {
 		broker_logger_info("Process already subscribed");
 		node->f_desc = subscriber->f_desc;
 	}
+	broker_log_subscribe(subscriber->cola, subscriber->ip, subscriber->puerto,
+			subscriber->especies);
 }
 
-void search_queue(t_subscribe *subscriber) {
+void search_queue(t_subscribe *subscriber, t_list* deliveries) {
 
 	switch (subscriber->cola) {
 	case NEW_QUEUE: {
@@ -828,7 +786,7 @@ void search_queue(t_subscribe *subscriber) {
 				subscriber->ip, subscriber->puerto);
 		pthread_mutex_lock(&mnew);
 		add_to(new_queue, subscriber);
-		send_all_messages(subscriber);
+		send_all_messages(subscriber, deliveries);
 		pthread_mutex_unlock(&mnew);
 		break;
 	}
@@ -838,7 +796,7 @@ void search_queue(t_subscribe *subscriber) {
 				subscriber->ip, subscriber->puerto);
 		pthread_mutex_lock(&mcatch);
 		add_to(catch_queue, subscriber);
-		send_all_messages(subscriber);
+		send_all_messages(subscriber, deliveries);
 		pthread_mutex_unlock(&mcatch);
 		break;
 	}
@@ -848,7 +806,7 @@ void search_queue(t_subscribe *subscriber) {
 				subscriber->ip, subscriber->puerto);
 		pthread_mutex_lock(&mcaught);
 		add_to(caught_queue, subscriber);
-		send_all_messages(subscriber);
+		send_all_messages(subscriber, deliveries);
 		pthread_mutex_unlock(&mcaught);
 		break;
 	}
@@ -858,7 +816,7 @@ void search_queue(t_subscribe *subscriber) {
 				subscriber->ip, subscriber->puerto);
 		pthread_mutex_lock(&mget);
 		add_to(get_queue, subscriber);
-		send_all_messages(subscriber);
+		send_all_messages(subscriber, deliveries);
 		pthread_mutex_unlock(&mget);
 		break;
 	}
@@ -868,7 +826,7 @@ void search_queue(t_subscribe *subscriber) {
 				subscriber->ip, subscriber->puerto);
 		pthread_mutex_lock(&mloc);
 		add_to(localized_queue, subscriber);
-		send_all_messages(subscriber);
+		send_all_messages(subscriber, deliveries);
 		pthread_mutex_unlock(&mloc);
 		break;
 	}
@@ -878,7 +836,7 @@ void search_queue(t_subscribe *subscriber) {
 				subscriber->ip, subscriber->puerto);
 		pthread_mutex_lock(&mappeared);
 		add_to(appeared_queue, subscriber);
-		send_all_messages(subscriber);
+		send_all_messages(subscriber, deliveries);
 		pthread_mutex_unlock(&mappeared);
 		break;
 	}
@@ -889,383 +847,93 @@ void search_queue(t_subscribe *subscriber) {
 
 void broker_exit() {
 	socket_close_conection(broker_socket);
+	broker_replica_destroy();
+	broker_codec_destroy();
+	broker_delivery_destroy();
+	broker_log_destroy();
+	broker_trace_destroy();
+	allocator_destroy(allocator);
 	broker_config_free();
 	broker_logger_destroy();
 }
 
 t_message_to_void *convert_to_void(t_protocol protocol, void *package_recv) {
-
-	uint32_t offset = 0;
+	// broker_logger_info("CONVERTING TO VOID*..");
 	t_message_to_void* message_to_void = malloc(sizeof(t_message_to_void));
-	message_to_void->size_message = 0;
-	switch (protocol) {
-	case NOOP: {
-		break;
-	}
-	case ACK: {
-		break;
-	}
-	case SUBSCRIBE: {
-		break;
-	}
-	case HANDSHAKE: {
-		break;
-	}
-	case NEW_POKEMON: {
-		// broker_logger_info("NEW RECEIVED, CONVERTING to VOID*..");
-		t_new_pokemon *new_receive = (t_new_pokemon*) package_recv;
-		message_to_void->message = malloc(
-				new_receive->tamanio_nombre + (sizeof(uint32_t) * 4));
-		memcpy(message_to_void->message + offset, &new_receive->tamanio_nombre,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(message_to_void->message + offset, new_receive->nombre_pokemon,
-				new_receive->tamanio_nombre);
-		offset += new_receive->tamanio_nombre;
-		memcpy(message_to_void->message + offset, &new_receive->pos_x,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(message_to_void->message + offset, &new_receive->pos_y,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(message_to_void->message + offset, &new_receive->cantidad,
-				sizeof(uint32_t));
-		message_to_void->size_message = new_receive->tamanio_nombre
-				+ (sizeof(uint32_t) * 4);
-
-		break;
-	}
-
-		// From GB or GC
-	case APPEARED_POKEMON: {
-		// broker_logger_info("APPEARED RECEIVED, CONVERTING TO VOID*..");
-
-		t_appeared_pokemon *appeared_rcv = (t_appeared_pokemon*) package_recv;
-		message_to_void->message = malloc(
-				appeared_rcv->tamanio_nombre + sizeof(uint32_t) * 3);
-
-		memcpy(message_to_void->message + offset, &appeared_rcv->tamanio_nombre,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(message_to_void->message + offset, appeared_rcv->nombre_pokemon,
-				appeared_rcv->tamanio_nombre);
-		offset += appeared_rcv->tamanio_nombre;
-		memcpy(message_to_void->message + offset, &appeared_rcv->pos_x,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(message_to_void->message + offset, &appeared_rcv->pos_y,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-
-		message_to_void->size_message = appeared_rcv->tamanio_nombre
-				+ sizeof(uint32_t) * 3;
-		break;
-	}
-		// From team
-	case GET_POKEMON: {
-		// broker_logger_info("GET RECEIVED, CONVERTING TO VOID*..");
-		t_get_pokemon *get_rcv = (t_get_pokemon*) package_recv;
-		message_to_void->message = malloc(
-				get_rcv->tamanio_nombre + sizeof(uint32_t));
-
-		memcpy(message_to_void->message + offset, &get_rcv->tamanio_nombre,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(message_to_void->message + offset, get_rcv->nombre_pokemon,
-				get_rcv->tamanio_nombre);
-		message_to_void->size_message = get_rcv->tamanio_nombre
-				+ sizeof(uint32_t);
-		break;
-	}
-
-		// From team
-	case CATCH_POKEMON: {
-		// broker_logger_info("CATCH RECEIVED, CONVERTING TO VOID*..");
-		t_catch_pokemon *catch_rcv = (t_catch_pokemon*) package_recv;
-		message_to_void->message = malloc(
-				catch_rcv->tamanio_nombre + sizeof(uint32_t) * 3);
-
-		memcpy(message_to_void->message + offset, &catch_rcv->tamanio_nombre,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(message_to_void->message + offset, catch_rcv->nombre_pokemon,
-				catch_rcv->tamanio_nombre);
-		offset += catch_rcv->tamanio_nombre;
-		memcpy(message_to_void->message + offset, &catch_rcv->pos_x,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(message_to_void->message + offset, &catch_rcv->pos_y,
-				sizeof(uint32_t));
-
-		message_to_void->size_message = catch_rcv->tamanio_nombre
-				+ sizeof(uint32_t) * 3;
-		break;
-	}
-		// From GC
-	case LOCALIZED_POKEMON: {
-		// broker_logger_info("LOCALIZED RECEIVED, CONVERTING TO VOID*..");
-		t_localized_pokemon *loc_rcv = (t_localized_pokemon*) package_recv;
-		message_to_void->message = malloc(
-				loc_rcv->tamanio_nombre + sizeof(uint32_t) + sizeof(uint32_t)
-						+ sizeof(uint32_t) * 2 * loc_rcv->cant_elem);
-
-		memcpy(message_to_void->message + offset, &loc_rcv->tamanio_nombre,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(message_to_void->message + offset, loc_rcv->nombre_pokemon,
-				loc_rcv->tamanio_nombre);
-		offset += loc_rcv->tamanio_nombre;
-		memcpy(message_to_void->message + offset, &loc_rcv->cant_elem,
-				sizeof(uint32_t));
-		for (int i = 0; i < loc_rcv->cant_elem; i++) {
-			offset += sizeof(uint32_t);
-			t_position *pos = list_get(loc_rcv->posiciones, i);
-			memcpy(message_to_void->message + offset, &pos->pos_x,
-					sizeof(uint32_t));
-			offset += sizeof(uint32_t);
-			memcpy(message_to_void->message + offset, &pos->pos_y,
-					sizeof(uint32_t));
-
-		}
-		message_to_void->size_message = loc_rcv->tamanio_nombre
-				+ sizeof(uint32_t) + sizeof(uint32_t)
-				+ sizeof(uint32_t) * 2 * loc_rcv->cant_elem;
-		break;
-	}
-
-	case CAUGHT_POKEMON: {
-		// broker_logger_info("CAUGHT RECEIVED, CONVERTING TO VOID*..");
-		t_caught_pokemon *caught_rcv = (t_caught_pokemon*) package_recv;
-		message_to_void->message = malloc(sizeof(uint32_t));
-
-		memcpy(message_to_void->message + offset, &caught_rcv->result,
-				sizeof(uint32_t));
-		message_to_void->size_message = sizeof(uint32_t);
-		break;
-	}
-
-	}
+	message_to_void->message = broker_codec_encode(protocol, package_recv,
+			&message_to_void->size_message);
 	return message_to_void;
-
 }
 
 void *get_from_memory(t_protocol protocol, int posicion, void *message) {
-
-	int offset = posicion;
-
-	switch (protocol) {
-	case NOOP: {
-		break;
-	}
-	case ACK: {
-		break;
-	}
-	case SUBSCRIBE: {
-		break;
-	}
-	case HANDSHAKE: {
-		break;
-	}
-	case NEW_POKEMON: {
-		// broker_logger_info("GETTING \"NEW\" MESSAGE FROM  MEMORY..");
-		t_new_pokemon *new_receive = malloc(sizeof(t_new_pokemon));
-
-		memcpy(&new_receive->tamanio_nombre, message + offset,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		new_receive->nombre_pokemon = malloc(new_receive->tamanio_nombre);
-		memset(new_receive->nombre_pokemon, 0, new_receive->tamanio_nombre + 1);
-		memcpy(new_receive->nombre_pokemon, message + offset,
-				new_receive->tamanio_nombre);
-		offset += new_receive->tamanio_nombre;
-
-		memcpy(&new_receive->pos_x, message + offset, sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(&new_receive->pos_y, message + offset, sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(&new_receive->cantidad, message + offset, sizeof(uint32_t));
-		/*
-		 broker_logger_info("******************************************");
-		 broker_logger_info("RECEIVED:");
-		 broker_logger_info("Pokemon: %s", new_receive->nombre_pokemon);
-		 broker_logger_info("Name length: %d", new_receive->tamanio_nombre);
-		 broker_logger_info("X Axis position: %d", new_receive->pos_x);
-		 broker_logger_info("Y Axis position: %d", new_receive->pos_y);
-		 broker_logger_info("Quantity: %d", new_receive->cantidad);
-		 */
-		return new_receive;
-
-	}
-
-		// From GB or GC
-	case APPEARED_POKEMON: {
-		// broker_logger_info("GETTING \"APPEARED\" MESSAGE FROM  MEMORY..");
-
-		t_appeared_pokemon *appeared_rcv = malloc(sizeof(t_appeared_pokemon));
-
-		memcpy(&appeared_rcv->tamanio_nombre, message + offset,
-				sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-
-		appeared_rcv->nombre_pokemon = malloc(appeared_rcv->tamanio_nombre);
-		memset(appeared_rcv->nombre_pokemon, 0,
-				appeared_rcv->tamanio_nombre + 1);
-		memcpy(appeared_rcv->nombre_pokemon, message + offset,
-				appeared_rcv->tamanio_nombre);
-
-		offset += appeared_rcv->tamanio_nombre;
-		memcpy(&appeared_rcv->pos_x, message + offset, sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(&appeared_rcv->pos_y, message + offset, sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		/*
-		 broker_logger_info("******************************************");
-		 broker_logger_info("RECEIVED:");
-		 broker_logger_info("Pokemon: %s", appeared_rcv->nombre_pokemon);
-		 broker_logger_info("Name length: %d", appeared_rcv->tamanio_nombre);
-		 broker_logger_info("X Axis position: %d", appeared_rcv->pos_x);
-		 broker_logger_info("Y Axis position: %d", appeared_rcv->pos_y);
-		 */
-		return appeared_rcv;
-	}
-		// From team
-	case GET_POKEMON: {
-		// broker_logger_info("GETING \"GET\" MESSAGE FROM  MEMORY..");
-		t_get_pokemon* get_rcv = malloc(sizeof(t_get_pokemon));
-
-		memcpy(&get_rcv->tamanio_nombre, message + offset, sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		get_rcv->nombre_pokemon = malloc(get_rcv->tamanio_nombre);
-		memset(get_rcv->nombre_pokemon, 0, get_rcv->tamanio_nombre + 1);
-		memcpy(get_rcv->nombre_pokemon, message + offset,
-				get_rcv->tamanio_nombre);
-		/*
-		 broker_logger_info("******************************************");
-		 broker_logger_info("RECEIVED:");
-		 broker_logger_info("Pokemon: %s", get_rcv->nombre_pokemon);
-		 broker_logger_info("Name length: %d", get_rcv->tamanio_nombre);
-		 */
-		return get_rcv;
-	}
-
-		// From team
-	case CATCH_POKEMON: {
-		// broker_logger_info("GETTING \"CATCH\" MESSAGE FROM  MEMORY..");
-		t_catch_pokemon *catch_rcv = malloc(sizeof(t_catch_pokemon));
-		memcpy(&catch_rcv->tamanio_nombre, message + offset, sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		catch_rcv->nombre_pokemon = malloc(catch_rcv->tamanio_nombre);
-		memset(catch_rcv->nombre_pokemon, 0, catch_rcv->tamanio_nombre + 1);
-		memcpy(catch_rcv->nombre_pokemon, message + offset,
-				catch_rcv->tamanio_nombre);
-		offset += catch_rcv->tamanio_nombre;
-		memcpy(&catch_rcv->pos_x, message + offset, sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		memcpy(&catch_rcv->pos_y, message + offset, sizeof(uint32_t));
-		/*
-		 broker_logger_info("******************************************");
-		 broker_logger_info("RECEIVED:");
-		 broker_logger_info("Pokemon: %s", catch_rcv->nombre_pokemon);
-		 broker_logger_info("Name length: %d", catch_rcv->tamanio_nombre);
-		 broker_logger_info("X Position: %d", catch_rcv->pos_x);
-		 broker_logger_info("Y Position: %d", catch_rcv->pos_y);
-		 */
-		return catch_rcv;
-	}
-		// From GC
-	case LOCALIZED_POKEMON: {
-		// broker_logger_info("GETTING \"LOCALIZED\" MESSAGE FROM MEMORY..");
-		t_localized_pokemon *loc_rcv = malloc(sizeof(t_localized_pokemon));
-
-		memcpy(&loc_rcv->tamanio_nombre, message + offset, sizeof(uint32_t));
-		offset += sizeof(uint32_t);
-		loc_rcv->nombre_pokemon = malloc(loc_rcv->tamanio_nombre);
-		memset(loc_rcv->nombre_pokemon, 0, loc_rcv->tamanio_nombre + 1);
-		memcpy(loc_rcv->nombre_pokemon, message + offset,
-				loc_rcv->tamanio_nombre);
-
-		loc_rcv->posiciones = list_create();
-		offset += loc_rcv->tamanio_nombre;
-		memcpy(&loc_rcv->cant_elem, message + offset, sizeof(uint32_t));
-		/*
-		 broker_logger_info("******************************************");
-		 broker_logger_info("RECEIVED:");
-		 broker_logger_info("Pokemon: %s", loc_rcv->nombre_pokemon);
-		 broker_logger_info("Name length: %d", loc_rcv->tamanio_nombre);
-		 broker_logger_info("Quantity: %d", loc_rcv->cant_elem);
-		 */
-		for (int i = 0; i < loc_rcv->cant_elem; i++) {
-			offset += sizeof(uint32_t);
-			t_position* pos = malloc(sizeof(t_position));
-			memcpy(&pos->pos_x, message + offset, sizeof(uint32_t));
-			offset += sizeof(uint32_t);
-			memcpy(&pos->pos_y, message + offset, sizeof(uint32_t));
-			list_add(loc_rcv->posiciones, pos);
-			/*
-			 broker_logger_info("X Axis Position: %d", pos->pos_x);
-			 broker_logger_info("Y Axis Position: %d", pos->pos_y);
-			 */
-		}
-		return loc_rcv;
-	}
-
-	case CAUGHT_POKEMON: {
-		// broker_logger_info("GETTING \"CAUGHT\" MESSAGE FROM MEMORY..");
-		t_caught_pokemon *caught_rcv = malloc(sizeof(t_caught_pokemon));
-		memcpy(&caught_rcv->result, message + offset, sizeof(uint32_t));
-		/*
-		 broker_logger_info("******************************************");
-		 broker_logger_info("RECEIVED:");
-
-		 if (caught_rcv->result) {
-		 broker_logger_info("Result: Caught");
-		 } else {
-		 broker_logger_info("Result: Failed");
-		 }
-		 */
-		return caught_rcv;
-	}
-	}
-	return NULL;
-
-}
-
-_Bool is_buddy() {
-	return broker_config->estrategia_memoria == 0;
+	// broker_logger_info("GETTING MESSAGE FROM MEMORY..");
+	return broker_codec_decode(protocol, message + posicion);
 }
 
-int compare_timings(const void* a, const void* b) {
-	return (((t_nodo_memory*) a)->timestamp > ((t_nodo_memory*) b)->timestamp) ?
-			-1 : 1;
-}
+// Guarda el mensaje en memoria y lo agrega al log. Devuelve la copia leida de
+// memoria; si no entra, una copia armada sin pasar por memoria con seq en 0.
+// Siempre es un mensaje nuevo, a liberar con broker_codec_free. NULL si no se
+// pudo leer de vuelta: el mensaje se descarta
+void* store_message(t_protocol protocol, void* message, t_cola cola,
+		uint32_t id_correlacional, char* especie, uint32_t* seq) {
+	t_message_to_void* message_void = convert_to_void(protocol, message);
+	broker_trace_record(TRACE_ALTA, cola, id_correlacional,
+			message_void->size_message);
+	t_nodo_memory* node = allocator_save(allocator, message_void->message,
+			message_void->size_message, cola, id_correlacional);
 
-int compare_memory_position(const void* a, const void* b) {
-	return (((t_nodo_memory*) a)->pointer > ((t_nodo_memory*) b)->pointer) ?
-			-1 : 1;
+	if (node == NULL) {
+		broker_logger_error(
+				"Data couldn't be stored. Reason: %d B message, bigger than memory",
+				message_void->size_message);
+		void* copy = broker_codec_decode(protocol, message_void->message);
+		free(message_void->message);
+		free(message_void);
+		*seq = 0;
+		return copy;
+	}
+	free(message_void->message);
+	free(message_void);
+
+	broker_logger_info("STARTING POSITION FOR %s_POKEMON: %d",
+			get_protocol_name(cola), node->pointer);
+	void* stored = get_from_memory(protocol, node->pointer, allocator->data);
+	if (stored == NULL) {
+		broker_logger_error("Data couldn't be read back from memory");
+		allocator_free(allocator, node, node->generacion);
+		*seq = 0;
+		return NULL;
+	}
+	*seq = broker_log_append(cola, id_correlacional, node, node->generacion,
+			especie);
+	return stored;
 }
 
-void update_timings(t_nodo_memory* node) {
-	if (broker_config->algoritmo_reemplazo == 1) {
-		time(&node->timestamp);
-	}
-
-	else
-		return;
+// El mensaje reemplazado ya no se puede enviar: sale del log
+void evict_message(t_cola cola, uint32_t id_correlacional,
+		t_nodo_memory* node, void* context) {
+	broker_trace_record(TRACE_BAJA, cola, id_correlacional, 0);
+	broker_log_remove(cola, id_correlacional, node);
 }
 
 void handle_disconnection(int fd) {
 
-	void disable_msg_ack(t_subscribe_ack_node* node) {
-		if (node->subscribe->f_desc == fd) {
-			node->subscribe->f_desc = -1;
+	void disable_subscriber(t_subscribe_nodo* node) {
+		if (node->f_desc == fd) {
+			node->f_desc = -1;
 		}
 	}
-	pthread_mutex_lock(&msubs);
-	for (int i = 0; i < list_size(list_msg_subscribers); ++i) {
-		t_subscribe_message_node* el = list_get(list_msg_subscribers, i);
-		list_map(el->list, (void*) disable_msg_ack);
-	}
-	pthread_mutex_unlock(&msubs);
+	t_list* queues[] = { new_queue, appeared_queue, localized_queue, get_queue,
+			catch_queue, caught_queue };
+	// Los envios se arman leyendo f_desc con msave: despues de esto no se
+	// arman mas para este fd, y se cierra cuando salen los que ya estaban
+	pthread_mutex_lock(&msave);
+	for (int i = 0; i < 6; ++i) {
+		list_iterate(queues[i], (void*) disable_subscriber);
+	}
+	pthread_mutex_unlock(&msave);
+	broker_delivery_close(fd);
+	socket_close_conection(fd);
 }
 
 char* get_protocol_name(t_cola q) {
@@ -1334,881 +1002,271 @@ char* get_queue_name(t_cola q) {
 	return out;
 }
 
-char* get_queue_name_short(t_cola q) {
-
-	char* out = string_duplicate("");
-
-	out = get_queue_name(q);
-
-	return string_substring_until(out, 3);
-}
-
-void purge_msg() {
-	pthread_mutex_lock(&mmem);
-	list_sort(list_memory, (void*) compare_timings);
-
-	/**
-	 * For debugging purposes, will be removed afterwards
-	 * for (int i=0; i< list_memory->elements_count; i++) {
-	 * t_nodo_memory* nd = (t_nodo_memory*)list_get(list_memory, i);
-	 * broker_logger_warn("%.2f", (float) nd->timestamp);
-	 * }
-	 *
-	 **/
-
-	t_nodo_memory* node = (t_nodo_memory*) list_get(list_memory, 0);
-	broker_logger_warn(
-			"The message with ID %d from %s, located at position %d, last modified at instant T=%d will be removed",
-			node->id, get_queue_name(node->cola), node->pointer,
-			(int) (node->timestamp - base_time));
-
-	consolidate(node->pointer);
-	_Bool find_msg(t_subscribe_message_node* n) {
-		return string_equals_ignore_case(get_queue_name(n->cola),
-				get_queue_name(node->cola)) && n->id == node->id;
-	}
-
-	list_remove(list_memory, 0);
-	pthread_mutex_unlock(&mmem);
-	pthread_mutex_lock(&msubs);
-	list_remove_by_condition(list_msg_subscribers, (void*) find_msg);
-	pthread_mutex_unlock(&msubs);
-	buddy_free(buddy, node->pointer);
-	broker_logger_info("Message removed successfully");
-}
-
-int save_on_memory_pd(t_message_to_void *message_void, t_cola cola,
-		int id_correlacional) {
-	pthread_mutex_lock(&mpointer);
-
-	estado_memoria(list_memory);
-
-	int last = list_size(list_memory);
-	t_nodo_memory *last_node = list_get(list_memory, last - 1);
-	pointer = last_node->pointer;
-	int from = pointer;
-	if (!is_buddy()) {
-		if (pointer + message_void->size_message
-				> broker_config->tamano_memoria) {
-			from = save_on_memory_partition(message_void, cola,
-					id_correlacional);
-			memcpy(memory + from, message_void->message,
-					message_void->size_message);
-			// broker_logger_info("Pointer %d",from);
-			pthread_mutex_unlock(&mpointer);
-
-			return from;
-		}
-		pointer += max(message_void->size_message,
-				broker_config->tamano_minimo_particion);
-		save_node_list_memory(from, message_void->size_message, cola,
-				id_correlacional);
-
-		memcpy(memory + from, message_void->message,
-				message_void->size_message);
-	}
-	pthread_mutex_unlock(&mpointer);
-	return from;
-}
-
-int save_on_memory_partition(t_message_to_void *message_void, t_cola cola,
-		int id_correlacional) {
-	int from;
-	int flag = 1;
-	int close_while = 0;
-	int fallas = 0;
-	while (1) {
-		if (close_while == 1) {
-			break;
-		}
-		if (fallas == broker_config->frecuencia_compactacion) {
-			compactacion();
-			fallas = 0;
-		}
-		if (broker_config->algoritmo_particion_libre == FF) {
-			// broker_logger_info("Aplicar algoritmo FIRST FIT");
-			from = libre_nodo_memoria_first(id_correlacional, cola,
-					message_void);
-		} else {
-			// broker_logger_info("Aplicar algoritmo BEST FIT");
-			from = libre_nodo_memoria_best(id_correlacional, cola,
-					message_void);
-		}
-		if (from == -1) {
-			fallas++;
-			flag = 2;			//para entrar a compactacion
-			// broker_logger_info("No se pudo aplicar FF");
-			if (broker_config->algoritmo_reemplazo == FIFO) {
-				aplicar_algoritmo_reemplazo_FIFO();
-			} else {
-				aplicar_algoritmo_reemplazo_LRU();
-			}
-		} else {
-			return from;
-		}
-
+t_list* get_queue_list(t_cola cola) {
+	switch (cola) {
+	case NEW_QUEUE:
+		return new_queue;
+	case APPEARED_QUEUE:
+		return appeared_queue;
+	case LOCALIZED_QUEUE:
+		return localized_queue;
+	case GET_QUEUE:
+		return get_queue;
+	case CATCH_QUEUE:
+		return catch_queue;
+	case CAUGHT_QUEUE:
+		return caught_queue;
 	}
-	return from;
+	return NULL;
 }
 
-int save_on_memory(t_message_to_void *message_void) {
-	pthread_mutex_lock(&mpointer);
-	int from =
-			is_buddy() ?
-					buddy_alloc(buddy, message_void->size_message) : pointer;
-
-	if (!is_buddy()) {
-		if (message_void->size_message
-				< broker_config->tamano_minimo_particion) {
-			pointer += broker_config->tamano_minimo_particion;
+void send_to_subscribers(t_list* queue, t_cola cola, t_list* deliveries,
+		uint32_t seq, uint32_t id, char* especie, t_protocol protocol,
+		void* message) {
+	// Un mensaje que no quedo en el log se envia igual, sin reintentos, pero
+	// con el mismo criterio de dueño y especie que los del log
+	char* owner = seq == 0 ? broker_log_take_route(cola, id) : NULL;
+	for (int i = 0; i < list_size(queue); i++) {
+		t_subscribe_nodo* node = list_get(queue, i);
+		if (node->f_desc <= 0) {
+			continue;
 		}
-
-		else {
-			pointer += message_void->size_message;
+		// Si no entra en vuelo lo envia el scheduler cuando haya lugar
+		bool send = seq == 0 ?
+				broker_log_is_for(cola, owner, especie, node->ip, node->puerto) :
+				broker_log_track(cola, seq, node->ip, node->puerto);
+		if (send) {
+			broker_delivery_add(deliveries, node->f_desc, protocol, message);
 		}
 	}
-
-	memcpy(memory + from, message_void->message, message_void->size_message);
-	pthread_mutex_unlock(&mpointer);
-	return from;
+	free(owner);
 }
 
-void save_node_list_memory(int pointer, int msg_size, t_cola cola, int id) {
-
-	t_nodo_memory * nodo_mem = malloc(sizeof(t_nodo_memory));
-
-	if (!is_buddy()) {
-		_Bool node_matches_received_queue(t_nodo_memory* node) {
-			return node->pointer == pointer;
-		}
-
-		t_nodo_memory * node_found = list_find(list_memory,
-				(void *) node_matches_received_queue);
-		if (node_found == NULL) {
-			estado_memoria(list_memory);
-			broker_logger_warn("Message saved at position: %d", pointer);
-		}
-		int size = node_found->size;
-
-		int next_pointer = node_found->pointer
-				+ max(broker_config->tamano_minimo_particion, msg_size);
-
-		node_found->size = max(broker_config->tamano_minimo_particion,
-				msg_size);
-		node_found->cola = cola;
-		node_found->id = id;
-		node_found->libre = false;
-		node_found->timestamp = (unsigned) time(NULL);
-
-		nodo_mem->cola = cola;
-		nodo_mem->size = size
-				- max(broker_config->tamano_minimo_particion, msg_size);
-		nodo_mem->pointer = next_pointer;
-		nodo_mem->libre = true;
-		nodo_mem->id = id;
-		nodo_mem->timestamp = (unsigned) time(NULL);
-	}
-
-	else {
-		nodo_mem->pointer = pointer;
-		nodo_mem->size =
-				!is_buddy() ?
-						((msg_size < broker_config->tamano_minimo_particion) ?
-								broker_config->tamano_minimo_particion :
-								msg_size) :
-						msg_size;
-		nodo_mem->cola = cola;
-		nodo_mem->id = id;
-		nodo_mem->timestamp = time(NULL);
+t_protocol get_queue_protocol(t_cola cola) {
+	switch (cola) {
+	case NEW_QUEUE:
+		return NEW_POKEMON;
+	case APPEARED_QUEUE:
+		return APPEARED_POKEMON;
+	case LOCALIZED_QUEUE:
+		return LOCALIZED_POKEMON;
+	case GET_QUEUE:
+		return GET_POKEMON;
+	case CATCH_QUEUE:
+		return CATCH_POKEMON;
+	default:
+		return CAUGHT_POKEMON;
 	}
-
-	pthread_mutex_lock(&mmem);
-	list_add(list_memory, nodo_mem);
-	pthread_mutex_unlock(&mmem);
 }
 
-t_nodo_memory* find_node(t_nodo_memory* node) {
-
-	int ret_pos = 0;
-
-	for (int i = 0; i < list_size(list_memory); i++) {
-		t_nodo_memory* nodo_mem = list_get(list_memory, i);
-		int id_nodo_mem = nodo_mem->id;
-		t_cola queue_nodo_mem = nodo_mem->cola;
-
-		if (!is_buddy()) {
-			if (node->id
-					== id_nodo_mem&& node->cola == queue_nodo_mem && node->libre==false) {
-				ret_pos = i;
-				break;
-			}
-		} else {
-			if (node->id == id_nodo_mem && node->cola == queue_nodo_mem) {
-				ret_pos = i;
-				break;
-			}
-		}
-
+uint32_t get_message_id(t_protocol protocol, void* message) {
+	switch (protocol) {
+	case NEW_POKEMON:
+		return ((t_new_pokemon*) message)->id_correlacional;
+	case APPEARED_POKEMON:
+		return ((t_appeared_pokemon*) message)->id_correlacional;
+	case LOCALIZED_POKEMON:
+		return ((t_localized_pokemon*) message)->id_correlacional;
+	case GET_POKEMON:
+		return ((t_get_pokemon*) message)->id_correlacional;
+	case CATCH_POKEMON:
+		return ((t_catch_pokemon*) message)->id_correlacional;
+	case CAUGHT_POKEMON:
+		return ((t_caught_pokemon*) message)->id_correlacional;
+	default:
+		return 0;
 	}
-	return list_get(list_memory, ret_pos);
 }
 
-_Bool is_msg_ackd(t_nodo_memory* node, t_subscribe* sub) {
-	if (!is_buddy() && node->libre == true) {
-		return true;
-	}
-	_Bool node_is_match(t_subscribe_message_node* msg_ack) {
-		return node->id == msg_ack->id
-				&& string_equals_ignore_case(get_queue_name(node->cola),
-						get_queue_name(msg_ack->cola));
-	}
-
-	_Bool is_ackd(t_subscribe_ack_node* m) {
-		return m->ack == true;
-	}
-
-	_Bool msg_is_from_process(t_subscribe_ack_node* acknode) {
-		return string_equals_ignore_case(acknode->subscribe->ip, sub->ip)
-				&& acknode->subscribe->puerto == sub->puerto;
-	}
-
-	t_subscribe_message_node* ack_msg_node = list_find(list_msg_subscribers,
-			(void*) node_is_match);
-	if (ack_msg_node == NULL) {
-		// broker_logger_warn("Devolvio nulo el ack");
-		return false;
-	}
-	t_subscribe_ack_node* msgsub = list_find(ack_msg_node->list,
-			(void*) msg_is_from_process);
-
-	_Bool find_sub(t_subscribe_nodo* node) {
-		return string_equals_ignore_case(node->ip, sub->ip)
-				&& node->puerto == sub->puerto;
-	}
-
-	t_subscribe_nodo* s = malloc(sizeof(t_subscribe_nodo));
-
-	switch (sub->cola) {
-
-	case NEW_QUEUE: {
-		s = list_find(new_queue, (void*) find_sub);
+void set_message_id(t_protocol protocol, void* message, uint32_t id) {
+	switch (protocol) {
+	case NEW_POKEMON:
+		((t_new_pokemon*) message)->id_correlacional = id;
 		break;
-	}
-	case APPEARED_QUEUE: {
-		s = list_find(appeared_queue, (void*) find_sub);
+	case APPEARED_POKEMON:
+		((t_appeared_pokemon*) message)->id_correlacional = id;
 		break;
-	}
-	case GET_QUEUE: {
-		s = list_find(get_queue, (void*) find_sub);
+	case LOCALIZED_POKEMON:
+		((t_localized_pokemon*) message)->id_correlacional = id;
 		break;
-	}
-	case CATCH_QUEUE: {
-		s = list_find(catch_queue, (void*) find_sub);
+	case GET_POKEMON:
+		((t_get_pokemon*) message)->id_correlacional = id;
 		break;
-	}
-	case LOCALIZED_QUEUE: {
-		s = list_find(localized_queue, (void*) find_sub);
+	case CATCH_POKEMON:
+		((t_catch_pokemon*) message)->id_correlacional = id;
 		break;
-	}
-	case CAUGHT_QUEUE: {
-		s = list_find(caught_queue, (void*) find_sub);
+	case CAUGHT_POKEMON:
+		((t_caught_pokemon*) message)->id_correlacional = id;
+		break;
+	default:
 		break;
 	}
-	}
-
-	if (msgsub == NULL) {
-		t_subscribe_ack_node* ack_subscriptor = malloc(
-				sizeof(t_subscribe_ack_node));
-		ack_subscriptor->subscribe = s;
-		ack_subscriptor->ack = false;
-		list_add(ack_msg_node->list, ack_subscriptor);
-		return false;
-	}
-
-	return msgsub->ack;
 }
 
-void send_all_messages(t_subscribe *subscriber) {
-	if (!is_buddy()) {
-		// broker_logger_info("----xxxxxx Estado xxxxxxx-----");
-		estado_memoria(list_memory);
-		// broker_logger_info("----xxxxxx Estado Final xxxxxxx-----");
-	}
-
-	_Bool msg_match(t_nodo_memory *node) {
-		return node->cola == subscriber->cola;
-	}
+// Arma desde memoria un mensaje del log, con su id. NULL si ya no esta: el
+// nodo se reutiliza al reemplazar y puede tener otro mensaje. La copia para
+// la replica no cuenta como uso
+void* read_logged_message(t_cola cola, t_log_entry* entry, bool uso) {
+	t_nodo_memory* nodo_mem = entry->data;
+	int from = uso ? allocator_access(allocator, nodo_mem, entry->generacion) :
+			allocator_peek(allocator, nodo_mem, entry->generacion);
+	if (from < 0) {
+		return NULL;
+	}
+	if (uso)
+		broker_trace_record(TRACE_ACCESO, cola, entry->id, 0);
+
+	t_protocol protocol = get_queue_protocol(cola);
+	void* message = get_from_memory(protocol, from, allocator->data);
+	if (message != NULL)
+		set_message_id(protocol, message, entry->id);
+	return message;
+}
 
-	pthread_mutex_lock(&mmem);
-	t_list* list_cpy = list_filter(list_memory, (void*) msg_match);
-	pthread_mutex_unlock(&mmem);
-	int cant = list_size(list_cpy);
-	if (cant == 1 && broker_config->estrategia_memoria == PD) {
+// Lee de memoria un mensaje del log y arma el envio al suscriptor
+void send_logged_message(t_list* deliveries, int f_desc, t_cola cola,
+		t_log_entry* entry) {
+	void* message = read_logged_message(cola, entry, true);
+	if (message == NULL)
 		return;
-	}
-
-	for (int i = 0; i < cant; i++) {
-		estado_ack(list_msg_subscribers);
-		t_nodo_memory *nodo_cpy = list_get(list_cpy, i);
-
-		if (!is_msg_ackd(nodo_cpy, subscriber)) {
-
-			pthread_mutex_lock(&mmem);
-			t_nodo_memory *nodo_mem = find_node(nodo_cpy);
-
-			update_timings(nodo_mem);
-
-			pthread_mutex_unlock(&mmem);
-
-			switch (subscriber->cola) {
-			case NEW_QUEUE: {
-				t_new_pokemon* new_snd = get_from_memory(NEW_POKEMON,
-						nodo_mem->pointer, memory);
-				new_snd->id_correlacional = nodo_mem->id;
-				utils_serialize_and_send(subscriber->f_desc, NEW_POKEMON,
-						new_snd);
-				break;
-			}
-			case CATCH_QUEUE: {
-				t_catch_pokemon* catch_snd = get_from_memory(CATCH_POKEMON,
-						nodo_mem->pointer, memory);
-				catch_snd->id_correlacional = nodo_mem->id;
-				utils_serialize_and_send(subscriber->f_desc, CATCH_POKEMON,
-						catch_snd);
-				break;
-			}
-			case CAUGHT_QUEUE: {
-				t_caught_pokemon* caught_snd = get_from_memory(CAUGHT_POKEMON,
-						nodo_mem->pointer, memory);
-				caught_snd->id_correlacional = nodo_mem->id;
-				utils_serialize_and_send(subscriber->f_desc, CAUGHT_POKEMON,
-						caught_snd);
-				break;
-			}
-			case GET_QUEUE: {
-				t_get_pokemon* get_snd = get_from_memory(GET_POKEMON,
-						nodo_mem->pointer, memory);
-				get_snd->id_correlacional = nodo_mem->id;
-				utils_serialize_and_send(subscriber->f_desc, GET_POKEMON,
-						get_snd);
-				break;
-			}
-			case LOCALIZED_QUEUE: {
-				t_localized_pokemon* localized_snd = get_from_memory(
-						LOCALIZED_POKEMON, nodo_mem->pointer, memory);
-				localized_snd->id_correlacional = nodo_mem->id;
-				utils_serialize_and_send(subscriber->f_desc, LOCALIZED_POKEMON,
-						localized_snd);
-				break;
-			}
-			case APPEARED_QUEUE: {
-				t_appeared_pokemon* appeared_snd = get_from_memory(
-						APPEARED_POKEMON, nodo_mem->pointer, memory);
-				appeared_snd->id_correlacional = nodo_mem->id;
-				utils_serialize_and_send(subscriber->f_desc, APPEARED_POKEMON,
-						appeared_snd);
-				break;
-			}
-
-			}
-		}
-	}
-}
-void create_message_ack(int id, t_list *cola, t_cola unCola) {
-	t_subscribe_message_node* message_node = malloc(
-			sizeof(t_subscribe_message_node));
-	message_node->id = id;
-	message_node->cola = unCola;
-	message_node->list = list_create();
-	pthread_mutex_lock(&msubs);
-	list_add(list_msg_subscribers, message_node);
-	pthread_mutex_unlock(&msubs);
-
-	for (int i = 0; i < list_size(cola); i++) {
-		t_subscribe_nodo* subscriptor = list_get(cola, i);
-		if (subscriptor->f_desc > 0) {
-			t_subscribe_ack_node* ack_subscriptor = malloc(
-					sizeof(t_subscribe_ack_node));
-			ack_subscriptor->subscribe = subscriptor;
-			ack_subscriptor->ack = false;
-			list_add(message_node->list, ack_subscriptor);
-		}
-	}
+	t_protocol protocol = get_queue_protocol(cola);
+	broker_delivery_add(deliveries, f_desc, protocol, message);
+	broker_codec_free(protocol, message);
 }
 
-void consolidate(int offset) {
-
-	int consolidate_with = 0;
-	int flag = 0;
-
-	_Bool elem_starts_at_offset(t_nodo_memory* node) {
-		return node->pointer == offset;
-	}
-
-	t_list* list_clone = list_duplicate(list_memory);
-	list_sort(list_clone, (void*) compare_memory_position);
-	broker_logger_error("Position to be removed %d", offset);
-
-	for (int counter = 0; counter < list_size(list_clone); counter++) {
-		flag = 0;
-		t_nodo_memory* node = list_get(list_clone, counter);
-		if (elem_starts_at_offset(node)) {
-			if (counter - 1 >= 0) {
-				t_nodo_memory* previous_elem = list_get(list_clone,
-						counter - 1);
-				if ((node->pointer
-						- (next_power_of_2(previous_elem->size)
-								+ previous_elem->pointer))
-						>= next_power_of_2(node->size)) {
-					consolidate_with = node->pointer - node->size;
-					flag = 1;
-					broker_logger_warn("Consolidated memory at positions %d and %d",
-							consolidate_with, offset);
-				}
-			}
-			if (flag == 0 && (counter != list_size(list_clone) -1)) {
-				t_nodo_memory* next_elem = list_get(list_clone, counter + 1);
-				if ((next_elem->pointer
-						- (node->pointer + next_power_of_2(node->size)))
-						>= next_power_of_2(node->size)) {
-					consolidate_with = node->pointer + node->size;
-					flag = 1;
-					broker_logger_warn("Consolidated memory at positions %d and %d",
-							offset, consolidate_with);
-				}
-			}
-
-			if (flag == 1) {
-				break;
-			}
+// Arma los envios de lo vencido y lo que entre en vuelo, de a un batch por vez
+// para no tener tomado el log mientras se lee memoria. Se llama con msave
+// tomado; los envios salen con broker_delivery_send despues de soltarlo.
+void send_due_messages(t_subscribe_nodo* sub, t_cola cola,
+		t_list* deliveries) {
+	t_log_entry batch[BROKER_LOG_BATCH];
+	int count;
+	while (sub->f_desc > 0
+			&& (count = broker_log_due(cola, sub->ip, sub->puerto, batch,
+					BROKER_LOG_BATCH)) > 0) {
+		for (int i = 0; i < count; i++) {
+			send_logged_message(deliveries, sub->f_desc, cola, &batch[i]);
 		}
 	}
 }
 
-void dump() {
-
-	int last_size = 0;
-	int last_pointer = 0;
-
-	FILE *f = NULL;
-	char* path_to_root = getenv("HOME");
-	char* dst_path = string_new();
-	string_append(&dst_path, path_to_root);
-	string_append(&dst_path, "/memdump.txt");
-	f = fopen(dst_path, "a");
-
-	if (f == NULL) {
-		broker_logger_error("Operation failed: Couldn't dump memory contents");
+void send_all_messages(t_subscribe *subscriber, t_list* deliveries) {
+	t_subscribe_nodo* sub = check_already_subscribed(subscriber->ip,
+			subscriber->puerto, get_queue_list(subscriber->cola));
+	if (sub == NULL) {
 		return;
 	}
-	if (ftell(f) != 0) {
-		fprintf(f,
-				"------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------\n");
-	}
-	time_t _time = time(NULL);
-	struct tm *tm = localtime(&_time);
-	char s[64];
-	strftime(s, sizeof(s), "%c", tm);
-	fprintf(f, "Dump %s\n", s);
-	pthread_mutex_lock(&mmem);
-	t_list* list_clone = list_duplicate(list_memory);
-	pthread_mutex_unlock(&mmem);
-	list_sort(list_clone, (void*) compare_memory_position);
-
-	for (int i = 0; i < list_size(list_clone); ++i) {
-
-		t_nodo_memory* node = list_get(list_clone, i);
-
-
-		// If first elem is free
-		if (i == 0 && node->pointer != 0) {
-			fprintf(f, "Particion %04d: %04d - %04d\t\t", i + 1, 0,
-					(node->pointer - 1));
-			fprintf(f, "[L]\t\t");
-			fprintf(f, "Size: %04d B\n", node->pointer);
-			fprintf(f, "Particion %04d: %04d - %04d\t\t", i + 2, node->pointer,
-					node->pointer + next_power_of_2(node->size) - 1);
-			fprintf(f, "[X]\t\t");
-			fprintf(f, "Total size: %04d B. Used: %04d B, Free: %04d B\t\t",
-					next_power_of_2(node->size), node->size,
-					next_power_of_2(node->size) - node->size);
-			fprintf(f, "LRU: %04d\t\t", (int) (node->timestamp - base_time));
-			fprintf(f, "Queue: %s\t\t", get_queue_name_short(node->cola));
-			fprintf(f, "ID: %04d\n", node->id);
-			last_size = i + 2;
-		}
-
-		else {
-			// If there's a hole in the middle
-			if (node->pointer > last_pointer) {
-				fprintf(f, "Particion %04d: %04d - %04d\t\t", last_size + 1,
-						last_pointer, node->pointer - 1);
-				fprintf(f, "[L]\t\t");
-				fprintf(f, "Size: %04d B\n", node->pointer - last_pointer);
-				fprintf(f, "Particion %04d: %04d - %04d\t\t", last_size + 2,
-						node->pointer, node->pointer + next_power_of_2(node->size) - 1);
-				fprintf(f, "[X]\t\t");
-				fprintf(f, "Total size: %04d B. Used: %04d B, Free: %04d B\t\t",
-						next_power_of_2(node->size), node->size,
-						next_power_of_2(node->size) - node->size);
-				fprintf(f, "LRU: %04d\t\t",
-						(int) (node->timestamp - base_time));
-				fprintf(f, "Queue: %s\t\t", get_queue_name_short(node->cola));
-				fprintf(f, "ID: %04d\n", node->id);
-				last_size += 2;
-			}
-
-			else {
-				fprintf(f, "Particion %04d: %04d - %04d\t\t", last_size + 1,
-						node->pointer,
-						node->pointer + next_power_of_2(node->size) - 1);
-				fprintf(f, "[X]\t\t");
-				fprintf(f, "Total size: %04d B. Used: %04d B, Free: %04d B\t\t",
-						next_power_of_2(node->size), node->size,
-						next_power_of_2(node->size) - node->size);
-				fprintf(f, "LRU: %04d\t\t",
-						(int) (node->timestamp - base_time));
-				fprintf(f, "Queue: %s\t\t", get_queue_name_short(node->cola));
-				fprintf(f, "ID: %04d\n", node->id);
-				last_size += 1;
-			}
-		}
-
-		last_pointer = node->pointer + next_power_of_2(node->size);
-
-		// if last block is empty
-		if ((i == (list_size(list_clone) - 1))
-				&& last_pointer != broker_config->tamano_memoria) {
-			fprintf(f, "Particion %04d: %04d - %04d\t\t", last_size + 1, last_pointer,
-					broker_config->tamano_memoria - 1);
-			fprintf(f, "[L]\t\t");
-			fprintf(f, "Size: %04d B\n",
-					broker_config->tamano_memoria - last_pointer);
-			last_size += 1;
-		}
-	}
-	fclose(f);
-	return;
-}
-
-int generar_id() {
-	pthread_mutex_lock(&mid);
-	id++;
-	pthread_mutex_unlock(&mid);
-	return id;
+	// Solo se recorre lo que el suscriptor no confirmo
+	broker_log_reset(subscriber->cola, subscriber->ip, subscriber->puerto);
+	send_due_messages(sub, subscriber->cola, deliveries);
 }
 
-int libre_nodo_memoria_best(int id_correlacional, t_cola cola,
-		t_message_to_void *message) {
-	int size_free;
-	int pointer_busy;
-	t_list *new_list = list_create();
-
-	int position;
-	int size = 0;
-	int flag_first = 0;
-
-	for (int i = 0; i < list_size(list_memory); i++) {
-		t_nodo_memory* memory_node = list_get(list_memory, i);
-		if (memory_node->libre == true && max(message->size_message,
-				broker_config->tamano_minimo_particion) <= memory_node->size) {
-
-			if (flag_first == 0) {
-				position = i;
-				size = memory_node->size;
-				flag_first = 1;
-			}
-			if (memory_node->size < size) {
-				position = i;
-				size = memory_node->size;
-			}
-		}
-	}
-	if (flag_first == 0) {
-		return -1;
-	}
-	int i = 0;
-	int flag = 0;
-	if (flag_first == 0) {
-		return -1;
-	}
-	while (i < list_size(list_memory)) {
-		t_nodo_memory* memory_node = list_get(list_memory, i);
-		if (i == position) {
-			// broker_logger_warn("iniciando reemplazo");
-			flag = 1;
-			int puntero = memory_node->pointer;
-			memory_node->cola = cola;
-			memory_node->id = id_correlacional;
-			size_free = memory_node->size
-					- max(message->size_message,
-							broker_config->tamano_minimo_particion);
-			memory_node->size = max(message->size_message,
-					broker_config->tamano_minimo_particion);
-			pointer_busy = memory_node->pointer;
-			memory_node->libre = false;
-			memory_node->timestamp = (unsigned) time(NULL);
-			list_add(new_list, memory_node);
-			if (size_free != 0) {
-				t_nodo_memory* memory_next = malloc(sizeof(t_nodo_memory));
-				memory_next->cola = cola;
-				memory_next->id = 0;
-				memory_next->libre = true;
-				memory_next->pointer = puntero + message->size_message;
-				memory_next->size = size_free;
-				memory_next->timestamp = (unsigned) time(NULL);
-				list_add(new_list, memory_next);
-			}
-
-			for (int k = i + 1; k < list_size(list_memory); k++) {
-				t_nodo_memory* memory_fill = list_get(list_memory, k);
-				list_add(new_list, memory_fill);
+void* retransmission_loop(void* arg) {
+	t_cola colas[] = { NEW_QUEUE, APPEARED_QUEUE, LOCALIZED_QUEUE, GET_QUEUE,
+			CATCH_QUEUE, CAUGHT_QUEUE };
+	for (;;) {
+		usleep(RETRANSMISSION_TICK);
+		t_list* deliveries = list_create();
+		pthread_mutex_lock(&msave);
+		for (int i = 0; i < 6; i++) {
+			t_list* queue = get_queue_list(colas[i]);
+			for (int j = 0; j < list_size(queue); j++) {
+				send_due_messages(list_get(queue, j), colas[i], deliveries);
 			}
-			break;
-
-		} else {
-			list_add(new_list, memory_node);
 		}
-		i++;
-	}
-	if (list_size(new_list) != 0) {
-		list_destroy(list_memory);
-		list_memory = new_list;
-	}
-	if (flag == 0) {
-		pointer_busy = -1;
+		pthread_mutex_unlock(&msave);
+		broker_delivery_send(deliveries);
 	}
-	list_memory = new_list;
-	/*broker_logger_warn("terminado reemplazo");
-	 broker_logger_warn("Estado memoria actual");
-	 estado_memoria(list_memory);
-	 broker_logger_warn("Terminado memoria actual");
-	 */
-	return pointer_busy;
+	return NULL;
 }
 
-int libre_nodo_memoria_first(int id_correlacional, t_cola cola,
-		t_message_to_void *message) {
-	estado_memoria(list_memory);
-	int size_free;
-	int pointer_busy;
-	t_list *new_list = list_create();
-	int flag = 0;
-	int i = 0;
-	while (i < list_size(list_memory)) {
-
-		t_nodo_memory* memory_node = list_get(list_memory, i);
-		if (memory_node->libre == true && max(message->size_message,
-				broker_config->tamano_minimo_particion) <= memory_node->size
-				&& flag == 0) {
-			// broker_logger_warn("iniciando reemplazo");
-			//estado_memoria(list_memory);
-			flag = 1;
-			int puntero = memory_node->pointer;
-			memory_node->cola = cola;
-			memory_node->id = id_correlacional;
-			size_free = memory_node->size
-					- max(message->size_message,
-							broker_config->tamano_minimo_particion);
-			memory_node->size = max(message->size_message,
-					broker_config->tamano_minimo_particion);
-			pointer_busy = memory_node->pointer;
-			memory_node->libre = false;
-			memory_node->timestamp = (unsigned) time(NULL);
-			list_add(new_list, memory_node);
-
-			if (size_free != 0) {
-				t_nodo_memory* memory_next = malloc(sizeof(t_nodo_memory));
-				memory_next->cola = cola;
-				memory_next->id = 0;
-				memory_next->libre = true;
-				memory_next->pointer = puntero + message->size_message;
-				memory_next->size = size_free;
-				memory_next->timestamp = (unsigned) time(NULL);
-				list_add(new_list, memory_next);
-			}
-			t_nodo_memory* memory_fill;
-			for (int k = i + 1; k < list_size(list_memory); k++) {
-				memory_fill = list_get(list_memory, k);
-				list_add(new_list, memory_fill);
-			}
-			//pointer = memory_fill->pointer;
-			break;
-		} else {
-			list_add(new_list, memory_node);
-		}
-		i++;
-	}
-
-	//list_destroy(list_memory );
-	if (flag == 0) {
-		pointer_busy = -1;
-	}
-	if (list_size(new_list) != 0) {
-		list_destroy(list_memory);
-		list_memory = new_list;
-	}
-	/*broker_logger_warn("terminado reemplazo");
-	 broker_logger_warn("Estado actual");
-	 estado_memoria(list_memory);
-	 broker_logger_warn("Estado final");
-	 */
-	return pointer_busy;
+static t_handshake* handshake_from_owner(char* owner) {
+	// "ip:puerto", y la ip puede ser unix:/ruta
+	char* separator = strrchr(owner, ':');
+	t_handshake* handshake = malloc(sizeof(t_handshake));
+	handshake->ip = string_substring_until(owner, separator - owner);
+	handshake->puerto = atoi(separator + 1);
+	return handshake;
 }
 
-void liberar_memoria(int id_correlacional, t_cola cola) {
-
-	for (int i = 0; i < list_size(list_memory); i++) {
-		t_nodo_memory* memory_node = list_get(list_memory, i);
-		if (memory_node->id == id_correlacional && memory_node->cola == cola) {
-			memory_node->id = 0;
-			memory_node->libre = true;
-		}
-	}
+static void snapshot_add(t_list* packages, t_protocol protocol,
+		void* message) {
+	t_package* package = utils_package_from(protocol, message);
+	if (package != NULL)
+		list_add(packages, package);
 }
 
-void compactacion() {
-	estado_memoria(list_memory);
-	//estado_memoria(list_memory);
-	// broker_logger_info("cantidad elementos previa a compactacion de lista %d",list_size(list_memory));
-	t_list *new_list = list_create();
-	broker_logger_info("Compaction started");
-	int flag = 0;
-	for (int i = 0; i < list_size(list_memory); i++) {
-		t_nodo_memory* memory_node_free = list_get(list_memory, i);
-		if (i == (list_size(list_memory) - 1)) {
-			list_add(new_list, memory_node_free);
-			break;
-
-		}
-		if (memory_node_free->libre == false) {
-			list_add(new_list, memory_node_free);
-		}
-		if (memory_node_free->libre == true) {
-
-			t_nodo_memory* memory_node_add;
-			t_nodo_memory* memory_node_next = NULL;
-			int last_pointer = memory_node_free->pointer;
-			if (i + 1 < list_size(list_memory)) {
-				memory_node_next = list_get(list_memory, i + 1);
-			}
-			if (memory_node_next != NULL && memory_node_next->libre == true) {
-				memory_node_free->size = memory_node_free->size
-						+ memory_node_next->size;
-				list_remove(list_memory, i + 1);
-				broker_logger_info(
-						"The partition starting at position %d had been removed ",
-						memory_node_next->pointer);
-				i--;
-
-			} else {
-				int offset = memory_node_free->pointer;
-				for (int k = i + 1; k < list_size(list_memory); k++) {
-					memory_node_add = list_get(list_memory, k);
-					memcpy(memory + offset, memory + memory_node_add->pointer,
-							memory_node_add->size);
-					memory_node_add->pointer = offset;
-					list_add(new_list, memory_node_add);
-					offset = offset + memory_node_add->size;
-					last_pointer = offset;
-				}
-				flag = 1;
-			}
-			memory_node_free->pointer = last_pointer;
-			list_add(new_list, memory_node_free);
-			list_memory = new_list;
-			//list_destroy(new_list);
-			if (flag == 1) {
-				i = -1;
-				new_list = list_create();
+// Copia del estado para la replica, en el orden en que ella lo aplica: los
+// mensajes, despues los suscriptores y lo que confirmaron. Con msave tomado
+// no se guarda ni se confirma nada mientras se arma, y lo encolado para la
+// replica hasta aca ya esta en la copia
+void replica_snapshot(t_list* packages) {
+	pthread_mutex_lock(&msave);
+	for (t_cola cola = NEW_QUEUE; cola <= CAUGHT_QUEUE; cola++) {
+		t_protocol protocol = get_queue_protocol(cola);
+		t_list* entries = broker_log_snapshot_entries(cola);
+		for (int i = 0; i < list_size(entries); i++) {
+			t_log_entry* entry = list_get(entries, i);
+			void* message = read_logged_message(cola, entry, false);
+			if (message == NULL)
+				continue;
+			if (entry->owner != NULL) {
+				t_handshake* owner = handshake_from_owner(entry->owner);
+				snapshot_add(packages, HANDSHAKE, owner);
+				free(owner->ip);
+				free(owner);
 			}
-			// broker_logger_warn("movido nodo de lugar");
-			//estado_memoria(list_memory);
-			// broker_logger_warn("estado nodo de lugar");
-
+			snapshot_add(packages, protocol, message);
+			broker_codec_free(protocol, message);
 		}
-
-	}
-	if (list_size(new_list) == 0) {
-		//pthread_mutex_lock(&mpointer);
-		t_nodo_memory *nodo_memory = malloc(sizeof(t_nodo_memory));
-		nodo_memory->pointer = 0;
-		nodo_memory->libre = true;
-		nodo_memory->size = broker_config->tamano_memoria;
-		nodo_memory->timestamp = (unsigned) time(NULL);
-		list_add(list_memory, nodo_memory);
-		pointer = 0;
-		//pthread_mutex_unlock(&mpointer);
-	}
-
-	if (list_size(new_list) != 0) {
-		list_destroy(list_memory);
-		list_memory = new_list;
-	}
-
-	//estado_memoria(list_memory);
-	broker_logger_info("Compaction finished");
-	// broker_logger_info("cantidad elementos de lista %d",list_size(list_memory));
-
-}
-
-void aplicar_algoritmo_reemplazo_FIFO() {
-	for (int i = 0; i < list_size(list_memory); i++) {
-		t_nodo_memory *nodo_memoria = list_get(list_memory, i);
-		if (nodo_memoria->libre == false) {
-			nodo_memoria->libre = true;
-			break;
-		}
-	}
-}
-
-void aplicar_algoritmo_reemplazo_LRU() {
-	estado_memoria(list_memory);
-	int flag = 0;
-	int position;
-	uint32_t less_time;
-	for (int i = 0; i < list_size(list_memory); i++) {
-		t_nodo_memory *nodo_memoria = list_get(list_memory, i);
-		if (nodo_memoria->libre == false) {
-			if (flag == 0) {
-				less_time = nodo_memoria->timestamp;
-				position = i;
-				flag = 1;
-			}
-			if (nodo_memoria->timestamp < less_time) {
-				less_time = nodo_memoria->timestamp;
-				position = i;
+		broker_log_snapshot_entries_destroy(entries);
+	}
+
+	for (t_cola cola = NEW_QUEUE; cola <= CAUGHT_QUEUE; cola++) {
+		t_list* cursors = broker_log_snapshot_cursors(cola);
+		for (int i = 0; i < list_size(cursors); i++) {
+			t_log_cursor_snapshot* cursor = list_get(cursors, i);
+			t_subscribe subscribe = { .ip = cursor->ip,
+					.puerto = cursor->puerto, .proceso = BROKER, .cola = cola,
+					.especies = cursor->especies };
+			snapshot_add(packages, SUBSCRIBE, &subscribe);
+			for (int j = 0; j < list_size(cursor->acks); j++) {
+				t_ack ack = { .id_corr_msg = (uintptr_t) list_get(cursor->acks,
+						j), .queue = cola, .sender_name = "BROKER",
+						.ip = cursor->ip, .port = cursor->puerto };
+				snapshot_add(packages, ACK, &ack);
 			}
 		}
+		broker_log_snapshot_cursors_destroy(cursors);
 	}
-	t_nodo_memory *nodo_memoria = list_get(list_memory, position);
-	nodo_memoria->libre = true;
+	broker_replica_discard();
+	pthread_mutex_unlock(&msave);
 }
 
-void estado_memoria(t_list *list) {
-	/*
-	 broker_logger_warn("Estado Actual");
-	 for (int i=0; i<list_size(list);i++){
-	 t_nodo_memory *nodo_memoria =list_get(list,i);
-	 broker_logger_info(" Posicion %d",i);
-	 broker_logger_info(" Pointer %d",nodo_memoria->pointer);
-	 broker_logger_info(" Cola %d",nodo_memoria->cola);
-	 broker_logger_info(" estado %d",nodo_memoria->libre);
-	 broker_logger_info(" size %d",nodo_memoria->size);
-	 broker_logger_info(" time %d",nodo_memoria->timestamp);
-	 }
-	 broker_logger_warn("Estado Final");
-	 */
+// La replica guarda los mensajes con los IDs del primario. Si los clientes se
+// pasan a ella, los IDs nuevos siguen desde el mayor que vio
+void avanzar_id(uint32_t visto) {
+	pthread_mutex_lock(&mid);
+	if (id < visto)
+		id = visto;
+	pthread_mutex_unlock(&mid);
 }
 
-void dump_partition() {
+int generar_id() {
+	pthread_mutex_lock(&mid);
+	id++;
+	pthread_mutex_unlock(&mid);
+	return id;
+}
 
+void dump() {
 	FILE *f = NULL;
 	char* path_to_root = getenv("HOME");
 	char* dst_path = string_new();
 	string_append(&dst_path, path_to_root);
 	string_append(&dst_path, "/memdump.txt");
 	f = fopen(dst_path, "a");
+	free(dst_path);
 
 	if (f == NULL) {
 		broker_logger_error("Operation failed: Couldn't dump memory contents");
@@ -2223,47 +1281,6 @@ void dump_partition() {
 	char s[64];
 	strftime(s, sizeof(s), "%c", tm);
 	fprintf(f, "Dump %s\n", s);
-	pthread_mutex_lock(&mmem);
-	t_list* list_clone = list_duplicate(list_memory);
-	pthread_mutex_unlock(&mmem);
-
-	for (int i = 0; i < list_size(list_clone); ++i) {
-
-		t_nodo_memory* node = list_get(list_clone, i);
-		fprintf(f, "Particion %04d: %04d - %04d\t\t", i, node->pointer,
-				node->pointer + node->size - 1);
-		if (node->libre == false) {
-			fprintf(f, "[X]\t\t");
-		} else {
-			fprintf(f, "[L]\t\t");
-		}
-
-		fprintf(f, "Size: %04d B \t\t", node->size);
-		if (node->libre == false) {
-			fprintf(f, "LRU: %04d\t\t", (int) (node->timestamp - base_time));
-			fprintf(f, "Queue: %s\t\t", get_queue_name(node->cola));
-			fprintf(f, "ID: %04d\n", node->id);
-		} else {
-			fprintf(f, "Queue: %s\t\t", "LIBRE");
-		}
-	}
+	allocator_dump(allocator, f, base_time);
 	fclose(f);
-	return;
-
-}
-
-void estado_ack(t_list *list_msg_subscribers) {
-	/*if (!is_buddy()) {
-	 for(int i=0;i<list_size(list_msg_subscribers);i++){
-	 t_subscribe_message_node *node = list_get(list_msg_subscribers,i);
-	 broker_logger_info("Id msj %d",node->id);
-	 broker_logger_info("cola del msj %s",get_queue_name(node->cola));
-	 for(int k=0;k<list_size(node->list);k++){
-	 t_subscribe_ack_node *node_ack = list_get(node->list,k);
-	 broker_logger_info("Puerto %d",node_ack->subscribe->puerto);
-	 broker_logger_info("IP %s",node_ack->subscribe->ip);
-	 }
-	 }
-	 }
-	 */
 }
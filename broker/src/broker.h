@@ -9,27 +9,32 @@
 
 #include "config/broker_config.h"
 #include "logger/broker_logger.h"
+#include "codec/broker_codec.h"
+#include "delivery/broker_delivery.h"
+#include "log/broker_log.h"
+#include "replica/broker_replica.h"
+#include "trace/broker_trace.h"
 #include "../../shared-common/common/sockets.h"
 #include "../../shared-common/common/utils.h"
 
+// Cada cuanto se revisan los mensajes en vuelo vencidos
+#define RETRANSMISSION_TICK 100000
+
 int broker_socket;
 time_t base_time;
 
 
-int broker_load();
+int broker_load(char* config_path);
 void broker_server_init();
 static void *handle_connection(void *arg);
 void broker_exit();
-void search_queue(t_subscribe *unSubscribe);
+void search_queue(t_subscribe *unSubscribe, t_list* deliveries);
 void initialize_queue();
 void add_to(t_list *list, t_subscribe* sub);
-void compactacion();
-
-pthread_mutex_t mpointer, mid, msubs, msave, mget, mappeared, mloc, mcatch, mcaught, mnew, mmem;
 
-char *memory;
+pthread_mutex_t mid, msave, mget, mappeared, mloc, mcatch, mcaught, mnew;
 
-uint32_t pointer;
+t_allocator* allocator;
 
 uint32_t id;
 
@@ -37,15 +42,6 @@ time_t base_time;
 
 t_list *get_queue,*appeared_queue,*new_queue,*caught_queue,*catch_queue,*localized_queue;
 
-t_list *list_memory;
-t_list *list_msg_subscribers;
-
-typedef struct {
-	int id;
-	t_cola cola;
-	t_list *list;
-} t_subscribe_message_node;
-
 
 typedef struct {
 	char* ip;
@@ -54,57 +50,40 @@ typedef struct {
 	int32_t f_desc;
 } t_subscribe_nodo;
 
-typedef struct {
-	t_subscribe_nodo* subscribe;
-	bool ack;
-} t_subscribe_ack_node;
-
-typedef struct {
-	int pointer;
-	int size;
-	t_cola cola;
-	int id;
-	time_t timestamp;
-	bool libre;
-} t_nodo_memory;
-
 typedef struct {
 	void* message;
 	uint32_t size_message;
 } t_message_to_void;
 
-struct buddy;
-struct buddy* buddy = NULL;
-
-struct buddy *buddy_new(int num_of_fragments);
-int buddy_alloc(struct buddy *self, uint32_t size);
-void buddy_free(struct buddy *self, int offset);
 char* get_queue_name(t_cola q);
 t_subscribe_nodo* check_already_subscribed(char *ip,uint32_t puerto,t_list *list);
 t_message_to_void *convert_to_void(t_protocol protocol, void *package_recv);
 void *get_from_memory(t_protocol protocol, int posicion, void *message);
-int save_on_memory(t_message_to_void *message_void);
+void* store_message(t_protocol protocol, void* message, t_cola cola,
+		uint32_t id_correlacional, char* especie, uint32_t* seq);
+void evict_message(t_cola cola, uint32_t id_correlacional,
+		t_nodo_memory* node, void* context);
 char* get_protocol_name(t_cola q);
-int save_on_memory_pd(t_message_to_void *message_void,t_cola cola,int id);
-void save_node_list_memory(int pointer, int size,t_cola cola,int id);
-void send_all_messages(t_subscribe *subscriber);
-void purge_msg();
+void send_all_messages(t_subscribe *subscriber, t_list* deliveries);
+t_protocol get_queue_protocol(t_cola cola);
+uint32_t get_message_id(t_protocol protocol, void* message);
+void set_message_id(t_protocol protocol, void* message, uint32_t id);
+void* read_logged_message(t_cola cola, t_log_entry* entry, bool uso);
+void send_logged_message(t_list* deliveries, int f_desc, t_cola cola,
+		t_log_entry* entry);
+void send_due_messages(t_subscribe_nodo* sub, t_cola cola,
+		t_list* deliveries);
+void* retransmission_loop(void* arg);
+void replica_snapshot(t_list* packages);
 int generar_id();
+void avanzar_id(uint32_t visto);
 void handle_disconnection(int fdesc);
 void dump();
-_Bool is_buddy();
-void create_message_ack(int id,t_list *cola,t_cola unCola);
-int libre_nodo_memoria_first(int id_correlacional,t_cola cola,t_message_to_void *message_void);
-int libre_nodo_memoria_best(int id_correlacional,t_cola cola,t_message_to_void *message_void);
-void aplicar_algoritmo_reemplazo_LRU();
-void aplicar_algoritmo_reemplazo_FIFO();
-void estado_memoria(t_list *list);
-void consolidate();
-_Bool is_buddy();
+t_list* get_queue_list(t_cola cola);
+void send_to_subscribers(t_list* queue, t_cola cola, t_list* deliveries,
+		uint32_t seq, uint32_t id, char* especie, t_protocol protocol,
+		void* message);
 void remove_after_n_secs(t_subscribe_nodo* sub, t_list* q, int n);
-int save_on_memory_partition(t_message_to_void *message_void,t_cola cola,int id_correlacional);
 void signal_handler(int signum);
 char* get_queue_name(t_cola q);
-void dump_partition();
-void estado_ack(t_list *list_msg_subscribers);
 #endif  /* BROKER_H_ */
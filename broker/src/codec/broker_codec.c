@@ -0,0 +1,259 @@
+#include "broker_codec.h"
+
+#define CODEC_QUEUES	(CAUGHT_QUEUE + 1)
+
+typedef struct {
+	t_dictionary* ids;
+	t_list* names;
+} t_name_table;
+
+static t_name_table tables[CODEC_QUEUES];
+static pthread_mutex_t mcodec = PTHREAD_MUTEX_INITIALIZER;
+
+void broker_codec_init() {
+	for (int i = 0; i < CODEC_QUEUES; i++) {
+		tables[i].ids = dictionary_create();
+		tables[i].names = list_create();
+	}
+}
+
+void broker_codec_destroy() {
+	for (int i = 0; i < CODEC_QUEUES; i++) {
+		dictionary_destroy(tables[i].ids);
+		list_destroy_and_destroy_elements(tables[i].names, free);
+	}
+}
+
+static t_cola codec_queue_of(t_protocol protocol) {
+	switch (protocol) {
+	case NEW_POKEMON:
+		return NEW_QUEUE;
+	case APPEARED_POKEMON:
+		return APPEARED_QUEUE;
+	case CATCH_POKEMON:
+		return CATCH_QUEUE;
+	case GET_POKEMON:
+		return GET_QUEUE;
+	case LOCALIZED_POKEMON:
+		return LOCALIZED_QUEUE;
+	default:
+		return CAUGHT_QUEUE;
+	}
+}
+
+static uint32_t codec_intern(t_cola queue, char* name) {
+	t_name_table* table = &tables[queue];
+	pthread_mutex_lock(&mcodec);
+	// Se guarda id + 1 para distinguir "no esta" de id 0
+	uintptr_t id = (uintptr_t) dictionary_get(table->ids, name);
+	if (id == 0) {
+		id = list_add(table->names, string_duplicate(name)) + 1;
+		dictionary_put(table->ids, name, (void*) id);
+	}
+	pthread_mutex_unlock(&mcodec);
+	return id - 1;
+}
+
+static char* codec_name(t_cola queue, uint32_t id) {
+	pthread_mutex_lock(&mcodec);
+	char* name = string_duplicate(list_get(tables[queue].names, id));
+	pthread_mutex_unlock(&mcodec);
+	return name;
+}
+
+static int codec_put(void* buffer, int offset, uint32_t value) {
+	return offset + serializer_put_varint(buffer + offset, value);
+}
+
+static int codec_get(void* buffer, int offset, uint32_t* value) {
+	return offset
+			+ serializer_get_varint(buffer + offset, SERIALIZER_VARINT_MAX,
+					value);
+}
+
+void* broker_codec_encode(t_protocol protocol, void* message, uint32_t* size) {
+	t_cola queue = codec_queue_of(protocol);
+	void* buffer = NULL;
+	int offset = 0;
+
+	switch (protocol) {
+	case NEW_POKEMON: {
+		t_new_pokemon* new_rcv = message;
+		buffer = malloc(SERIALIZER_VARINT_MAX * 4);
+		offset = codec_put(buffer, offset,
+				codec_intern(queue, new_rcv->nombre_pokemon));
+		offset = codec_put(buffer, offset, new_rcv->pos_x);
+		offset = codec_put(buffer, offset, new_rcv->pos_y);
+		offset = codec_put(buffer, offset, new_rcv->cantidad);
+		break;
+	}
+	case APPEARED_POKEMON: {
+		t_appeared_pokemon* appeared_rcv = message;
+		buffer = malloc(SERIALIZER_VARINT_MAX * 3);
+		offset = codec_put(buffer, offset,
+				codec_intern(queue, appeared_rcv->nombre_pokemon));
+		offset = codec_put(buffer, offset, appeared_rcv->pos_x);
+		offset = codec_put(buffer, offset, appeared_rcv->pos_y);
+		break;
+	}
+	case CATCH_POKEMON: {
+		t_catch_pokemon* catch_rcv = message;
+		buffer = malloc(SERIALIZER_VARINT_MAX * 3);
+		offset = codec_put(buffer, offset,
+				codec_intern(queue, catch_rcv->nombre_pokemon));
+		offset = codec_put(buffer, offset, catch_rcv->pos_x);
+		offset = codec_put(buffer, offset, catch_rcv->pos_y);
+		break;
+	}
+	case GET_POKEMON: {
+		t_get_pokemon* get_rcv = message;
+		buffer = malloc(SERIALIZER_VARINT_MAX);
+		offset = codec_put(buffer, offset,
+				codec_intern(queue, get_rcv->nombre_pokemon));
+		break;
+	}
+	case CAUGHT_POKEMON: {
+		t_caught_pokemon* caught_rcv = message;
+		buffer = malloc(SERIALIZER_VARINT_MAX);
+		offset = codec_put(buffer, offset, caught_rcv->result);
+		break;
+	}
+	case LOCALIZED_POKEMON: {
+		// Se guarda siempre compacto; encoding recuerda como llego para
+		// reenviarlo igual
+		t_localized_pokemon* loc_rcv = message;
+		uint32_t encoding = loc_rcv->coordenadas != NULL;
+		t_list* coordenadas =
+				loc_rcv->coordenadas != NULL ?
+						loc_rcv->coordenadas :
+						utils_localized_group(loc_rcv->posiciones);
+		int blob_size;
+		void* blob = utils_localized_encode(coordenadas, &blob_size);
+		if (coordenadas != loc_rcv->coordenadas)
+			list_destroy_and_destroy_elements(coordenadas, free);
+
+		buffer = malloc(SERIALIZER_VARINT_MAX * 4 + blob_size);
+		offset = codec_put(buffer, offset,
+				codec_intern(queue, loc_rcv->nombre_pokemon));
+		offset = codec_put(buffer, offset, loc_rcv->cant_elem);
+		offset = codec_put(buffer, offset, encoding);
+		offset = codec_put(buffer, offset, blob_size);
+		memcpy(buffer + offset, blob, blob_size);
+		offset += blob_size;
+		free(blob);
+		break;
+	}
+	default:
+		break;
+	}
+
+	*size = offset;
+	return buffer;
+}
+
+void* broker_codec_decode(t_protocol protocol, void* buffer) {
+	t_cola queue = codec_queue_of(protocol);
+	int offset = 0;
+	uint32_t name_id;
+
+	switch (protocol) {
+	case NEW_POKEMON: {
+		t_new_pokemon* new_snd = malloc(sizeof(t_new_pokemon));
+		offset = codec_get(buffer, offset, &name_id);
+		offset = codec_get(buffer, offset, &new_snd->pos_x);
+		offset = codec_get(buffer, offset, &new_snd->pos_y);
+		offset = codec_get(buffer, offset, &new_snd->cantidad);
+		new_snd->nombre_pokemon = codec_name(queue, name_id);
+		new_snd->tamanio_nombre = strlen(new_snd->nombre_pokemon) + 1;
+		new_snd->id_correlacional = 0;
+		return new_snd;
+	}
+	case APPEARED_POKEMON: {
+		t_appeared_pokemon* appeared_snd = malloc(sizeof(t_appeared_pokemon));
+		offset = codec_get(buffer, offset, &name_id);
+		offset = codec_get(buffer, offset, &appeared_snd->pos_x);
+		offset = codec_get(buffer, offset, &appeared_snd->pos_y);
+		appeared_snd->nombre_pokemon = codec_name(queue, name_id);
+		appeared_snd->tamanio_nombre = strlen(appeared_snd->nombre_pokemon) + 1;
+		appeared_snd->id_correlacional = 0;
+		return appeared_snd;
+	}
+	case CATCH_POKEMON: {
+		t_catch_pokemon* catch_snd = malloc(sizeof(t_catch_pokemon));
+		offset = codec_get(buffer, offset, &name_id);
+		offset = codec_get(buffer, offset, &catch_snd->pos_x);
+		offset = codec_get(buffer, offset, &catch_snd->pos_y);
+		catch_snd->nombre_pokemon = codec_name(queue, name_id);
+		catch_snd->tamanio_nombre = strlen(catch_snd->nombre_pokemon) + 1;
+		catch_snd->id_correlacional = 0;
+		return catch_snd;
+	}
+	case GET_POKEMON: {
+		t_get_pokemon* get_snd = malloc(sizeof(t_get_pokemon));
+		offset = codec_get(buffer, offset, &name_id);
+		get_snd->nombre_pokemon = codec_name(queue, name_id);
+		get_snd->tamanio_nombre = strlen(get_snd->nombre_pokemon) + 1;
+		get_snd->id_correlacional = 0;
+		return get_snd;
+	}
+	case CAUGHT_POKEMON: {
+		t_caught_pokemon* caught_snd = malloc(sizeof(t_caught_pokemon));
+		offset = codec_get(buffer, offset, &caught_snd->result);
+		caught_snd->id_correlacional = 0;
+		return caught_snd;
+	}
+	case LOCALIZED_POKEMON: {
+		t_localized_pokemon* loc_snd = malloc(sizeof(t_localized_pokemon));
+		uint32_t encoding;
+		uint32_t blob_size;
+		offset = codec_get(buffer, offset, &name_id);
+		offset = codec_get(buffer, offset, &loc_snd->cant_elem);
+		offset = codec_get(buffer, offset, &encoding);
+		offset = codec_get(buffer, offset, &blob_size);
+		loc_snd->nombre_pokemon = codec_name(queue, name_id);
+		loc_snd->tamanio_nombre = strlen(loc_snd->nombre_pokemon) + 1;
+		loc_snd->id_correlacional = 0;
+		loc_snd->posiciones = NULL;
+		loc_snd->coordenadas = utils_localized_decode(buffer + offset,
+				blob_size, loc_snd->cant_elem);
+		if (loc_snd->coordenadas == NULL) {
+			free(loc_snd->nombre_pokemon);
+			free(loc_snd);
+			return NULL;
+		}
+		if (!encoding) {
+			utils_localized_positions(loc_snd);
+			list_destroy_and_destroy_elements(loc_snd->coordenadas, free);
+			loc_snd->coordenadas = NULL;
+		}
+		return loc_snd;
+	}
+	default:
+		return NULL;
+	}
+}
+
+void broker_codec_free(t_protocol protocol, void* message) {
+	if (message == NULL)
+		return;
+	switch (protocol) {
+	case NEW_POKEMON:
+		free(((t_new_pokemon*) message)->nombre_pokemon);
+		break;
+	case APPEARED_POKEMON:
+		free(((t_appeared_pokemon*) message)->nombre_pokemon);
+		break;
+	case CATCH_POKEMON:
+		free(((t_catch_pokemon*) message)->nombre_pokemon);
+		break;
+	case GET_POKEMON:
+		free(((t_get_pokemon*) message)->nombre_pokemon);
+		break;
+	case LOCALIZED_POKEMON:
+		utils_localized_destroy(message);
+		return;
+	default:
+		break;
+	}
+	free(message);
+}
@@ -0,0 +1,60 @@
+#ifndef CODEC_BROKER_CODEC_H_
+#define CODEC_BROKER_CODEC_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <commons/string.h>
+#include <commons/collections/list.h>
+#include <commons/collections/dictionary.h>
+
+#include "../../../shared-common/common/protocols.h"
+#include "../../../shared-common/common/serializer.h"
+#include "../../../shared-common/common/utils.h"
+
+// Formato de cada mensaje en la cache (todos los enteros en varint):
+//   NEW:       [nombre][x][y][cantidad]
+//   APPEARED:  [nombre][x][y]
+//   CATCH:     [nombre][x][y]
+//   GET:       [nombre]
+//   CAUGHT:    [resultado]
+//   LOCALIZED: [nombre][cant_elem][encoding][tamaño blob][blob compacto]
+// donde [nombre] es el id del nombre del pokemon en el diccionario de la cola.
+// Los nombres no se liberan nunca: son especies, no crecen con los mensajes.
+
+/**
+ * @NAME: broker_codec_init
+ * @DESC: Crea los diccionarios de nombres de cada cola.
+ */
+void broker_codec_init();
+
+/**
+ * @NAME: broker_codec_encode
+ * @DESC: Codifica el mensaje para guardarlo en memoria. Devuelve un buffer
+ * 		nuevo y deja su tamaño en size.
+ */
+void* broker_codec_encode(t_protocol protocol, void* message, uint32_t* size);
+
+/**
+ * @NAME: broker_codec_decode
+ * @DESC: Arma el mensaje a partir de lo guardado en memoria. El
+ * 		id_correlacional no se guarda y queda en 0. Devuelve NULL si lo
+ * 		guardado no se puede leer.
+ */
+void* broker_codec_decode(t_protocol protocol, void* buffer);
+
+/**
+ * @NAME: broker_codec_free
+ * @DESC: Libera un mensaje armado por broker_codec_decode o recibido por
+ * 		socket, con su nombre y sus listas.
+ */
+void broker_codec_free(t_protocol protocol, void* message);
+
+/**
+ * @NAME: broker_codec_destroy
+ * @DESC: Libera los diccionarios.
+ */
+void broker_codec_destroy();
+
+#endif /* CODEC_BROKER_CODEC_H_ */
@@ -2,9 +2,9 @@
 
 void read_config(t_config* config_file);
 
-int broker_config_load()
+int broker_config_load(char* path)
 {
-	return config_load(NULL, CONFIG_FILE_PATH, read_config, broker_print_config);
+	return config_load(NULL, path, read_config, broker_print_config);
 }
 
 e_memory_struct broker_algoritmo_memoria_from_string(char* algoritmo)
@@ -59,9 +59,20 @@ void broker_config_free()
 {
 	free(broker_config->ip_broker);
 	free(broker_config->log_file);
+	free(broker_config->traza_memoria);
+	cluster_destroy(broker_config->cluster);
 	free(broker_config);
 }
 
+int broker_config_int_or_default(t_config* config_file, char* key, int default_value)
+{
+	if(config_has_property(config_file, key))
+	{
+		return config_get_int_value(config_file, key);
+	}
+	return default_value;
+}
+
 void read_config(t_config* config_file)
 {
 	broker_config = malloc(sizeof(t_broker_config));
@@ -76,6 +87,16 @@ void read_config(t_config* config_file)
 	broker_config->frecuencia_compactacion = config_get_int_value(config_file, "FRECUENCIA_COMPACTACION");
 	broker_config->log_file = malloc(sizeof(char*));
 	broker_config->log_file = string_duplicate(config_get_string_value(config_file, "LOG_FILE"));
+	// Opcionales: reenvio de mensajes sin ACK
+	broker_config->retransmision_timeout = broker_config_int_or_default(config_file, "RETRANSMISION_TIMEOUT", RETRANSMISION_TIMEOUT_DEFAULT);
+	broker_config->retransmision_timeout_maximo = broker_config_int_or_default(config_file, "RETRANSMISION_TIMEOUT_MAXIMO", RETRANSMISION_TIMEOUT_MAXIMO_DEFAULT);
+	broker_config->retransmision_intentos = broker_config_int_or_default(config_file, "RETRANSMISION_INTENTOS", RETRANSMISION_INTENTOS_DEFAULT);
+	broker_config->mensajes_en_vuelo = broker_config_int_or_default(config_file, "MENSAJES_EN_VUELO", MENSAJES_EN_VUELO_DEFAULT);
+	// Opcional: graba los eventos de la memoria para memory-bench
+	broker_config->traza_memoria = config_has_property(config_file, "TRAZA_MEMORIA") ?
+			string_duplicate(config_get_string_value(config_file, "TRAZA_MEMORIA")) : NULL;
+	// Opcional: las colas que atiende este broker dentro del cluster
+	broker_config->cluster = cluster_create(config_file, broker_config->ip_broker, broker_config->puerto_broker);
 
 }
 
@@ -138,4 +159,14 @@ void broker_print_config()
 	broker_logger_info("PUERTO_BROKER: %d", broker_config->puerto_broker);
 	broker_logger_info("FRECUENCIA_COMPACTACION: %d", broker_config->frecuencia_compactacion);
 	broker_logger_info("LOG_FILE: %s", broker_config->log_file);
+	broker_logger_info("RETRANSMISION_TIMEOUT: %d", broker_config->retransmision_timeout);
+	broker_logger_info("RETRANSMISION_TIMEOUT_MAXIMO: %d", broker_config->retransmision_timeout_maximo);
+	broker_logger_info("RETRANSMISION_INTENTOS: %d", broker_config->retransmision_intentos);
+	broker_logger_info("MENSAJES_EN_VUELO: %d", broker_config->mensajes_en_vuelo);
+	if (broker_config->traza_memoria != NULL)
+		broker_logger_info("TRAZA_MEMORIA: %s", broker_config->traza_memoria);
+	for (int i = 0; i < list_size(broker_config->cluster->nodes); i++) {
+		t_cluster_node* node = list_get(broker_config->cluster->nodes, i);
+		broker_logger_info("CLUSTER_BROKERS[%d]: %s:%d", i, node->ip, node->port);
+	}
 }
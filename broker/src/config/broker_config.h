@@ -6,6 +6,8 @@
 #include <commons/string.h>
 
 #include "../../../shared-common/common/config.h"
+#include "../../../shared-common/common/cluster.h"
+#include "../../../shared-common/common/allocator.h"
 
 #include "../logger/broker_logger.h"
 
@@ -18,20 +20,11 @@
 #define FIRST_FIT "FIRST FIT"
 #define BEST_FIT "BEST FIT"
 
-typedef enum
-{
-	BS, PD
-} e_memory_struct;
-
-typedef enum
-{
-	FIFO, LRU
-} e_algoritmo_reemplazo;
-
-typedef enum
-{
-	FF, BF
-} e_algoritmo_particion_libre;
+// Valores por defecto de la retransmision si no estan en el config
+#define RETRANSMISION_TIMEOUT_DEFAULT 1000
+#define RETRANSMISION_TIMEOUT_MAXIMO_DEFAULT 16000
+#define RETRANSMISION_INTENTOS_DEFAULT 5
+#define MENSAJES_EN_VUELO_DEFAULT 16
 
 typedef struct
 {
@@ -44,11 +37,18 @@ typedef struct
 	int puerto_broker;
 	int frecuencia_compactacion;
 	char* log_file;
+	int retransmision_timeout;
+	int retransmision_timeout_maximo;
+	int retransmision_intentos;
+	int mensajes_en_vuelo;
+	// Archivo de la traza de memoria, NULL si no se graba
+	char* traza_memoria;
+	t_cluster* cluster;
 } t_broker_config;
 
 t_broker_config* broker_config;
 
-int broker_config_load();
+int broker_config_load(char* path);
 void broker_config_free();
 void broker_print_config();
 
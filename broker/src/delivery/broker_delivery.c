@@ -0,0 +1,89 @@
+#include "broker_delivery.h"
+
+typedef struct {
+	int pendientes;
+	pthread_mutex_t envio;
+} t_delivery_socket;
+
+// "fd" -> t_delivery_socket, solo mientras tiene envios pendientes
+static t_dictionary* sockets;
+static pthread_mutex_t msockets = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sockets_libres = PTHREAD_COND_INITIALIZER;
+
+void broker_delivery_init() {
+	sockets = dictionary_create();
+}
+
+void broker_delivery_add(t_list* deliveries, int f_desc, t_protocol protocol,
+		void* message) {
+	t_package* package = utils_package_from(protocol, message);
+	if (package == NULL)
+		return;
+
+	char* key = string_itoa(f_desc);
+	pthread_mutex_lock(&msockets);
+	t_delivery_socket* estado = dictionary_get(sockets, key);
+	if (estado == NULL) {
+		estado = malloc(sizeof(t_delivery_socket));
+		estado->pendientes = 0;
+		pthread_mutex_init(&estado->envio, NULL);
+		dictionary_put(sockets, key, estado);
+	}
+	estado->pendientes++;
+	pthread_mutex_unlock(&msockets);
+	free(key);
+
+	t_delivery* delivery = malloc(sizeof(t_delivery));
+	delivery->f_desc = f_desc;
+	delivery->package = package;
+	list_add(deliveries, delivery);
+}
+
+static void delivery_socket_destroy(t_delivery_socket* estado) {
+	pthread_mutex_destroy(&estado->envio);
+	free(estado);
+}
+
+static void delivery_send(t_delivery* delivery) {
+	char* key = string_itoa(delivery->f_desc);
+	pthread_mutex_lock(&msockets);
+	t_delivery_socket* estado = dictionary_get(sockets, key);
+	pthread_mutex_unlock(&msockets);
+
+	// Mientras tenga pendientes no sale de la tabla
+	pthread_mutex_lock(&estado->envio);
+	utils_package_send_to(delivery->package, delivery->f_desc);
+	pthread_mutex_unlock(&estado->envio);
+
+	pthread_mutex_lock(&msockets);
+	if (--estado->pendientes == 0) {
+		dictionary_remove(sockets, key);
+		delivery_socket_destroy(estado);
+		pthread_cond_broadcast(&sockets_libres);
+	}
+	pthread_mutex_unlock(&msockets);
+	free(key);
+
+	utils_package_destroy(delivery->package);
+	free(delivery);
+}
+
+void broker_delivery_send(t_list* deliveries) {
+	list_destroy_and_destroy_elements(deliveries, (void*) delivery_send);
+}
+
+void broker_delivery_close(int f_desc) {
+	// Despierta a quien este bloqueado enviandole: el otro lado ya no lee
+	shutdown(f_desc, SHUT_RDWR);
+	char* key = string_itoa(f_desc);
+	pthread_mutex_lock(&msockets);
+	while (dictionary_has_key(sockets, key))
+		pthread_cond_wait(&sockets_libres, &msockets);
+	pthread_mutex_unlock(&msockets);
+	free(key);
+}
+
+void broker_delivery_destroy() {
+	dictionary_destroy_and_destroy_elements(sockets,
+			(void*) delivery_socket_destroy);
+}
@@ -0,0 +1,63 @@
+#ifndef DELIVERY_BROKER_DELIVERY_H_
+#define DELIVERY_BROKER_DELIVERY_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <commons/string.h>
+#include <commons/collections/list.h>
+#include <commons/collections/dictionary.h>
+
+#include "../../../shared-common/common/protocols.h"
+#include "../../../shared-common/common/utils.h"
+
+// Los envios a suscriptores se arman con msave tomado, que es lo que asegura
+// que el fd sigue siendo del suscriptor, y se hacen despues de soltarlo: un
+// suscriptor que no lee frena solo a quien le esta enviando a el, no la
+// recepcion ni los envios de las demas colas.
+//
+// Cada fd lleva la cuenta de los envios armados que faltan. Antes de cerrar
+// una conexion se espera a que terminen, asi el numero de fd no se reutiliza
+// con un envio pendiente. Los envios a un mismo fd van de a uno para que no
+// se mezclen los frames de dos hilos.
+
+typedef struct {
+	int f_desc;
+	t_package* package;
+} t_delivery;
+
+/**
+ * @NAME: broker_delivery_init
+ * @DESC: Crea la tabla de envios por fd.
+ */
+void broker_delivery_init();
+
+/**
+ * @NAME: broker_delivery_add
+ * @DESC: Serializa el mensaje para f_desc y lo agrega a deliveries. Se llama
+ * 		con msave tomado; el mensaje se puede liberar apenas vuelve.
+ */
+void broker_delivery_add(t_list* deliveries, int f_desc, t_protocol protocol,
+		void* message);
+
+/**
+ * @NAME: broker_delivery_send
+ * @DESC: Envia y libera todo lo de deliveries, y la lista. Se llama sin msave.
+ */
+void broker_delivery_send(t_list* deliveries);
+
+/**
+ * @NAME: broker_delivery_close
+ * @DESC: Corta la conexion y espera los envios pendientes a f_desc. Se llama
+ * 		despues de sacar el fd de los suscriptores y antes de cerrarlo.
+ */
+void broker_delivery_close(int f_desc);
+
+/**
+ * @NAME: broker_delivery_destroy
+ * @DESC: Libera la tabla.
+ */
+void broker_delivery_destroy();
+
+#endif /* DELIVERY_BROKER_DELIVERY_H_ */
@@ -0,0 +1,631 @@
+#include "broker_log.h"
+
+#define LOG_QUEUES				(CAUGHT_QUEUE + 1)
+#define LOG_INITIAL_CAPACITY	64
+
+typedef struct {
+	uint32_t seq;
+	uint64_t deadline;
+	int attempts;
+	// Agoto los intentos: no ocupa lugar en vuelo ni se reintenta
+	bool parked;
+} t_log_inflight;
+
+typedef struct {
+	char* key;
+	uint32_t acked;
+	// Todo lo anterior a sent ya se envio al menos una vez
+	uint32_t sent;
+	// ACKs que llegaron desde mas adelante que el cursor. Los clientes
+	// confirman en orden, asi que casi siempre esta vacia.
+	t_list* acked_ahead;
+	t_list* inflight;
+	int active;
+	// Especies que recibe, en minuscula. NULL recibe todo
+	t_dictionary* especies;
+} t_log_cursor;
+
+typedef struct {
+	// Buffer circular indexado por seq, la capacidad es potencia de 2
+	t_log_entry* entries;
+	uint32_t capacity;
+	uint32_t first_seq;
+	uint32_t next_seq;
+	// id -> t_list de los seq vivos con ese id, en orden. Los clientes
+	// reusan ids (p.ej. el id_correlacional de un APPEARED/CAUGHT), asi que
+	// puede haber varios mensajes vivos con el mismo
+	t_dictionary* seqs;
+	t_dictionary* cursors;
+	// id del pedido -> "ip:puerto" de quien espera la respuesta
+	t_dictionary* routes;
+} t_queue_log;
+
+static t_queue_log logs[LOG_QUEUES];
+static pthread_mutex_t mlog = PTHREAD_MUTEX_INITIALIZER;
+
+// Nombres de especie en minuscula, compartidos por todas las entradas. No se
+// liberan hasta el final: son especies, no crecen con los mensajes.
+static t_dictionary* species;
+
+// Un nodo en vuelo por envio: se reutilizan en vez de ir a malloc con cada
+// mensaje
+static t_pool* inflight_pool;
+
+static void log_inflight_release(t_log_inflight* inflight) {
+	pool_release(inflight_pool, inflight);
+}
+
+static struct {
+	int timeout_ms;
+	int max_timeout_ms;
+	int intentos;
+	int max_en_vuelo;
+} retransmission;
+
+void broker_log_init(int timeout_ms, int max_timeout_ms, int intentos,
+		int max_en_vuelo) {
+	retransmission.timeout_ms = timeout_ms;
+	retransmission.max_timeout_ms = max_timeout_ms;
+	retransmission.intentos = intentos;
+	retransmission.max_en_vuelo = max_en_vuelo;
+	for (int i = 0; i < LOG_QUEUES; i++) {
+		logs[i].capacity = LOG_INITIAL_CAPACITY;
+		logs[i].entries = malloc(LOG_INITIAL_CAPACITY * sizeof(t_log_entry));
+		// La secuencia arranca en 1: en el diccionario 0 es "no esta"
+		logs[i].first_seq = 1;
+		logs[i].next_seq = 1;
+		logs[i].seqs = dictionary_create();
+		logs[i].cursors = dictionary_create();
+		logs[i].routes = dictionary_create();
+	}
+	species = dictionary_create();
+	inflight_pool = pool_create(sizeof(t_log_inflight), 0);
+}
+
+static void log_cursor_destroy(t_log_cursor* cursor) {
+	free(cursor->key);
+	list_destroy(cursor->acked_ahead);
+	list_destroy_and_destroy_elements(cursor->inflight,
+			(void*) log_inflight_release);
+	if (cursor->especies != NULL)
+		dictionary_destroy(cursor->especies);
+	free(cursor);
+}
+
+void broker_log_destroy() {
+	for (int i = 0; i < LOG_QUEUES; i++) {
+		for (uint32_t seq = logs[i].first_seq; seq < logs[i].next_seq; seq++)
+			free(logs[i].entries[seq & (logs[i].capacity - 1)].owner);
+		free(logs[i].entries);
+		dictionary_destroy_and_destroy_elements(logs[i].seqs,
+				(void*) list_destroy);
+		dictionary_destroy_and_destroy_elements(logs[i].routes, free);
+		dictionary_destroy_and_destroy_elements(logs[i].cursors,
+				(void*) log_cursor_destroy);
+	}
+	dictionary_destroy_and_destroy_elements(species, free);
+	pool_destroy(inflight_pool);
+}
+
+static t_log_entry* log_entry(t_queue_log* log, uint32_t seq) {
+	return &log->entries[seq & (log->capacity - 1)];
+}
+
+static bool log_contains(t_queue_log* log, uint32_t seq) {
+	return seq >= log->first_seq && seq < log->next_seq;
+}
+
+static void log_grow(t_queue_log* log) {
+	uint32_t capacity = log->capacity * 2;
+	t_log_entry* entries = malloc(capacity * sizeof(t_log_entry));
+	for (uint32_t seq = log->first_seq; seq < log->next_seq; seq++)
+		entries[seq & (capacity - 1)] = *log_entry(log, seq);
+	free(log->entries);
+	log->entries = entries;
+	log->capacity = capacity;
+}
+
+// Descarta del principio los mensajes que ya no estan en memoria
+static void log_trim(t_queue_log* log) {
+	while (log->first_seq < log->next_seq
+			&& !log_entry(log, log->first_seq)->live)
+		log->first_seq++;
+}
+
+static void log_add_seq(t_queue_log* log, uint32_t id, uint32_t seq) {
+	char* key = string_itoa(id);
+	t_list* seqs = dictionary_get(log->seqs, key);
+	if (seqs == NULL) {
+		seqs = list_create();
+		dictionary_put(log->seqs, key, seqs);
+	}
+	free(key);
+	list_add(seqs, (void*) (uintptr_t) seq);
+}
+
+static void log_remove_seq(t_queue_log* log, uint32_t id, uint32_t seq) {
+	char* key = string_itoa(id);
+	t_list* seqs = dictionary_get(log->seqs, key);
+	if (seqs != NULL) {
+		bool is_seq(void* other) {
+			return (uintptr_t) other == seq;
+		}
+		list_remove_by_condition(seqs, (void*) is_seq);
+		if (list_is_empty(seqs))
+			list_destroy(dictionary_remove(log->seqs, key));
+	}
+	free(key);
+}
+
+static void log_kill(t_queue_log* log, uint32_t seq) {
+	t_log_entry* entry = log_entry(log, seq);
+	log_remove_seq(log, entry->id, seq);
+	entry->live = false;
+	free(entry->owner);
+	entry->owner = NULL;
+	log_trim(log);
+}
+
+// Cola por la que llega la respuesta a un pedido de la cola dada
+static int log_reply_queue(t_cola cola) {
+	switch (cola) {
+	case GET_QUEUE:
+		return LOCALIZED_QUEUE;
+	case CATCH_QUEUE:
+		return CAUGHT_QUEUE;
+	default:
+		return -1;
+	}
+}
+
+// Se llama con el mutex tomado
+static char* log_species(char* especie) {
+	if (especie == NULL)
+		return NULL;
+	char* key = string_duplicate(especie);
+	string_to_lower(key);
+	char* interned = dictionary_get(species, key);
+	if (interned == NULL) {
+		interned = key;
+		dictionary_put(species, key, interned);
+	} else {
+		free(key);
+	}
+	return interned;
+}
+
+static char* log_owner_key(char* ip, uint32_t puerto) {
+	return string_from_format("%s:%d", ip, puerto);
+}
+
+uint32_t broker_log_append(t_cola cola, uint32_t id, void* data,
+		uint64_t generacion, char* especie) {
+	t_queue_log* log = &logs[cola];
+	pthread_mutex_lock(&mlog);
+
+	if (log->next_seq - log->first_seq == log->capacity)
+		log_grow(log);
+
+	uint32_t seq = log->next_seq++;
+	t_log_entry* entry = log_entry(log, seq);
+	entry->seq = seq;
+	entry->id = id;
+	entry->data = data;
+	entry->generacion = generacion;
+	entry->live = true;
+	entry->especie = log_species(especie);
+
+	char* key = string_itoa(id);
+	entry->owner = dictionary_remove(log->routes, key);
+	free(key);
+	log_add_seq(log, id, seq);
+
+	pthread_mutex_unlock(&mlog);
+	return seq;
+}
+
+void broker_log_route(t_cola cola, uint32_t id, char* ip, uint32_t puerto) {
+	int reply = log_reply_queue(cola);
+	if (reply < 0)
+		return;
+	char* key = string_itoa(id);
+	pthread_mutex_lock(&mlog);
+	free(dictionary_remove(logs[reply].routes, key));
+	dictionary_put(logs[reply].routes, key, log_owner_key(ip, puerto));
+	pthread_mutex_unlock(&mlog);
+	free(key);
+}
+
+void broker_log_remove(t_cola cola, uint32_t id, void* data) {
+	t_queue_log* log = &logs[cola];
+	int reply = log_reply_queue(cola);
+	pthread_mutex_lock(&mlog);
+	char* seqs_key = string_itoa(id);
+	t_list* seqs = dictionary_get(log->seqs, seqs_key);
+	free(seqs_key);
+	bool is_data(void* seq) {
+		return log_entry(log, (uintptr_t) seq)->data == data;
+	}
+	uintptr_t seq = seqs == NULL ? 0 :
+			(uintptr_t) list_find(seqs, (void*) is_data);
+	if (seq != 0)
+		log_kill(log, seq);
+	if (reply >= 0) {
+		char* key = string_itoa(id);
+		free(dictionary_remove(logs[reply].routes, key));
+		free(key);
+	}
+	pthread_mutex_unlock(&mlog);
+}
+
+char* broker_log_take_route(t_cola cola, uint32_t id) {
+	char* key = string_itoa(id);
+	pthread_mutex_lock(&mlog);
+	char* owner = dictionary_remove(logs[cola].routes, key);
+	pthread_mutex_unlock(&mlog);
+	free(key);
+	return owner;
+}
+
+static t_log_cursor* log_cursor(t_queue_log* log, char* ip, uint32_t puerto) {
+	char* key = log_owner_key(ip, puerto);
+	t_log_cursor* cursor = dictionary_get(log->cursors, key);
+	free(key);
+	return cursor;
+}
+
+static bool log_take_ahead(t_log_cursor* cursor, uint32_t seq) {
+	bool is_seq(void* acked) {
+		return (uintptr_t) acked == seq;
+	}
+	return list_remove_by_condition(cursor->acked_ahead, (void*) is_seq)
+			!= NULL;
+}
+
+static bool log_is_ahead(t_log_cursor* cursor, uint32_t seq) {
+	bool is_seq(void* acked) {
+		return (uintptr_t) acked == seq;
+	}
+	return list_any_satisfy(cursor->acked_ahead, (void*) is_seq);
+}
+
+static bool log_is_for(t_log_entry* entry, t_log_cursor* cursor) {
+	if (entry->owner != NULL && strcmp(entry->owner, cursor->key) != 0)
+		return false;
+	return cursor->especies == NULL || entry->especie == NULL
+			|| dictionary_has_key(cursor->especies, entry->especie);
+}
+
+bool broker_log_is_for(t_cola cola, char* owner, char* especie, char* ip,
+		uint32_t puerto) {
+	char* key = log_owner_key(ip, puerto);
+	bool is_for = owner == NULL || strcmp(owner, key) == 0;
+	pthread_mutex_lock(&mlog);
+	t_log_cursor* cursor = dictionary_get(logs[cola].cursors, key);
+	if (is_for && cursor != NULL) {
+		t_log_entry entry = { .owner = owner, .especie = log_species(especie) };
+		is_for = log_is_for(&entry, cursor);
+	}
+	pthread_mutex_unlock(&mlog);
+	free(key);
+	return is_for;
+}
+
+// Avanza el cursor sobre todo lo confirmado, lo que es para otro suscriptor
+// o lo que ya salio de memoria
+static void log_advance(t_queue_log* log, t_log_cursor* cursor) {
+	if (cursor->acked < log->first_seq) {
+		cursor->acked = log->first_seq;
+		bool is_behind(void* acked) {
+			return (uintptr_t) acked < cursor->acked;
+		}
+		while (list_remove_by_condition(cursor->acked_ahead,
+				(void*) is_behind) != NULL)
+			;
+	}
+
+	while (cursor->acked < log->next_seq) {
+		t_log_entry* entry = log_entry(log, cursor->acked);
+		if (entry->live && log_is_for(entry, cursor)
+				&& !log_take_ahead(cursor, cursor->acked))
+			break;
+		cursor->acked++;
+	}
+	if (cursor->sent < cursor->acked)
+		cursor->sent = cursor->acked;
+	while (cursor->sent < log->next_seq) {
+		t_log_entry* entry = log_entry(log, cursor->sent);
+		if (entry->live && log_is_for(entry, cursor)
+				&& !log_is_ahead(cursor, cursor->sent))
+			break;
+		cursor->sent++;
+	}
+}
+
+static uint64_t log_now_ms() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Espera antes del reenvio numero attempts: se duplica en cada intento
+static uint64_t log_timeout(int attempts) {
+	uint64_t timeout = retransmission.timeout_ms;
+	for (int i = 1; i < attempts && timeout < retransmission.max_timeout_ms; i++)
+		timeout *= 2;
+	return timeout < retransmission.max_timeout_ms ?
+			timeout : retransmission.max_timeout_ms;
+}
+
+static void log_start(t_log_cursor* cursor, uint32_t seq, uint64_t now) {
+	t_log_inflight* inflight = pool_alloc(inflight_pool);
+	inflight->seq = seq;
+	inflight->attempts = 1;
+	inflight->deadline = now + log_timeout(1);
+	inflight->parked = false;
+	list_add(cursor->inflight, inflight);
+	cursor->active++;
+}
+
+static void log_forget(t_log_cursor* cursor, uint32_t seq) {
+	bool is_seq(t_log_inflight* inflight) {
+		return inflight->seq == seq;
+	}
+	t_log_inflight* inflight = list_remove_by_condition(cursor->inflight,
+			(void*) is_seq);
+	if (inflight == NULL)
+		return;
+	if (!inflight->parked)
+		cursor->active--;
+	log_inflight_release(inflight);
+}
+
+static t_dictionary* log_filter_create(t_list* especies) {
+	if (especies == NULL || list_is_empty(especies))
+		return NULL;
+	t_dictionary* filter = dictionary_create();
+	for (int i = 0; i < list_size(especies); i++) {
+		char* especie = log_species(list_get(especies, i));
+		dictionary_put(filter, especie, especie);
+	}
+	return filter;
+}
+
+void broker_log_subscribe(t_cola cola, char* ip, uint32_t puerto,
+		t_list* especies) {
+	t_queue_log* log = &logs[cola];
+	pthread_mutex_lock(&mlog);
+	t_log_cursor* cursor = log_cursor(log, ip, puerto);
+	if (cursor != NULL) {
+		if (cursor->especies != NULL)
+			dictionary_destroy(cursor->especies);
+	} else {
+		cursor = malloc(sizeof(t_log_cursor));
+		cursor->key = log_owner_key(ip, puerto);
+		cursor->acked = log->first_seq;
+		cursor->sent = log->first_seq;
+		cursor->acked_ahead = list_create();
+		cursor->inflight = list_create();
+		cursor->active = 0;
+
+		dictionary_put(log->cursors, cursor->key, cursor);
+	}
+	cursor->especies = log_filter_create(especies);
+	pthread_mutex_unlock(&mlog);
+}
+
+// El ACK trae solo el id. Si hay varios vivos con ese id, confirma el que el
+// suscriptor tiene en vuelo o, si no, el primero que le falta confirmar
+static uint32_t log_seq_to_ack(t_queue_log* log, t_log_cursor* cursor,
+		uint32_t id) {
+	char* key = string_itoa(id);
+	t_list* seqs = dictionary_get(log->seqs, key);
+	free(key);
+	if (seqs == NULL)
+		return 0;
+
+	bool in_flight(void* seq) {
+		bool is_seq(t_log_inflight* inflight) {
+			return inflight->seq == (uintptr_t) seq;
+		}
+		return list_any_satisfy(cursor->inflight, (void*) is_seq);
+	}
+	bool pending(void* seq) {
+		return (uintptr_t) seq >= cursor->acked
+				&& log_is_for(log_entry(log, (uintptr_t) seq), cursor)
+				&& !log_is_ahead(cursor, (uintptr_t) seq);
+	}
+	uintptr_t seq = (uintptr_t) list_find(seqs, (void*) in_flight);
+	if (seq == 0)
+		seq = (uintptr_t) list_find(seqs, (void*) pending);
+	return seq;
+}
+
+void broker_log_ack(t_cola cola, uint32_t id, char* ip, uint32_t puerto) {
+	t_queue_log* log = &logs[cola];
+	pthread_mutex_lock(&mlog);
+	t_log_cursor* cursor = log_cursor(log, ip, puerto);
+	uint32_t seq = cursor == NULL ? 0 : log_seq_to_ack(log, cursor, id);
+	if (seq != 0 && cursor != NULL) {
+		log_forget(cursor, seq);
+		if (seq >= cursor->acked && !log_is_ahead(cursor, seq))
+			list_add(cursor->acked_ahead, (void*) (uintptr_t) seq);
+		log_advance(log, cursor);
+	}
+	pthread_mutex_unlock(&mlog);
+}
+
+bool broker_log_track(t_cola cola, uint32_t seq, char* ip, uint32_t puerto) {
+	t_queue_log* log = &logs[cola];
+	bool tracked = false;
+	pthread_mutex_lock(&mlog);
+	t_log_cursor* cursor = log_cursor(log, ip, puerto);
+	if (cursor != NULL) {
+		log_advance(log, cursor);
+		// Si tiene mensajes anteriores esperando lugar, este va detras de ellos
+		if (cursor->sent == seq && log_contains(log, seq)
+				&& cursor->active < retransmission.max_en_vuelo) {
+			log_start(cursor, seq, log_now_ms());
+			cursor->sent++;
+			tracked = true;
+		}
+	}
+	pthread_mutex_unlock(&mlog);
+	return tracked;
+}
+
+int broker_log_due(t_cola cola, char* ip, uint32_t puerto, t_log_entry* batch,
+		int max) {
+	t_queue_log* log = &logs[cola];
+	int count = 0;
+	pthread_mutex_lock(&mlog);
+	t_log_cursor* cursor = log_cursor(log, ip, puerto);
+	if (cursor == NULL) {
+		pthread_mutex_unlock(&mlog);
+		return 0;
+	}
+	log_advance(log, cursor);
+	uint64_t now = log_now_ms();
+
+	// Vencidos
+	for (int i = 0; i < list_size(cursor->inflight) && count < max; i++) {
+		t_log_inflight* inflight = list_get(cursor->inflight, i);
+		if (!log_contains(log, inflight->seq)
+				|| !log_entry(log, inflight->seq)->live) {
+			// Salio de memoria, ya no hay nada que reenviar
+			list_remove(cursor->inflight, i--);
+			if (!inflight->parked)
+				cursor->active--;
+			log_inflight_release(inflight);
+			continue;
+		}
+		if (inflight->parked || inflight->deadline > now)
+			continue;
+		if (inflight->attempts >= retransmission.intentos) {
+			inflight->parked = true;
+			cursor->active--;
+			continue;
+		}
+		inflight->attempts++;
+		inflight->deadline = now + log_timeout(inflight->attempts);
+		batch[count++] = *log_entry(log, inflight->seq);
+	}
+
+	// Nuevos, mientras haya lugar en vuelo
+	while (cursor->sent < log->next_seq && count < max
+			&& cursor->active < retransmission.max_en_vuelo) {
+		uint32_t seq = cursor->sent++;
+		t_log_entry* entry = log_entry(log, seq);
+		if (!entry->live || !log_is_for(entry, cursor)
+				|| log_is_ahead(cursor, seq))
+			continue;
+		log_start(cursor, seq, now);
+		batch[count++] = *entry;
+	}
+	pthread_mutex_unlock(&mlog);
+	return count;
+}
+
+void broker_log_reset(t_cola cola, char* ip, uint32_t puerto) {
+	t_queue_log* log = &logs[cola];
+	pthread_mutex_lock(&mlog);
+	t_log_cursor* cursor = log_cursor(log, ip, puerto);
+	if (cursor != NULL) {
+		list_clean_and_destroy_elements(cursor->inflight,
+				(void*) log_inflight_release);
+		cursor->active = 0;
+		cursor->sent = cursor->acked;
+		log_advance(log, cursor);
+	}
+	pthread_mutex_unlock(&mlog);
+}
+
+int broker_log_count(t_cola cola, uint32_t id) {
+	char* key = string_itoa(id);
+	pthread_mutex_lock(&mlog);
+	t_list* seqs = dictionary_get(logs[cola].seqs, key);
+	int count = seqs == NULL ? 0 : list_size(seqs);
+	pthread_mutex_unlock(&mlog);
+	free(key);
+	return count;
+}
+
+t_list* broker_log_snapshot_entries(t_cola cola) {
+	t_queue_log* log = &logs[cola];
+	int reply = log_reply_queue(cola);
+	t_list* entries = list_create();
+	pthread_mutex_lock(&mlog);
+	for (uint32_t seq = log->first_seq; seq < log->next_seq; seq++) {
+		t_log_entry* entry = log_entry(log, seq);
+		if (!entry->live)
+			continue;
+		t_log_entry* copy = malloc(sizeof(t_log_entry));
+		*copy = *entry;
+		char* owner = entry->owner;
+		if (reply >= 0) {
+			char* key = string_itoa(entry->id);
+			owner = dictionary_get(logs[reply].routes, key);
+			free(key);
+		}
+		copy->owner = owner == NULL ? NULL : string_duplicate(owner);
+		list_add(entries, copy);
+	}
+	pthread_mutex_unlock(&mlog);
+	return entries;
+}
+
+static void log_snapshot_entry_destroy(t_log_entry* entry) {
+	free(entry->owner);
+	free(entry);
+}
+
+void broker_log_snapshot_entries_destroy(t_list* entries) {
+	list_destroy_and_destroy_elements(entries,
+			(void*) log_snapshot_entry_destroy);
+}
+
+t_list* broker_log_snapshot_cursors(t_cola cola) {
+	t_queue_log* log = &logs[cola];
+	t_list* cursors = list_create();
+	void add_cursor(char* key, t_log_cursor* cursor) {
+		t_log_cursor_snapshot* snapshot = malloc(
+				sizeof(t_log_cursor_snapshot));
+		// La clave es "ip:puerto" y la ip puede ser unix:/ruta
+		char* separator = strrchr(key, ':');
+		snapshot->ip = string_substring_until(key, separator - key);
+		snapshot->puerto = atoi(separator + 1);
+		snapshot->especies = NULL;
+		if (cursor->especies != NULL) {
+			snapshot->especies = list_create();
+			void add_especie(char* especie, void* value) {
+				list_add(snapshot->especies, string_duplicate(especie));
+			}
+			dictionary_iterator(cursor->especies, (void*) add_especie);
+		}
+		snapshot->acks = list_create();
+		for (uint32_t seq = log->first_seq; seq < log->next_seq; seq++) {
+			t_log_entry* entry = log_entry(log, seq);
+			if (entry->live && log_is_for(entry, cursor)
+					&& (seq < cursor->acked || log_is_ahead(cursor, seq)))
+				list_add(snapshot->acks, (void*) (uintptr_t) entry->id);
+		}
+		list_add(cursors, snapshot);
+	}
+	pthread_mutex_lock(&mlog);
+	dictionary_iterator(log->cursors, (void*) add_cursor);
+	pthread_mutex_unlock(&mlog);
+	return cursors;
+}
+
+static void log_cursor_snapshot_destroy(t_log_cursor_snapshot* snapshot) {
+	free(snapshot->ip);
+	if (snapshot->especies != NULL)
+		list_destroy_and_destroy_elements(snapshot->especies, free);
+	list_destroy(snapshot->acks);
+	free(snapshot);
+}
+
+void broker_log_snapshot_cursors_destroy(t_list* cursors) {
+	list_destroy_and_destroy_elements(cursors,
+			(void*) log_cursor_snapshot_destroy);
+}
@@ -0,0 +1,179 @@
+#ifndef LOG_BROKER_LOG_H_
+#define LOG_BROKER_LOG_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <commons/string.h>
+#include <commons/collections/list.h>
+#include <commons/collections/dictionary.h>
+
+#include "../../../shared-common/common/protocols.h"
+#include "../../../shared-common/common/pool.h"
+
+// Cantidad de mensajes que se copian del log por vez al reenviar
+#define BROKER_LOG_BATCH	32
+
+// Cada cola guarda sus mensajes en orden de llegada con un numero de
+// secuencia. Cada suscriptor (ip, puerto) tiene un cursor por cola: todo lo
+// anterior al cursor ya fue confirmado. Reenviar al reconectarse es recorrer
+// desde el cursor hasta el final.
+//
+// Lo enviado y todavia sin ACK queda en vuelo con un vencimiento. Al vencer se
+// reenvia duplicando el timeout, hasta agotar los intentos: ahi se deja de
+// reintentar hasta que el suscriptor se reconecte. Cada suscriptor tiene un
+// maximo de mensajes en vuelo; lo que no entra sale cuando llegan ACKs.
+//
+// Un LOCALIZED/CAUGHT que responde a un GET/CATCH de un suscriptor conocido
+// tiene dueño y solo se le envia a el; para el resto de los cursores es como
+// si ya estuviera confirmado. Lo mismo con los mensajes de especies que no
+// estan en el filtro con el que se suscribio.
+typedef struct {
+	uint32_t seq;
+	uint32_t id;
+	void* data;
+	// Para validar data: la generacion de la particion en memoria
+	uint64_t generacion;
+	bool live;
+	char* owner;
+	char* especie;
+} t_log_entry;
+
+// Estado de un cursor para copiarselo a la replica
+typedef struct {
+	char* ip;
+	uint32_t puerto;
+	// NULL si recibe todo
+	t_list* especies;
+	// Ids de lo que ya confirmo y sigue en el log, en orden
+	t_list* acks;
+} t_log_cursor_snapshot;
+
+/**
+ * @NAME: broker_log_init
+ * @DESC: Crea el log y los cursores de cada cola. timeout_ms es la espera
+ * 		antes del primer reenvio, max_timeout_ms el tope del backoff.
+ */
+void broker_log_init(int timeout_ms, int max_timeout_ms, int intentos,
+		int max_en_vuelo);
+
+/**
+ * @NAME: broker_log_append
+ * @DESC: Agrega el mensaje id al final del log de la cola. data es lo que
+ * 		devuelve broker_log_due para encontrarlo en memoria, junto con su
+ * 		generacion. especie es el pokemon del mensaje, NULL si no tiene
+ * 		(CAUGHT).
+ */
+uint32_t broker_log_append(t_cola cola, uint32_t id, void* data,
+		uint64_t generacion, char* especie);
+
+/**
+ * @NAME: broker_log_route
+ * @DESC: Registra que el GET/CATCH id lo envio el suscriptor (ip, puerto).
+ * 		Cuando llegue su respuesta se agrega al log con ese dueño.
+ */
+void broker_log_route(t_cola cola, uint32_t id, char* ip, uint32_t puerto);
+
+/**
+ * @NAME: broker_log_remove
+ * @DESC: Marca el mensaje como fuera de memoria. Entre los que tienen ese id
+ * 		es el que se agrego con data. Ya no se reenvia ni hace falta su ACK
+ * 		para avanzar los cursores. Si era un GET/CATCH se olvida quien lo
+ * 		envio: una respuesta posterior va a todos.
+ */
+void broker_log_remove(t_cola cola, uint32_t id, void* data);
+
+/**
+ * @NAME: broker_log_take_route
+ * @DESC: Saca y devuelve el "ip:puerto" que espera la respuesta id de la cola,
+ * 		o NULL si va a todos. Para los mensajes que no entran al log; el que
+ * 		llama la libera.
+ */
+char* broker_log_take_route(t_cola cola, uint32_t id);
+
+/**
+ * @NAME: broker_log_is_for
+ * @DESC: Si un mensaje fuera del log, con ese dueño y especie, le corresponde
+ * 		al suscriptor (ip, puerto). Mismo criterio que el de los mensajes del
+ * 		log.
+ */
+bool broker_log_is_for(t_cola cola, char* owner, char* especie, char* ip,
+		uint32_t puerto);
+
+/**
+ * @NAME: broker_log_subscribe
+ * @DESC: Crea el cursor del suscriptor si no existia. Un suscriptor nuevo
+ * 		arranca desde el mensaje mas viejo que sigue en memoria. especies
+ * 		reemplaza el filtro anterior; NULL o vacia recibe todo.
+ */
+void broker_log_subscribe(t_cola cola, char* ip, uint32_t puerto,
+		t_list* especies);
+
+/**
+ * @NAME: broker_log_ack
+ * @DESC: Registra el ACK del suscriptor para el mensaje id y avanza su cursor
+ * 		si corresponde. Si hay varios mensajes con ese id confirma el que tiene
+ * 		en vuelo o, si no, el primero que le falta.
+ */
+void broker_log_ack(t_cola cola, uint32_t id, char* ip, uint32_t puerto);
+
+/**
+ * @NAME: broker_log_track
+ * @DESC: Se llama antes de enviarle al suscriptor el mensaje recien agregado.
+ * 		Si es para el, es el siguiente que le toca y tiene lugar en vuelo lo
+ * 		registra y devuelve true; si no, no se envia o queda para
+ * 		broker_log_due.
+ */
+bool broker_log_track(t_cola cola, uint32_t seq, char* ip, uint32_t puerto);
+
+/**
+ * @NAME: broker_log_due
+ * @DESC: Copia en batch hasta max mensajes que hay que enviarle al
+ * 		suscriptor: primero los vencidos, despues los que nunca se enviaron
+ * 		mientras haya lugar en vuelo. Los deja registrados como enviados.
+ * 		Devuelve cuantos copio; se llama hasta que devuelva 0.
+ */
+int broker_log_due(t_cola cola, char* ip, uint32_t puerto, t_log_entry* batch,
+		int max);
+
+/**
+ * @NAME: broker_log_reset
+ * @DESC: El suscriptor se reconecto: lo que estaba en vuelo se perdio con la
+ * 		conexion anterior y se vuelve a enviar todo desde el cursor.
+ */
+void broker_log_reset(t_cola cola, char* ip, uint32_t puerto);
+
+/**
+ * @NAME: broker_log_count
+ * @DESC: Cuantos mensajes vivos con ese id hay en el log de la cola.
+ */
+int broker_log_count(t_cola cola, uint32_t id);
+
+/**
+ * @NAME: broker_log_snapshot_entries
+ * @DESC: Copia en una lista nueva las entradas vivas de la cola, en orden. En
+ * 		un GET/CATCH owner es quien espera la respuesta. Se libera con
+ * 		broker_log_snapshot_entries_destroy.
+ */
+t_list* broker_log_snapshot_entries(t_cola cola);
+void broker_log_snapshot_entries_destroy(t_list* entries);
+
+/**
+ * @NAME: broker_log_snapshot_cursors
+ * @DESC: Lista de t_log_cursor_snapshot con los cursores de la cola: su
+ * 		filtro y lo que confirmaron, incluidos los ACK adelantados. Se libera
+ * 		con broker_log_snapshot_cursors_destroy.
+ */
+t_list* broker_log_snapshot_cursors(t_cola cola);
+void broker_log_snapshot_cursors_destroy(t_list* cursors);
+
+/**
+ * @NAME: broker_log_destroy
+ * @DESC: Libera el log y los cursores.
+ */
+void broker_log_destroy();
+
+#endif /* LOG_BROKER_LOG_H_ */
@@ -0,0 +1,151 @@
+#include "broker_replica.h"
+
+static char* replica_ip = NULL;
+static int replica_port;
+static t_handshake origin;
+static t_list* pending;
+static int discarded;
+static bool running = false;
+static t_replica_snapshot take_snapshot;
+static pthread_t worker;
+static pthread_mutex_t replica_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t replica_available = PTHREAD_COND_INITIALIZER;
+
+// Envia la copia del estado entre dos REPLICA. Lo que se encola mientras
+// tanto sale despues
+static int broker_replica_sync(int fd) {
+	t_list* packages = list_create();
+	take_snapshot(packages);
+	int count = list_size(packages);
+	int result = 0;
+	for (int i = 0; i < count && result == 0; i++) {
+		if (utils_package_send_to(list_get(packages, i), fd) < 0)
+			result = -1;
+	}
+	list_destroy_and_destroy_elements(packages,
+			(void*) utils_package_destroy);
+	if (result == 0)
+		result = utils_serialize_and_send(fd, REPLICA, &origin);
+	if (result == 0) {
+		broker_logger_info("Estado copiado a la replica: %d mensajes", count);
+	}
+	return result;
+}
+
+static int broker_replica_connect() {
+	int fd = socket_connect_to_server(replica_ip, replica_port);
+	if (fd < 0)
+		return -1;
+	if (utils_serialize_and_send(fd, REPLICA, &origin) < 0
+			|| broker_replica_sync(fd) < 0) {
+		socket_close_conection(fd);
+		return -1;
+	}
+	broker_logger_info("Replicando mensajes al broker %s:%d", replica_ip,
+			replica_port);
+	return fd;
+}
+
+static void* broker_replica_loop(void* arg) {
+	int fd = -1;
+
+	pthread_mutex_lock(&replica_mutex);
+	while (running) {
+		if (fd < 0) {
+			pthread_mutex_unlock(&replica_mutex);
+			fd = broker_replica_connect();
+			if (fd < 0)
+				usleep(BROKER_REPLICA_RECONEXION);
+			pthread_mutex_lock(&replica_mutex);
+			continue;
+		}
+
+		if (list_is_empty(pending)) {
+			pthread_cond_wait(&replica_available, &replica_mutex);
+			continue;
+		}
+
+		t_package* package = list_remove(pending, 0);
+		pthread_mutex_unlock(&replica_mutex);
+
+		// Un paquete a medio enviar se descarta: la replica ve la conexion
+		// cortada y la siguiente arranca desde un frame completo
+		if (utils_package_send_to(package, fd) < 0) {
+			broker_logger_warn("Se perdio la conexion con la replica");
+			socket_close_conection(fd);
+			fd = -1;
+		}
+		utils_package_destroy(package);
+		pthread_mutex_lock(&replica_mutex);
+	}
+	pthread_mutex_unlock(&replica_mutex);
+
+	if (fd >= 0)
+		socket_close_conection(fd);
+	return NULL;
+}
+
+void broker_replica_init(char* ip, int port, char* own_ip, int own_port,
+		t_replica_snapshot snapshot) {
+	take_snapshot = snapshot;
+	replica_ip = string_duplicate(ip);
+	replica_port = port;
+	origin.ip = string_duplicate(own_ip);
+	origin.puerto = own_port;
+	pending = list_create();
+	discarded = 0;
+	running = true;
+
+	if (pthread_create(&worker, NULL, broker_replica_loop, NULL) != 0) {
+		broker_logger_error("No se pudo crear el hilo de replicacion");
+		running = false;
+	}
+}
+
+void broker_replica_ship(t_protocol protocol, void* message) {
+	// Se asigna antes de aceptar conexiones y no cambia hasta el final
+	if (replica_ip == NULL)
+		return;
+
+	t_package* package = utils_package_from(protocol, message);
+	if (package == NULL)
+		return;
+
+	pthread_mutex_lock(&replica_mutex);
+	if (list_size(pending) >= BROKER_REPLICA_PENDIENTES) {
+		utils_package_destroy(list_remove(pending, 0));
+		if (discarded++ % BROKER_REPLICA_PENDIENTES == 0)
+			broker_logger_warn("La replica no responde, se descartan mensajes");
+	}
+	list_add(pending, package);
+	pthread_cond_signal(&replica_available);
+	pthread_mutex_unlock(&replica_mutex);
+}
+
+void broker_replica_discard() {
+	if (replica_ip == NULL)
+		return;
+
+	pthread_mutex_lock(&replica_mutex);
+	list_clean_and_destroy_elements(pending, (void*) utils_package_destroy);
+	discarded = 0;
+	pthread_mutex_unlock(&replica_mutex);
+}
+
+void broker_replica_destroy() {
+	if (replica_ip == NULL)
+		return;
+
+	pthread_mutex_lock(&replica_mutex);
+	bool started = running;
+	running = false;
+	pthread_cond_broadcast(&replica_available);
+	pthread_mutex_unlock(&replica_mutex);
+	if (started)
+		pthread_join(worker, NULL);
+
+	list_destroy_and_destroy_elements(pending, (void*) utils_package_destroy);
+	free(replica_ip);
+	free(origin.ip);
+	replica_ip = NULL;
+}
@@ -0,0 +1,72 @@
+#ifndef REPLICA_BROKER_REPLICA_H_
+#define REPLICA_BROKER_REPLICA_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <commons/string.h>
+#include <commons/collections/list.h>
+
+#include "../logger/broker_logger.h"
+#include "../../../shared-common/common/protocols.h"
+#include "../../../shared-common/common/sockets.h"
+#include "../../../shared-common/common/utils.h"
+
+// Maximo de mensajes esperando a la replica. Con la replica caida se
+// descartan los mas viejos
+#define BROKER_REPLICA_PENDIENTES	4096
+// Espera entre intentos de conexion a la replica, en microsegundos
+#define BROKER_REPLICA_RECONEXION	1000000
+
+// El primario le envia a su replica, por una conexion propia que arranca con
+// REPLICA, los mismos mensajes que procesa: cada mensaje guardado ya con su
+// ID, los SUBSCRIBE y los ACK. Un GET/CATCH con dueño va precedido del
+// HANDSHAKE de quien lo envio. La replica los aplica igual que si vinieran de
+// un cliente, asi tiene la cache y los cursores para cuando los clientes se
+// pasen a ella.
+//
+// El envio es asincronico: quien procesa el mensaje solo arma el paquete y lo
+// encola, un hilo lo envia.
+//
+// Con cada conexion, antes de lo encolado, el primario le envia una copia de
+// su estado: los mensajes del log (con el HANDSHAKE de su dueño delante si lo
+// tienen), los SUBSCRIBE de cada cursor y los ACK de lo que ya confirmo, y
+// despues un segundo REPLICA. Asi lo perdido con la replica caida o con la
+// cola llena se recupera al reconectar. La replica suma la copia a lo que
+// tiene: no guarda dos veces un mensaje que ya esta en su log.
+
+// Arma en packages la copia del estado. Tiene que llamar a
+// broker_replica_discard en el mismo momento en que lee el estado
+typedef void (*t_replica_snapshot)(t_list* packages);
+
+/**
+ * @NAME: broker_replica_init
+ * @DESC: Arranca el hilo que se conecta a la replica (ip, port) y le envia la
+ * 		copia del estado y lo encolado. own_ip y own_port identifican al
+ * 		primario ante ella.
+ */
+void broker_replica_init(char* ip, int port, char* own_ip, int own_port,
+		t_replica_snapshot snapshot);
+
+/**
+ * @NAME: broker_replica_ship
+ * @DESC: Serializa el mensaje y lo encola para la replica. No hace nada si no
+ * 		hay replica. El mensaje sigue siendo de quien llama.
+ */
+void broker_replica_ship(t_protocol protocol, void* message);
+
+/**
+ * @NAME: broker_replica_discard
+ * @DESC: Descarta lo encolado, que ya esta en la copia del estado que se esta
+ * 		armando.
+ */
+void broker_replica_discard();
+
+/**
+ * @NAME: broker_replica_destroy
+ * @DESC: Frena el hilo y descarta lo que no se llego a enviar.
+ */
+void broker_replica_destroy();
+
+#endif /* REPLICA_BROKER_REPLICA_H_ */
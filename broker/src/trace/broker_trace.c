@@ -0,0 +1,153 @@
+#include "broker_trace.h"
+
+// Buffer circular de un hilo. head lo mueve solo el hilo dueño y tail solo
+// el hilo que escribe, asi ninguno de los dos necesita un mutex
+typedef struct {
+	t_trace_record records[BROKER_TRACE_BUFFER];
+	uint32_t head;
+	uint32_t tail;
+	uint32_t descartados;
+	uint32_t descartados_avisados;
+	// El hilo dueño termino: se vacia una ultima vez y se libera
+	bool cerrado;
+} t_trace_buffer;
+
+static FILE* trace_file = NULL;
+static bool trace_enabled = false;
+static bool trace_running = false;
+static uint64_t trace_start;
+// Buffers de todos los hilos. El mutex solo se toma al crear el buffer de un
+// hilo nuevo y al vaciar, nunca al registrar un evento
+static t_list* trace_buffers;
+static pthread_mutex_t trace_lock;
+static pthread_key_t trace_key;
+static pthread_t trace_writer;
+
+static uint64_t broker_trace_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void broker_trace_thread_exit(void* buffer) {
+	__atomic_store_n(&((t_trace_buffer*) buffer)->cerrado, true,
+			__ATOMIC_RELEASE);
+}
+
+static t_trace_buffer* broker_trace_buffer() {
+	t_trace_buffer* buffer = pthread_getspecific(trace_key);
+	if (buffer == NULL) {
+		buffer = calloc(1, sizeof(t_trace_buffer));
+		pthread_setspecific(trace_key, buffer);
+		pthread_mutex_lock(&trace_lock);
+		list_add(trace_buffers, buffer);
+		pthread_mutex_unlock(&trace_lock);
+	}
+	return buffer;
+}
+
+void broker_trace_record(e_trace_event tipo, t_cola cola, uint32_t id,
+		uint32_t size) {
+	if (!__atomic_load_n(&trace_enabled, __ATOMIC_ACQUIRE))
+		return;
+
+	uint64_t ns = broker_trace_now() - trace_start;
+	t_trace_buffer* buffer = broker_trace_buffer();
+	uint32_t head = buffer->head;
+	if (head - __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE)
+			== BROKER_TRACE_BUFFER) {
+		__atomic_fetch_add(&buffer->descartados, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	t_trace_record* record = &buffer->records[head & (BROKER_TRACE_BUFFER - 1)];
+	record->ns = ns;
+	record->tipo = tipo;
+	record->cola = cola;
+	record->id = id;
+	record->size = size;
+	__atomic_store_n(&buffer->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void broker_trace_drain(t_trace_buffer* buffer) {
+	uint8_t bytes[ALLOC_TRACE_RECORD_SIZE];
+	uint32_t tail = buffer->tail;
+	uint32_t head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+	for (; tail != head; tail++) {
+		alloc_trace_encode(&buffer->records[tail & (BROKER_TRACE_BUFFER - 1)],
+				bytes);
+		fwrite(bytes, 1, ALLOC_TRACE_RECORD_SIZE, trace_file);
+	}
+	__atomic_store_n(&buffer->tail, tail, __ATOMIC_RELEASE);
+}
+
+static void broker_trace_flush() {
+	uint32_t descartados = 0;
+	pthread_mutex_lock(&trace_lock);
+	for (int i = 0; i < list_size(trace_buffers); i++) {
+		t_trace_buffer* buffer = list_get(trace_buffers, i);
+		// Leido antes de vaciar: lo que el hilo registro antes de terminar
+		// ya esta a la vista
+		bool cerrado = __atomic_load_n(&buffer->cerrado, __ATOMIC_ACQUIRE);
+		broker_trace_drain(buffer);
+
+		uint32_t total = __atomic_load_n(&buffer->descartados,
+				__ATOMIC_RELAXED);
+		descartados += total - buffer->descartados_avisados;
+		buffer->descartados_avisados = total;
+		if (cerrado) {
+			list_remove(trace_buffers, i--);
+			free(buffer);
+		}
+	}
+	pthread_mutex_unlock(&trace_lock);
+	fflush(trace_file);
+
+	if (descartados > 0)
+		broker_logger_warn("Traza de memoria: se descartaron %d eventos",
+				descartados);
+}
+
+static void* broker_trace_loop(void* arg) {
+	while (__atomic_load_n(&trace_running, __ATOMIC_ACQUIRE)) {
+		usleep(BROKER_TRACE_FLUSH);
+		broker_trace_flush();
+	}
+	return NULL;
+}
+
+int broker_trace_init(char* path) {
+	trace_file = fopen(path, "wb");
+	if (trace_file == NULL) {
+		broker_logger_error("No se pudo crear la traza de memoria %s", path);
+		return -1;
+	}
+	uint8_t header[ALLOC_TRACE_HEADER_SIZE];
+	alloc_trace_write_header(header);
+	fwrite(header, 1, ALLOC_TRACE_HEADER_SIZE, trace_file);
+
+	trace_buffers = list_create();
+	pthread_mutex_init(&trace_lock, NULL);
+	pthread_key_create(&trace_key, broker_trace_thread_exit);
+	trace_start = broker_trace_now();
+	trace_running = true;
+	pthread_create(&trace_writer, NULL, broker_trace_loop, NULL);
+	__atomic_store_n(&trace_enabled, true, __ATOMIC_RELEASE);
+	broker_logger_info("Grabando la traza de memoria en %s", path);
+	return 0;
+}
+
+void broker_trace_destroy() {
+	if (trace_file == NULL)
+		return;
+	__atomic_store_n(&trace_enabled, false, __ATOMIC_RELEASE);
+	__atomic_store_n(&trace_running, false, __ATOMIC_RELEASE);
+	pthread_join(trace_writer, NULL);
+
+	broker_trace_flush();
+	list_destroy_and_destroy_elements(trace_buffers, free);
+	pthread_key_delete(trace_key);
+	pthread_mutex_destroy(&trace_lock);
+	fclose(trace_file);
+	trace_file = NULL;
+}
@@ -0,0 +1,53 @@
+#ifndef TRACE_BROKER_TRACE_H_
+#define TRACE_BROKER_TRACE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <commons/collections/list.h>
+
+#include "../logger/broker_logger.h"
+#include "../../../shared-common/common/alloc_trace.h"
+#include "../../../shared-common/common/protocols.h"
+
+// Eventos que entran en el buffer de cada hilo, potencia de dos. Si el hilo
+// de escritura no llega a vaciarlo los eventos nuevos se descartan
+#define BROKER_TRACE_BUFFER	4096
+// Cada cuanto se vacian los buffers al archivo, en microsegundos
+#define BROKER_TRACE_FLUSH	10000
+
+// Con TRAZA_MEMORIA el broker graba los eventos de su memoria en el formato
+// de alloc_trace.h: cada alta (tamaño, cola, id), reemplazo, lectura para
+// reenviar, ACK y suscripcion, con el instante en ns. Es lo que reproduce
+// memory-bench para comparar configuraciones con el trafico real.
+//
+// Quien registra un evento nunca espera: lo deja en un buffer circular de su
+// propio hilo y un hilo aparte los escribe. Como cada hilo se vacia por
+// separado, en el archivo los eventos de distintos hilos pueden quedar
+// desordenados; hay que ordenarlos por ns al leer.
+
+/**
+ * @NAME: broker_trace_init
+ * @DESC: Crea el archivo y arranca el hilo que escribe. -1 si no se pudo
+ * 		abrir, en ese caso no se graba nada.
+ */
+int broker_trace_init(char* path);
+
+/**
+ * @NAME: broker_trace_record
+ * @DESC: Registra un evento. No hace nada si la traza no esta activa.
+ */
+void broker_trace_record(e_trace_event tipo, t_cola cola, uint32_t id,
+		uint32_t size);
+
+/**
+ * @NAME: broker_trace_destroy
+ * @DESC: Frena el hilo, escribe lo que quedaba y cierra el archivo.
+ */
+void broker_trace_destroy();
+
+#endif /* TRACE_BROKER_TRACE_H_ */
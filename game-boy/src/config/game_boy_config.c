@@ -14,6 +14,7 @@ void game_boy_config_free()
 	free(game_boy_config->ip_broker);
 	free(game_boy_config->ip_team);
 	free(game_boy_config->ip_gamecard);
+	cluster_destroy(game_boy_config->cluster);
 	free(game_boy_config);
 }
 
@@ -29,6 +30,8 @@ void read_config(t_config* config_file)
 	game_boy_config->puerto_broker = config_get_int_value(config_file, "PUERTO_BROKER");
 	game_boy_config->puerto_team = config_get_int_value(config_file, "PUERTO_TEAM");
 	game_boy_config->puerto_gamecard = config_get_int_value(config_file, "PUERTO_GAMECARD");
+	// Opcional: sin CLUSTER_BROKERS todo va a IP_BROKER:PUERTO_BROKER
+	game_boy_config->cluster = cluster_create(config_file, game_boy_config->ip_broker, game_boy_config->puerto_broker);
 }
 
 void print_config()
@@ -6,6 +6,7 @@
 #include <commons/string.h>
 
 #include "../../../shared-common/common/config.h"
+#include "../../../shared-common/common/cluster.h"
 
 #include "../logger/game_boy_logger.h"
 
@@ -19,6 +20,7 @@ typedef struct
 	int puerto_broker;
 	int puerto_team;
 	int puerto_gamecard;
+	t_cluster* cluster;
 
 } t_game_boy_config;
 
@@ -177,16 +177,17 @@ void subscriber_command(char** arguments, int arguments_size) {
 	sub_snd->puerto = game_boy_config->puerto_broker;
 	sub_snd->cola = get_queue_by_name(arguments[1]);
 	sub_snd->seconds = atoi(arguments[2]);
+	sub_snd->especies = NULL;
 	utils_serialize_and_send(game_boy_broker_fd, subscribe_protocol, sub_snd);
 	usleep(500000);
 
 	int protocol;
-	int received_bytes;
+	void* message;
+	t_frame_reader* reader = framing_reader_create(game_boy_broker_fd, 0);
 
 	while (true) {
-		received_bytes = recv(game_boy_broker_fd, &protocol, sizeof(int), 0);
-
-		if (received_bytes <= 0) {
+		if (utils_receive_message(reader, &protocol, &message) <= 0) {
+			framing_reader_destroy(reader);
 			return;
 		}
 
@@ -194,7 +195,7 @@ void subscriber_command(char** arguments, int arguments_size) {
 
 		case NEW_POKEMON: {
 			game_boy_logger_info("Se recibio un NEW");
-			t_new_pokemon *new_receive = utils_receive_and_deserialize(game_boy_broker_fd, protocol);
+			t_new_pokemon *new_receive = message;
 
 			t_protocol ack_protocol = ACK;
 
@@ -213,7 +214,7 @@ void subscriber_command(char** arguments, int arguments_size) {
 
 		case GET_POKEMON: {
 			game_boy_logger_info("Se recibio un GET");
-			t_get_pokemon *get_rcv = utils_receive_and_deserialize(game_boy_broker_fd, protocol);
+			t_get_pokemon *get_rcv = message;
 
 			t_protocol ack_protocol = ACK;
 
@@ -232,7 +233,7 @@ void subscriber_command(char** arguments, int arguments_size) {
 
 		case CATCH_POKEMON: {
 			game_boy_logger_info("Se recibio un CATCH");
-			t_catch_pokemon *catch_rcv = utils_receive_and_deserialize(game_boy_broker_fd, protocol);
+			t_catch_pokemon *catch_rcv = message;
 
 			t_protocol ack_protocol = ACK;
 
@@ -251,7 +252,7 @@ void subscriber_command(char** arguments, int arguments_size) {
 
 		case CAUGHT_POKEMON: {
 			game_boy_logger_info("Se recibio un CAUGHT");
-			t_caught_pokemon *caught_rcv = utils_receive_and_deserialize(game_boy_broker_fd, protocol);
+			t_caught_pokemon *caught_rcv = message;
 
 			t_protocol ack_protocol = ACK;
 
@@ -274,7 +275,7 @@ void subscriber_command(char** arguments, int arguments_size) {
 
 		case LOCALIZED_POKEMON: {
 			game_boy_logger_info("Se recibio un LOCALIZED");
-			t_localized_pokemon *loc_rcv = utils_receive_and_deserialize(game_boy_broker_fd, protocol);
+			t_localized_pokemon *loc_rcv = message;
 
 			t_protocol ack_protocol = ACK;
 
@@ -293,7 +294,7 @@ void subscriber_command(char** arguments, int arguments_size) {
 
 		case APPEARED_POKEMON: {
 			game_boy_logger_info("Se recibio un APPEARED");
-			t_appeared_pokemon *appeared_rcv = utils_receive_and_deserialize(game_boy_broker_fd, protocol);
+			t_appeared_pokemon *appeared_rcv = message;
 
 			t_protocol ack_protocol = ACK;
 
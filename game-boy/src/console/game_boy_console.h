@@ -36,6 +36,7 @@ typedef struct {
 } t_command;
 
 int game_boy_console_read(t_dictionary*, char*[], int);
+t_cola get_queue_by_name(char*);
 t_dictionary* game_boy_get_command_actions();
 void game_boy_free_command_actions(t_dictionary*);
 
@@ -28,9 +28,32 @@ int game_boy_load() {
 	return 0;
 }
 
+int game_boy_broker_queue(char* option, char* type) {
+	if (string_equals_ignore_case(option, "SUBSCRIBE"))
+		return get_queue_by_name(type);
+	if (string_equals_ignore_case(type, "NEW_POKEMON"))
+		return NEW_QUEUE;
+	if (string_equals_ignore_case(type, "APPEARED_POKEMON"))
+		return APPEARED_QUEUE;
+	if (string_equals_ignore_case(type, "GET_POKEMON"))
+		return GET_QUEUE;
+	if (string_equals_ignore_case(type, "LOCALIZED_POKEMON"))
+		return LOCALIZED_QUEUE;
+	if (string_equals_ignore_case(type, "CATCH_POKEMON"))
+		return CATCH_QUEUE;
+	if (string_equals_ignore_case(type, "CAUGHT_POKEMON"))
+		return CAUGHT_QUEUE;
+	return -1;
+}
+
 void connect_to_broker() {
-	game_boy_broker_fd = socket_connect_to_server(game_boy_config->ip_broker,
-			game_boy_config->puerto_broker);
+	if (broker_queue >= 0) {
+		game_boy_broker_fd = cluster_connect(game_boy_config->cluster,
+				broker_queue);
+	} else {
+		game_boy_broker_fd = cluster_node_connect(
+				list_get(game_boy_config->cluster->nodes, 0));
+	}
 	if (game_boy_broker_fd < 0) {
 		socket_close_conection(game_boy_broker_fd);
 		exit(EXIT_FAILURE);
@@ -102,6 +125,7 @@ void game_boy_init(int argcount, char* arguments[]) {
 		if (string_equals_ignore_case(match, "BROKER")
 				|| string_equals_ignore_case(match, "SUBSCRIBE")) {
 			game_boy_logger_info("Creando un hilo para enviar al broker");
+			broker_queue = game_boy_broker_queue(match, arguments[2]);
 			pthread_create(&tid[0], NULL, (void*) connect_to_broker, NULL);
 		}
 
@@ -21,6 +21,8 @@ void game_boy_exit();
 char* valid_options[4] = {"BROKER", "GAMECARD", "TEAM", "SUBSCRIBE"};
 _Bool connected = false;
 pthread_t tid[2];
+// Cola del mensaje a enviar, decide a que broker del cluster conectarse
+int broker_queue = -1;
 
 struct t_console_args {
 	char* arguments[20];
@@ -14,6 +14,7 @@ C_DEPS :=
 # Every subdirectory with source files must be described here
 SUBDIRS := \
 src/config \
+src/delay \
 src/file_system \
 src \
 src/logger \
@@ -3,6 +3,11 @@
 void read_config(t_config* config_file);
 void print_config();
 
+static int read_optional_int(t_config* config_file, char* key, int default_value)
+{
+	return config_has_property(config_file, key) ? config_get_int_value(config_file, key) : default_value;
+}
+
 int game_card_config_load()
 {
 	game_card_logger_info("Se establecerá la configuración");
@@ -12,7 +17,9 @@ int game_card_config_load()
 void game_card_config_free()
 {
 	free(game_card_config->punto_montaje_tallgrass);
+	free(game_card_config->almacenamiento_bloques);
 	free(game_card_config->ip_broker);
+	cluster_destroy(game_card_config->cluster);
 	free(game_card_config);
 }
 
@@ -21,12 +28,27 @@ void read_config(t_config* config_file)
 	game_card_config = malloc(sizeof(t_game_card_config));
 	game_card_config->tiempo_de_reintento_conexion = config_get_int_value(config_file, "TIEMPO_DE_REINTENTO_CONEXION");
 	game_card_config->tiempo_de_reintento_operacion = config_get_int_value(config_file, "TIEMPO_DE_REINTENTO_OPERACION");
+	// Opcionales: TIEMPO_RETARDO_OPERACION vale para las tres y cada una se puede pisar
+	int tiempo_retardo = read_optional_int(config_file, "TIEMPO_RETARDO_OPERACION", 0);
+	game_card_config->tiempo_retardo_new = read_optional_int(config_file, "TIEMPO_RETARDO_NEW", tiempo_retardo);
+	game_card_config->tiempo_retardo_get = read_optional_int(config_file, "TIEMPO_RETARDO_GET", tiempo_retardo);
+	game_card_config->tiempo_retardo_catch = read_optional_int(config_file, "TIEMPO_RETARDO_CATCH", tiempo_retardo);
+	// Opcional: cuanto puede esperar un cambio antes de escribirse a los bloques
+	game_card_config->escritura_diferida = read_optional_int(config_file, "ESCRITURA_DIFERIDA", ESCRITURA_DIFERIDA_DEFAULT);
 	game_card_config->punto_montaje_tallgrass = malloc(sizeof(char*));
 	game_card_config->punto_montaje_tallgrass = string_duplicate(config_get_string_value(config_file, "PUNTO_MONTAJE_TALLGRASS"));
+	// Opcional: sin ALMACENAMIENTO_BLOQUES un archivo por bloque, como pide el enunciado
+	game_card_config->almacenamiento_bloques = string_duplicate(config_has_property(config_file, "ALMACENAMIENTO_BLOQUES") ?
+			config_get_string_value(config_file, "ALMACENAMIENTO_BLOQUES") : "ARCHIVOS");
 	game_card_config->ip_broker = string_duplicate(config_get_string_value(config_file, "IP_BROKER"));
 	game_card_config->puerto_broker = config_get_int_value(config_file, "PUERTO_BROKER");
+	// Opcional: sin CLUSTER_BROKERS todo va a IP_BROKER:PUERTO_BROKER
+	game_card_config->cluster = cluster_create(config_file, game_card_config->ip_broker, game_card_config->puerto_broker);
 	game_card_config->ip_game_card = string_duplicate(config_get_string_value(config_file, "IP_GAMECARD"));
 	game_card_config->puerto_game_card = config_get_int_value(config_file, "PUERTO_GAMECARD");
+	// Opcional: LOCALIZED con (x, y, cantidad) en lugar de una posicion por pokemon
+	game_card_config->localized_compacto = config_has_property(config_file, "LOCALIZED_COMPACTO")
+			&& config_get_int_value(config_file, "LOCALIZED_COMPACTO") == 1;
 
 }
 
@@ -34,9 +56,19 @@ void print_config()
 {
 	game_card_logger_info("TIEMPO_DE_REINTENTO_CONEXION: %d", game_card_config->tiempo_de_reintento_conexion);
 	game_card_logger_info("TIEMPO_DE_REINTENTO_OPERACION: %d", game_card_config->tiempo_de_reintento_operacion);
+	game_card_logger_info("TIEMPO_RETARDO_NEW: %d", game_card_config->tiempo_retardo_new);
+	game_card_logger_info("TIEMPO_RETARDO_GET: %d", game_card_config->tiempo_retardo_get);
+	game_card_logger_info("TIEMPO_RETARDO_CATCH: %d", game_card_config->tiempo_retardo_catch);
+	game_card_logger_info("ESCRITURA_DIFERIDA: %d", game_card_config->escritura_diferida);
 	game_card_logger_info("PUNTO_MONTAJE_TALLGRASS: %s", game_card_config->punto_montaje_tallgrass);
+	game_card_logger_info("ALMACENAMIENTO_BLOQUES: %s", game_card_config->almacenamiento_bloques);
 	game_card_logger_info("IP_BROKER: %s", game_card_config->ip_broker);
 	game_card_logger_info("PUERTO_BROKER: %d", game_card_config->puerto_broker);
+	for (int i = 0; i < list_size(game_card_config->cluster->nodes); i++) {
+		t_cluster_node* node = list_get(game_card_config->cluster->nodes, i);
+		game_card_logger_info("CLUSTER_BROKERS[%d]: %s:%d", i, node->ip, node->port);
+	}
 	game_card_logger_info("IP_GAMECARD: %s", game_card_config->ip_game_card);
 	game_card_logger_info("PUERTO_GAMECARD: %d", game_card_config->puerto_game_card);
+	game_card_logger_info("LOCALIZED_COMPACTO: %d", game_card_config->localized_compacto);
 }
@@ -2,24 +2,40 @@
 #define CONFIG_game_card_CONFIG_H_
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <commons/config.h>
 #include <commons/string.h>
 
 #include "../logger/game_card_logger.h"
 
 #include "../../../shared-common/common/config.h"
+#include "../../../shared-common/common/cluster.h"
 
 #define CONFIG_FILE_PATH "game-card.config"
+#define ESCRITURA_DIFERIDA_DEFAULT 1000
 
 typedef struct
 {
 	int tiempo_de_reintento_conexion;
+	// Ya no se usa: quien espera un archivo sigue apenas se libera
 	int tiempo_de_reintento_operacion;
+	// Retardo simulado de cada operacion, en segundos. 0 responde en el
+	// momento
+	int tiempo_retardo_new;
+	int tiempo_retardo_get;
+	int tiempo_retardo_catch;
+	// Milisegundos que un cambio puede quedar solo en memoria. 0 escribe en
+	// el momento
+	int escritura_diferida;
 	char* punto_montaje_tallgrass;
+	// ARCHIVOS (Bloques/<n>.bin), ARCHIVO_UNICO (Blocks.bin) o MMAP (Blocks.bin mapeado)
+	char* almacenamiento_bloques;
 	char* ip_broker;
 	int puerto_broker;
 	char* ip_game_card;
 	int puerto_game_card;
+	bool localized_compacto;
+	t_cluster* cluster;
 } t_game_card_config;
 
 t_game_card_config* game_card_config;
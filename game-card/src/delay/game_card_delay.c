@@ -0,0 +1,109 @@
+#include "game_card_delay.h"
+
+typedef struct {
+	struct timespec deadline;
+	t_delay_callback callback;
+	void* arg;
+} t_delay_task;
+
+// Ordenadas por vencimiento
+static t_list* tasks;
+static pthread_mutex_t delay_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t delay_changed;
+static pthread_t delay_thread;
+static bool delay_running = false;
+
+static bool delay_before(struct timespec* a, struct timespec* b) {
+	return a->tv_sec < b->tv_sec
+			|| (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static void* delay_loop(void* arg) {
+	pthread_mutex_lock(&delay_lock);
+	while (delay_running) {
+		if (list_is_empty(tasks)) {
+			pthread_cond_wait(&delay_changed, &delay_lock);
+			continue;
+		}
+		t_delay_task* next = list_get(tasks, 0);
+		if (pthread_cond_timedwait(&delay_changed, &delay_lock,
+				&next->deadline) != ETIMEDOUT)
+			continue;
+
+		// Vencio la primera; se despacha sin el lock para no frenar a
+		// quien agenda
+		t_delay_task* task = list_remove(tasks, 0);
+		pthread_mutex_unlock(&delay_lock);
+		task->callback(task->arg);
+		free(task);
+		pthread_mutex_lock(&delay_lock);
+	}
+	pthread_mutex_unlock(&delay_lock);
+	return NULL;
+}
+
+void game_card_delay_init() {
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&delay_changed, &attr);
+	pthread_condattr_destroy(&attr);
+
+	tasks = list_create();
+	delay_running = true;
+	pthread_create(&delay_thread, NULL, delay_loop, NULL);
+}
+
+void game_card_delay_schedule(int seconds, t_delay_callback callback,
+		void* arg) {
+	if (seconds <= 0) {
+		callback(arg);
+		return;
+	}
+
+	pthread_mutex_lock(&delay_lock);
+	if (!delay_running) {
+		pthread_mutex_unlock(&delay_lock);
+		callback(arg);
+		return;
+	}
+	t_delay_task* task = malloc(sizeof(t_delay_task));
+	clock_gettime(CLOCK_MONOTONIC, &task->deadline);
+	task->deadline.tv_sec += seconds;
+	task->callback = callback;
+	task->arg = arg;
+
+	int index = list_size(tasks);
+	while (index > 0
+			&& delay_before(&task->deadline,
+					&((t_delay_task*) list_get(tasks, index - 1))->deadline))
+		index--;
+	list_add_in_index(tasks, index, task);
+	// Solo hay que despertar al hilo si cambio la primera
+	if (index == 0)
+		pthread_cond_signal(&delay_changed);
+	pthread_mutex_unlock(&delay_lock);
+}
+
+void game_card_delay_destroy() {
+	pthread_mutex_lock(&delay_lock);
+	if (!delay_running) {
+		pthread_mutex_unlock(&delay_lock);
+		return;
+	}
+	delay_running = false;
+	pthread_cond_signal(&delay_changed);
+	pthread_mutex_unlock(&delay_lock);
+	pthread_join(delay_thread, NULL);
+
+	if (!list_is_empty(tasks))
+		game_card_logger_warn("Se envian sin retardo %d respuestas pendientes",
+				list_size(tasks));
+	while (!list_is_empty(tasks)) {
+		t_delay_task* task = list_remove(tasks, 0);
+		task->callback(task->arg);
+		free(task);
+	}
+	list_destroy(tasks);
+	pthread_cond_destroy(&delay_changed);
+}
@@ -0,0 +1,42 @@
+#ifndef DELAY_GAME_CARD_DELAY_H_
+#define DELAY_GAME_CARD_DELAY_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <commons/collections/list.h>
+
+#include "../logger/game_card_logger.h"
+
+// Retardo simulado de las operaciones sobre el filesystem. La operacion se
+// hace en el momento y lo que se demora es la respuesta: el archivo no queda
+// tomado mientras tanto y ningun hilo se queda dormido esperando. Un solo
+// hilo despacha todas las respuestas demoradas a medida que vencen.
+
+typedef void (*t_delay_callback)(void* arg);
+
+/**
+ * @NAME: game_card_delay_init
+ * @DESC: Arranca el hilo que despacha las respuestas demoradas.
+ */
+void game_card_delay_init();
+
+/**
+ * @NAME: game_card_delay_schedule
+ * @DESC: Llama a callback con arg dentro de seconds segundos, desde el hilo
+ * 		del retardo. Con 0 o menos lo llama en el momento, desde el hilo
+ * 		que pide.
+ */
+void game_card_delay_schedule(int seconds, t_delay_callback callback,
+		void* arg);
+
+/**
+ * @NAME: game_card_delay_destroy
+ * @DESC: Despacha en el momento lo que quedaba pendiente y frena el hilo.
+ */
+void game_card_delay_destroy();
+
+#endif /* DELAY_GAME_CARD_DELAY_H_ */
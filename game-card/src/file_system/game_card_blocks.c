@@ -0,0 +1,324 @@
+#include "game_card_blocks.h"
+#include <errno.h>
+
+static e_blocks_backend backend;
+static char* montaje;
+static int block_size;
+static int cantidad_bloques;
+// TALL_GRASS_BIN: los bloques tienen ceros en medio de los datos
+static bool contenido_binario;
+// Blocks.bin, con ARCHIVO_UNICO y MMAP
+static int blocks_fd = -1;
+static char* blocks_map = NULL;
+// Bloques escritos desde el ultimo msync, -1 si ninguno
+static int sucio_desde = -1;
+static int sucio_hasta = -1;
+static pthread_mutex_t msucio = PTHREAD_MUTEX_INITIALIZER;
+// Un msync a la vez: quien sincroniza espera al que se llevo sus bloques
+static pthread_mutex_t msync_bloques = PTHREAD_MUTEX_INITIALIZER;
+// Un bloque en 0, para completar los que no se llenan
+static char* bloque_vacio;
+
+static char* blocks_path(int bloque) {
+	return string_from_format("%sBloques/%d.bin", montaje, bloque);
+}
+
+static char* blocks_file_path() {
+	return string_from_format("%sBlocks.bin", montaje);
+}
+
+e_blocks_backend game_card_blocks_backend(char* nombre) {
+	if (nombre != NULL && string_equals_ignore_case(nombre, "ARCHIVO_UNICO"))
+		return BLOQUES_ARCHIVO_UNICO;
+	if (nombre != NULL && string_equals_ignore_case(nombre, "MMAP"))
+		return BLOQUES_MMAP;
+	if (nombre != NULL && !string_equals_ignore_case(nombre, "ARCHIVOS"))
+		game_card_logger_warn("Formato de bloques %s desconocido, se usa ARCHIVOS", nombre);
+	return BLOQUES_ARCHIVOS;
+}
+
+// Lee el bloque de su archivo en Bloques/. 0 si no existe
+static int blocks_read_file(int bloque, void* buffer) {
+	char* path = blocks_path(bloque);
+	int fd = open(path, O_RDONLY);
+	free(path);
+	if (fd == -1)
+		return 0;
+	int leidos = read(fd, buffer, block_size);
+	close(fd);
+	return leidos > 0 ? leidos : 0;
+}
+
+// Con sincronizar, el bloque queda en disco antes de volver. -1 si falla
+static int blocks_write_file(int bloque, void* buffer, int size, bool sincronizar) {
+	char* path = blocks_path(bloque);
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0664);
+	if (fd == -1) {
+		game_card_logger_error("No se pudo escribir el bloque %s: %s", path, strerror(errno));
+		free(path);
+		return -1;
+	}
+	bool ok = size <= 0 || write(fd, buffer, size) == size;
+	ok = ok && (!sincronizar || fsync(fd) == 0);
+	ok = close(fd) == 0 && ok;
+	if (!ok)
+		game_card_logger_error("No se pudo escribir el bloque %s: %s", path, strerror(errno));
+	free(path);
+	return ok ? 0 : -1;
+}
+
+// fsync del directorio, para que un rename dentro de el sobreviva a un corte
+static int blocks_sync_dir(char* dir) {
+	int fd = open(dir, O_RDONLY | O_DIRECTORY);
+	if (fd == -1)
+		return -1;
+	int res = fsync(fd);
+	close(fd);
+	return res;
+}
+
+// Bloques/<n>.bin -> Blocks.bin. Los archivos se borran recien cuando el
+// Blocks.bin quedo en su lugar; si algo falla se borra el temporal y siguen
+// los de Bloques/
+static int blocks_to_single_file(char* path) {
+	game_card_logger_info("Pasando los bloques de Bloques/ a %s", path);
+	char* temporal = string_from_format("%s.tmp", path);
+	int fd = open(temporal, O_RDWR | O_CREAT | O_TRUNC, 0664);
+	if (fd == -1) {
+		game_card_logger_error("No se pudo crear %s: %s", temporal, strerror(errno));
+		free(temporal);
+		return -1;
+	}
+
+	bool ok = ftruncate(fd, (off_t) block_size * cantidad_bloques) == 0;
+	char* buffer = malloc(block_size);
+	for (int i = 0; ok && i < cantidad_bloques; i++) {
+		int leidos = blocks_read_file(i, buffer);
+		if (leidos > 0)
+			ok = pwrite(fd, buffer, leidos, (off_t) i * block_size) == leidos;
+	}
+	free(buffer);
+	ok = ok && fsync(fd) == 0;
+	ok = close(fd) == 0 && ok;
+	ok = ok && rename(temporal, path) == 0;
+	if (!ok) {
+		game_card_logger_error("No se pudo escribir %s: %s", temporal, strerror(errno));
+		unlink(temporal);
+		free(temporal);
+		return -1;
+	}
+	free(temporal);
+
+	if (blocks_sync_dir(montaje) == -1) {
+		// El Blocks.bin ya esta, pero sin el fsync un corte podria perderlo:
+		// los bloques quedan tambien en Bloques/
+		game_card_logger_warn("No se pudo sincronizar %s, no se borra Bloques/", montaje);
+		return 0;
+	}
+	for (int i = 0; i < cantidad_bloques; i++) {
+		char* bloque = blocks_path(i);
+		unlink(bloque);
+		free(bloque);
+	}
+	return 0;
+}
+
+// Blocks.bin -> Bloques/<n>.bin. Con texto cada archivo se queda con los
+// bytes hasta el primer 0; con registros binarios, con el bloque entero.
+// Blocks.bin se borra recien cuando todos los bloques quedaron en disco; si
+// algo falla sigue siendo el original y se vuelve a intentar al reiniciar
+static int single_file_to_blocks(char* path) {
+	game_card_logger_info("Pasando los bloques de %s a Bloques/", path);
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		game_card_logger_error("No se pudo abrir %s: %s", path, strerror(errno));
+		return -1;
+	}
+
+	bool ok = true;
+	char* buffer = malloc(block_size);
+	for (int i = 0; ok && i < cantidad_bloques; i++) {
+		int leidos = pread(fd, buffer, block_size, (off_t) i * block_size);
+		if (leidos == -1) {
+			game_card_logger_error("No se pudo leer %s: %s", path, strerror(errno));
+			ok = false;
+			break;
+		}
+		if (leidos > 0 && !contenido_binario)
+			leidos = strnlen(buffer, leidos);
+		ok = blocks_write_file(i, buffer, leidos, true) == 0;
+	}
+	free(buffer);
+	close(fd);
+	if (!ok)
+		return -1;
+
+	char* bloques = string_from_format("%sBloques", montaje);
+	ok = blocks_sync_dir(bloques) == 0;
+	free(bloques);
+	if (!ok) {
+		// Los bloques estan, pero sin el fsync un corte podria perderlos
+		game_card_logger_warn("No se pudo sincronizar Bloques/, no se borra %s", path);
+		return 0;
+	}
+	unlink(path);
+	return 0;
+}
+
+int game_card_blocks_init(char* punto_montaje, int size, int blocks,
+		e_blocks_backend formato, bool binario) {
+	montaje = string_duplicate(punto_montaje);
+	block_size = size;
+	cantidad_bloques = blocks;
+	backend = formato;
+	contenido_binario = binario;
+	bloque_vacio = calloc(1, block_size);
+
+	char* path = blocks_file_path();
+	bool hay_archivo_unico = access(path, F_OK) != -1;
+	char* primero = blocks_path(0);
+	bool hay_archivos = access(primero, F_OK) != -1;
+	free(primero);
+
+	if (backend == BLOQUES_ARCHIVOS) {
+		int res = hay_archivo_unico ? single_file_to_blocks(path) : 0;
+		free(path);
+		return res;
+	}
+
+	if (!hay_archivo_unico && hay_archivos && blocks_to_single_file(path) == -1) {
+		free(path);
+		return -1;
+	}
+	blocks_fd = open(path, O_RDWR | O_CREAT, 0664);
+	if (blocks_fd == -1) {
+		game_card_logger_error("No se pudo abrir %s", path);
+		free(path);
+		return -1;
+	}
+	// Nuevo o de otro tamaño: sin escribir nada, lo que falta se lee en 0
+	ftruncate(blocks_fd, (off_t) block_size * cantidad_bloques);
+
+	if (backend == BLOQUES_MMAP) {
+		blocks_map = mmap(NULL, (size_t) block_size * cantidad_bloques,
+				PROT_READ | PROT_WRITE, MAP_SHARED, blocks_fd, 0);
+		if (blocks_map == MAP_FAILED) {
+			game_card_logger_error("Fallo el mmap de %s: %s", path, strerror(errno));
+			blocks_map = NULL;
+			free(path);
+			return -1;
+		}
+	}
+	free(path);
+	return 0;
+}
+
+static void blocks_mark(int bloque) {
+	pthread_mutex_lock(&msucio);
+	if (sucio_desde == -1 || bloque < sucio_desde)
+		sucio_desde = bloque;
+	if (bloque > sucio_hasta)
+		sucio_hasta = bloque;
+	pthread_mutex_unlock(&msucio);
+}
+
+void game_card_blocks_format() {
+	// Tambien con MMAP: el mapeo ve el archivo nuevo, todo en 0
+	if (backend != BLOQUES_ARCHIVOS) {
+		ftruncate(blocks_fd, 0);
+		ftruncate(blocks_fd, (off_t) block_size * cantidad_bloques);
+		return;
+	}
+	game_card_logger_info("Creando bloques en el path /Bloques");
+	for (int i = 0; i < cantidad_bloques; i++)
+		blocks_write_file(i, NULL, 0, false);
+}
+
+int game_card_blocks_read(int bloque, void* buffer) {
+	return game_card_blocks_read_run(bloque, 1, buffer);
+}
+
+int game_card_blocks_read_run(int bloque, int cantidad, void* buffer) {
+	if (backend == BLOQUES_ARCHIVOS) {
+		// Un archivo por bloque: se corta en el primero que no esta lleno
+		int leidos = 0;
+		for (int i = 0; i < cantidad; i++) {
+			int bytes = blocks_read_file(bloque + i, (char*) buffer + leidos);
+			leidos += bytes;
+			if (bytes < block_size)
+				break;
+		}
+		return leidos;
+	}
+	if (backend == BLOQUES_MMAP) {
+		memcpy(buffer, blocks_map + (size_t) bloque * block_size, (size_t) cantidad * block_size);
+		return cantidad * block_size;
+	}
+	int leidos = pread(blocks_fd, buffer, (size_t) cantidad * block_size, (off_t) bloque * block_size);
+	return leidos > 0 ? leidos : 0;
+}
+
+char* game_card_blocks_data(int bloque) {
+	return blocks_map != NULL ? blocks_map + (size_t) bloque * block_size : NULL;
+}
+
+void game_card_blocks_write(int bloque, void* buffer, int size) {
+	if (backend == BLOQUES_ARCHIVOS) {
+		blocks_write_file(bloque, buffer, size, false);
+		return;
+	}
+	if (backend == BLOQUES_MMAP) {
+		char* destino = blocks_map + (size_t) bloque * block_size;
+		if (size > 0)
+			memcpy(destino, buffer, size);
+		memset(destino + size, 0, block_size - size);
+		blocks_mark(bloque);
+		return;
+	}
+	off_t offset = (off_t) bloque * block_size;
+	pwrite(blocks_fd, buffer, size, offset);
+	if (size < block_size)
+		pwrite(blocks_fd, bloque_vacio, block_size - size, offset + size);
+}
+
+void game_card_blocks_clear(int bloque) {
+	game_card_blocks_write(bloque, NULL, 0);
+}
+
+void game_card_blocks_sync() {
+	if (blocks_map == NULL)
+		return;
+	// Si otro hilo se llevo el rango con bloques de este, al volver de aca
+	// su msync tiene que haber terminado
+	pthread_mutex_lock(&msync_bloques);
+	pthread_mutex_lock(&msucio);
+	int desde = sucio_desde;
+	int hasta = sucio_hasta;
+	sucio_desde = -1;
+	sucio_hasta = -1;
+	pthread_mutex_unlock(&msucio);
+	if (desde != -1) {
+		// msync pide la direccion alineada a pagina
+		long pagina = sysconf(_SC_PAGESIZE);
+		size_t inicio = (size_t) desde * block_size / pagina * pagina;
+		size_t fin = (size_t) (hasta + 1) * block_size;
+		if (msync(blocks_map + inicio, fin - inicio, MS_SYNC) == -1)
+			game_card_logger_error("Fallo el msync de los bloques: %s", strerror(errno));
+	}
+	pthread_mutex_unlock(&msync_bloques);
+}
+
+void game_card_blocks_destroy() {
+	if (blocks_map != NULL) {
+		game_card_blocks_sync();
+		munmap(blocks_map, (size_t) block_size * cantidad_bloques);
+		blocks_map = NULL;
+	}
+	if (blocks_fd != -1) {
+		fsync(blocks_fd);
+		close(blocks_fd);
+		blocks_fd = -1;
+	}
+	free(bloque_vacio);
+	free(montaje);
+}
@@ -0,0 +1,105 @@
+#ifndef FILE_SYSTEM_GAME_CARD_BLOCKS_H_
+#define FILE_SYSTEM_GAME_CARD_BLOCKS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <commons/string.h>
+
+#include "../logger/game_card_logger.h"
+
+// Donde viven los bloques del TALL_GRASS.
+//
+// ARCHIVOS es el formato del enunciado: Bloques/<n>.bin, un archivo por
+// bloque con solo los bytes que usa. Cada acceso abre y cierra su archivo.
+//
+// ARCHIVO_UNICO guarda todos los bloques en Blocks.bin, el bloque n en
+// n * BLOCK_SIZE, y se lee y escribe con pread/pwrite sobre un solo fd.
+// Formatear es crear el archivo vacio del tamaño total. Lo que un bloque no
+// usa queda en 0.
+//
+// MMAP usa el mismo Blocks.bin pero mapeado: leer es mirar la memoria y
+// escribir es copiar a ella. Lo escrito se baja al disco con un solo msync
+// por tanda, en game_card_blocks_sync.
+//
+// Si al arrancar los bloques estan en el otro formato se convierten. El
+// Blocks.bin se arma aparte y reemplaza a los archivos recien completo.
+typedef enum {
+	BLOQUES_ARCHIVOS,
+	BLOQUES_ARCHIVO_UNICO,
+	BLOQUES_MMAP
+} e_blocks_backend;
+
+/**
+ * @NAME: game_card_blocks_backend
+ * @DESC: El formato por su nombre en el config. ARCHIVOS si no lo conoce.
+ */
+e_blocks_backend game_card_blocks_backend(char* nombre);
+
+/**
+ * @NAME: game_card_blocks_init
+ * @DESC: Abre los bloques de punto_montaje, convirtiendolos si estaban en el
+ * 		otro formato. binario si el TALL_GRASS guarda registros binarios, que
+ * 		no se pueden cortar en el primer 0. -1 si no se pudo abrir Blocks.bin.
+ */
+int game_card_blocks_init(char* punto_montaje, int block_size, int blocks,
+		e_blocks_backend backend, bool binario);
+
+/**
+ * @NAME: game_card_blocks_format
+ * @DESC: Deja todos los bloques vacios. Para un filesystem nuevo.
+ */
+void game_card_blocks_format();
+
+/**
+ * @NAME: game_card_blocks_read
+ * @DESC: Copia el bloque a buffer (BLOCK_SIZE bytes) y devuelve cuantos
+ * 		bytes leyo.
+ */
+int game_card_blocks_read(int bloque, void* buffer);
+
+/**
+ * @NAME: game_card_blocks_read_run
+ * @DESC: Lee cantidad bloques seguidos, desde bloque, en una sola lectura
+ * 		si el formato lo permite. Devuelve cuantos bytes leyo.
+ */
+int game_card_blocks_read_run(int bloque, int cantidad, void* buffer);
+
+/**
+ * @NAME: game_card_blocks_data
+ * @DESC: El bloque en memoria, para leerlo sin copiarlo. NULL si el formato
+ * 		no mapea los bloques: hay que usar game_card_blocks_read.
+ */
+char* game_card_blocks_data(int bloque);
+
+/**
+ * @NAME: game_card_blocks_write
+ * @DESC: Reemplaza el contenido del bloque por los size bytes de buffer.
+ */
+void game_card_blocks_write(int bloque, void* buffer, int size);
+
+/**
+ * @NAME: game_card_blocks_clear
+ * @DESC: Deja el bloque vacio.
+ */
+void game_card_blocks_clear(int bloque);
+
+/**
+ * @NAME: game_card_blocks_sync
+ * @DESC: Con MMAP baja al disco lo escrito desde la ultima vez, en un solo
+ * 		msync. Al volver esta en disco todo lo que se escribio antes de
+ * 		llamarla, aunque lo haya sincronizado otro hilo. Con los otros
+ * 		formatos no hace nada.
+ */
+void game_card_blocks_sync();
+
+void game_card_blocks_destroy();
+
+#endif /* FILE_SYSTEM_GAME_CARD_BLOCKS_H_ */
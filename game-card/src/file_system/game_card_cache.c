@@ -0,0 +1,248 @@
+#include "game_card_cache.h"
+
+// Especie -> t_pokemon_cache. No se borran: son especies, no crecen con los
+// mensajes
+static t_dictionary* caches;
+static pthread_mutex_t mcaches = PTHREAD_MUTEX_INITIALIZER;
+static t_cache_load cache_load;
+static t_cache_store cache_store;
+static int escritura_diferida;
+
+static pthread_t flusher;
+static pthread_mutex_t mflusher = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flusher_stop;
+static bool flusher_running = false;
+
+static uint64_t cache_now_ms() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static char* cache_key(uint32_t x, uint32_t y) {
+	return string_from_format("%d-%d", x, y);
+}
+
+// Escribe la especie si sigue sucia. Con la especie tomada
+static void cache_flush(t_pokemon_cache* cache) {
+	pthread_mutex_lock(&cache->escritura);
+	if (__atomic_load_n(&cache->sucio, __ATOMIC_ACQUIRE)) {
+		cache_store(cache);
+		if (cache->palabras_sucias > 0)
+			memset(cache->bloques_sucios, 0,
+					cache->palabras_sucias * sizeof(uint64_t));
+		cache->sucio_desde_bloque = -1;
+		__atomic_store_n(&cache->sucio, false, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&cache->escritura);
+}
+
+// Las especies que estan sucias hace al menos edad ms
+static t_list* cache_dirty(uint64_t edad) {
+	uint64_t now = cache_now_ms();
+	t_list* dirty = list_create();
+	void add_if_dirty(char* especie, t_pokemon_cache* cache) {
+		if (__atomic_load_n(&cache->sucio, __ATOMIC_ACQUIRE)
+				&& now - __atomic_load_n(&cache->sucio_desde, __ATOMIC_ACQUIRE)
+						>= edad)
+			list_add(dirty, cache);
+	}
+	pthread_mutex_lock(&mcaches);
+	dictionary_iterator(caches, (void*) add_if_dirty);
+	pthread_mutex_unlock(&mcaches);
+	return dirty;
+}
+
+static void cache_flush_dirty(uint64_t edad) {
+	t_list* dirty = cache_dirty(edad);
+	for (int i = 0; i < list_size(dirty); i++) {
+		t_pokemon_cache* cache = list_get(dirty, i);
+		// Lectura: no cambia lo que ven los GET, solo el disco
+		t_game_card_lock* lock = game_card_lock_read(cache->especie);
+		cache_flush(cache);
+		game_card_unlock_read(lock);
+	}
+	list_destroy(dirty);
+}
+
+// Se despierta cada media escritura_diferida y escribe lo que lleva al menos
+// ese tiempo sucio: nada queda sin escribir mas de escritura_diferida ms
+static void* cache_flusher_loop(void* arg) {
+	int periodo = escritura_diferida / 2 > 0 ? escritura_diferida / 2 : 1;
+	pthread_mutex_lock(&mflusher);
+	while (flusher_running) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += periodo / 1000;
+		deadline.tv_nsec += (long) (periodo % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&flusher_stop, &mflusher, &deadline);
+		if (!flusher_running)
+			break;
+		pthread_mutex_unlock(&mflusher);
+		cache_flush_dirty(periodo);
+		pthread_mutex_lock(&mflusher);
+	}
+	pthread_mutex_unlock(&mflusher);
+	return NULL;
+}
+
+void game_card_cache_init(int diferida, t_cache_load load,
+		t_cache_store store) {
+	caches = dictionary_create();
+	cache_load = load;
+	cache_store = store;
+	escritura_diferida = diferida;
+	if (escritura_diferida <= 0)
+		return;
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&flusher_stop, &attr);
+	pthread_condattr_destroy(&attr);
+	flusher_running = true;
+	pthread_create(&flusher, NULL, cache_flusher_loop, NULL);
+}
+
+t_pokemon_cache* game_card_cache_get(char* especie) {
+	pthread_mutex_lock(&mcaches);
+	t_pokemon_cache* cache = dictionary_get(caches, especie);
+	if (cache == NULL) {
+		cache = malloc(sizeof(t_pokemon_cache));
+		cache->especie = string_duplicate(especie);
+		pthread_mutex_init(&cache->carga, NULL);
+		pthread_mutex_init(&cache->escritura, NULL);
+		cache->cargado = false;
+		cache->existe = false;
+		cache->coordenadas = dictionary_create();
+		cache->lineas = list_create();
+		cache->bloques = list_create();
+		cache->tamanio = 0;
+		cache->bloques_sucios = NULL;
+		cache->palabras_sucias = 0;
+		cache->sucio_desde_bloque = -1;
+		cache->tamanio_escrito = 0;
+		cache->bloques_escritos = 0;
+		cache->sucio = false;
+		cache->sucio_desde = 0;
+		dictionary_put(caches, especie, cache);
+	}
+	pthread_mutex_unlock(&mcaches);
+
+	// Con el lock de lectura dos GET pueden llegar a la vez a cargarla
+	pthread_mutex_lock(&cache->carga);
+	if (!cache->cargado) {
+		cache_load(cache);
+		cache->cargado = true;
+	}
+	pthread_mutex_unlock(&cache->carga);
+	return cache;
+}
+
+void* game_card_cache_find(t_pokemon_cache* cache, uint32_t x, uint32_t y) {
+	char* key = cache_key(x, y);
+	void* linea = dictionary_get(cache->coordenadas, key);
+	free(key);
+	return linea;
+}
+
+void game_card_cache_add(t_pokemon_cache* cache, uint32_t x, uint32_t y,
+		void* linea) {
+	char* key = cache_key(x, y);
+	dictionary_put(cache->coordenadas, key, linea);
+	free(key);
+	list_add(cache->lineas, linea);
+}
+
+void game_card_cache_insert(t_pokemon_cache* cache, int indice, uint32_t x,
+		uint32_t y, void* linea) {
+	char* key = cache_key(x, y);
+	dictionary_put(cache->coordenadas, key, linea);
+	free(key);
+	list_add_in_index(cache->lineas, indice, linea);
+}
+
+void* game_card_cache_remove(t_pokemon_cache* cache, uint32_t x, uint32_t y) {
+	char* key = cache_key(x, y);
+	void* linea = dictionary_remove(cache->coordenadas, key);
+	free(key);
+	if (linea == NULL)
+		return NULL;
+	bool is_line(void* otra) {
+		return otra == linea;
+	}
+	list_remove_by_condition(cache->lineas, is_line);
+	return linea;
+}
+
+void game_card_cache_mark_block(t_pokemon_cache* cache, int bloque) {
+	int palabra = bloque / 64;
+	if (palabra >= cache->palabras_sucias) {
+		int palabras = cache->palabras_sucias > 0 ? cache->palabras_sucias : 1;
+		while (palabras <= palabra)
+			palabras *= 2;
+		cache->bloques_sucios = realloc(cache->bloques_sucios,
+				palabras * sizeof(uint64_t));
+		memset(cache->bloques_sucios + cache->palabras_sucias, 0,
+				(palabras - cache->palabras_sucias) * sizeof(uint64_t));
+		cache->palabras_sucias = palabras;
+	}
+	cache->bloques_sucios[palabra] |= (uint64_t) 1 << (bloque % 64);
+}
+
+void game_card_cache_mark_from(t_pokemon_cache* cache, int bloque) {
+	if (cache->sucio_desde_bloque == -1 || bloque < cache->sucio_desde_bloque)
+		cache->sucio_desde_bloque = bloque;
+}
+
+bool game_card_cache_block_dirty(t_pokemon_cache* cache, int bloque) {
+	if (cache->sucio_desde_bloque != -1 && bloque >= cache->sucio_desde_bloque)
+		return true;
+	int palabra = bloque / 64;
+	return palabra < cache->palabras_sucias
+			&& (cache->bloques_sucios[palabra] >> (bloque % 64)) & 1;
+}
+
+void game_card_cache_touch(t_pokemon_cache* cache) {
+	if (!cache->sucio) {
+		__atomic_store_n(&cache->sucio_desde, cache_now_ms(), __ATOMIC_RELEASE);
+		__atomic_store_n(&cache->sucio, true, __ATOMIC_RELEASE);
+	}
+	// Sin escritura diferida se escribe ya, con el lock del que cambio
+	if (escritura_diferida <= 0)
+		cache_flush(cache);
+}
+
+void game_card_cache_flush() {
+	cache_flush_dirty(0);
+}
+
+static void cache_destroy(t_pokemon_cache* cache) {
+	pthread_mutex_destroy(&cache->carga);
+	pthread_mutex_destroy(&cache->escritura);
+	dictionary_destroy(cache->coordenadas);
+	list_destroy_and_destroy_elements(cache->lineas, free);
+	list_destroy(cache->bloques);
+	free(cache->bloques_sucios);
+	free(cache->especie);
+	free(cache);
+}
+
+void game_card_cache_destroy() {
+	pthread_mutex_lock(&mflusher);
+	bool running = flusher_running;
+	flusher_running = false;
+	if (running)
+		pthread_cond_signal(&flusher_stop);
+	pthread_mutex_unlock(&mflusher);
+	if (running) {
+		pthread_join(flusher, NULL);
+		pthread_cond_destroy(&flusher_stop);
+	}
+	cache_flush_dirty(0);
+	dictionary_destroy_and_destroy_elements(caches, (void*) cache_destroy);
+}
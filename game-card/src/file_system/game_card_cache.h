@@ -0,0 +1,140 @@
+#ifndef FILE_SYSTEM_GAME_CARD_CACHE_H_
+#define FILE_SYSTEM_GAME_CARD_CACHE_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <commons/string.h>
+#include <commons/collections/list.h>
+#include <commons/collections/dictionary.h>
+
+#include "../logger/game_card_logger.h"
+#include "game_card_lock.h"
+
+// Contenido de cada especie en memoria. Se carga del disco la primera vez
+// que se usa y desde ahi los GET no leen el disco. NEW y CATCH cambian la
+// memoria y marcan la especie como sucia; un hilo aparte la escribe a los
+// bloques a lo sumo escritura_diferida ms despues. Varios cambios seguidos
+// de una especie se escriben juntos.
+//
+// Todo se toca con la especie tomada en game_card_lock: para leer alcanza
+// con el lock de lectura, para cambiar hace falta el de escritura. El hilo
+// que escribe toma el de lectura, asi los GET siguen mientras tanto.
+
+typedef struct {
+	char* especie;
+	pthread_mutex_t carga;
+	bool cargado;
+	// Tiene archivo en Files/
+	bool existe;
+	// "x-y" -> blockLine*
+	t_dictionary* coordenadas;
+	// blockLine*, en el orden en que se escriben
+	t_list* lineas;
+	// Bloques reservados, en orden. Pueden sobrar hasta la proxima escritura
+	t_list* bloques;
+	// Bytes que ocupa el contenido
+	int tamanio;
+	// Bloques a reescribir en la proxima escritura, un bit por posicion en
+	// bloques, y desde que posicion se reescribe hasta el final, -1 si no hay
+	uint64_t* bloques_sucios;
+	int palabras_sucias;
+	int sucio_desde_bloque;
+	// Lo que dice el Metadata.bin: si no cambio no se reescribe
+	int tamanio_escrito;
+	int bloques_escritos;
+	// Una escritura a la vez: el hilo y game_card_cache_flush toman la
+	// especie para leer, los dos a la vez
+	pthread_mutex_t escritura;
+	bool sucio;
+	uint64_t sucio_desde;
+} t_pokemon_cache;
+
+// Llena lineas, bloques, tamanio y existe desde el disco
+typedef void (*t_cache_load)(t_pokemon_cache* cache);
+// Escribe la especie a los bloques y al Metadata.bin
+typedef void (*t_cache_store)(t_pokemon_cache* cache);
+
+/**
+ * @NAME: game_card_cache_init
+ * @DESC: Crea la tabla y arranca el hilo que escribe. Con escritura_diferida
+ * 		en 0 no hay hilo: cada cambio se escribe en el momento.
+ */
+void game_card_cache_init(int escritura_diferida, t_cache_load load,
+		t_cache_store store);
+
+/**
+ * @NAME: game_card_cache_get
+ * @DESC: Devuelve la especie, cargandola si es la primera vez. Se llama con
+ * 		la especie tomada.
+ */
+t_pokemon_cache* game_card_cache_get(char* especie);
+
+/**
+ * @NAME: game_card_cache_find
+ * @DESC: La linea de la coordenada o NULL.
+ */
+void* game_card_cache_find(t_pokemon_cache* cache, uint32_t x, uint32_t y);
+
+/**
+ * @NAME: game_card_cache_add
+ * @DESC: Agrega una linea nueva (un blockLine) al final.
+ */
+void game_card_cache_add(t_pokemon_cache* cache, uint32_t x, uint32_t y,
+		void* linea);
+
+/**
+ * @NAME: game_card_cache_insert
+ * @DESC: Agrega una linea nueva en la posicion indice de lineas.
+ */
+void game_card_cache_insert(t_pokemon_cache* cache, int indice, uint32_t x,
+		uint32_t y, void* linea);
+
+/**
+ * @NAME: game_card_cache_remove
+ * @DESC: Saca la linea de la coordenada y la devuelve.
+ */
+void* game_card_cache_remove(t_pokemon_cache* cache, uint32_t x, uint32_t y);
+
+/**
+ * @NAME: game_card_cache_mark_block
+ * @DESC: Marca para reescribir el bloque en esa posicion de bloques.
+ */
+void game_card_cache_mark_block(t_pokemon_cache* cache, int bloque);
+
+/**
+ * @NAME: game_card_cache_mark_from
+ * @DESC: Marca para reescribir desde esa posicion hasta el ultimo bloque.
+ */
+void game_card_cache_mark_from(t_pokemon_cache* cache, int bloque);
+
+/**
+ * @NAME: game_card_cache_block_dirty
+ * @DESC: Si hay que reescribir el bloque en esa posicion.
+ */
+bool game_card_cache_block_dirty(t_pokemon_cache* cache, int bloque);
+
+/**
+ * @NAME: game_card_cache_touch
+ * @DESC: Marca la especie como cambiada. Se llama con la especie tomada para
+ * 		escribir.
+ */
+void game_card_cache_touch(t_pokemon_cache* cache);
+
+/**
+ * @NAME: game_card_cache_flush
+ * @DESC: Escribe ya todas las especies sucias, sin esperar al hilo.
+ */
+void game_card_cache_flush();
+
+/**
+ * @NAME: game_card_cache_destroy
+ * @DESC: Frena el hilo, escribe lo que quedaba sucio y libera la tabla.
+ */
+void game_card_cache_destroy();
+
+#endif /* FILE_SYSTEM_GAME_CARD_CACHE_H_ */
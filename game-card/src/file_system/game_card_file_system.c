@@ -1,5 +1,9 @@
 #include "game_card_file_system.h"
 
+// MAGIC_NUMBER TALL_GRASS_BIN: registros de REGISTRO_BINARIO bytes en lugar de lineas
+static bool formatoBinario = false;
+// MIGRATING=Y en el Metadata.bin: una migracion a registros binarios se corto
+static bool migracionPendiente = false;
 
 void gcfsCreateStructs(){
 	createRootFiles();
@@ -7,9 +11,14 @@ void gcfsCreateStructs(){
 	initSemaphore();
 }
 
+static void pokemonOpenChanged(char* especie, bool abierto);
+static void loadPokemon(t_pokemon_cache* cache);
+static void storePokemon(t_pokemon_cache* cache);
+
 void initSemaphore() {
-	pthread_mutex_init(&MUTEX_LISTA_ARCHIVO_ABIERTO, NULL);
-	files_open = dictionary_create();
+	pthread_mutex_init(&MUTEX_BITMAP, NULL);
+	game_card_lock_init(pokemonOpenChanged);
+	game_card_cache_init(game_card_config->escritura_diferida, loadPokemon, storePokemon);
 }
 
 int createRecursiveDirectory(char* path) {
@@ -60,7 +69,8 @@ int createFile(char* fullPath) {
 		return -1;
     } else {
 		mkdir(completePath, 0777);
-		updatePokemonMetadata(fullPath, "N", "0", "[]", "N", "NEW_POKEMON_CREATE_FILE");
+		// Se crea tomado: lo marca como libre quien lo tomo al terminar
+		updatePokemonMetadata(fullPath, "N", "0", "[]", "Y", "NEW_POKEMON_CREATE_FILE");
 	}
 
 	free(completePath);
@@ -80,11 +90,14 @@ void updatePokemonMetadata(char* fullPath, char* directory, char* size, char* bl
 	string_append(&newDirectoryMetadata, "/Metadata.bin");
 	
 	FILE* metadata = fopen(newDirectoryMetadata, "w+b");
-	config_metadata = config_create(newDirectoryMetadata);
+	t_config* config_metadata = config_create(newDirectoryMetadata);
 	config_set_value(config_metadata, "DIRECTORY", directory);
 	config_set_value(config_metadata, "SIZE", size);
 	config_set_value(config_metadata, "BLOCKS", blocks);
 	config_set_value(config_metadata, "OPEN", open);
+	// Va junto con los bloques: una migracion cortada sabe como leer cada especie
+	if (formatoBinario)
+		config_set_value(config_metadata, "FORMAT", MAGIC_NUMBER_BINARIO);
 	config_save(config_metadata);
 	
 	config_destroy(config_metadata);
@@ -107,23 +120,35 @@ void updateOpenFileState(char* fullPath, char* open, char* op) {
 	string_append(&newDirectoryMetadata, completePath);
 	string_append(&newDirectoryMetadata, "/Metadata.bin");
 
+	if (access(newDirectoryMetadata, F_OK) == -1) {
+		free(completePath);
+		free(newDirectoryMetadata);
+		free(blockSize);
+		free(blocks);
+		return;
+	}
 
 	t_config* readMetadataFile = config_create(newDirectoryMetadata);
 	blockSize = string_duplicate(config_get_string_value(readMetadataFile, "SIZE"));
 	blocks = string_duplicate(config_get_string_value(readMetadataFile, "BLOCKS"));
+	char* format = config_has_property(readMetadataFile, "FORMAT")
+			? string_duplicate(config_get_string_value(readMetadataFile, "FORMAT")) : NULL;
 	
 	FILE* metadata = fopen(newDirectoryMetadata, "w+b");
-	config_metadata = config_create(newDirectoryMetadata);
+	t_config* config_metadata = config_create(newDirectoryMetadata);
 	config_set_value(config_metadata, "SIZE", blockSize);
 	config_set_value(config_metadata, "DIRECTORY", "N");
 	config_set_value(config_metadata, "BLOCKS", blocks);
 	config_set_value(config_metadata, "OPEN", open);
+	if (format != NULL)
+		config_set_value(config_metadata, "FORMAT", format);
 	config_save(config_metadata);
 	
 
 	config_destroy(config_metadata);
 	fclose(metadata);
 	config_destroy(readMetadataFile);
+	free(format);
 	
 	free(completePath);
 	free(newDirectoryMetadata);
@@ -131,69 +156,62 @@ void updateOpenFileState(char* fullPath, char* open, char* op) {
 	free(blocks);
 }
 
-int coordinateExists(unsigned int posX, unsigned int posY, t_list* pokemonLines) {
-	int coordinateExist = 0;
-
-	for (int i=0; i<list_size(pokemonLines); i++) {
-		blockLine* newLineBlock = (blockLine*) list_get(pokemonLines, i);
-
-		if (newLineBlock->posX == posX && newLineBlock->posY == posY) {
-			coordinateExist = 1;
-		}
-	}
-	
-	return coordinateExist;
-}
-
-
-// Add pokemon total if coordinate exists
-void addTotalPokemonIfCoordinateExist(t_new_pokemon* newPokemon, t_list* pokemonLines) {
-	for (int i=0; i<list_size(pokemonLines); i++) {
-		blockLine* pokemonLineBlock = (blockLine*)list_get(pokemonLines, i);
-		if (pokemonLineBlock->posX == newPokemon->pos_x && pokemonLineBlock->posY == newPokemon->pos_y) {
-			pokemonLineBlock->cantidad = pokemonLineBlock->cantidad + newPokemon->cantidad;
-		}
-	}
-}
-
-// Delete pokemon total if coordinate exists
-void deletePokemonTotalIfCoordinateExist(t_catch_pokemon* catchPokemon, t_list* pokemonLines) {
-	for (int i=0; i<list_size(pokemonLines); i++) {
-		blockLine* pokemonLineBlock = (blockLine*)list_get(pokemonLines, i);
-		if (pokemonLineBlock->posX == catchPokemon->pos_x && pokemonLineBlock->posY == catchPokemon->pos_y) {
-			if (pokemonLineBlock->cantidad != 1) {
-				pokemonLineBlock->cantidad = pokemonLineBlock->cantidad - 1;	
+// Pide bloques para que el archivo siga contiguo: primero los que siguen al
+// ultimo que ya tiene (lastBlock, -1 si no tiene). Si estan ocupados empieza
+// un tramo nuevo, dejando HUECO_EXTENT bloques libres despues del archivo
+// que tenga antes para que ese pueda seguir creciendo pegado. Si no hay un
+// tramo tan largo se conforma con uno donde entren los que faltan, y si
+// tampoco hay, de a uno. Con MUTEX_BITMAP tomado
+t_list* requestFreeBlocks(int extraBlocksNeeded, int lastBlock) {
+	t_list* retList = list_create();
+	for (int i=0; i<extraBlocksNeeded; i++) {
+		int faltan = extraBlocksNeeded - i;
+		int freeBlockPosition = lastBlock + 1;
+		if (lastBlock == -1 || !getAndSetBlockIfFree(bitmap, lfsMetaData.blocks, freeBlockPosition)) {
+			freeBlockPosition = getFreeRun(bitmap, lfsMetaData.blocks, faltan + 2 * HUECO_EXTENT);
+			if (freeBlockPosition > 0) {
+				freeBlockPosition += HUECO_EXTENT;
+			} else if (freeBlockPosition == -1) {
+				freeBlockPosition = getFreeRun(bitmap, lfsMetaData.blocks, faltan);
+			}
+			if (freeBlockPosition != -1) {
+				getAndSetBlockIfFree(bitmap, lfsMetaData.blocks, freeBlockPosition);
 			} else {
-				list_remove(pokemonLines, i);
+				freeBlockPosition = getAndSetFreeBlock(bitmap, lfsMetaData.blocks);
 			}
 		}
-	}
-}
-
-t_list* requestFreeBlocks(int extraBlocksNeeded) {
-	t_list* retList = list_create();
-	for (int i=0; i<extraBlocksNeeded; i++) {
-		int freeBlockPosition = getAndSetFreeBlock(bitmap, lfsMetaData.blocks);
-		list_add(retList, (void*) freeBlockPosition);
+		list_add(retList, (void*) (intptr_t) freeBlockPosition);
+		lastBlock = freeBlockPosition;
 	}
 	return retList;
 }
 
-// Formatea una lista de enteros a un string con formato [1, 2, 3] requerido por el Metadata
+// Formatea una lista de enteros al BLOCKS del Metadata. Cada tramo de bloques
+// seguidos va como inicio:largo, un bloque suelto como antes: [3:16,40,52:4]
 char* formatToMetadataBlocks(t_list* blocks) {
 	char* retBlocks = string_new();
 	string_append(&retBlocks, "[");
 
-	if (list_size(blocks) > 1) {
-		for(int i=0; i<list_size(blocks); i++) {
-			string_append(&retBlocks, string_itoa((int)list_get(blocks, i)));
-			if (i != (list_size(blocks) - 1)) string_append(&retBlocks, ",");
+	int inicio = -1;
+	int largo = 0;
+	void appendExtent() {
+		if (largo == 0) return;
+		char* extent = largo == 1 ? string_itoa(inicio) : string_from_format("%d:%d", inicio, largo);
+		if (strlen(retBlocks) > 1) string_append(&retBlocks, ",");
+		string_append(&retBlocks, extent);
+		free(extent);
+	}
+	void addBlock(void* block) {
+		if (largo > 0 && (int) (intptr_t) block == inicio + largo) {
+			largo++;
+			return;
 		}
-	} 
-	
-	if (list_size(blocks) == 1) {
-		string_append(&retBlocks, string_itoa((int)list_get(blocks, 0)));
+		appendExtent();
+		inicio = (int) (intptr_t) block;
+		largo = 1;
 	}
+	list_iterate(blocks, addBlock);
+	appendExtent();
 
 	string_append(&retBlocks, "]");
 	return retBlocks;
@@ -210,366 +228,537 @@ void freeBlockLine(blockLine* newLineBlock) {
 }
 
 
-void createNewPokemon(t_new_pokemon* newPokemon) {
-	char* completePath = string_new();
-	string_append(&completePath, struct_paths[FILES]);
-	string_append(&completePath, newPokemon->nombre_pokemon);
-	int freeBlocks = getFreeBlocks(lfsMetaData.blocks, bitmap);
+// Largo de la linea "x-y=cantidad\n" o del registro en el archivo
+static int pokemonLineLength(uint32_t posX, uint32_t posY, uint32_t cantidad) {
+	if (formatoBinario) return REGISTRO_BINARIO;
+	return snprintf(NULL, 0, "%d-%d=%d\n", posX, posY, cantidad);
+}
 
-	// Existe Pokemon
-	if (access(completePath, F_OK) != -1) {
-		game_card_logger_info("Pokemon existe dentro del FS!.");
-		operateNewPokemonFile(newPokemon, completePath, freeBlocks);
-	} else {
-		game_card_logger_info("No existe ese Pokemon. Se crean y escriben las estructuras.");
-		char* super_path = (char*) malloc(strlen(newPokemon->nombre_pokemon) +1);
-		char* pokemonDirectory = (char*) malloc(strlen(newPokemon->nombre_pokemon)+1);
-	
-		if (string_contains(newPokemon->nombre_pokemon, "/")) {
-	    	split_path(newPokemon->nombre_pokemon, &super_path, &pokemonDirectory);
-			char* filePath = string_new();
-			string_append(&filePath, "Files/");
-			string_append(&filePath, super_path);
-			createRecursiveDirectory(filePath);
-			free(filePath);
-		}
+// Deja en destino la linea o el registro, como va en el archivo. Devuelve el largo
+static int encodePokemonLine(char* destino, blockLine* pokemonLine) {
+	if (!formatoBinario)
+		return sprintf(destino, "%d-%d=%d\n", pokemonLine->posX, pokemonLine->posY, pokemonLine->cantidad);
+	uint32_t registro[3] = { htole32(pokemonLine->posX), htole32(pokemonLine->posY), htole32(pokemonLine->cantidad) };
+	memcpy(destino, registro, REGISTRO_BINARIO);
+	return REGISTRO_BINARIO;
+}
 
-		createFile(newPokemon->nombre_pokemon);
-
-		char* pokemonPerPosition = formatToBlockLine(newPokemon->pos_x, newPokemon->pos_y, newPokemon->cantidad);
-		int pokemonPerPositionLength = strlen(pokemonPerPosition);
-
-		// Necesito 1 solo bloque
-		if(lfsMetaData.blockSize >= pokemonPerPositionLength) {
-		  
-		  int blocksRequired = cuantosBloquesOcupa(pokemonPerPosition);
-
-		  if (freeBlocks > blocksRequired) {
-			int freeBlockPosition = getAndSetFreeBlock(bitmap, lfsMetaData.blocks);
-			t_list* freeBlocks = list_create();
-			list_add(freeBlocks, (void*)freeBlockPosition);
-			char* metadataBlocks = formatToMetadataBlocks(freeBlocks);
-			char* stringLength = string_itoa(pokemonPerPositionLength);
-			
-			char* pathBloque = obtenerPathDelNumeroDeBloque(freeBlockPosition);
-			FILE* blockFile = fopen(pathBloque,"wr");
-			fwrite(pokemonPerPosition, 1 , pokemonPerPositionLength, blockFile);
-			updatePokemonMetadata(newPokemon->nombre_pokemon, "N", stringLength, metadataBlocks, "N", "NEW_POKEMON");
-			game_card_logger_info("Operacion NEW_POKEMON %s, Coordenada: (%d, %d, %d) terminada correctamente", newPokemon->nombre_pokemon, newPokemon->pos_x, newPokemon->pos_y, newPokemon->cantidad);
-			
-			fclose(blockFile);
-			free(metadataBlocks);
-			free(stringLength);
-			free(pathBloque);
-			list_destroy(freeBlocks);
-
-		  } else {
-			game_card_logger_error("No hay bloques disponibles. No se puede hacer la operacion");
-		  }
-		} else if(lfsMetaData.blockSize < pokemonPerPositionLength) {
-		  
-		  t_list* pokemonLines = list_create();
-		  blockLine* newNode = createBlockLine(newPokemon->pos_x, newPokemon->pos_y, newPokemon->cantidad);
-		  list_add(pokemonLines, (void*)newNode);
-
-		  char* stringToWrite = formatListToStringLine(pokemonLines);
-		  int blocksRequired = cuantosBloquesOcupa(stringToWrite);
-
-		  if (freeBlocks > blocksRequired) {
-			char* stringLength = string_itoa(strlen(stringToWrite));
-			t_list* listBlocks = requestFreeBlocks(blocksRequired);
-			writeBlocks(stringToWrite, listBlocks);
-			char* metadataBlocks = formatToMetadataBlocks(listBlocks);
-			updatePokemonMetadata(newPokemon->nombre_pokemon, "N", stringLength, metadataBlocks, "N", "NEW_POKEMON");
-			game_card_logger_info("Operacion NEW_POKEMON %s, Coordenada: (%d, %d, %d) terminada correctamente", newPokemon->nombre_pokemon, newPokemon->pos_x, newPokemon->pos_y, newPokemon->cantidad);
-
-			list_destroy(listBlocks);
-			free(metadataBlocks);
-		  } else {
-			  game_card_logger_error("No hay bloques disponibles. No se puede hacer la operacion");
-		  }
-		  
-		  list_destroy_and_destroy_elements(pokemonLines, (void*)freeBlockLine);
-		  free(stringToWrite);
-	  	}
-
-		free(super_path);
-		free(pokemonDirectory);
-		free(pokemonPerPosition);
+static blockLine* decodePokemonRecord(char* registro) {
+	uint32_t campos[3];
+	memcpy(campos, registro, REGISTRO_BINARIO);
+	return createBlockLine(le32toh(campos[0]), le32toh(campos[1]), le32toh(campos[2]));
+}
+
+// Orden de los registros binarios: por x y despues por y
+static bool pokemonLineBefore(blockLine* una, blockLine* otra) {
+	return una->posX < otra->posX || (una->posX == otra->posX && una->posY < otra->posY);
+}
+
+// Reserva los bloques que hagan falta para que entren tamanio bytes. Si
+// sobran no se liberan aca: siguen en el Metadata.bin hasta la proxima
+// escritura
+static bool reservePokemonBlocks(t_pokemon_cache* cache, int tamanio) {
+	int blocksRequired = tamanio == 0 ? 0 : calcualarBloques(tamanio);
+	int extraBlocksNeeded = blocksRequired - list_size(cache->bloques);
+	if (extraBlocksNeeded <= 0)
+		return true;
+
+	pthread_mutex_lock(&MUTEX_BITMAP);
+	bool fits = getFreeBlocks(lfsMetaData.blocks, bitmap) >= extraBlocksNeeded;
+	if (fits) {
+		int lastBlock = list_is_empty(cache->bloques) ? -1 : (int) (intptr_t) list_get(cache->bloques, list_size(cache->bloques) - 1);
+		t_list* extraBlocks = requestFreeBlocks(extraBlocksNeeded, lastBlock);
+		list_add_all(cache->bloques, extraBlocks);
+		list_destroy(extraBlocks);
 	}
-	
-	free(completePath);
+	pthread_mutex_unlock(&MUTEX_BITMAP);
+	return fits;
 }
 
-int catchAPokemon(t_catch_pokemon* catchPokemon) {
-	char* completePath = string_new();
-	int res;
-	string_append(&completePath, struct_paths[FILES]);
-	string_append(&completePath, catchPokemon->nombre_pokemon);
+// El Bitmap.bin esta mapeado: se baja al disco en cada escritura, con
+// MUTEX_BITMAP tomado. Incluye los bloques reservados desde la anterior
+static void syncBitmap() {
+	if (msync(bitmap->bitarray, bitmap->size, MS_SYNC) == -1)
+		game_card_logger_error("Fallo el msync del bitmap: %s", strerror(errno));
+}
 
-	if (access(completePath, F_OK) != -1) {
-		game_card_logger_info("Existe el pokemon, se leen las estructuras");
-		res = operateCatchPokemonFile(catchPokemon, completePath);
-	} else {
-		game_card_logger_error("No existe ese Pokemon en el filesystem.");
+// Marca los bloques donde cae [desde, desde + largo)
+static void markPokemonBytes(t_pokemon_cache* cache, int desde, int largo) {
+	for (int i = desde / lfsMetaData.blockSize; i <= (desde + largo - 1) / lfsMetaData.blockSize; i++)
+		game_card_cache_mark_block(cache, i);
+}
+
+// La linea cambio de cantidad. Si el largo es el mismo solo se reescribe su
+// bloque; si no, se corre todo lo que viene despues
+static void resizePokemonLine(t_pokemon_cache* cache, blockLine* pokemonLine, int largoAnterior) {
+	int largo = pokemonLineLength(pokemonLine->posX, pokemonLine->posY, pokemonLine->cantidad);
+	cache->tamanio += largo - largoAnterior;
+	if (largo == largoAnterior) {
+		markPokemonBytes(cache, pokemonLine->offset, largo);
+		return;
+	}
+	void shift(blockLine* otherLine) {
+		if (otherLine->offset > pokemonLine->offset)
+			otherLine->offset += largo - largoAnterior;
 	}
+	list_iterate(cache->lineas, (void*) shift);
+	game_card_cache_mark_from(cache, pokemonLine->offset / lfsMetaData.blockSize);
+}
 
+// Una linea nueva va al final. Un registro binario va en su lugar en el
+// orden y corre a los que siguen
+static void insertPokemonLine(t_pokemon_cache* cache, blockLine* pokemonLine) {
+	int largo = pokemonLineLength(pokemonLine->posX, pokemonLine->posY, pokemonLine->cantidad);
+	if (!formatoBinario) {
+		pokemonLine->offset = cache->tamanio;
+		game_card_cache_add(cache, pokemonLine->posX, pokemonLine->posY, pokemonLine);
+		markPokemonBytes(cache, pokemonLine->offset, largo);
+		cache->tamanio += largo;
+		return;
+	}
 
-	free(completePath);
+	int indice = 0;
+	void place(blockLine* otherLine) {
+		if (pokemonLineBefore(otherLine, pokemonLine)) indice++;
+		else otherLine->offset += largo;
+	}
+	list_iterate(cache->lineas, (void*) place);
+	pokemonLine->offset = indice * largo;
+	game_card_cache_insert(cache, indice, pokemonLine->posX, pokemonLine->posY, pokemonLine);
+	game_card_cache_mark_from(cache, pokemonLine->offset / lfsMetaData.blockSize);
+	cache->tamanio += largo;
+}
 
-	return res;
+static void removePokemonLine(t_pokemon_cache* cache, blockLine* pokemonLine) {
+	int largo = pokemonLineLength(pokemonLine->posX, pokemonLine->posY, pokemonLine->cantidad);
+	game_card_cache_remove(cache, pokemonLine->posX, pokemonLine->posY);
+	void shift(blockLine* otherLine) {
+		if (otherLine->offset > pokemonLine->offset)
+			otherLine->offset -= largo;
+	}
+	list_iterate(cache->lineas, (void*) shift);
+	game_card_cache_mark_from(cache, pokemonLine->offset / lfsMetaData.blockSize);
+	cache->tamanio -= largo;
+	freeBlockLine(pokemonLine);
 }
 
+// Escribe los bloques marcados de los primeros blocksRequired. Una sola
+// pasada por las lineas, que estan en orden: cada una se copia a los
+// bloques que toca y un bloque se escribe cuando se pasa al siguiente
+static void writePokemonBlocks(t_pokemon_cache* cache, int blocksRequired) {
+	char* contenido = malloc(lfsMetaData.blockSize);
+	int actual = -1;
+	bool actualSucio = false;
+	char texto[40];
+
+	void flush() {
+		if (actual == -1 || !actualSucio)
+			return;
+		int desde = actual * lfsMetaData.blockSize;
+		int hasta = desde + lfsMetaData.blockSize < cache->tamanio ? desde + lfsMetaData.blockSize : cache->tamanio;
+		game_card_blocks_write((int) (intptr_t) list_get(cache->bloques, actual), contenido, hasta - desde);
+	}
 
+	void copy(blockLine* pokemonLine) {
+		int largo = encodePokemonLine(texto, pokemonLine);
+		int primero = pokemonLine->offset / lfsMetaData.blockSize;
+		int ultimo = (pokemonLine->offset + largo - 1) / lfsMetaData.blockSize;
+		for (int bloque = primero; bloque <= ultimo && bloque < blocksRequired; bloque++) {
+			if (bloque != actual) {
+				flush();
+				actual = bloque;
+				actualSucio = game_card_cache_block_dirty(cache, bloque);
+			}
+			if (!actualSucio)
+				continue;
+			// La linea puede empezar en el bloque anterior o seguir en el proximo
+			int desde = bloque * lfsMetaData.blockSize;
+			int inicio = pokemonLine->offset < desde ? desde - pokemonLine->offset : 0;
+			int fin = pokemonLine->offset + largo > desde + lfsMetaData.blockSize ?
+					desde + lfsMetaData.blockSize - pokemonLine->offset : largo;
+			memcpy(contenido + pokemonLine->offset + inicio - desde, texto + inicio, fin - inicio);
+		}
+	}
 
-t_list* getAPokemon(t_get_pokemon* getPokemon) {
-	char* completePath = string_new();
-	string_append(&completePath, struct_paths[FILES]);
-	string_append(&completePath, getPokemon->nombre_pokemon);
-	t_list* res;
+	list_iterate(cache->lineas, (void*) copy);
+	flush();
+	free(contenido);
+}
 
-	if (access(completePath, F_OK) != -1) {
-		game_card_logger_info("Existe el pokemon, se leen las estructuras");
-		res = operateGetPokemonFile(getPokemon, completePath);
-	} else {
-		game_card_logger_error("No existe ese Pokemon en el filesystem.");
-		res = list_create();
-		
+static void createPokemonFile(char* nombrePokemon) {
+	char* super_path = (char*) malloc(strlen(nombrePokemon) +1);
+	char* pokemonDirectory = (char*) malloc(strlen(nombrePokemon)+1);
+
+	if (string_contains(nombrePokemon, "/")) {
+		split_path(nombrePokemon, &super_path, &pokemonDirectory);
+		char* filePath = string_new();
+		string_append(&filePath, "Files/");
+		string_append(&filePath, super_path);
+		createRecursiveDirectory(filePath);
+		free(filePath);
 	}
 
-	free(completePath);
-	return res;
+	createFile(nombrePokemon);
+
+	free(super_path);
+	free(pokemonDirectory);
 }
 
-void operateNewPokemonFile(t_new_pokemon* newPokemon, char* completePath, int freeBlocks) {
-	pokemonMetadata pokemonMetadata = readPokemonMetadata(completePath);
+void createNewPokemon(t_new_pokemon* newPokemon) {
+	// Tomado antes de ver si existe: dos NEW de una especie nueva no la crean dos veces
+	t_game_card_lock* lock = game_card_lock_write(newPokemon->nombre_pokemon);
+	t_pokemon_cache* cache = game_card_cache_get(newPokemon->nombre_pokemon);
 
-	pthread_mutex_lock (&MUTEX_LISTA_ARCHIVO_ABIERTO);
-	pokemon_open_tad* pokemonOpenTad = dictionary_get(files_open, completePath);
-	if (pokemonOpenTad == NULL) {
-		pokemonOpenTad = new_pokemon_open_tad();
-		dictionary_put(files_open, completePath, pokemonOpenTad);
+	if (cache->existe) {
+		game_card_logger_info("Pokemon existe dentro del FS!.");
+	} else {
+		game_card_logger_info("No existe ese Pokemon. Se crean y escriben las estructuras.");
+		createPokemonFile(newPokemon->nombre_pokemon);
+		cache->existe = true;
 	}
-	pthread_mutex_unlock (&MUTEX_LISTA_ARCHIVO_ABIERTO);
-	while (true) {
-		if(string_equals_ignore_case(pokemonMetadata.isOpen, "N")) {
-			sleep(10);
-			game_card_logger_info("El archivo no esta abierto por ningun proceso, se procede a abrir el mismo.");
-			pthread_mutex_lock(&pokemonOpenTad->mArchivo);
-			updateOpenFileState(newPokemon->nombre_pokemon, "Y", "NEW_POKEMON");
-			pthread_mutex_unlock(&pokemonOpenTad->mArchivo);
-			
-			t_list* listBlocks = stringBlocksToList(pokemonMetadata.blocks);
-			t_list* pokemonLines = readPokemonLines(listBlocks);
-			if (coordinateExists(newPokemon->pos_x, newPokemon->pos_y, pokemonLines) == 1) {
-				addTotalPokemonIfCoordinateExist(newPokemon, pokemonLines);
-			} else {
-				blockLine* newNode = createBlockLine(newPokemon->pos_x, newPokemon->pos_y, newPokemon->cantidad);
-				list_add(pokemonLines, (void*)newNode);
-			}
-			
-			char* stringToWrite = formatListToStringLine(pokemonLines);
-			int blocksRequired = cuantosBloquesOcupa(stringToWrite);
-			char* stringLength = string_itoa(strlen(stringToWrite));
-
-			if (freeBlocks > blocksRequired) {
-				// Necesito pedir bloques
-				if (blocksRequired > list_size(listBlocks)) {
-					int extraBlocksNeeded = blocksRequired - list_size(listBlocks);
-					t_list* extraBlocks = requestFreeBlocks(extraBlocksNeeded);
-					// Agrego los nuevos bloques en la lista original
-					list_add_all(listBlocks, (void*)extraBlocks);
-					list_destroy(extraBlocks);
-				} 
-				writeBlocks(stringToWrite, listBlocks);
-				char* metadataBlocks = formatToMetadataBlocks(listBlocks);
-				
-				pthread_mutex_lock(&pokemonOpenTad->mArchivo);
-				updatePokemonMetadata(newPokemon->nombre_pokemon, "N", stringLength, metadataBlocks, "N", "NEW_POKEMON");
-				pthread_mutex_unlock(&pokemonOpenTad->mArchivo);
-
-				game_card_logger_info("Operacion NEW_POKEMON %s, Coordenada: (%d, %d, %d) terminada correctamente", newPokemon->nombre_pokemon, newPokemon->pos_x, newPokemon->pos_y, newPokemon->cantidad);
-				free(metadataBlocks);
-			} else {
-				game_card_logger_error("No hay bloques disponibles. No se puede hacer la operacion");
-			}
 
-			char* metadataBlocks = formatToMetadataBlocks(listBlocks);
-			pthread_mutex_lock(&pokemonOpenTad->mArchivo);
-			updatePokemonMetadata(newPokemon->nombre_pokemon, "N", stringLength, metadataBlocks, "N", "NEW_POKEMON");
-			pthread_mutex_unlock(&pokemonOpenTad->mArchivo);
-			list_destroy_and_destroy_elements(pokemonLines, (void*)freeBlockLine);
-			free(stringToWrite);
-			free(stringLength);
-			break;
+	blockLine* pokemonLine = game_card_cache_find(cache, newPokemon->pos_x, newPokemon->pos_y);
+	int tamanio = cache->tamanio;
+	if (pokemonLine != NULL) {
+		tamanio += pokemonLineLength(newPokemon->pos_x, newPokemon->pos_y, pokemonLine->cantidad + newPokemon->cantidad)
+				- pokemonLineLength(newPokemon->pos_x, newPokemon->pos_y, pokemonLine->cantidad);
+	} else {
+		tamanio += pokemonLineLength(newPokemon->pos_x, newPokemon->pos_y, newPokemon->cantidad);
+	}
+
+	if (reservePokemonBlocks(cache, tamanio)) {
+		if (pokemonLine != NULL) {
+			int largoAnterior = pokemonLineLength(pokemonLine->posX, pokemonLine->posY, pokemonLine->cantidad);
+			pokemonLine->cantidad += newPokemon->cantidad;
+			resizePokemonLine(cache, pokemonLine, largoAnterior);
 		} else {
-			game_card_logger_info("Archivo abierto, se procede a reintentar luego de %d segundos. ", game_card_config->tiempo_de_reintento_operacion);
-			game_card_logger_info("Operacion NEW_POKEMON %s, Coordenada: (%d, %d, %d)", newPokemon->nombre_pokemon, newPokemon->pos_x, newPokemon->pos_y, newPokemon->cantidad);
-			sleep(game_card_config->tiempo_de_reintento_operacion);
-			pokemonMetadata = readPokemonMetadata(completePath);
+			insertPokemonLine(cache, createBlockLine(newPokemon->pos_x, newPokemon->pos_y, newPokemon->cantidad));
 		}
+		game_card_cache_touch(cache);
+		game_card_logger_info("Operacion NEW_POKEMON %s, Coordenada: (%d, %d, %d) terminada correctamente", newPokemon->nombre_pokemon, newPokemon->pos_x, newPokemon->pos_y, newPokemon->cantidad);
+	} else {
+		game_card_logger_error("No hay bloques disponibles. No se puede hacer la operacion");
 	}
-	
 
-	free(pokemonMetadata.blocks);
-	free(pokemonMetadata.isOpen);
+	game_card_unlock_write(lock);
 }
 
+int catchAPokemon(t_catch_pokemon* catchPokemon) {
+	int res = 0;
 
-t_list* operateGetPokemonFile(t_get_pokemon* getPokemon, char* completePath) {
-	pokemonMetadata pokemonMetadata = readPokemonMetadata(completePath);
-	t_list* res;
+	t_game_card_lock* lock = game_card_lock_write(catchPokemon->nombre_pokemon);
+	t_pokemon_cache* cache = game_card_cache_get(catchPokemon->nombre_pokemon);
+	blockLine* pokemonLine = cache->existe ?
+			game_card_cache_find(cache, catchPokemon->pos_x, catchPokemon->pos_y) : NULL;
 
-	pthread_mutex_lock (&MUTEX_LISTA_ARCHIVO_ABIERTO);
-	pokemon_open_tad* pokemonOpenTad = dictionary_get(files_open, completePath);
-	if (pokemonOpenTad == NULL) {
-		pokemonOpenTad = new_pokemon_open_tad();
-		dictionary_put(files_open, completePath, pokemonOpenTad);
-	}
-	pthread_mutex_unlock (&MUTEX_LISTA_ARCHIVO_ABIERTO);
-
-	while (true) {
-		if (string_equals_ignore_case(pokemonMetadata.isOpen, "N")) {
-			sleep(10);
-			game_card_logger_info("El archivo no esta abierto por ningun proceso, se procede a abrir el mismo.");
-			pthread_mutex_lock(&pokemonOpenTad->mArchivo);
-			updateOpenFileState(getPokemon->nombre_pokemon, "Y", "GET_POKEMON");
-			pthread_mutex_unlock(&pokemonOpenTad->mArchivo);
-
-			t_list* listBlocks = stringBlocksToList(pokemonMetadata.blocks);
-			res = readPokemonLines(listBlocks);
-			
-			pthread_mutex_lock(&pokemonOpenTad->mArchivo);
-			updateOpenFileState(getPokemon->nombre_pokemon, "N", "GET_POKEMON");
-			pthread_mutex_unlock(&pokemonOpenTad->mArchivo);
-
-			game_card_logger_info("Operacion GET_POKEMON %s terminada correctamente", getPokemon->nombre_pokemon);
-			break;
+	if (!cache->existe) {
+		game_card_logger_error("No existe ese Pokemon en el filesystem.");
+	} else if (pokemonLine == NULL) {
+		game_card_logger_error("No existen las coordenadas para ese pokemon, no se puede completar la operacion.");
+	} else {
+		if (pokemonLine->cantidad > 1) {
+			int largoAnterior = pokemonLineLength(pokemonLine->posX, pokemonLine->posY, pokemonLine->cantidad);
+			pokemonLine->cantidad--;
+			resizePokemonLine(cache, pokemonLine, largoAnterior);
 		} else {
-			game_card_logger_info("Archivo abierto, se procede a reintentar luego de %d segundos", game_card_config->tiempo_de_reintento_operacion);
-			game_card_logger_info("Operacion GET_POKEMON %s", getPokemon->nombre_pokemon);
-			sleep(game_card_config->tiempo_de_reintento_operacion);
-			pokemonMetadata = readPokemonMetadata(completePath);
+			removePokemonLine(cache, pokemonLine);
 		}
-		
+		game_card_cache_touch(cache);
+		res = 1;
+		game_card_logger_info("Operacion CATCH_POKEMON %s en la posicion (%d, %d) terminada correctamente", catchPokemon->nombre_pokemon, catchPokemon->pos_x, catchPokemon->pos_y);
 	}
-	
 
-	free(pokemonMetadata.blocks);
-	free(pokemonMetadata.isOpen);
+	game_card_unlock_write(lock);
 	return res;
 }
 
-int operateCatchPokemonFile(t_catch_pokemon* catchPokemon, char* completePath) {
-	pokemonMetadata pokemonMetadata = readPokemonMetadata(completePath);
-	int res = 0;
+// Devuelve una copia de las lineas (blockLine), a liberar por quien llama
+t_list* getAPokemon(t_get_pokemon* getPokemon) {
+	t_list* res = list_create();
+
+	t_game_card_lock* lock = game_card_lock_read(getPokemon->nombre_pokemon);
+	t_pokemon_cache* cache = game_card_cache_get(getPokemon->nombre_pokemon);
+	if (cache->existe) {
+		for (int i = 0; i < list_size(cache->lineas); i++) {
+			blockLine* pokemonLine = list_get(cache->lineas, i);
+			list_add(res, createBlockLine(pokemonLine->posX, pokemonLine->posY, pokemonLine->cantidad));
+		}
+		game_card_logger_info("Operacion GET_POKEMON %s terminada correctamente", getPokemon->nombre_pokemon);
+	} else {
+		game_card_logger_error("No existe ese Pokemon en el filesystem.");
+	}
+	game_card_unlock_read(lock);
+
+	return res;
+}
 
-	pthread_mutex_lock (&MUTEX_LISTA_ARCHIVO_ABIERTO);
-	pokemon_open_tad* pokemonOpenTad = dictionary_get(files_open, completePath);
-	if (pokemonOpenTad == NULL) {
-		pokemonOpenTad = new_pokemon_open_tad();
-		dictionary_put(files_open, completePath, pokemonOpenTad);
+// Carga una especie del disco a la cache
+static void loadPokemon(t_pokemon_cache* cache) {
+	char* completePath = string_new();
+	string_append(&completePath, struct_paths[FILES]);
+	string_append(&completePath, cache->especie);
+
+	cache->existe = access(completePath, F_OK) != -1;
+	if (cache->existe) {
+		pokemonMetadata pokemonMetadata = readPokemonMetadata(completePath);
+		t_list* listBlocks = stringBlocksToList(pokemonMetadata.blocks);
+		list_add_all(cache->bloques, listBlocks);
+		list_destroy(listBlocks);
+		cache->tamanio_escrito = pokemonMetadata.blockSize;
+		cache->bloques_escritos = list_size(cache->bloques);
+
+		t_list* pokemonLines = readPokemonLines(cache->bloques, pokemonMetadata.blockSize);
+		for (int i = 0; i < list_size(pokemonLines); i++) {
+			blockLine* pokemonLine = list_get(pokemonLines, i);
+			pokemonLine->offset = cache->tamanio;
+			game_card_cache_add(cache, pokemonLine->posX, pokemonLine->posY, pokemonLine);
+			cache->tamanio += pokemonLineLength(pokemonLine->posX, pokemonLine->posY, pokemonLine->cantidad);
+		}
+		list_destroy(pokemonLines);
+		free(pokemonMetadata.blocks);
+		free(pokemonMetadata.isOpen);
 	}
-	pthread_mutex_unlock (&MUTEX_LISTA_ARCHIVO_ABIERTO);
-	while(true) {
-		if (string_equals_ignore_case(pokemonMetadata.isOpen, "N")) {
-			sleep(10);
-			game_card_logger_info("El archivo no esta abierto por ningun proceso, se procede a abrir el mismo.");
-			pthread_mutex_lock(&pokemonOpenTad->mArchivo);
-			updateOpenFileState(catchPokemon->nombre_pokemon, "Y", "CATCH_POKEMON");
-			pthread_mutex_unlock(&pokemonOpenTad->mArchivo);
-
-			t_list* listBlocks = stringBlocksToList(pokemonMetadata.blocks);
-			t_list* pokemonLines = readPokemonLines(listBlocks);
-
-			if (coordinateExists(catchPokemon->pos_x, catchPokemon->pos_y, pokemonLines) == 1) {
-				deletePokemonTotalIfCoordinateExist(catchPokemon, pokemonLines);
-				char* stringToWrite = formatListToStringLine(pokemonLines);
-				int blocksRequired = cuantosBloquesOcupa(stringToWrite);
-				char* stringLength = string_itoa(strlen(stringToWrite));
-
-				if (strlen(stringToWrite) != 0) {
-					if (blocksRequired == list_size(listBlocks)) {
-						writeBlocks(stringToWrite, listBlocks);
-						char* metadataBlocks = formatToMetadataBlocks(listBlocks);
-						
-						pthread_mutex_lock(&pokemonOpenTad->mArchivo);
-						updatePokemonMetadata(catchPokemon->nombre_pokemon, "N", stringLength, metadataBlocks, "N", "CATCH_POKEMON");
-						pthread_mutex_unlock(&pokemonOpenTad->mArchivo);
-						free(metadataBlocks);
-					}
-
-					if (blocksRequired < list_size(listBlocks)) {
-						int lastBlockUsing = (int)list_get(listBlocks, list_size(listBlocks) - 1 );
-						list_remove(listBlocks, list_size(listBlocks) - 1);
-						writeBlocks(stringToWrite, listBlocks);
-						char* metadataBlocks = formatToMetadataBlocks(listBlocks);
-						
-						
-						pthread_mutex_lock(&pokemonOpenTad->mArchivo);
-						updatePokemonMetadata(catchPokemon->nombre_pokemon, "N", stringLength, metadataBlocks, "N", "CATCH_POKEMON");
-						pthread_mutex_unlock(&pokemonOpenTad->mArchivo);
-						
-						// Limpio estructuras que ya no uso
-						setear_bloque_libre_en_posicion(bitmap, lastBlockUsing);
-						fclose(fopen(obtenerPathDelNumeroDeBloque(lastBlockUsing), "w"));
-						free(metadataBlocks);
-					}
-				} 
-
-				// Edge case donde el pokemon tiene una sola linea, un solo bloque asignado y la unica coordenada es == 1
-				// Asumo que el bloque se queda ocupado pero con size = 0
-				if (strlen(stringToWrite) == 0 && list_size(pokemonLines) == 0) {
-					int blockUsed = (int)list_get(listBlocks, 0);
-					char* metadataBlocks = formatToMetadataBlocks(listBlocks);
-					char* zeroLength = string_itoa(0);
-
-					pthread_mutex_lock(&pokemonOpenTad->mArchivo);
-					updatePokemonMetadata(catchPokemon->nombre_pokemon, "N", zeroLength, "[]", "N", "CATCH_POKEMON");
-					pthread_mutex_unlock(&pokemonOpenTad->mArchivo);
-						
-					// Limpio estructuras que ya no uso
-					fclose(fopen(obtenerPathDelNumeroDeBloque(blockUsed), "w"));
-					game_card_logger_info("Se procede a setear el bloque %d como LIBRE", blockUsed);
-					setear_bloque_libre_en_posicion(bitmap, blockUsed);
-					free(zeroLength);
-					free(metadataBlocks);
-				}
-				res = 1;
-				//char* metadataBlocks = formatToMetadataBlocks(listBlocks);
-				game_card_logger_info("Operacion CATCH_POKEMON %s en la posicion (%d, %d) terminada correctamente", catchPokemon->nombre_pokemon, catchPokemon->pos_x, catchPokemon->pos_y);
+	free(completePath);
+}
+
+// Escribe la especie: solo los bloques marcados, el Metadata.bin si cambio,
+// y recien despues libera los bloques que sobran
+static void storePokemon(t_pokemon_cache* cache) {
+	int blocksRequired = cache->tamanio == 0 ? 0 : calcualarBloques(cache->tamanio);
+
+	writePokemonBlocks(cache, blocksRequired);
+	// Con MMAP un solo msync para todos los bloques de la tanda, antes del
+	// Metadata.bin que los referencia
+	game_card_blocks_sync();
+
+	if (cache->tamanio != cache->tamanio_escrito || blocksRequired != cache->bloques_escritos) {
+		t_list* listBlocks = list_take(cache->bloques, blocksRequired);
+		char* metadataBlocks = formatToMetadataBlocks(listBlocks);
+		char* stringLength = string_itoa(cache->tamanio);
+		// El OPEN queda como esta: Y si escribe un NEW/CATCH sin escritura
+		// diferida, N si escribe el hilo con la especie tomada para leer
+		char* open = game_card_lock_writing(cache->especie) ? "Y" : "N";
+		updatePokemonMetadata(cache->especie, "N", stringLength, metadataBlocks, open, "STORE");
+		cache->tamanio_escrito = cache->tamanio;
+		cache->bloques_escritos = blocksRequired;
+		list_destroy(listBlocks);
+		free(metadataBlocks);
+		free(stringLength);
+	}
+
+	pthread_mutex_lock(&MUTEX_BITMAP);
+	while (list_size(cache->bloques) > blocksRequired) {
+		int unusedBlock = (int) (intptr_t) list_remove(cache->bloques, blocksRequired);
+		game_card_blocks_clear(unusedBlock);
+		game_card_logger_info("Se procede a setear el bloque %d como LIBRE", unusedBlock);
+		setear_bloque_libre_en_posicion(bitmap, unusedBlock);
+	}
+	syncBitmap();
+	pthread_mutex_unlock(&MUTEX_BITMAP);
+}
 
-				free(stringToWrite);
-				free(stringLength);
+// Agrega a especies los directorios de Files/ con un Metadata.bin con
+// DIRECTORY=N, como ruta desde Files/. Entra en los que tienen DIRECTORY=Y
+static void addPokemonFiles(char* relativo, t_list* especies) {
+	char* directorio = string_from_format("%s%s", struct_paths[FILES], relativo);
+	DIR* dir = opendir(directorio);
+	if (dir == NULL) {
+		free(directorio);
+		return;
+	}
+
+	struct dirent* entrada;
+	while ((entrada = readdir(dir)) != NULL) {
+		if (entrada->d_name[0] == '.') continue;
+		char* hijo = string_from_format("%s%s%s", relativo, relativo[0] ? "/" : "", entrada->d_name);
+		char* metadataBin = string_from_format("%s%s/Metadata.bin", struct_paths[FILES], hijo);
+		if (access(metadataBin, F_OK) != -1) {
+			t_config* metadata = config_create(metadataBin);
+			bool esArchivo = config_has_property(metadata, "DIRECTORY")
+					&& string_equals_ignore_case(config_get_string_value(metadata, "DIRECTORY"), "N");
+			config_destroy(metadata);
+			if (esArchivo) {
+				list_add(especies, hijo);
+				hijo = NULL;
 			} else {
-				game_card_logger_error("No existen las coordenadas para ese pokemon, no se puede completar la operacion.");
-				pthread_mutex_lock(&pokemonOpenTad->mArchivo);
-				updateOpenFileState(catchPokemon->nombre_pokemon, "N", "CATCH_POKEMON");
-				pthread_mutex_unlock(&pokemonOpenTad->mArchivo);
+				addPokemonFiles(hijo, especies);
 			}
+		}
+		free(hijo);
+		free(metadataBin);
+	}
+	closedir(dir);
+	free(directorio);
+}
 
-			list_destroy_and_destroy_elements(pokemonLines, (void*)freeBlockLine);
-			break;
-		} else {
-			game_card_logger_info("Archivo abierto, se procede a reintentar luego de %d segundos", game_card_config->tiempo_de_reintento_operacion);
-			game_card_logger_info("Operacion CATCH_POKEMON %s, Coordenada: (%d, %d)", catchPokemon->nombre_pokemon, catchPokemon->pos_x, catchPokemon->pos_y);
-			sleep(game_card_config->tiempo_de_reintento_operacion);
-			pokemonMetadata = readPokemonMetadata(completePath);
+// FORMAT del Metadata.bin de la especie: TALL_GRASS_BIN si ya se escribio en
+// registros binarios
+static bool pokemonIsBinary(char* especie) {
+	char* metadataBin = string_from_format("%s%s/Metadata.bin", struct_paths[FILES], especie);
+	t_config* metadata = config_create(metadataBin);
+	bool binario = config_has_property(metadata, "FORMAT")
+			&& string_equals_ignore_case(config_get_string_value(metadata, "FORMAT"), MAGIC_NUMBER_BINARIO);
+	config_destroy(metadata);
+	free(metadataBin);
+	return binario;
+}
+
+// Marca el Metadata.bin del filesystem con la migracion en curso, o con el
+// MAGIC_NUMBER binario cuando termino
+static void saveMigrationState(bool terminada) {
+	char* metadataBin = string_from_format("%sMetadata.bin", struct_paths[METADATA]);
+	t_config* metadata = config_create(metadataBin);
+	if (terminada) {
+		config_set_value(metadata, "MAGIC_NUMBER", MAGIC_NUMBER_BINARIO);
+		char* version = string_itoa(VERSION_BINARIO);
+		config_set_value(metadata, "VERSION", version);
+		free(version);
+		config_remove_key(metadata, "MIGRATING");
+	} else {
+		config_set_value(metadata, "MIGRATING", "Y");
+	}
+	config_save(metadata);
+	config_destroy(metadata);
+	free(metadataBin);
+	migracionPendiente = !terminada;
+}
+
+// Al retomar: libera los bloques ocupados en el bitmap que no son de ninguna
+// especie. Los deja un corte entre el Metadata.bin de una especie y la
+// liberacion de sus bloques viejos
+static void releaseOrphanBlocks(t_list* caches) {
+	bool* usados = calloc(lfsMetaData.blocks, sizeof(bool));
+	void use(t_pokemon_cache* cache) {
+		void mark(void* block) {
+			if ((int) (intptr_t) block < lfsMetaData.blocks)
+				usados[(int) (intptr_t) block] = true;
+		}
+		list_iterate(cache->bloques, mark);
+	}
+	list_iterate(caches, (void*) use);
+
+	int liberados = 0;
+	pthread_mutex_lock(&MUTEX_BITMAP);
+	for (int i = 0; i < lfsMetaData.blocks; i++) {
+		if (!usados[i] && bitarray_test_bit(bitmap, i)) {
+			game_card_blocks_clear(i);
+			setear_bloque_libre_en_posicion(bitmap, i);
+			liberados++;
 		}
+	}
+	syncBitmap();
+	pthread_mutex_unlock(&MUTEX_BITMAP);
+	free(usados);
+	if (liberados > 0)
+		game_card_logger_info("Liberados %d bloques que dejo la migracion cortada", liberados);
+}
 
+// Pasa todas las especies de lineas de texto a registros binarios y despues
+// cambia el MAGIC_NUMBER. Se corre con el GameCard parado (--migrar-binario).
+// Antes de tocar una especie deja MIGRATING=Y en el Metadata.bin. Cada
+// especie se escribe en bloques nuevos y su Metadata.bin pasa a ellos, con
+// FORMAT=TALL_GRASS_BIN, recien cuando estan escritos; despues se liberan los
+// de texto. Si se corta, volver a correrlo retoma: lee cada especie en su
+// formato y migra las que siguen en texto. -1 si en algun momento no hay
+// bloques libres: en ese caso no cambia nada
+int gcfsMigrateToBinary() {
+	if (formatoBinario && !migracionPendiente) {
+		game_card_logger_info("El filesystem ya usa registros binarios");
+		return 0;
 	}
 
-	free(pokemonMetadata.blocks);
-	free(pokemonMetadata.isOpen);
+	bool retomada = migracionPendiente;
+	if (retomada)
+		game_card_logger_info("Retomando la migracion a registros binarios");
+	t_list* especies = list_create();
+	addPokemonFiles("", especies);
+	t_list* caches = list_create();
+	t_list* pendientes = list_create();
+	// Sin escritura diferida no hay otro hilo que lea formatoBinario
+	void load(char* especie) {
+		formatoBinario = retomada && pokemonIsBinary(especie);
+		t_pokemon_cache* cache = game_card_cache_get(especie);
+		list_add(caches, cache);
+		if (!formatoBinario)
+			list_add(pendientes, cache);
+	}
+	list_iterate(especies, (void*) load);
+	formatoBinario = false;
+	if (retomada)
+		releaseOrphanBlocks(caches);
 
-	return res;
-}
+	// Mientras se migra una especie estan sus bloques viejos y los nuevos
+	int freeBlocks = getFreeBlocks(lfsMetaData.blocks, bitmap);
+	int missingBlocks = 0;
+	void count(t_pokemon_cache* cache) {
+		int tamanio = list_size(cache->lineas) * REGISTRO_BINARIO;
+		int blocksRequired = tamanio == 0 ? 0 : calcualarBloques(tamanio);
+		if (blocksRequired - freeBlocks > missingBlocks)
+			missingBlocks = blocksRequired - freeBlocks;
+		freeBlocks += list_size(cache->bloques) - blocksRequired;
+	}
+	list_iterate(pendientes, (void*) count);
+
+	if (missingBlocks > 0) {
+		game_card_logger_error("Faltan %d bloques libres para migrar a registros binarios", missingBlocks);
+		list_destroy_and_destroy_elements(especies, free);
+		list_destroy(caches);
+		list_destroy(pendientes);
+		return -1;
+	}
 
+	if (!retomada)
+		saveMigrationState(false);
+	formatoBinario = true;
+	void migrate(t_pokemon_cache* cache) {
+		t_game_card_lock* lock = game_card_lock_write(cache->especie);
+		t_list* textBlocks = cache->bloques;
+		cache->bloques = list_create();
+		list_sort(cache->lineas, (void*) pokemonLineBefore);
+		cache->tamanio = 0;
+		void place(blockLine* pokemonLine) {
+			pokemonLine->offset = cache->tamanio;
+			cache->tamanio += REGISTRO_BINARIO;
+		}
+		list_iterate(cache->lineas, (void*) place);
+		reservePokemonBlocks(cache, cache->tamanio);
+		// Sin escritura diferida: touch escribe los registros y despues el
+		// Metadata.bin, que siempre cambia de bloques
+		cache->bloques_escritos = -1;
+		game_card_cache_mark_from(cache, 0);
+		game_card_cache_touch(cache);
+
+		pthread_mutex_lock(&MUTEX_BITMAP);
+		void release(void* block) {
+			game_card_blocks_clear((int) (intptr_t) block);
+			setear_bloque_libre_en_posicion(bitmap, (int) (intptr_t) block);
+		}
+		list_iterate(textBlocks, release);
+		syncBitmap();
+		pthread_mutex_unlock(&MUTEX_BITMAP);
+		list_destroy(textBlocks);
+		game_card_unlock_write(lock);
+		game_card_logger_info("Migrada %s: %d registros", cache->especie, list_size(cache->lineas));
+	}
+	list_iterate(pendientes, (void*) migrate);
 
-pokemon_open_tad* new_pokemon_open_tad() {
-	pokemon_open_tad* pokemonOpenTad = malloc(sizeof(pokemon_open_tad));
-    pthread_mutex_init(&pokemonOpenTad->mArchivo, NULL);
-    return pokemonOpenTad;
+	// Recien con todas las especies escritas
+	saveMigrationState(true);
+	free(lfsMetaData.magicNumber);
+	lfsMetaData.magicNumber = string_duplicate(MAGIC_NUMBER_BINARIO);
+
+	game_card_logger_info("Filesystem migrado a registros binarios: %d especies", list_size(caches));
+	list_destroy_and_destroy_elements(especies, free);
+	list_destroy(caches);
+	list_destroy(pendientes);
+	return 0;
+}
+
+// El OPEN del Metadata.bin refleja si un NEW o CATCH tiene tomada la especie,
+// para quien mire el filesystem desde afuera. Una especie que todavia no
+// existe no tiene Metadata.bin
+static void pokemonOpenChanged(char* especie, bool abierto) {
+	updateOpenFileState(especie, abierto ? "Y" : "N", "LOCK");
 }
 
 /**
@@ -638,13 +827,6 @@ int _mkpath(char* file_path, mode_t mode)
 }
 
 
-char* obtenerPathDelNumeroDeBloque(int numeroDeBloque){
-	char* path_del_bloque = malloc(strlen(game_card_config->punto_montaje_tallgrass)+strlen("/Bloques")+20);
-	sprintf(path_del_bloque,"%sBloques/%d.bin",game_card_config->punto_montaje_tallgrass, numeroDeBloque);
-	return path_del_bloque;
-}
-
-
 pokemonMetadata readPokemonMetadata(char* pokemonPath) {
 	char* existingPokemonMetadata = string_new();
 	char* existingPokemonBlocks = string_new();
@@ -683,124 +865,111 @@ int calcualarBloques(int tamanio) {
     return 1 + ((tamanio - 1) / lfsMetaData.blockSize);
 }
 
-void writeBlocks(char* value, t_list* bloques) {
-
-    int limite = string_length(value);
-    char* valorAGuardar = string_duplicate(value);
-
-    for(int i = 0; i < list_size(bloques) && limite > 0; i++) {
-
-        char* pathBloque = obtenerPathDelNumeroDeBloque((int) list_get(bloques, i));
-
-        FILE * bloque = fopen(pathBloque, "w+");
-
-        int limiteSuperior;
-
-        if(limite >= lfsMetaData.blockSize) {
-            limiteSuperior = lfsMetaData.blockSize;
-        } else {
-            limiteSuperior = limite;
-        }
-
-        char* take = string_substring(valorAGuardar, 0, limiteSuperior);
-
-        fwrite(take,1,limiteSuperior,bloque);
-        limite -= string_length(take);
-
-        if(limite > 0) {
-            valorAGuardar = string_substring_from(valorAGuardar, limiteSuperior);
-        }
-
-        fclose(bloque);
-        free(pathBloque);
-        free(take);
-    }
-
-    free(valorAGuardar);
-}
-
 // Dado una lista de bloques t_list 1,2,3 se leen los contenidos de dichos bloques
 // y se retorna una lista con los contenidos leidos
 // t_list(int) => t_list (blockLine)
-// is_break determina si el contenido fue partido en otro bloque (si es que al grabar no entro el contenido y el \n esta en el bloque siguiente)
-t_list* readPokemonLines(t_list* blocks) {
+// tamanio es el SIZE del Metadata: lo que sigue en el ultimo bloque no es del archivo.
+// Cada tramo de bloques seguidos se lee de una vez. Una linea o un registro
+// pueden quedar partidos entre dos tramos: se van armando en linea
+t_list* readPokemonLines(t_list* blocks, int tamanio) {
 	t_list* retList = list_create();
-	size_t len = 0;
-	char* line = NULL;
-	ssize_t read;
-	FILE* blockFile;
-	int isBreakFile = 0;
-	char* previousLastLine = string_new();
-
-	for (int i = 0; i < list_size(blocks); i++) {
-		char* blockPath = string_new();
-        string_append(&blockPath, struct_paths[BLOCKS]);
-        string_append(&blockPath, string_itoa((int)list_get(blocks, i)));
-		string_append(&blockPath, ".bin");
-
-		blockFile = fopen(blockPath, "r");
-
-		if (blockFile == NULL) {
-			game_card_logger_error("No ha sido posible leer el archivo");
+	int* numeros = malloc(sizeof(int) * (list_size(blocks) + 1));
+	int cantidadBloques = 0;
+	void addNumero(void* block) {
+		numeros[cantidadBloques++] = (int) (intptr_t) block;
+	}
+	list_iterate(blocks, addNumero);
+
+	char* buffer = NULL;
+	int bufferBloques = 0;
+	char linea[40];
+	int largoLinea = 0;
+	int restantes = tamanio;
+	int cantidad;
+
+	for (int i = 0; i < cantidadBloques && restantes > 0; i += cantidad) {
+		cantidad = 1;
+		while (i + cantidad < cantidadBloques && numeros[i + cantidad] == numeros[i] + cantidad
+				&& cantidad * lfsMetaData.blockSize < restantes)
+			cantidad++;
+		int largo = restantes < cantidad * lfsMetaData.blockSize ? restantes : cantidad * lfsMetaData.blockSize;
+
+		// Con MMAP se lee directo de la memoria mapeada
+		char* contenido = game_card_blocks_data(numeros[i]);
+		if (contenido == NULL) {
+			if (cantidad > bufferBloques) {
+				buffer = realloc(buffer, cantidad * lfsMetaData.blockSize);
+				bufferBloques = cantidad;
+			}
+			contenido = buffer;
+			if (game_card_blocks_read_run(numeros[i], cantidad, buffer) < largo) {
+				game_card_logger_error("Los bloques desde %d estan incompletos", numeros[i]);
+				break;
+			}
 		}
 
-		while((read = getline(&line, &len, blockFile)) != -1) {
-			blockLine* blockLine;
-			if(string_contains(line, "\n") == 0) {
-				isBreakFile = 1;
-				string_append(&previousLastLine, line);
-			} else if(isBreakFile == 1) {
-				string_append(&previousLastLine, line);
-				blockLine = formatStringToBlockLine(previousLastLine);
-				isBreakFile = 0;
-				previousLastLine = string_new();
-				list_add(retList, (void*)blockLine);
-			} else {
-				blockLine = formatStringToBlockLine(line);
-				list_add(retList, (void*)blockLine);
+		if (formatoBinario) {
+			// Registros de tamaño fijo: solo el que queda partido pasa por linea
+			int j = 0;
+			if (largoLinea > 0) {
+				j = REGISTRO_BINARIO - largoLinea < largo ? REGISTRO_BINARIO - largoLinea : largo;
+				memcpy(linea + largoLinea, contenido, j);
+				largoLinea += j;
+				if (largoLinea == REGISTRO_BINARIO) {
+					list_add(retList, decodePokemonRecord(linea));
+					largoLinea = 0;
+				}
+			}
+			for (; j + REGISTRO_BINARIO <= largo; j += REGISTRO_BINARIO)
+				list_add(retList, decodePokemonRecord(contenido + j));
+			if (j < largo) {
+				memcpy(linea + largoLinea, contenido + j, largo - j);
+				largoLinea += largo - j;
+			}
+		} else {
+			for (int j = 0; j < largo; j++) {
+				if (contenido[j] == '\n') {
+					linea[largoLinea] = '\0';
+					list_add(retList, formatStringToBlockLine(linea));
+					largoLinea = 0;
+				} else if (largoLinea < sizeof(linea) - 1) {
+					linea[largoLinea++] = contenido[j];
+				}
 			}
 		}
-
-		free(blockPath);
-		fclose(blockFile);
+		restantes -= largo;
 	}
 
-	if (line) free(line);
-
-
+	free(buffer);
+	free(numeros);
 	return retList;
 }
 
 
-// Dado un string con formato [1,2,3,...] se devuelve una lista con los enteros que simbolizan un numero de bloque
+// Dado un string con formato [1,2,3,...] se devuelve una lista con los enteros que simbolizan un numero de bloque.
+// Un tramo inicio:largo se expande a sus bloques: [3:4,9] es 3,4,5,6,9
 t_list* stringBlocksToList(char* blocks) {
 	t_list* retList = list_create();
-	// Solo esta usando un bloque
-	if (strlen(blocks) == 3) {
-		char* blockStrWithoutBraces = string_substring(blocks, 1, 1);
-		list_add(retList, (void*)atoi(blockStrWithoutBraces));
-	} // Mas de un bloque siendo usado
-	else {
-		char* blocksStrWithoutBraces = string_substring(blocks, 1, strlen(blocks) - 2);
-		char** blocksWithoutCommaSeparator = string_split(blocksStrWithoutBraces, ",");
-		int i = 0;
-		while(blocksWithoutCommaSeparator[i] != NULL) {
-			list_add(retList, (void*)atoi(blocksWithoutCommaSeparator[i]));
-			i++;
-		}
+	char* resto = blocks + 1;
+	while (*resto != ']' && *resto != '\0') {
+		int inicio = strtol(resto, &resto, 10);
+		int largo = 1;
+		if (*resto == ':') largo = strtol(resto + 1, &resto, 10);
+		for (int i = 0; i < largo; i++) list_add(retList, (void*) (intptr_t) (inicio + i));
+		if (*resto == ',') resto++;
+		else if (*resto != ']') break;
 	}
-
 	return retList;
 }
 
 // Dado una linea con formato "1-1=100/n" se devuelve la estructura correspondiente para poder manipularla
 blockLine* formatStringToBlockLine(char* blockline) {
 	blockLine* newLineBlock = malloc(sizeof(blockLine));
-	char** splittedLine = string_split(blockline, "=");
-	char** coordinates = string_split(splittedLine[0], "-");
-	newLineBlock->posX = atoi(coordinates[0]);
-	newLineBlock->posY = atoi(coordinates[1]);
-	newLineBlock->cantidad = atoi(splittedLine[1]);
+	char* resto;
+	newLineBlock->posX = strtoul(blockline, &resto, 10);
+	newLineBlock->posY = strtoul(resto + 1, &resto, 10);
+	newLineBlock->cantidad = strtoul(resto + 1, NULL, 10);
+	newLineBlock->offset = 0;
 	return newLineBlock;
 }
 
@@ -840,6 +1009,7 @@ blockLine* createBlockLine(int intPosX, int intPosY, int intCantidad) {
 	newLineBlock->posX = intPosX;
 	newLineBlock->posY = intPosY;
 	newLineBlock->cantidad = intCantidad;
+	newLineBlock->offset = 0;
 	return newLineBlock;
 }
 
@@ -867,11 +1037,18 @@ void mostrar_bitarray(t_bitarray* bitmap){
 	printf("test bit posicion, es  %d en posicion %d \n", bitarray_test_bit(bitmap,k),k);
 }
 
+// Bloques libres y desde donde buscar el proximo. Se tocan con MUTEX_BITMAP
+// tomado, igual que el bitmap
+static int bloquesLibres = 0;
+static int proximoLibre = 0;
+
 void setear_bloque_ocupado_en_posicion(t_bitarray* bitmap, off_t pos){
+	if (!bitarray_test_bit(bitmap, pos)) bloquesLibres--;
 	bitarray_set_bit(bitmap, pos);
 }
 
 void setear_bloque_libre_en_posicion(t_bitarray* bitmap, off_t pos){
+	if (bitarray_test_bit(bitmap, pos)) bloquesLibres++;
 	bitarray_clean_bit(bitmap, pos);
 }
 
@@ -879,30 +1056,89 @@ bool testear_bloque_libre_en_posicion(t_bitarray* bitmap, int pos){
 	return bitarray_test_bit(bitmap, (off_t)(pos));
 }
 
-// Obtiene y setea el proximo bloque libre
+// Los 64 bits del bitmap desde el bloque inicio (multiplo de 64). El bitmap
+// es MSB_FIRST: el bloque inicio queda en el bit mas significativo. Lo que
+// pasa del ultimo bloque vale 1, como si estuviera ocupado
+static uint64_t bitmapWord(t_bitarray* bitmap, unsigned int blocks, int inicio) {
+	uint64_t word = ~0ULL;
+	int validos = blocks - inicio < 64 ? blocks - inicio : 64;
+	memcpy(&word, bitmap->bitarray + inicio / 8, (validos + 7) / 8);
+	word = be64toh(word);
+	if (validos < 64) word |= ~0ULL >> validos;
+	return word;
+}
+
+// Obtiene y setea el proximo bloque libre, de a 64 bloques por vez. Sigue
+// desde el ultimo que dio y al llegar al final vuelve a empezar. -1 si no hay
 int getAndSetFreeBlock(t_bitarray* bitmap, unsigned int blocks){
-	int j;
-	for(j =0; testear_bloque_libre_en_posicion(bitmap, j); j++); // Hasta un bloque lbre
-	setear_bloque_ocupado_en_posicion(bitmap, j);
-	game_card_logger_info("Se procede a setear el bloque %d como OCUPADO", j);
-	return j;
+	if (bloquesLibres == 0) return -1;
+	int palabras = (blocks + 63) / 64;
+	int primera = proximoLibre / 64;
+	// La primera palabra se mira dos veces: desde el proximo y, al dar la
+	// vuelta, lo de antes
+	for (int i = 0; i <= palabras; i++) {
+		int palabra = (primera + i) % palabras;
+		uint64_t libres = ~bitmapWord(bitmap, blocks, palabra * 64);
+		if (i == 0) libres &= ~0ULL >> (proximoLibre % 64);
+		if (libres != 0) {
+			int j = palabra * 64 + __builtin_clzll(libres);
+			setear_bloque_ocupado_en_posicion(bitmap, j);
+			proximoLibre = (j + 1) % blocks;
+			game_card_logger_info("Se procede a setear el bloque %d como OCUPADO", j);
+			return j;
+		}
+	}
+	return -1;
 }
 
-// Retorna la cantidad de bloques libres
-int getFreeBlocks(int metadataBlocks, t_bitarray* bitmap){
+// Setea el bloque pos si esta libre
+bool getAndSetBlockIfFree(t_bitarray* bitmap, unsigned int blocks, int pos){
+	if (pos >= blocks || testear_bloque_libre_en_posicion(bitmap, pos)) return false;
+	setear_bloque_ocupado_en_posicion(bitmap, pos);
+	game_card_logger_info("Se procede a setear el bloque %d como OCUPADO", pos);
+	return true;
+}
 
-    int bloques_libres = 0;
-    int bloque_libre;
-    int bit = 0;
-    int tamMaximo = metadataBlocks;
-    while(bit < tamMaximo)
-    {
-        bloque_libre = bitarray_test_bit(bitmap,bit);
-        if(bloque_libre == 0)bloques_libres ++;
-        bit++;
-    }
+// Primer bloque de un tramo de cantidad bloques libres seguidos, -1 si no
+// hay. Las palabras llenas o vacias se saltean enteras
+int getFreeRun(t_bitarray* bitmap, unsigned int blocks, int cantidad){
+	int inicio = -1;
+	int largo = 0;
+	for (int palabra = 0; palabra * 64 < blocks; palabra++) {
+		uint64_t word = bitmapWord(bitmap, blocks, palabra * 64);
+		if (word == ~0ULL) {
+			largo = 0;
+			continue;
+		}
+		if (word == 0) {
+			if (largo == 0) inicio = palabra * 64;
+			largo += 64;
+			if (largo >= cantidad) return inicio;
+			continue;
+		}
+		for (int bit = 0; bit < 64; bit++) {
+			if (word & (1ULL << (63 - bit))) {
+				largo = 0;
+			} else {
+				if (largo == 0) inicio = palabra * 64 + bit;
+				if (++largo >= cantidad) return inicio;
+			}
+		}
+	}
+	return -1;
+}
+
+// Retorna la cantidad de bloques libres, que se lleva al setear cada bloque
+int getFreeBlocks(int metadataBlocks, t_bitarray* bitmap){
+	return bloquesLibres;
+}
 
-    return bloques_libres;
+// Cuenta los libres al leer el bitmap
+static void countFreeBlocks(unsigned int blocks) {
+	bloquesLibres = 0;
+	for (int inicio = 0; inicio < blocks; inicio += 64)
+		bloquesLibres += __builtin_popcountll(~bitmapWord(bitmap, blocks, inicio));
+	proximoLibre = 0;
 }
 
 /**
@@ -957,6 +1193,9 @@ void setupMetadata() {
         readMetaData(metadataBin);
     }
 
+	game_card_blocks_init(game_card_config->punto_montaje_tallgrass, lfsMetaData.blockSize, lfsMetaData.blocks,
+			game_card_blocks_backend(game_card_config->almacenamiento_bloques), formatoBinario);
+
 	string_append(&bitmapBin, struct_paths[METADATA]);
 	string_append(&bitmapBin, "Bitmap.bin");
 
@@ -999,14 +1238,7 @@ void setupFilesDirectory() {
 }
 
 void createBlocks(){
-	game_card_logger_info("Creando bloques en el path /Bloques");
-	FILE* newBloque;
-	for(int i=0; i <= lfsMetaData.blocks-1; i++){
-        char* pathBloque = obtenerPathDelNumeroDeBloque(i);
-        newBloque = fopen(pathBloque,"w+b");
-        fclose(newBloque);
-		free(pathBloque);
-    }
+	game_card_blocks_format();
 }
 
 void createBitmap(char* bitmapBin) {
@@ -1036,9 +1268,29 @@ void readMetaData(char* metadataPath) {
 	lfsMetaData.blocks = config_get_int_value(metadataFile,"BLOCKS");
     lfsMetaData.magicNumber = string_duplicate(config_get_string_value(metadataFile,"MAGIC_NUMBER"));
 	lfsMetaData.blockSize = config_get_int_value(metadataFile,"BLOCK_SIZE");
+	formatoBinario = string_equals_ignore_case(lfsMetaData.magicNumber, MAGIC_NUMBER_BINARIO);
+	migracionPendiente = config_has_property(metadataFile, "MIGRATING")
+			&& string_equals_ignore_case(config_get_string_value(metadataFile, "MIGRATING"), "Y");
+if (formatoBinario && config_has_property(metadataFile, "VERSION")
+			&& config_get_int_value(metadataFile, "VERSION") != VERSION_BINARIO) {
+		game_card_logger_error("Version %d del formato binario no soportada", config_get_int_value(metadataFile, "VERSION"));
+	}
 	config_destroy(metadataFile);
 }
 
+bool gcfsMigrationPending() {
+	char* metadataBin = string_from_format("%sMetadata/Metadata.bin", game_card_config->punto_montaje_tallgrass);
+	bool pendiente = false;
+	if (access(metadataBin, F_OK) != -1) {
+		t_config* metadata = config_create(metadataBin);
+		pendiente = config_has_property(metadata, "MIGRATING")
+				&& string_equals_ignore_case(config_get_string_value(metadata, "MIGRATING"), "Y");
+		config_destroy(metadata);
+	}
+	free(metadataBin);
+	return pendiente;
+}
+
 void readBitmap(char* bitmapBin) {
 	game_card_logger_info("Leyendo Bitmap.bin");
 	bitmap_file = fopen(bitmapBin, "rb+");
@@ -1052,4 +1304,8 @@ void readBitmap(char* bitmapBin) {
 	}
 	fread((void*) bitarray_str, sizeof(char), file_size, bitmap_file);
 	bitmap = bitarray_create_with_mode(bitarray_str, file_size, MSB_FIRST);
+	// Si el Metadata.bin dice mas bloques de los que entran en el bitmap
+	// solo se usan los que entran
+	if (lfsMetaData.blocks > file_size * 8) lfsMetaData.blocks = file_size * 8;
+	countFreeBlocks(lfsMetaData.blocks);
 }
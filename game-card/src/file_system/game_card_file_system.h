@@ -9,6 +9,9 @@
 #include <sys/stat.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <endian.h>
+#include <dirent.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h> /* mmap() is defined in this header */
@@ -21,6 +24,9 @@
 
 #include "../logger/game_card_logger.h"
 #include "../config/game_card_config.h"
+#include "game_card_lock.h"
+#include "game_card_cache.h"
+#include "game_card_blocks.h"
 #include "../../../shared-common/common/utils.h"
 
 
@@ -31,6 +37,8 @@ typedef struct {
 	uint32_t posX;
 	uint32_t posY;
 	uint32_t cantidad;
+	// Donde empieza la linea dentro del archivo
+	uint32_t offset;
 } blockLine;
 
 int calcualarBloques(int tamanio);
@@ -45,21 +53,13 @@ char* formatToBlockLine(int posX, int posY, int cantidad);
 bool stringFitsInBlocks(char* stringToWrite, t_list* listBlocks);
 void printListOfPokemonReadedLines(t_list* pokemonLines);
 
-void writeBlocks(char* value, t_list* bloques);
-t_list* readPokemonLines(t_list* blocks);
+t_list* readPokemonLines(t_list* blocks, int tamanio);
 
 /**
  * Game card file system
  * */
-t_dictionary* files_open;
-pthread_mutex_t MUTEX_LISTA_ARCHIVO_ABIERTO;
-
-typedef struct pokemon_open_tad {
-    pthread_mutex_t mArchivo;
-} pokemon_open_tad;
-
-
-pokemon_open_tad* new_pokemon_open_tad();
+// Bitmap y cantidad de bloques libres, compartidos por todas las especies
+pthread_mutex_t MUTEX_BITMAP;
 
 char* formatToMetadataBlocks(t_list* blocks);
 void updatePokemonMetadata(char* fullPath, char* directory, char* size, char* blocks, char* open, char* op);
@@ -71,14 +71,9 @@ void createNewPokemon(t_new_pokemon* newPokemon);
 t_list* getAPokemon(t_get_pokemon* getPokemon);
 int catchAPokemon(t_catch_pokemon* catchPokemon);
 
-void operateNewPokemonFile(t_new_pokemon* newPokemon, char* completePath, int freeBlocks);
-t_list* operateGetPokemonFile(t_get_pokemon* getPokemon, char* completePath);
-int operateCatchPokemonFile(t_catch_pokemon* catchPokemon, char* completePath);
-
-int coordinateExists(unsigned int posX, unsigned int posY, t_list* pokemonLines);
-void addTotalPokemonIfCoordinateExist(t_new_pokemon* newPokemon, t_list* pokemonLines);
-void deletePokemonTotalIfCoordinateExist(t_catch_pokemon* catchPokemon, t_list* pokemonLines);
-t_list* requestFreeBlocks(int extraBlocksNeeded);
+// Bloques que se dejan libres al empezar un tramo nuevo, para el archivo de antes
+#define HUECO_EXTENT 8
+t_list* requestFreeBlocks(int extraBlocksNeeded, int lastBlock);
 
 int calcualarBloques(int tamanio);
 int cuantosBloquesOcupa(char* value);
@@ -86,6 +81,9 @@ char* crearPathBloque(int bloque, char* montajeBloques);
 void updateOpenFileState(char* fullPath, char* open, char* op);
 
 void gcfsCreateStructs();
+int gcfsMigrateToBinary();
+// MIGRATING=Y en el Metadata.bin: hay que volver a correr --migrar-binario
+bool gcfsMigrationPending();
 void gcfsFreeBitmaps();
 void freeBlockLine(blockLine* newLineBlock);
 
@@ -101,7 +99,6 @@ typedef struct {
 int lastchar(char* str, char chr);
 int split_path(char* path, char** super_path, char** name);
 int _mkpath(char* file_path, mode_t mode);
-char* obtenerPathDelNumeroDeBloque(int numeroDeBloque);
 pokemonMetadata readPokemonMetadata(char* pokemonPath);
 
 /**
@@ -113,6 +110,8 @@ void setear_bloque_libre_en_posicion(t_bitarray* bitmap, off_t pos);
 bool testear_bloque_libre_en_posicion(t_bitarray* bitmap, int pos);
 int getAndSetFreeBlock(t_bitarray* bitmap, unsigned int blocks);
 int getFreeBlocks(int metadataBlocks, t_bitarray* bitmap);
+bool getAndSetBlockIfFree(t_bitarray* bitmap, unsigned int blocks, int pos);
+int getFreeRun(t_bitarray* bitmap, unsigned int blocks, int cantidad);
 
 /**
  * Setup
@@ -126,6 +125,14 @@ typedef enum {
 	TALL_GRASS
 } e_paths_structure;
 
+// MAGIC_NUMBER del Metadata.bin. Con TALL_GRASS cada archivo son lineas
+// "x-y=cantidad\n". Con TALL_GRASS_BIN son registros de 12 bytes (x, y y
+// cantidad, uint32 little endian) ordenados por x y despues por y
+#define MAGIC_NUMBER_TEXTO "TALL_GRASS"
+#define MAGIC_NUMBER_BINARIO "TALL_GRASS_BIN"
+#define VERSION_BINARIO 1
+#define REGISTRO_BINARIO 12
+
 typedef struct {
 	unsigned int blockSize, blocks;
 	char* magicNumber;
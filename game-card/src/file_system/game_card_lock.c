@@ -0,0 +1,93 @@
+#include "game_card_lock.h"
+
+// Especie -> t_game_card_lock. Las entradas no se borran: son especies, no
+// crecen con los mensajes
+static t_dictionary* locks;
+static pthread_mutex_t mlocks = PTHREAD_MUTEX_INITIALIZER;
+static t_lock_change on_change;
+
+void game_card_lock_init(t_lock_change callback) {
+	locks = dictionary_create();
+	on_change = callback;
+}
+
+static t_game_card_lock* lock_get(char* especie) {
+	pthread_mutex_lock(&mlocks);
+	t_game_card_lock* lock = dictionary_get(locks, especie);
+	if (lock == NULL) {
+		lock = malloc(sizeof(t_game_card_lock));
+		lock->especie = string_duplicate(especie);
+		pthread_mutex_init(&lock->mutex, NULL);
+		pthread_cond_init(&lock->cambio, NULL);
+		lock->lectores = 0;
+		lock->escritor = false;
+		lock->escritores_esperando = 0;
+		dictionary_put(locks, especie, lock);
+	}
+	pthread_mutex_unlock(&mlocks);
+	return lock;
+}
+
+// Se llama con el mutex de la especie tomado: mientras se escribe el OPEN
+// nadie mas entra ni sale de esa especie
+static void lock_notify(t_game_card_lock* lock, bool abierto) {
+	if (on_change != NULL)
+		on_change(lock->especie, abierto);
+}
+
+t_game_card_lock* game_card_lock_read(char* especie) {
+	t_game_card_lock* lock = lock_get(especie);
+	pthread_mutex_lock(&lock->mutex);
+	while (lock->escritor || lock->escritores_esperando > 0)
+		pthread_cond_wait(&lock->cambio, &lock->mutex);
+	lock->lectores++;
+	pthread_mutex_unlock(&lock->mutex);
+	return lock;
+}
+
+t_game_card_lock* game_card_lock_write(char* especie) {
+	t_game_card_lock* lock = lock_get(especie);
+	pthread_mutex_lock(&lock->mutex);
+	lock->escritores_esperando++;
+	while (lock->escritor || lock->lectores > 0)
+		pthread_cond_wait(&lock->cambio, &lock->mutex);
+	lock->escritores_esperando--;
+	lock->escritor = true;
+	lock_notify(lock, true);
+	pthread_mutex_unlock(&lock->mutex);
+	return lock;
+}
+
+void game_card_unlock_read(t_game_card_lock* lock) {
+	pthread_mutex_lock(&lock->mutex);
+	if (--lock->lectores == 0)
+		pthread_cond_broadcast(&lock->cambio);
+	pthread_mutex_unlock(&lock->mutex);
+}
+
+void game_card_unlock_write(t_game_card_lock* lock) {
+	pthread_mutex_lock(&lock->mutex);
+	lock->escritor = false;
+	lock_notify(lock, false);
+	pthread_cond_broadcast(&lock->cambio);
+	pthread_mutex_unlock(&lock->mutex);
+}
+
+bool game_card_lock_writing(char* especie) {
+	t_game_card_lock* lock = lock_get(especie);
+	pthread_mutex_lock(&lock->mutex);
+	bool escritor = lock->escritor;
+	pthread_mutex_unlock(&lock->mutex);
+	return escritor;
+}
+
+static void lock_destroy(t_game_card_lock* lock) {
+	pthread_mutex_destroy(&lock->mutex);
+	pthread_cond_destroy(&lock->cambio);
+	free(lock->especie);
+	free(lock);
+}
+
+void game_card_lock_destroy() {
+	dictionary_destroy_and_destroy_elements(locks, (void*) lock_destroy);
+}
@@ -0,0 +1,65 @@
+#ifndef FILE_SYSTEM_GAME_CARD_LOCK_H_
+#define FILE_SYSTEM_GAME_CARD_LOCK_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <commons/string.h>
+#include <commons/collections/dictionary.h>
+
+// Lock de lectura/escritura por especie, dentro del proceso. Los GET leen a
+// la vez; NEW y CATCH escriben de a uno y tienen prioridad sobre los GET
+// que llegan despues, asi no se quedan esperando para siempre. Quien espera
+// sigue apenas se libera el archivo, sin reintentos.
+//
+// El OPEN del Metadata.bin se sigue escribiendo para quien mire el
+// filesystem desde afuera, pero ya no se lee: lo actualiza on_change cuando
+// un NEW o CATCH toma y suelta el archivo. Los GET no tocan el disco.
+
+typedef void (*t_lock_change)(char* especie, bool abierto);
+
+typedef struct {
+	char* especie;
+	pthread_mutex_t mutex;
+	pthread_cond_t cambio;
+	int lectores;
+	bool escritor;
+	int escritores_esperando;
+} t_game_card_lock;
+
+/**
+ * @NAME: game_card_lock_init
+ * @DESC: Crea la tabla. on_change puede ser NULL.
+ */
+void game_card_lock_init(t_lock_change on_change);
+
+/**
+ * @NAME: game_card_lock_read
+ * @DESC: Toma la especie para leer. Espera si alguien la esta escribiendo o
+ * 		esperando para escribir.
+ */
+t_game_card_lock* game_card_lock_read(char* especie);
+
+/**
+ * @NAME: game_card_lock_write
+ * @DESC: Toma la especie para escribir, sola.
+ */
+t_game_card_lock* game_card_lock_write(char* especie);
+
+void game_card_unlock_read(t_game_card_lock* lock);
+void game_card_unlock_write(t_game_card_lock* lock);
+
+/**
+ * @NAME: game_card_lock_writing
+ * @DESC: Si un NEW o CATCH tiene tomada la especie, es decir si su OPEN es Y.
+ * 		Quien la tiene tomada, para leer o escribir, sabe que no cambia.
+ */
+bool game_card_lock_writing(char* especie);
+
+/**
+ * @NAME: game_card_lock_destroy
+ * @DESC: Libera la tabla. No tiene que quedar ninguna especie tomada.
+ */
+void game_card_lock_destroy();
+
+#endif /* FILE_SYSTEM_GAME_CARD_LOCK_H_ */
@@ -4,13 +4,22 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
-../src/file_system/game_card_file_system.c 
+../src/file_system/game_card_blocks.c \
+../src/file_system/game_card_cache.c \
+../src/file_system/game_card_file_system.c \
+../src/file_system/game_card_lock.c 
 
 OBJS += \
-./src/file_system/game_card_file_system.o 
+./src/file_system/game_card_blocks.o \
+./src/file_system/game_card_cache.o \
+./src/file_system/game_card_file_system.o \
+./src/file_system/game_card_lock.o 
 
 C_DEPS += \
-./src/file_system/game_card_file_system.d 
+./src/file_system/game_card_blocks.d \
+./src/file_system/game_card_cache.d \
+./src/file_system/game_card_file_system.d \
+./src/file_system/game_card_lock.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -3,6 +3,16 @@
 int main(int argc, char *argv[]) {
 	if (game_card_load() < 0)
 		return EXIT_FAILURE;
+	// ./game-card --migrar-binario: pasa el TALL_GRASS a registros binarios y termina
+	if (argc > 1 && string_equals_ignore_case(argv[1], "--migrar-binario"))
+		return game_card_migrate() < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+	// Una migracion cortada deja especies en texto y otras en binario
+	if (gcfsMigrationPending()) {
+		game_card_logger_error("La migracion a registros binarios no termino: correr ./game-card --migrar-binario");
+		game_card_config_free();
+		game_card_logger_destroy();
+		return EXIT_FAILURE;
+	}
 	game_card_init();
 	game_card_exit();
 
@@ -22,9 +32,49 @@ int game_card_load() {
 	return 0;
 }
 
+// Operaciones del FS en curso (NEW, GET y CATCH). Al cerrar no se aceptan
+// mas y se espera a las que estan antes de escribir y liberar las estructuras
+static int operaciones = 0;
+static bool cerrando = false;
+static pthread_mutex_t moperaciones = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sin_operaciones = PTHREAD_COND_INITIALIZER;
+
+static bool game_card_operation_begin() {
+	pthread_mutex_lock(&moperaciones);
+	bool aceptada = !cerrando;
+	if (aceptada)
+		operaciones++;
+	pthread_mutex_unlock(&moperaciones);
+	return aceptada;
+}
+
+static void game_card_operation_end() {
+	pthread_mutex_lock(&moperaciones);
+	if (--operaciones == 0)
+		pthread_cond_broadcast(&sin_operaciones);
+	pthread_mutex_unlock(&moperaciones);
+}
+
+static bool game_card_closing() {
+	pthread_mutex_lock(&moperaciones);
+	bool closing = cerrando;
+	pthread_mutex_unlock(&moperaciones);
+	return closing;
+}
+
 void game_card_init() {
 	game_card_logger_info("Inicando GAMECARD..");
+	// SIGINT y SIGTERM los espera este hilo: se bloquean antes de crear los
+	// demas, que heredan la mascara
+	sigset_t senales;
+	sigemptyset(&senales);
+	sigaddset(&senales, SIGINT);
+	sigaddset(&senales, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &senales, NULL);
 	gcfsCreateStructs();
+	game_card_delay_init();
+	game_card_broker = broker_router_create(game_card_config->cluster);
+	game_card_fd = -1;
 
 	pthread_attr_t attrs;
 	pthread_attr_init(&attrs);
@@ -55,15 +105,21 @@ void game_card_init() {
 	usleep(500000);
 
 	game_card_logger_info("Creando un hilo para poner al GAMECARD en modo Servidor");
-	game_card_init_as_server();
-	usleep(500000);
-	for (;;)
-		;
+	pthread_t tid4;
+	pthread_create(&tid4, NULL, (void*) game_card_init_as_server, NULL);
+	pthread_detach(tid4);
+
+	// Al volver, game_card_exit envia las respuestas demoradas y escribe lo
+	// que quedo en memoria
+	int signum;
+	sigwait(&senales, &signum);
+	game_card_logger_info("Signal %s recibida. Cerrando GAMECARD..",
+			signum == SIGINT ? "SIGINT" : "SIGTERM");
 }
 
 void game_card_retry_connect(void* arg) {
 	void* arg2 = arg;
-	while (true) {
+	while (!game_card_closing()) {
 		is_connected = false;
 		subscribe_to(arg2);
 		utils_delay(game_card_config->tiempo_de_reintento_conexion);
@@ -73,8 +129,8 @@ void game_card_retry_connect(void* arg) {
 void subscribe_to(void *arg) {
 
 	t_cola cola = *((int *) arg);
-	int new_broker_fd = socket_connect_to_server(game_card_config->ip_broker,
-			game_card_config->puerto_broker);
+	// Si el broker no responde y tiene replica se pasa a ella
+	int new_broker_fd = cluster_connect(game_card_config->cluster, cola);
 
 	if (new_broker_fd < 0) {
 		game_card_logger_warn("No se pudo conectar la cola %d con BROKER",
@@ -90,6 +146,7 @@ void subscribe_to(void *arg) {
 		sub_snd->puerto = game_card_config->puerto_game_card;
 		sub_snd->proceso = GAME_CARD;
 		sub_snd->cola = cola;
+		sub_snd->especies = NULL;
 		utils_serialize_and_send(new_broker_fd, subscribe_protocol, sub_snd);
 		recv_game_card(new_broker_fd, 0);
 		is_connected = true;
@@ -101,19 +158,27 @@ void game_card_init_as_server() {
 			game_card_config->ip_game_card, game_card_config->puerto_game_card);
 	if (game_card_socket < 0) {
 		game_card_logger_error("Error al levantar GAMECARD server");
+		return;
+	}
+	// game_card_exit lo cierra para dejar de aceptar conexiones
+	pthread_mutex_lock(&moperaciones);
+	bool closing = cerrando;
+	if (!closing)
+		game_card_fd = game_card_socket;
+	pthread_mutex_unlock(&moperaciones);
+	if (closing) {
+		socket_close_conection(game_card_socket);
+		return;
 	}
 	game_card_logger_info(
 			"Server creado correctamente!! Esperando conexion del GAMEBOY");
-	struct sockaddr_in client_info;
-	socklen_t addrlen = sizeof client_info;
 	pthread_attr_t attrs;
 	pthread_attr_init(&attrs);
 	pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_JOINABLE);
 	int accepted_fd;
 	for (;;) {
 		pthread_t tid;
-		if ((accepted_fd = accept(game_card_socket,
-				(struct sockaddr *) &client_info, &addrlen)) != -1) {
+		if ((accepted_fd = socket_accept_conection(game_card_socket)) != -1) {
 			t_handle_connection* connection_handler = malloc(
 					sizeof(t_handle_connection));
 			connection_handler->fd = accepted_fd;
@@ -125,6 +190,8 @@ void game_card_init_as_server() {
 					"Creando un hilo para atender una conexión en el socket %d",
 					accepted_fd);
 			usleep(500000);
+		} else if (game_card_closing()) {
+			return;
 		} else {
 			game_card_logger_error("Error al conectar con un cliente");
 		}
@@ -138,26 +205,33 @@ static void *handle_connection(void *arg) {
 	return NULL;
 }
 void *recv_game_card(int fd, int respond_to) {
-	int received_bytes;
 	int protocol;
+	void* message;
 	int client_fd = fd;
+	t_frame_reader* reader = framing_reader_create(client_fd, 0);
 
 	// 1 = Receives from GB; 0 = Receives from Broker
 	int is_server = respond_to;
 
 	while (true) {
-		received_bytes = recv(client_fd, &protocol, sizeof(int), 0);
-
-		if (received_bytes <= 0) {
+		if (utils_receive_message(reader, &protocol, &message) <= 0) {
 			game_card_logger_error("Error al recibir mensaje");
+			framing_reader_destroy(reader);
 			return NULL;
 		}
+		// Cerrando: no se confirma ni se procesa, el broker lo vuelve a enviar
+		bool operacion = protocol == NEW_POKEMON || protocol == GET_POKEMON
+				|| protocol == CATCH_POKEMON;
+		if (operacion && !game_card_operation_begin()) {
+			utils_message_destroy(protocol, message);
+			continue;
+		}
 		switch (protocol) {
 
 		// From Broker or GB
 		case NEW_POKEMON: {
 			game_card_logger_info("NEW received");
-			t_new_pokemon *new_receive = utils_receive_and_deserialize(client_fd, protocol);
+			t_new_pokemon *new_receive = message;
 			game_card_logger_info("Operacion NEW_POKEMON %s, Coordenada: (%d, %d, %d)", new_receive->nombre_pokemon, new_receive->pos_x, new_receive->pos_y, new_receive->cantidad);
 			game_card_logger_info("ID Correlacional: %d", new_receive->id_correlacional);
 			usleep(100000);
@@ -192,7 +266,7 @@ void *recv_game_card(int fd, int respond_to) {
 			// From broker or GB
 		case GET_POKEMON: {
 			game_card_logger_info("GET received");
-			t_get_pokemon *get_rcv = utils_receive_and_deserialize(client_fd, protocol);
+			t_get_pokemon *get_rcv = message;
 			game_card_logger_info("Operacion GET_POKEMON %s", get_rcv->nombre_pokemon);
 			game_card_logger_info("ID correlacional: %d", get_rcv->id_correlacional);
 			usleep(50000);
@@ -227,7 +301,7 @@ void *recv_game_card(int fd, int respond_to) {
 			// From broker or GB
 		case CATCH_POKEMON: {
 			game_card_logger_info("CATCH received");
-			t_catch_pokemon *catch_rcv = utils_receive_and_deserialize(client_fd, protocol);
+			t_catch_pokemon *catch_rcv = message;
 			game_card_logger_info("Operacion CATCH_POKEMON %s, Coordenada: (%d, %d)", catch_rcv->nombre_pokemon, catch_rcv->pos_x, catch_rcv->pos_y);
 			game_card_logger_info("ID correlacional: %d", catch_rcv->id_correlacional);
 			usleep(50000);
@@ -272,21 +346,23 @@ void process_new_and_send_appeared(void* arg) {
 
 	// Process New and send Appeared to broker
 	t_appeared_pokemon* appeared_snd = malloc(sizeof(t_appeared_pokemon));
-	t_protocol appeared_protocol = APPEARED_POKEMON;
 	appeared_snd->nombre_pokemon = new_receive->nombre_pokemon;
 	appeared_snd->tamanio_nombre = new_receive->tamanio_nombre;
 	appeared_snd->id_correlacional = new_receive->id_correlacional;
 	appeared_snd->pos_x = new_receive->pos_x;
 	appeared_snd->pos_y = new_receive->pos_y;
-	int client_fd = socket_connect_to_server(game_card_config->ip_broker,
-			game_card_config->puerto_broker);
-	if (client_fd > 0) {
-		utils_serialize_and_send(client_fd, appeared_protocol, appeared_snd);
+	game_card_delay_schedule(game_card_config->tiempo_retardo_new,
+			send_appeared, appeared_snd);
+	game_card_operation_end();
+}
+
+void send_appeared(void* arg) {
+	t_protocol appeared_protocol = APPEARED_POKEMON;
+	t_broker_connection* broker = broker_router_get(game_card_broker,
+			APPEARED_QUEUE);
+	if (broker_connection_send(broker, appeared_protocol, arg) == 0) {
 		game_card_logger_info("APPEARED sent to BROKER");
 	}
-	usleep(500000);
-	game_card_logger_info("CLOSING CONNECTION WITH BROKER");
-	socket_close_conection(client_fd);
 }
 
 void process_get_and_send_localized(void* arg) {
@@ -298,32 +374,40 @@ void process_get_and_send_localized(void* arg) {
 	loc_snd->nombre_pokemon = get_rcv->nombre_pokemon;
 	loc_snd->tamanio_nombre = strlen(loc_snd->nombre_pokemon) + 1;
 
-	t_list* positions_snd = list_create();
+	loc_snd->posiciones = NULL;
+	loc_snd->coordenadas = NULL;
+	loc_snd->cant_elem = utils_localized_count(response);
+
+	if (game_card_config->localized_compacto) {
+		loc_snd->coordenadas = response;
+	} else {
+		t_list* positions_snd = list_create();
 
-	for (int i=0; i< list_size(response); ++i) {
-		t_position_aux* pos_aux = list_get(response, i);
-		for (int j=0; j < pos_aux->cant; ++j) {
-			t_position* pos = malloc(sizeof(t_position));
-			pos->pos_x = pos_aux->x;
-			pos->pos_y = pos_aux->y;
+		for (int i=0; i< list_size(response); ++i) {
+			t_position_aux* pos_aux = list_get(response, i);
+			for (int j=0; j < pos_aux->cant; ++j) {
+				t_position* pos = malloc(sizeof(t_position));
+				pos->pos_x = pos_aux->x;
+				pos->pos_y = pos_aux->y;
 
-			list_add(positions_snd, pos);
+				list_add(positions_snd, pos);
+			}
 		}
+		loc_snd->posiciones = positions_snd;
 	}
 
-	loc_snd->cant_elem = list_size(positions_snd);
-	loc_snd->posiciones = positions_snd;
+	game_card_delay_schedule(game_card_config->tiempo_retardo_get,
+			send_localized, loc_snd);
+	game_card_operation_end();
+}
 
+void send_localized(void* arg) {
 	t_protocol localized_protocol = LOCALIZED_POKEMON;
-
-	int client_fd = socket_connect_to_server(game_card_config->ip_broker,
-			game_card_config->puerto_broker);
-	if (client_fd > 0) {
-		utils_serialize_and_send(client_fd, localized_protocol, loc_snd);
+	t_broker_connection* broker = broker_router_get(game_card_broker,
+			LOCALIZED_QUEUE);
+	if (broker_connection_send(broker, localized_protocol, arg) == 0) {
 		game_card_logger_info("LOCALIZED sent to BROKER");
 	}
-	usleep(50000);
-	socket_close_conection(client_fd);
 }
 
 void process_catch_and_send_caught(void* arg) {
@@ -333,23 +417,60 @@ void process_catch_and_send_caught(void* arg) {
 	t_caught_pokemon* caught_snd = malloc(sizeof(t_catch_pokemon));
 	caught_snd->id_correlacional = catch_rcv->id_correlacional;
 	caught_snd->result = res;
+	game_card_delay_schedule(game_card_config->tiempo_retardo_catch,
+			send_caught, caught_snd);
+	game_card_operation_end();
+}
+
+void send_caught(void* arg) {
+	t_caught_pokemon* caught_snd = arg;
 	game_card_logger_info("CAUGHT RESPONSE sent to BROKER %d", caught_snd->result);
 	// Process Catch and send Caught to broker
 	t_protocol caught_protocol = CAUGHT_POKEMON;
 
-	int client_fd = socket_connect_to_server(game_card_config->ip_broker,
-			game_card_config->puerto_broker);
-	if (client_fd > 0) {
-		utils_serialize_and_send(client_fd, caught_protocol, caught_snd);
+	t_broker_connection* broker = broker_router_get(game_card_broker,
+			CAUGHT_QUEUE);
+	if (broker_connection_send(broker, caught_protocol, caught_snd) == 0) {
 		game_card_logger_info("CAUGHT sent to BROKER");
 	}
-	usleep(500000);
-	socket_close_conection(client_fd);
+}
+
+int game_card_migrate() {
+	// Cada especie se escribe en el momento, sin el hilo de escritura diferida
+	game_card_config->escritura_diferida = 0;
+	gcfsCreateStructs();
+	int response = gcfsMigrateToBinary();
+	game_card_cache_destroy();
+	game_card_lock_destroy();
+	game_card_blocks_destroy();
+	game_card_config_free();
+	game_card_logger_destroy();
+	return response;
 }
 
 void game_card_exit() {
-	socket_close_conection(game_card_fd);
+	// Primero se deja de aceptar trabajo: el listener y lo que llegue por las
+	// conexiones abiertas
+	pthread_mutex_lock(&moperaciones);
+	cerrando = true;
+	if (game_card_fd >= 0) {
+		shutdown(game_card_fd, SHUT_RDWR);
+		socket_close_conection(game_card_fd);
+		game_card_fd = -1;
+	}
+	// Las operaciones en curso terminan de usar el FS y agendan su respuesta
+	while (operaciones > 0)
+		pthread_cond_wait(&sin_operaciones, &moperaciones);
+	pthread_mutex_unlock(&moperaciones);
+
+	// Envia las respuestas demoradas antes de cerrar las conexiones
+	game_card_delay_destroy();
+	broker_router_destroy(game_card_broker);
 	//gcfsFreeBitmaps();
+	// Antes que los locks: escribe lo que quedaba en memoria
+	game_card_cache_destroy();
+	game_card_lock_destroy();
+	game_card_blocks_destroy();
 	game_card_config_free();
 	game_card_logger_destroy();
 
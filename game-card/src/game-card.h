@@ -8,18 +8,23 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <signal.h>
 
 #include "config/game_card_config.h"
 #include "logger/game_card_logger.h"
 #include "file_system/game_card_file_system.h"
+#include "delay/game_card_delay.h"
 #include "../../shared-common/common/sockets.h"
 #include "../../shared-common/common/utils.h"
+#include "../../shared-common/common/broker_connection.h"
 
 int game_card_fd;
 bool is_connected;
+t_broker_router* game_card_broker;
 
 int game_card_load();
 void game_card_init();
+int game_card_migrate();
 void game_card_retry_connect(void* arg);
 void game_card_init_as_server();
 void *recv_game_card(int fd, int send_to);
@@ -30,5 +35,8 @@ void send_ack(void* arg);
 void process_new_and_send_appeared(void* arg);
 void process_get_and_send_localized(void* arg);
 void process_catch_and_send_caught(void* arg);
+void send_appeared(void* arg);
+void send_localized(void* arg);
+void send_caught(void* arg);
 
 #endif /* GAME_CARD_H_ */
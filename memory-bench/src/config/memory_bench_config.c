@@ -0,0 +1,37 @@
+#include "memory_bench_config.h"
+
+// Posicion del valor entre las dos opciones, -1 si no es ninguna
+static int memory_bench_config_option(t_config* config_file, char* key,
+		char* first, char* second)
+{
+	if (!config_has_property(config_file, key))
+		return -1;
+	char* value = config_get_string_value(config_file, key);
+	if (string_equals_ignore_case(value, first))
+		return 0;
+	if (string_equals_ignore_case(value, second))
+		return 1;
+	return -1;
+}
+
+int memory_bench_config_load(char* path)
+{
+	t_config* config_file = config_create(path);
+	if (config_file == NULL)
+		return -1;
+
+	memory_bench_config = malloc(sizeof(t_memory_bench_config));
+	memory_bench_config->tamano_memoria = config_get_int_value(config_file, "TAMANO_MEMORIA");
+	memory_bench_config->tamano_minimo_particion = config_get_int_value(config_file, "TAMANO_MINIMO_PARTICION");
+	memory_bench_config->frecuencia_compactacion = config_get_int_value(config_file, "FRECUENCIA_COMPACTACION");
+	memory_bench_config->estrategia_memoria = memory_bench_config_option(config_file, "ALGORITMO_MEMORIA", "bs", "pd");
+	memory_bench_config->algoritmo_reemplazo = memory_bench_config_option(config_file, "ALGORITMO_REEMPLAZO", "fifo", "lru");
+	memory_bench_config->algoritmo_particion_libre = memory_bench_config_option(config_file, "ALGORITMO_PARTICION_LIBRE", "ff", "bf");
+	config_destroy(config_file);
+	return 0;
+}
+
+void memory_bench_config_free()
+{
+	free(memory_bench_config);
+}
@@ -0,0 +1,29 @@
+#ifndef CONFIG_MEMORY_BENCH_CONFIG_H_
+#define CONFIG_MEMORY_BENCH_CONFIG_H_
+
+#include <stdlib.h>
+#include <commons/config.h>
+#include <commons/string.h>
+
+#include "../../../shared-common/common/allocator.h"
+
+#define CONFIG_FILE_PATH "broker.config"
+
+// Lo que usa la memoria del broker.config. Los algoritmos se prueban todos;
+// los configurados solo se marcan en el reporte
+typedef struct
+{
+	int tamano_memoria;
+	int tamano_minimo_particion;
+	int frecuencia_compactacion;
+	e_memory_struct estrategia_memoria;
+	e_algoritmo_reemplazo algoritmo_reemplazo;
+	e_algoritmo_particion_libre algoritmo_particion_libre;
+} t_memory_bench_config;
+
+t_memory_bench_config* memory_bench_config;
+
+int memory_bench_config_load(char* path);
+void memory_bench_config_free();
+
+#endif /* CONFIG_MEMORY_BENCH_CONFIG_H_ */
@@ -0,0 +1,419 @@
+#include "memory-bench.h"
+
+static char* memoria_names[] = { "BS", "PD" };
+static char* reemplazo_names[] = { "FIFO", "LRU" };
+static char* particion_names[] = { "FF", "BF" };
+
+static uint64_t memory_bench_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void usage() {
+	fprintf(stderr,
+			"Uso: memory-bench [-n operaciones] [-t min:max] [-l %%liberaciones] "
+			"[-a %%accesos] [-m muestras] [-s semilla] [-o salida] "
+			"[broker.config] [traza]\n");
+}
+
+static t_memory_bench_trace* memory_bench_trace_create(char* origen,
+		int capacidad) {
+	t_memory_bench_trace* trace = malloc(sizeof(t_memory_bench_trace));
+	trace->origen = string_duplicate(origen);
+	trace->ops = malloc(sizeof(t_memory_bench_op) * capacidad);
+	trace->cantidad = 0;
+	trace->mensajes = 0;
+	trace->tamano_max = 0;
+	trace->bajas = 0;
+	trace->acks = 0;
+	trace->suscripciones = 0;
+	return trace;
+}
+
+typedef struct {
+	t_trace_record record;
+	int orden;
+} t_memory_bench_record;
+
+static int compare_records(const void* a, const void* b) {
+	const t_memory_bench_record* first = a;
+	const t_memory_bench_record* second = b;
+	if (first->record.ns != second->record.ns)
+		return first->record.ns < second->record.ns ? -1 : 1;
+	return first->orden - second->orden;
+}
+
+// Los eventos de cada hilo del broker se escriben por separado: se ordenan
+// por instante, y a igual instante en el orden del archivo
+static t_memory_bench_record* memory_bench_trace_read(t_alloc_trace* file,
+		int* cantidad) {
+	int capacidad = 1024;
+	t_memory_bench_record* records = malloc(
+			sizeof(t_memory_bench_record) * capacidad);
+	*cantidad = 0;
+	t_trace_record record;
+	while (alloc_trace_next(file, &record)) {
+		if (*cantidad == capacidad) {
+			capacidad *= 2;
+			records = realloc(records,
+					sizeof(t_memory_bench_record) * capacidad);
+		}
+		records[*cantidad].record = record;
+		records[*cantidad].orden = *cantidad;
+		(*cantidad)++;
+	}
+	qsort(records, *cantidad, sizeof(t_memory_bench_record), compare_records);
+	return records;
+}
+
+// ALTA, ACCESO y LIBERACION se reproducen; el resto solo se cuenta
+t_memory_bench_trace* memory_bench_trace_load(char* path) {
+	t_alloc_trace* file = alloc_trace_open(path);
+	if (file == NULL)
+		return NULL;
+	int cantidad;
+	t_memory_bench_record* records = memory_bench_trace_read(file, &cantidad);
+	alloc_trace_close(file);
+
+	int capacidad = cantidad > 0 ? cantidad : 1;
+	t_memory_bench_trace* trace = memory_bench_trace_create(path, capacidad);
+	// "cola:id" -> numero de mensaje + 1
+	t_dictionary* mensajes = dictionary_create();
+	for (int i = 0; i < cantidad; i++) {
+		t_trace_record record = records[i].record;
+		if (record.tipo == TRACE_BAJA) {
+			trace->bajas++;
+			continue;
+		}
+		if (record.tipo == TRACE_ACK) {
+			trace->acks++;
+			continue;
+		}
+		if (record.tipo == TRACE_SUSCRIPCION) {
+			trace->suscripciones++;
+			continue;
+		}
+		if (record.tipo > TRACE_LIBERACION || record.cola > CAUGHT_QUEUE)
+			continue;
+
+		char* key = string_from_format("%d:%u", record.cola, record.id);
+		int mensaje;
+		if (record.tipo == TRACE_ALTA) {
+			// El mismo id otra vez es otro mensaje: el anterior ya no se usa
+			if (dictionary_has_key(mensajes, key))
+				dictionary_remove(mensajes, key);
+			mensaje = trace->mensajes++;
+			dictionary_put(mensajes, key, (void*) (intptr_t) (mensaje + 1));
+			if (record.size > trace->tamano_max)
+				trace->tamano_max = record.size;
+		} else {
+			mensaje = (intptr_t) dictionary_get(mensajes, key) - 1;
+		}
+		free(key);
+		if (mensaje < 0)
+			continue;
+
+		t_memory_bench_op* op = &trace->ops[trace->cantidad++];
+		op->tipo = record.tipo;
+		op->cola = record.cola;
+		op->size = record.size;
+		op->mensaje = mensaje;
+	}
+	dictionary_destroy(mensajes);
+	free(records);
+	return trace;
+}
+
+// Cada operacion libera o lee un mensaje guardado al azar, o guarda uno nuevo
+// con tamaño uniforme en [tamano_min, tamano_max]
+t_memory_bench_trace* memory_bench_trace_synthetic(
+		t_memory_bench_options* options) {
+	t_memory_bench_trace* trace = memory_bench_trace_create("sintetica",
+			options->operaciones);
+	trace->tamano_max = options->tamano_max;
+	int* vivos = malloc(sizeof(int) * options->operaciones);
+	int cantidad_vivos = 0;
+	unsigned int seed = options->semilla;
+
+	for (int i = 0; i < options->operaciones; i++) {
+		t_memory_bench_op* op = &trace->ops[trace->cantidad++];
+		int r = rand_r(&seed) % 100;
+		if (cantidad_vivos > 0 && r < options->liberaciones) {
+			int k = rand_r(&seed) % cantidad_vivos;
+			op->tipo = TRACE_LIBERACION;
+			op->mensaje = vivos[k];
+			op->size = 0;
+			vivos[k] = vivos[--cantidad_vivos];
+		} else if (cantidad_vivos > 0
+				&& r < options->liberaciones + options->accesos) {
+			op->tipo = TRACE_ACCESO;
+			op->mensaje = vivos[rand_r(&seed) % cantidad_vivos];
+			op->size = 0;
+		} else {
+			op->tipo = TRACE_ALTA;
+			op->mensaje = trace->mensajes++;
+			op->size = options->tamano_min
+					+ rand_r(&seed)
+							% (options->tamano_max - options->tamano_min + 1);
+			vivos[cantidad_vivos++] = op->mensaje;
+		}
+		op->cola = op->mensaje % (CAUGHT_QUEUE + 1);
+	}
+	free(vivos);
+	return trace;
+}
+
+void memory_bench_trace_destroy(t_memory_bench_trace* trace) {
+	free(trace->origen);
+	free(trace->ops);
+	free(trace);
+}
+
+// Reproduce la traza con una combinacion de algoritmos. El tiempo es solo el
+// de las operaciones: las muestras de fragmentacion quedan afuera
+static void memory_bench_run(t_memory_bench_trace* trace,
+		t_memory_bench_options* options, t_allocator_config config,
+		bool configurado, FILE* out) {
+	t_allocator* allocator = allocator_create(config, NULL, NULL, NULL);
+	t_nodo_memory** nodos = calloc(trace->mensajes + 1, sizeof(t_nodo_memory*));
+	uint64_t* generaciones = calloc(trace->mensajes + 1, sizeof(uint64_t));
+	char* datos = calloc(trace->tamano_max + 1, 1);
+	int paso = trace->cantidad / options->muestras;
+	if (paso < 1)
+		paso = 1;
+	t_memory_bench_sample* muestras = malloc(
+			sizeof(t_memory_bench_sample) * (trace->cantidad / paso + 1));
+	int tomadas = 0;
+	int perdidos = 0;
+
+	uint64_t ns = 0;
+	uint64_t inicio = memory_bench_now();
+	for (int i = 0; i < trace->cantidad; i++) {
+		t_memory_bench_op* op = &trace->ops[i];
+		t_nodo_memory* nodo = nodos[op->mensaje];
+		switch (op->tipo) {
+		case TRACE_ALTA:
+			nodo = allocator_save(allocator, datos, op->size, op->cola,
+					op->mensaje);
+			nodos[op->mensaje] = nodo;
+			if (nodo != NULL)
+				generaciones[op->mensaje] = nodo->generacion;
+			break;
+		case TRACE_ACCESO:
+			if (nodo == NULL
+					|| allocator_access(allocator, nodo,
+							generaciones[op->mensaje]) < 0)
+				perdidos++;
+			break;
+		case TRACE_LIBERACION:
+			if (nodo != NULL)
+				allocator_free(allocator, nodo, generaciones[op->mensaje]);
+			break;
+		default:
+			break;
+		}
+
+		if ((i + 1) % paso == 0 || i + 1 == trace->cantidad) {
+			ns += memory_bench_now() - inicio;
+			uint32_t mayor;
+			t_memory_bench_sample* muestra = &muestras[tomadas++];
+			muestra->operacion = i + 1;
+			muestra->libres = allocator_free_bytes(allocator, &mayor);
+			muestra->fragmentacion =
+					muestra->libres == 0 ?
+							0 : 1 - (double) mayor / muestra->libres;
+			inicio = memory_bench_now();
+		}
+	}
+
+	double media = 0;
+	double maxima = 0;
+	for (int i = 0; i < tomadas; i++) {
+		media += muestras[i].fragmentacion;
+		if (muestras[i].fragmentacion > maxima)
+			maxima = muestras[i].fragmentacion;
+	}
+	if (tomadas > 0)
+		media /= tomadas;
+
+	t_allocator_stats* stats = &allocator->stats;
+	double segundos = ns / 1e9;
+	fprintf(out, "    {\n");
+	fprintf(out, "      \"memoria\": \"%s\",\n", memoria_names[config.estrategia]);
+	fprintf(out, "      \"reemplazo\": \"%s\",\n",
+			reemplazo_names[config.reemplazo]);
+	if (config.estrategia == BS)
+		fprintf(out, "      \"particion_libre\": null,\n");
+	else
+		fprintf(out, "      \"particion_libre\": \"%s\",\n",
+				particion_names[config.particion_libre]);
+	fprintf(out, "      \"configurado\": %s,\n", configurado ? "true" : "false");
+	fprintf(out, "      \"segundos\": %.6f,\n", segundos);
+	fprintf(out, "      \"ops_por_segundo\": %.0f,\n",
+			segundos > 0 ? trace->cantidad / segundos : 0);
+	fprintf(out, "      \"asignaciones\": %" PRIu64 ",\n", stats->asignaciones);
+	fprintf(out, "      \"liberaciones\": %" PRIu64 ",\n", stats->liberaciones);
+	fprintf(out, "      \"reemplazos\": %" PRIu64 ",\n", stats->reemplazos);
+	fprintf(out, "      \"rechazos\": %" PRIu64 ",\n", stats->rechazos);
+	fprintf(out, "      \"accesos_perdidos\": %d,\n", perdidos);
+	fprintf(out, "      \"compactaciones\": %" PRIu64 ",\n",
+			stats->compactaciones);
+	fprintf(out, "      \"compactacion_ms\": %.3f,\n",
+			stats->compactacion_ns / 1e6);
+	fprintf(out, "      \"bytes_movidos\": %" PRIu64 ",\n", stats->bytes_movidos);
+	fprintf(out, "      \"fragmentacion\": {\n");
+	fprintf(out, "        \"media\": %.4f,\n", media);
+	fprintf(out, "        \"maxima\": %.4f,\n", maxima);
+	fprintf(out, "        \"serie\": [");
+	for (int i = 0; i < tomadas; i++) {
+		fprintf(out, "%s[%d, %.4f, %u]", i == 0 ? "" : ", ",
+				muestras[i].operacion, muestras[i].fragmentacion,
+				muestras[i].libres);
+	}
+	fprintf(out, "]\n");
+	fprintf(out, "      }\n");
+	fprintf(out, "    }");
+
+	free(muestras);
+	free(datos);
+	free(nodos);
+	free(generaciones);
+	allocator_destroy(allocator);
+}
+
+// Todas las combinaciones: BS con FIFO y LRU, PD con FIFO y LRU por FF y BF
+void memory_bench_report(t_memory_bench_trace* trace,
+		t_memory_bench_options* options, FILE* out) {
+	t_memory_bench_config* broker = memory_bench_config;
+	fprintf(out, "{\n");
+	fprintf(out, "  \"origen\": \"%s\",\n", trace->origen);
+	fprintf(out, "  \"operaciones\": %d,\n", trace->cantidad);
+	fprintf(out, "  \"mensajes\": %d,\n", trace->mensajes);
+	fprintf(out, "  \"tamano_memoria\": %d,\n", broker->tamano_memoria);
+	fprintf(out, "  \"tamano_minimo_particion\": %d,\n",
+			broker->tamano_minimo_particion);
+	fprintf(out, "  \"frecuencia_compactacion\": %d,\n",
+			broker->frecuencia_compactacion);
+	fprintf(out, "  \"traza\": { \"bajas\": %d, \"acks\": %d, \"suscripciones\": %d },\n",
+			trace->bajas, trace->acks, trace->suscripciones);
+	fprintf(out, "  \"resultados\": [\n");
+
+	bool primero = true;
+	for (e_memory_struct memoria = BS; memoria <= PD; memoria++) {
+		for (e_algoritmo_reemplazo reemplazo = FIFO; reemplazo <= LRU;
+				reemplazo++) {
+			for (e_algoritmo_particion_libre particion = FF; particion <= BF;
+					particion++) {
+				// Con buddy system no se elige particion libre
+				if (memoria == BS && particion != FF)
+					continue;
+				t_allocator_config config = {
+					.tamano = broker->tamano_memoria,
+					.tamano_minimo = broker->tamano_minimo_particion,
+					.estrategia = memoria,
+					.reemplazo = reemplazo,
+					.particion_libre = particion,
+					.frecuencia_compactacion = broker->frecuencia_compactacion
+				};
+				bool configurado = memoria == broker->estrategia_memoria
+						&& reemplazo == broker->algoritmo_reemplazo
+						&& (memoria == BS
+								|| particion == broker->algoritmo_particion_libre);
+				if (!primero)
+					fprintf(out, ",\n");
+				memory_bench_run(trace, options, config, configurado, out);
+				primero = false;
+			}
+		}
+	}
+	fprintf(out, "\n  ]\n}\n");
+}
+
+static void memory_bench_range(char* value, int* min, int* max) {
+	char* separador = strpbrk(value, ":,");
+	*min = atoi(value);
+	*max = separador != NULL ? atoi(separador + 1) : *min;
+}
+
+int main(int argc, char *argv[]) {
+	t_memory_bench_options options = {
+		.operaciones = MEMORY_BENCH_OPERACIONES,
+		.tamano_min = MEMORY_BENCH_TAMANO_MIN,
+		.tamano_max = MEMORY_BENCH_TAMANO_MAX,
+		.liberaciones = MEMORY_BENCH_LIBERACIONES,
+		.accesos = MEMORY_BENCH_ACCESOS,
+		.muestras = MEMORY_BENCH_MUESTRAS,
+		.semilla = time(NULL),
+		.salida = "-"
+	};
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:t:l:a:m:s:o:")) != -1) {
+		switch (opt) {
+		case 'n':
+			options.operaciones = atoi(optarg);
+			break;
+		case 't':
+			memory_bench_range(optarg, &options.tamano_min, &options.tamano_max);
+			break;
+		case 'l':
+			options.liberaciones = atoi(optarg);
+			break;
+		case 'a':
+			options.accesos = atoi(optarg);
+			break;
+		case 'm':
+			options.muestras = atoi(optarg);
+			break;
+		case 's':
+			options.semilla = strtoul(optarg, NULL, 10);
+			break;
+		case 'o':
+			options.salida = optarg;
+			break;
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+	if (options.operaciones <= 0 || options.tamano_min <= 0
+			|| options.tamano_max < options.tamano_min
+			|| options.liberaciones < 0 || options.accesos < 0
+			|| options.liberaciones + options.accesos > 100
+			|| options.muestras <= 0) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	char* config_path = optind < argc ? argv[optind] : CONFIG_FILE_PATH;
+	char* trace_path = optind + 1 < argc ? argv[optind + 1] : NULL;
+	if (memory_bench_config_load(config_path) < 0) {
+		fprintf(stderr, "No se pudo leer la config %s\n", config_path);
+		return EXIT_FAILURE;
+	}
+
+	t_memory_bench_trace* trace =
+			trace_path != NULL ?
+					memory_bench_trace_load(trace_path) :
+					memory_bench_trace_synthetic(&options);
+	if (trace == NULL) {
+		fprintf(stderr, "No se pudo leer la traza %s\n", trace_path);
+		memory_bench_config_free();
+		return EXIT_FAILURE;
+	}
+
+	FILE* out = strcmp(options.salida, "-") == 0 ?
+			stdout : fopen(options.salida, "w");
+	if (out == NULL) {
+		fprintf(stderr, "No se pudo abrir %s\n", options.salida);
+	} else {
+		memory_bench_report(trace, &options, out);
+		if (out != stdout)
+			fclose(out);
+	}
+
+	memory_bench_trace_destroy(trace);
+	memory_bench_config_free();
+	return out != NULL ? EXIT_SUCCESS : EXIT_FAILURE;
+}
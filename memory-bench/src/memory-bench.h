@@ -0,0 +1,73 @@
+#ifndef MEMORY_BENCH_H_
+#define MEMORY_BENCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <commons/string.h>
+#include <commons/collections/dictionary.h>
+
+#include "config/memory_bench_config.h"
+#include "../../shared-common/common/allocator.h"
+#include "../../shared-common/common/alloc_trace.h"
+
+#define MEMORY_BENCH_OPERACIONES	100000
+#define MEMORY_BENCH_TAMANO_MIN		8
+#define MEMORY_BENCH_TAMANO_MAX		64
+#define MEMORY_BENCH_LIBERACIONES	0
+#define MEMORY_BENCH_ACCESOS		30
+#define MEMORY_BENCH_MUESTRAS		100
+
+// Opciones de la traza sintetica y del reporte
+typedef struct {
+	int operaciones;
+	int tamano_min;
+	int tamano_max;
+	// Porcentaje de las operaciones que liberan o leen un mensaje guardado
+	int liberaciones;
+	int accesos;
+	int muestras;
+	unsigned int semilla;
+	char* salida;
+} t_memory_bench_options;
+
+// Una operacion a reproducir. Los mensajes se numeran desde 0 al cargar la
+// traza, asi el allocator se ejercita sin buscar en diccionarios
+typedef struct {
+	e_trace_event tipo;
+	t_cola cola;
+	uint32_t size;
+	int mensaje;
+} t_memory_bench_op;
+
+typedef struct {
+	char* origen;
+	t_memory_bench_op* ops;
+	int cantidad;
+	int mensajes;
+	uint32_t tamano_max;
+	// Eventos de la traza que no se reproducen, solo se cuentan
+	int bajas;
+	int acks;
+	int suscripciones;
+} t_memory_bench_trace;
+
+typedef struct {
+	int operacion;
+	double fragmentacion;
+	uint32_t libres;
+} t_memory_bench_sample;
+
+t_memory_bench_trace* memory_bench_trace_load(char* path);
+t_memory_bench_trace* memory_bench_trace_synthetic(
+		t_memory_bench_options* options);
+void memory_bench_trace_destroy(t_memory_bench_trace* trace);
+void memory_bench_report(t_memory_bench_trace* trace,
+		t_memory_bench_options* options, FILE* out);
+
+#endif /* MEMORY_BENCH_H_ */
@@ -0,0 +1,289 @@
+#include "shared-common-test.h"
+
+static int fallas = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: fallo %s\n", __FILE__, __LINE__, #cond); \
+		fallas++; \
+	} \
+} while (0)
+
+// Serializa el mensaje como se manda por el socket: header y payload
+static void* frame_bytes(int protocol, void* message, int* size) {
+	t_package* package = utils_package_from(protocol, message);
+	*size = package->buffer->size + 2 * sizeof(int);
+	void* bytes = serializer_serialize_package(package, *size);
+	utils_package_destroy(package);
+	return bytes;
+}
+
+static void* frame_decode(t_frame* frame) {
+	t_list* fields = framing_frame_fields(frame);
+	if (fields == NULL)
+		return NULL;
+	void* message = utils_deserialize_fields(frame->protocol, fields);
+	list_destroy_and_destroy_elements(fields, (void*) utils_destroy_list);
+	return message;
+}
+
+static void fields_add(t_list* fields, void* value, int size) {
+	t_buffer* field = malloc(sizeof(t_buffer));
+	field->size = size;
+	field->stream = malloc(size);
+	memcpy(field->stream, value, size);
+	list_add(fields, field);
+}
+
+static void fields_add_int(t_list* fields, uint32_t value) {
+	fields_add(fields, &value, sizeof(uint32_t));
+}
+
+static t_localized_pokemon* localized_create(bool compacto) {
+	t_localized_pokemon* localized = malloc(sizeof(t_localized_pokemon));
+	localized->id_correlacional = 42;
+	localized->nombre_pokemon = string_duplicate("Pikachu");
+	localized->tamanio_nombre = strlen(localized->nombre_pokemon) + 1;
+	localized->posiciones = list_create();
+	localized->coordenadas = NULL;
+	uint32_t puntos[][2] = { { 1, 2 }, { 1, 2 }, { 7, 3 }, { 1000000, 0 } };
+	for (int i = 0; i < 4; i++) {
+		t_position* pos = malloc(sizeof(t_position));
+		pos->pos_x = puntos[i][0];
+		pos->pos_y = puntos[i][1];
+		list_add(localized->posiciones, pos);
+	}
+	localized->cant_elem = list_size(localized->posiciones);
+	if (compacto) {
+		localized->coordenadas = utils_localized_group(localized->posiciones);
+		list_destroy_and_destroy_elements(localized->posiciones, free);
+		localized->posiciones = NULL;
+	}
+	return localized;
+}
+
+static void check_localized(t_localized_pokemon* localized) {
+	CHECK(localized != NULL);
+	if (localized == NULL)
+		return;
+	CHECK(localized->id_correlacional == 42);
+	CHECK(strcmp(localized->nombre_pokemon, "Pikachu") == 0);
+	CHECK(localized->cant_elem == 4);
+	t_list* posiciones = utils_localized_positions(localized);
+	CHECK(posiciones != NULL && list_size(posiciones) == 4);
+	if (posiciones == NULL || list_size(posiciones) != 4)
+		return;
+	CHECK(((t_position*) list_get(posiciones, 0))->pos_x == 1);
+	CHECK(((t_position*) list_get(posiciones, 1))->pos_y == 2);
+	CHECK(((t_position*) list_get(posiciones, 3))->pos_x == 1000000);
+}
+
+// Varios frames escritos de a pocos bytes: el reader tiene que devolverlos
+// enteros y en orden aunque un recv corte un header o traiga mas de uno
+static void test_frames_partial_and_coalesced() {
+	int fds[2];
+	CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+	t_new_pokemon new_pokemon = { .nombre_pokemon = "Charmander",
+			.tamanio_nombre = 11, .cantidad = 3, .pos_x = 4, .pos_y = 5,
+			.id_correlacional = 9 };
+	t_get_pokemon get_pokemon = { .nombre_pokemon = "Squirtle",
+			.tamanio_nombre = 9, .id_correlacional = 10 };
+	t_localized_pokemon* localized = localized_create(false);
+
+	int sizes[3];
+	void* frames[3];
+	frames[0] = frame_bytes(NEW_POKEMON, &new_pokemon, &sizes[0]);
+	frames[1] = frame_bytes(GET_POKEMON, &get_pokemon, &sizes[1]);
+	frames[2] = frame_bytes(LOCALIZED_POKEMON, localized, &sizes[2]);
+	utils_localized_destroy(localized);
+
+	int total = sizes[0] + sizes[1] + sizes[2];
+	char* stream = malloc(total);
+	memcpy(stream, frames[0], sizes[0]);
+	memcpy(stream + sizes[0], frames[1], sizes[1]);
+	memcpy(stream + sizes[0] + sizes[1], frames[2], sizes[2]);
+
+	t_frame_reader* reader = framing_reader_create(fds[1], 0);
+	int recibidos = 0;
+	for (int offset = 0; offset < total; offset += 3) {
+		int chunk = total - offset < 3 ? total - offset : 3;
+		CHECK(write(fds[0], stream + offset, chunk) == chunk);
+		CHECK(framing_reader_fill(reader) == chunk);
+
+		t_frame frame;
+		int status;
+		while ((status = framing_reader_next(reader, &frame)) == FRAMING_OK) {
+			void* message = frame_decode(&frame);
+			CHECK(message != NULL);
+			if (recibidos == 0) {
+				t_new_pokemon* received = message;
+				CHECK(frame.protocol == NEW_POKEMON);
+				CHECK(strcmp(received->nombre_pokemon, "Charmander") == 0);
+				CHECK(received->cantidad == 3 && received->pos_y == 5);
+				free(received->nombre_pokemon);
+				free(received);
+			} else if (recibidos == 1) {
+				t_get_pokemon* received = message;
+				CHECK(frame.protocol == GET_POKEMON);
+				CHECK(strcmp(received->nombre_pokemon, "Squirtle") == 0);
+				free(received->nombre_pokemon);
+				free(received);
+			} else {
+				CHECK(frame.protocol == LOCALIZED_POKEMON);
+				check_localized(message);
+				utils_localized_destroy(message);
+			}
+			recibidos++;
+		}
+		CHECK(status == FRAMING_INCOMPLETE);
+	}
+	CHECK(recibidos == 3);
+
+	// Los tres de un solo recv
+	CHECK(write(fds[0], stream, total) == total);
+	t_frame frame;
+	for (int i = 0; i < 3; i++) {
+		CHECK(framing_reader_read(reader, &frame) == FRAMING_OK);
+		CHECK(frame.size == sizes[i] - (int) FRAMING_HEADER_SIZE);
+	}
+	CHECK(framing_reader_next(reader, &frame) == FRAMING_INCOMPLETE);
+
+	framing_reader_destroy(reader);
+	for (int i = 0; i < 3; i++)
+		free(frames[i]);
+	free(stream);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+static void test_frame_size_limits() {
+	int fds[2];
+	CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	t_frame_reader* reader = framing_reader_create(fds[1], 64);
+	t_frame frame;
+
+	int header[2] = { GET_POKEMON, 65 };
+	CHECK(write(fds[0], header, sizeof(header)) == sizeof(header));
+	CHECK(framing_reader_read(reader, &frame) == FRAMING_TOO_LARGE);
+	framing_reader_destroy(reader);
+
+	reader = framing_reader_create(fds[1], 64);
+	header[1] = -1;
+	CHECK(write(fds[0], header, sizeof(header)) == sizeof(header));
+	CHECK(framing_reader_read(reader, &frame) == FRAMING_TOO_LARGE);
+	framing_reader_destroy(reader);
+
+	close(fds[0]);
+	reader = framing_reader_create(fds[1], 0);
+	CHECK(framing_reader_read(reader, &frame) == FRAMING_CLOSED);
+	framing_reader_destroy(reader);
+	close(fds[1]);
+}
+
+// Un campo que declara mas bytes de los que quedan en el payload
+static void test_fields_out_of_bounds() {
+	char payload[12];
+	int size = 100;
+	memcpy(payload, &size, sizeof(int));
+	t_frame frame = { .protocol = GET_POKEMON, .size = sizeof(payload),
+			.payload = payload };
+	CHECK(framing_frame_fields(&frame) == NULL);
+
+	size = -4;
+	memcpy(payload, &size, sizeof(int));
+	CHECK(framing_frame_fields(&frame) == NULL);
+
+	// Queda un tamaño cortado al final
+	size = 4;
+	memcpy(payload, &size, sizeof(int));
+	frame.size = 10;
+	CHECK(framing_frame_fields(&frame) == NULL);
+}
+
+// cant_elem viene del peer y no puede pedir mas posiciones de las que hay
+static void test_localized_count_bounds() {
+	t_list* fields = list_create();
+	fields_add_int(fields, 1);
+	fields_add(fields, "Pikachu", strlen("Pikachu") + 1);
+	fields_add_int(fields, 8);
+	fields_add_int(fields, 0x80000000);
+	CHECK(utils_deserialize_fields(LOCALIZED_POKEMON, fields) == NULL);
+
+	fields_add_int(fields, 1);
+	fields_add_int(fields, 2);
+	CHECK(utils_deserialize_fields(LOCALIZED_POKEMON, fields) == NULL);
+
+	uint32_t uno = 1;
+	memcpy(((t_buffer*) list_get(fields, 3))->stream, &uno, sizeof(uint32_t));
+	t_localized_pokemon* localized = utils_deserialize_fields(
+			LOCALIZED_POKEMON, fields);
+	CHECK(localized != NULL && list_size(localized->posiciones) == 1);
+	if (localized != NULL)
+		utils_localized_destroy(localized);
+	list_destroy_and_destroy_elements(fields, (void*) utils_destroy_list);
+}
+
+static void test_localized_roundtrip() {
+	for (int compacto = 0; compacto < 2; compacto++) {
+		t_localized_pokemon* localized = localized_create(compacto);
+		int size;
+		void* bytes = frame_bytes(LOCALIZED_POKEMON, localized, &size);
+		utils_localized_destroy(localized);
+
+		t_frame frame = { .protocol = LOCALIZED_POKEMON, .size = size
+				- FRAMING_HEADER_SIZE, .payload = bytes + FRAMING_HEADER_SIZE };
+		t_localized_pokemon* received = frame_decode(&frame);
+		check_localized(received);
+		if (received != NULL) {
+			CHECK((received->coordenadas != NULL) == compacto);
+			utils_localized_destroy(received);
+		}
+		free(bytes);
+	}
+}
+
+static void test_localized_decode_bounds() {
+	t_localized_pokemon* localized = localized_create(true);
+	int size;
+	uint8_t* blob = utils_localized_encode(localized->coordenadas, &size);
+
+	t_list* coordenadas = utils_localized_decode(blob, size, 4);
+	CHECK(coordenadas != NULL && list_size(coordenadas) == 3);
+	if (coordenadas != NULL)
+		list_destroy_and_destroy_elements(coordenadas, free);
+
+	// Cortado, con una cantidad que no suma cant_elem o con otra version
+	for (int i = 0; i < size; i++)
+		CHECK(utils_localized_decode(blob, i, 4) == NULL);
+	CHECK(utils_localized_decode(blob, size, 3) == NULL);
+	CHECK(utils_localized_decode(blob, size, 0x80000004) == NULL);
+	blob[0]++;
+	CHECK(utils_localized_decode(blob, size, 4) == NULL);
+	free(blob);
+
+	// Una cantidad que se expandiria en mas pokemones de los que entran
+	t_position_aux* primera = list_get(localized->coordenadas, 0);
+	primera->cant = LOCALIZED_MAX_POKEMONS + 1;
+	blob = utils_localized_encode(localized->coordenadas, &size);
+	CHECK(utils_localized_decode(blob, size,
+			utils_localized_count(localized->coordenadas)) == NULL);
+	free(blob);
+	utils_localized_destroy(localized);
+}
+
+int main() {
+	test_frames_partial_and_coalesced();
+	test_frame_size_limits();
+	test_fields_out_of_bounds();
+	test_localized_count_bounds();
+	test_localized_roundtrip();
+	test_localized_decode_bounds();
+
+	if (fallas > 0) {
+		printf("%d chequeos fallaron\n", fallas);
+		return EXIT_FAILURE;
+	}
+	printf("ok\n");
+	return EXIT_SUCCESS;
+}
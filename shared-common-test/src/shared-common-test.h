@@ -0,0 +1,18 @@
+#ifndef SHARED_COMMON_TEST_H_
+#define SHARED_COMMON_TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <commons/string.h>
+#include <commons/collections/list.h>
+
+#include "../../shared-common/common/utils.h"
+#include "../../shared-common/common/framing.h"
+#include "../../shared-common/common/serializer.h"
+
+#endif /* SHARED_COMMON_TEST_H_ */
@@ -0,0 +1,79 @@
+#include "alloc_trace.h"
+
+static char* event_names[] = { "ALTA", "BAJA", "ACK", "SUSCRIPCION", "ACCESO",
+		"LIBERACION" };
+
+static void put_uint(uint8_t* buffer, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++)
+		buffer[i] = (value >> (8 * i)) & 0xFF;
+}
+
+static uint64_t get_uint(uint8_t* buffer, int bytes) {
+	uint64_t value = 0;
+	for (int i = 0; i < bytes; i++)
+		value |= (uint64_t) buffer[i] << (8 * i);
+	return value;
+}
+
+void alloc_trace_write_header(void* buffer) {
+	memcpy(buffer, ALLOC_TRACE_MAGIC, 4);
+	put_uint(buffer + 4, ALLOC_TRACE_VERSION, 4);
+}
+
+void alloc_trace_encode(t_trace_record* record, void* buffer) {
+	uint8_t* bytes = buffer;
+	put_uint(bytes, record->ns, 8);
+	bytes[8] = record->tipo;
+	bytes[9] = record->cola;
+	put_uint(bytes + 10, record->id, 4);
+	put_uint(bytes + 14, record->size, 4);
+}
+
+void alloc_trace_decode(void* buffer, t_trace_record* record) {
+	uint8_t* bytes = buffer;
+	record->ns = get_uint(bytes, 8);
+	record->tipo = bytes[8];
+	record->cola = bytes[9];
+	record->id = get_uint(bytes + 10, 4);
+	record->size = get_uint(bytes + 14, 4);
+}
+
+t_alloc_trace* alloc_trace_open(char* path) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return NULL;
+
+	uint8_t header[ALLOC_TRACE_HEADER_SIZE];
+	if (fread(header, 1, ALLOC_TRACE_HEADER_SIZE, file)
+			!= ALLOC_TRACE_HEADER_SIZE
+			|| memcmp(header, ALLOC_TRACE_MAGIC, 4) != 0
+			|| get_uint(header + 4, 4) != ALLOC_TRACE_VERSION) {
+		fclose(file);
+		return NULL;
+	}
+
+	t_alloc_trace* trace = malloc(sizeof(t_alloc_trace));
+	trace->file = file;
+	trace->version = ALLOC_TRACE_VERSION;
+	return trace;
+}
+
+bool alloc_trace_next(t_alloc_trace* trace, t_trace_record* record) {
+	uint8_t buffer[ALLOC_TRACE_RECORD_SIZE];
+	if (fread(buffer, 1, ALLOC_TRACE_RECORD_SIZE, trace->file)
+			!= ALLOC_TRACE_RECORD_SIZE)
+		return false;
+	alloc_trace_decode(buffer, record);
+	return true;
+}
+
+void alloc_trace_close(t_alloc_trace* trace) {
+	fclose(trace->file);
+	free(trace);
+}
+
+char* alloc_trace_event_name(e_trace_event tipo) {
+	if (tipo > TRACE_LIBERACION)
+		return "?";
+	return event_names[tipo];
+}
@@ -0,0 +1,89 @@
+#ifndef COMMON_ALLOC_TRACE_H_
+#define COMMON_ALLOC_TRACE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Traza de la memoria del broker: un encabezado y registros de tamaño fijo,
+// todo little endian.
+//
+// Encabezado: "DTRC", version (uint32)
+// Registro:   ns (uint64, desde el inicio de la traza), tipo (uint8),
+//             cola (uint8), id (uint32), size (uint32)
+//
+// En SUSCRIPCION id es el puerto del suscriptor y size 0. En ACK, ACCESO y
+// LIBERACION size es 0.
+//
+// El broker escribe los eventos de cada hilo por separado: el archivo no
+// esta ordenado por ns.
+#define ALLOC_TRACE_MAGIC		"DTRC"
+#define ALLOC_TRACE_VERSION		1
+#define ALLOC_TRACE_HEADER_SIZE	8
+#define ALLOC_TRACE_RECORD_SIZE	18
+
+typedef enum {
+	TRACE_ALTA,
+	TRACE_BAJA,
+	TRACE_ACK,
+	TRACE_SUSCRIPCION,
+	TRACE_ACCESO,
+	TRACE_LIBERACION
+} e_trace_event;
+
+typedef struct {
+	uint64_t ns;
+	e_trace_event tipo;
+	uint8_t cola;
+	uint32_t id;
+	uint32_t size;
+} t_trace_record;
+
+typedef struct {
+	FILE* file;
+	uint32_t version;
+} t_alloc_trace;
+
+/**
+ * @NAME: alloc_trace_write_header
+ * @DESC: Deja en buffer los ALLOC_TRACE_HEADER_SIZE bytes del encabezado.
+ */
+void alloc_trace_write_header(void* buffer);
+
+/**
+ * @NAME: alloc_trace_encode
+ * @DESC: Deja en buffer los ALLOC_TRACE_RECORD_SIZE bytes del registro.
+ */
+void alloc_trace_encode(t_trace_record* record, void* buffer);
+
+/**
+ * @NAME: alloc_trace_decode
+ * @DESC: Lee un registro de ALLOC_TRACE_RECORD_SIZE bytes.
+ */
+void alloc_trace_decode(void* buffer, t_trace_record* record);
+
+/**
+ * @NAME: alloc_trace_open
+ * @DESC: Abre una traza para leer. NULL si no existe o el encabezado no es
+ * 		valido.
+ */
+t_alloc_trace* alloc_trace_open(char* path);
+
+/**
+ * @NAME: alloc_trace_next
+ * @DESC: Lee el siguiente registro. false al final de la traza; un registro
+ * 		cortado al final (el broker se cayo escribiendo) tambien termina.
+ */
+bool alloc_trace_next(t_alloc_trace* trace, t_trace_record* record);
+
+void alloc_trace_close(t_alloc_trace* trace);
+
+/**
+ * @NAME: alloc_trace_event_name
+ * @DESC: Nombre del tipo de evento, para mostrar.
+ */
+char* alloc_trace_event_name(e_trace_event tipo);
+
+#endif /* COMMON_ALLOC_TRACE_H_ */
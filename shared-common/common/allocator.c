@@ -0,0 +1,580 @@
+#include "allocator.h"
+
+#define allocator_max(a, b) ((a) > (b) ? (a) : (b))
+
+static char* queue_names[] = { "NEW_QUEUE", "APPEARED_QUEUE",
+		"LOCALIZED_QUEUE", "GET_QUEUE", "CATCH_QUEUE", "CAUGHT_QUEUE" };
+
+// Buddy system: arbol binario completo sobre la memoria, cada nodo guarda el
+// mayor bloque libre que tiene debajo
+struct buddy {
+	uint32_t size;
+	uint32_t longest[1];
+};
+
+static inline int left_child(int index) {
+	// index * 2^1 + 1
+	return ((index << 1) + 1);
+}
+
+static inline int right_child(int index) {
+	// index * 2^1 + 2
+	return ((index << 1) + 2);
+}
+
+static inline int parent(int index) {
+	// (index+1)/2^1 - 1
+	return (((index + 1) >> 1) - 1);
+}
+
+static inline bool is_power_of_2(int index) {
+	return !(index & (index - 1));
+}
+
+static inline unsigned next_power_of_2(int size) {
+	size -= 1;
+	size |= (size >> 1);
+	size |= (size >> 2);
+	size |= (size >> 4);
+	size |= (size >> 8);
+	size |= (size >> 16);
+	return size + 1;
+}
+
+static struct buddy *buddy_new(int total_mem) {
+	if (!is_power_of_2(total_mem)) {
+		total_mem = next_power_of_2(total_mem);
+	}
+
+	// Allocate an array to represent a complete binary tree
+	struct buddy *self = malloc(
+			sizeof(struct buddy) + 2 * total_mem * sizeof(uint32_t));
+	self->size = total_mem;
+	uint32_t node_size = total_mem * 2;
+
+	for (int i = 0; i < total_mem * 2 - 1; i++) {
+		if (is_power_of_2(i + 1)) {
+			node_size >>= 1;
+		}
+		self->longest[i] = node_size;
+	}
+	return self;
+}
+
+// Choose smallest child greater than size
+static unsigned choose_better_child(struct buddy *self, int index,
+		uint32_t size) {
+	struct compound {
+		uint32_t size;
+		int index;
+	} children[2];
+
+	children[0].index = left_child(index);
+	children[0].size = self->longest[children[0].index];
+	children[1].index = right_child(index);
+	children[1].size = self->longest[children[1].index];
+
+	int min_idx = (children[0].size <= children[1].size) ? 0 : 1;
+
+	if (size > children[min_idx].size) {
+		min_idx = 1 - min_idx;
+	}
+
+	return children[min_idx].index;
+}
+
+// size tiene que ser potencia de dos y entrar en longest[0]
+static int buddy_alloc(struct buddy *self, uint32_t size) {
+	uint32_t index = 0;
+	uint32_t node_size;
+	for (node_size = self->size; node_size != size; node_size >>= 1) {
+		index = choose_better_child(self, index, size);
+	}
+
+	self->longest[index] = 0;
+	int offset = (index + 1) * node_size - self->size;
+
+	while (index) {
+		index = parent(index);
+		self->longest[index] = allocator_max(self->longest[left_child(index)],
+				self->longest[right_child(index)]);
+	}
+
+	return offset;
+}
+
+static void buddy_free(struct buddy *self, int offset) {
+	if (offset < 0 || offset >= self->size) {
+		return;
+	}
+
+	uint32_t node_size = 1;
+	uint32_t index = offset + self->size - 1;
+
+	for (; self->longest[index] != 0; index = parent(index)) {
+		node_size <<= 1;
+		if (index == 0) {
+			break;
+		}
+	}
+
+	self->longest[index] = node_size;
+
+	while (index) {
+		index = parent(index);
+		node_size <<= 1;
+
+		uint32_t left_longest = self->longest[left_child(index)];
+		uint32_t right_longest = self->longest[right_child(index)];
+
+		if (left_longest + right_longest == node_size) {
+			self->longest[index] = node_size;
+		} else {
+			self->longest[index] = allocator_max(left_longest, right_longest);
+		}
+	}
+}
+
+static uint64_t allocator_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static bool allocator_is_buddy(t_allocator* allocator) {
+	return allocator->config.estrategia == BS;
+}
+
+// Nunca menos de un byte: una particion vacia no se podria liberar
+static int allocator_partition_size(t_allocator* allocator, uint32_t size) {
+	return allocator_max(allocator_max((int) size,
+			allocator->config.tamano_minimo), 1);
+}
+
+static int allocator_block_size(t_allocator* allocator, t_nodo_memory* node) {
+	if (!allocator_is_buddy(allocator))
+		return node->size;
+	return next_power_of_2(allocator_partition_size(allocator, node->size));
+}
+
+static int allocator_memory_size(t_allocator* allocator) {
+	return allocator_is_buddy(allocator) ?
+			allocator->buddy->size : allocator->config.tamano;
+}
+
+static t_nodo_memory* allocator_node(t_allocator* allocator, int pointer,
+		int size) {
+	t_nodo_memory* node = pool_alloc(allocator->node_pool);
+	node->pointer = pointer;
+	node->size = size;
+	node->cola = 0;
+	node->id = 0;
+	node->libre = true;
+	node->timestamp = time(NULL);
+	node->uso = 0;
+	node->generacion = 0;
+	return node;
+}
+
+// El nodo deja de estar en la lista pero sigue valido para quien lo tenga
+static void allocator_retire(t_allocator* allocator, t_nodo_memory* node) {
+	node->libre = true;
+	node->id = 0;
+	pool_release(allocator->node_pool, node);
+}
+
+static int allocator_index_of(t_allocator* allocator, t_nodo_memory* node) {
+	for (int i = 0; i < list_size(allocator->nodes); i++) {
+		if (list_get(allocator->nodes, i) == node)
+			return i;
+	}
+	return -1;
+}
+
+t_allocator* allocator_create(t_allocator_config config, t_log* log,
+		t_allocator_evict on_evict, void* context) {
+	t_allocator* allocator = malloc(sizeof(t_allocator));
+	allocator->config = config;
+	allocator->nodes = list_create();
+	allocator->node_pool = pool_create(sizeof(t_nodo_memory), 0);
+	allocator->buddy = NULL;
+	allocator->tick = 0;
+	allocator->generaciones = 0;
+	memset(&allocator->stats, 0, sizeof(t_allocator_stats));
+	allocator->on_evict = on_evict;
+	allocator->context = context;
+	allocator->log = log;
+	pthread_mutex_init(&allocator->lock, NULL);
+
+	if (allocator_is_buddy(allocator)) {
+		allocator->buddy = buddy_new(config.tamano);
+	} else {
+		list_add(allocator->nodes, allocator_node(allocator, 0, config.tamano));
+	}
+	allocator->data = calloc(allocator_memory_size(allocator), 1);
+	return allocator;
+}
+
+// Une la particion libre con sus vecinas libres
+static void allocator_merge(t_allocator* allocator, int index) {
+	t_nodo_memory* node = list_get(allocator->nodes, index);
+	if (index + 1 < list_size(allocator->nodes)) {
+		t_nodo_memory* next = list_get(allocator->nodes, index + 1);
+		if (next->libre) {
+			node->size += next->size;
+			allocator_retire(allocator, list_remove(allocator->nodes, index + 1));
+		}
+	}
+	if (index > 0) {
+		t_nodo_memory* previous = list_get(allocator->nodes, index - 1);
+		if (previous->libre) {
+			previous->size += node->size;
+			allocator_retire(allocator, list_remove(allocator->nodes, index));
+		}
+	}
+}
+
+static void allocator_release(t_allocator* allocator, int index) {
+	t_nodo_memory* node = list_get(allocator->nodes, index);
+	if (allocator_is_buddy(allocator)) {
+		buddy_free(allocator->buddy, node->pointer);
+		allocator_retire(allocator, list_remove(allocator->nodes, index));
+	} else {
+		node->libre = true;
+		node->id = 0;
+		allocator_merge(allocator, index);
+	}
+}
+
+// FIFO reemplaza el que entro primero y LRU el que se uso hace mas tiempo:
+// los dos son el ocupado con menor uso, solo cambia cuando se actualiza
+static int allocator_victim(t_allocator* allocator) {
+	int victim = -1;
+	uint64_t oldest = UINT64_MAX;
+	for (int i = 0; i < list_size(allocator->nodes); i++) {
+		t_nodo_memory* node = list_get(allocator->nodes, i);
+		if (!node->libre && node->uso < oldest) {
+			oldest = node->uso;
+			victim = i;
+		}
+	}
+	return victim;
+}
+
+static bool allocator_evict(t_allocator* allocator) {
+	int index = allocator_victim(allocator);
+	if (index < 0)
+		return false;
+
+	t_nodo_memory* node = list_get(allocator->nodes, index);
+	t_cola cola = node->cola;
+	uint32_t id = node->id;
+	if (allocator->log != NULL)
+		log_info(allocator->log,
+				"The message with ID %d from %s, located at position %d will be removed",
+				id, queue_names[cola], node->pointer);
+	allocator_release(allocator, index);
+	allocator->stats.reemplazos++;
+	if (allocator->on_evict != NULL)
+		allocator->on_evict(cola, id, node, allocator->context);
+	return true;
+}
+
+// Mueve las ocupadas al principio, en el mismo orden, y deja una sola libre
+static void allocator_compact(t_allocator* allocator) {
+	if (allocator->log != NULL)
+		log_info(allocator->log, "Compaction started");
+	uint64_t start = allocator_now();
+
+	t_list* used = list_create();
+	int offset = 0;
+	for (int i = 0; i < list_size(allocator->nodes); i++) {
+		t_nodo_memory* node = list_get(allocator->nodes, i);
+		if (node->libre) {
+			allocator_retire(allocator, node);
+			continue;
+		}
+		if (node->pointer != offset) {
+			memmove(allocator->data + offset, allocator->data + node->pointer,
+					node->size);
+			allocator->stats.bytes_movidos += node->size;
+			node->pointer = offset;
+		}
+		offset += node->size;
+		list_add(used, node);
+	}
+	if (offset < allocator->config.tamano)
+		list_add(used, allocator_node(allocator, offset,
+				allocator->config.tamano - offset));
+
+	list_destroy(allocator->nodes);
+	allocator->nodes = used;
+	allocator->stats.compactaciones++;
+	allocator->stats.compactacion_ns += allocator_now() - start;
+	if (allocator->log != NULL)
+		log_info(allocator->log, "Compaction finished");
+}
+
+static int allocator_find_free(t_allocator* allocator, int size) {
+	int found = -1;
+	for (int i = 0; i < list_size(allocator->nodes); i++) {
+		t_nodo_memory* node = list_get(allocator->nodes, i);
+		if (!node->libre || node->size < size)
+			continue;
+		if (allocator->config.particion_libre == FF)
+			return i;
+		if (found < 0
+				|| node->size < ((t_nodo_memory*) list_get(allocator->nodes, found))->size)
+			found = i;
+	}
+	return found;
+}
+
+static bool allocator_should_compact(t_allocator* allocator, int fallas) {
+	int frecuencia = allocator->config.frecuencia_compactacion;
+	if (frecuencia < 0)
+		return false;
+	return frecuencia == 0 || fallas % frecuencia == 0;
+}
+
+// Particiones dinamicas: busca con FF/BF; cada FRECUENCIA_COMPACTACION
+// busquedas fallidas compacta y si aun asi no entra reemplaza una
+static t_nodo_memory* allocator_save_partition(t_allocator* allocator,
+		int size) {
+	int fallas = 0;
+	bool compacted = false;
+	int index;
+	while ((index = allocator_find_free(allocator, size)) < 0) {
+		fallas++;
+		if (!compacted && allocator_should_compact(allocator, fallas)) {
+			allocator_compact(allocator);
+			compacted = true;
+			continue;
+		}
+		if (!allocator_evict(allocator)) {
+			// Nada para reemplazar: lo libre esta repartido en huecos
+			allocator_compact(allocator);
+		}
+		compacted = false;
+	}
+
+	t_nodo_memory* node = list_get(allocator->nodes, index);
+	if (node->size > size) {
+		list_add_in_index(allocator->nodes, index + 1,
+				allocator_node(allocator, node->pointer + size,
+						node->size - size));
+		node->size = size;
+	}
+	return node;
+}
+
+static t_nodo_memory* allocator_save_buddy(t_allocator* allocator,
+		uint32_t size) {
+	uint32_t block = next_power_of_2(allocator_partition_size(allocator, size));
+	while (allocator->buddy->longest[0] < block) {
+		if (!allocator_evict(allocator))
+			return NULL;
+	}
+
+	t_nodo_memory* node = allocator_node(allocator,
+			buddy_alloc(allocator->buddy, block), size);
+	list_add(allocator->nodes, node);
+	return node;
+}
+
+t_nodo_memory* allocator_save(t_allocator* allocator, void* data,
+		uint32_t size, t_cola cola, uint32_t id) {
+	int partition = allocator_partition_size(allocator, size);
+	if (partition > allocator_memory_size(allocator)) {
+		pthread_mutex_lock(&allocator->lock);
+		allocator->stats.rechazos++;
+		pthread_mutex_unlock(&allocator->lock);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&allocator->lock);
+	t_nodo_memory* node =
+			allocator_is_buddy(allocator) ?
+					allocator_save_buddy(allocator, size) :
+					allocator_save_partition(allocator, partition);
+	if (node != NULL) {
+		node->cola = cola;
+		node->id = id;
+		node->libre = false;
+		node->timestamp = time(NULL);
+		node->uso = ++allocator->tick;
+		node->generacion = ++allocator->generaciones;
+		if (data != NULL)
+			memcpy(allocator->data + node->pointer, data, size);
+		allocator->stats.asignaciones++;
+	} else {
+		allocator->stats.rechazos++;
+	}
+	pthread_mutex_unlock(&allocator->lock);
+	return node;
+}
+
+static bool allocator_holds(t_nodo_memory* node, uint64_t generacion) {
+	return !node->libre && node->generacion == generacion;
+}
+
+int allocator_access(t_allocator* allocator, t_nodo_memory* node,
+		uint64_t generacion) {
+	pthread_mutex_lock(&allocator->lock);
+	if (!allocator_holds(node, generacion)) {
+		pthread_mutex_unlock(&allocator->lock);
+		return -1;
+	}
+	if (allocator->config.reemplazo == LRU) {
+		node->uso = ++allocator->tick;
+		time(&node->timestamp);
+	}
+	int pointer = node->pointer;
+	pthread_mutex_unlock(&allocator->lock);
+	return pointer;
+}
+
+int allocator_peek(t_allocator* allocator, t_nodo_memory* node,
+		uint64_t generacion) {
+	pthread_mutex_lock(&allocator->lock);
+	int pointer = allocator_holds(node, generacion) ? node->pointer : -1;
+	pthread_mutex_unlock(&allocator->lock);
+	return pointer;
+}
+
+void allocator_free(t_allocator* allocator, t_nodo_memory* node,
+		uint64_t generacion) {
+	pthread_mutex_lock(&allocator->lock);
+	if (allocator_holds(node, generacion)) {
+		int index = allocator_index_of(allocator, node);
+		if (index >= 0) {
+			allocator_release(allocator, index);
+			allocator->stats.liberaciones++;
+		}
+	}
+	pthread_mutex_unlock(&allocator->lock);
+}
+
+uint32_t allocator_free_bytes(t_allocator* allocator, uint32_t* largest) {
+	pthread_mutex_lock(&allocator->lock);
+	uint32_t free_bytes = 0;
+	uint32_t biggest = 0;
+	if (allocator_is_buddy(allocator)) {
+		free_bytes = allocator->buddy->size;
+		for (int i = 0; i < list_size(allocator->nodes); i++)
+			free_bytes -= allocator_block_size(allocator,
+					list_get(allocator->nodes, i));
+		biggest = allocator->buddy->longest[0];
+	} else {
+		for (int i = 0; i < list_size(allocator->nodes); i++) {
+			t_nodo_memory* node = list_get(allocator->nodes, i);
+			if (node->libre) {
+				free_bytes += node->size;
+				biggest = allocator_max(biggest, (uint32_t) node->size);
+			}
+		}
+	}
+	pthread_mutex_unlock(&allocator->lock);
+	if (largest != NULL)
+		*largest = biggest;
+	return free_bytes;
+}
+
+double allocator_fragmentation(t_allocator* allocator) {
+	uint32_t largest;
+	uint32_t free_bytes = allocator_free_bytes(allocator, &largest);
+	return free_bytes == 0 ? 0 : 1 - (double) largest / free_bytes;
+}
+
+static char* allocator_queue_short(t_cola cola, char* buffer) {
+	strncpy(buffer, queue_names[cola], 3);
+	buffer[3] = '\0';
+	return buffer;
+}
+
+static bool compare_memory_position(t_nodo_memory* a, t_nodo_memory* b) {
+	return a->pointer < b->pointer;
+}
+
+static void allocator_dump_buddy(t_allocator* allocator, FILE* f,
+		time_t base_time) {
+	t_list* list_clone = list_duplicate(allocator->nodes);
+	list_sort(list_clone, (void*) compare_memory_position);
+
+	char cola[4];
+	int last_size = 0;
+	int last_pointer = 0;
+	for (int i = 0; i < list_size(list_clone); ++i) {
+		t_nodo_memory* node = list_get(list_clone, i);
+		int block = allocator_block_size(allocator, node);
+
+		// Hueco libre antes del bloque
+		if (node->pointer > last_pointer) {
+			fprintf(f, "Particion %04d: %04d - %04d\t\t", last_size + 1,
+					last_pointer, node->pointer - 1);
+			fprintf(f, "[L]\t\t");
+			fprintf(f, "Size: %04d B\n", node->pointer - last_pointer);
+			last_size++;
+		}
+		fprintf(f, "Particion %04d: %04d - %04d\t\t", last_size + 1,
+				node->pointer, node->pointer + block - 1);
+		fprintf(f, "[X]\t\t");
+		fprintf(f, "Total size: %04d B. Used: %04d B, Free: %04d B\t\t", block,
+				node->size, block - node->size);
+		fprintf(f, "LRU: %04d\t\t", (int) (node->timestamp - base_time));
+		fprintf(f, "Queue: %s\t\t", allocator_queue_short(node->cola, cola));
+		fprintf(f, "ID: %04d\n", node->id);
+		last_size++;
+		last_pointer = node->pointer + block;
+	}
+
+	if (last_pointer != allocator->buddy->size) {
+		fprintf(f, "Particion %04d: %04d - %04d\t\t", last_size + 1,
+				last_pointer, allocator->buddy->size - 1);
+		fprintf(f, "[L]\t\t");
+		fprintf(f, "Size: %04d B\n", allocator->buddy->size - last_pointer);
+	}
+	list_destroy(list_clone);
+}
+
+static void allocator_dump_partitions(t_allocator* allocator, FILE* f,
+		time_t base_time) {
+	for (int i = 0; i < list_size(allocator->nodes); ++i) {
+		t_nodo_memory* node = list_get(allocator->nodes, i);
+		fprintf(f, "Particion %04d: %04d - %04d\t\t", i, node->pointer,
+				node->pointer + node->size - 1);
+		if (node->libre == false) {
+			fprintf(f, "[X]\t\t");
+		} else {
+			fprintf(f, "[L]\t\t");
+		}
+
+		fprintf(f, "Size: %04d B \t\t", node->size);
+		if (node->libre == false) {
+			fprintf(f, "LRU: %04d\t\t", (int) (node->timestamp - base_time));
+			fprintf(f, "Queue: %s\t\t", queue_names[node->cola]);
+			fprintf(f, "ID: %04d\n", node->id);
+		} else {
+			fprintf(f, "Queue: %s\n", "LIBRE");
+		}
+	}
+}
+
+void allocator_dump(t_allocator* allocator, FILE* f, time_t base_time) {
+	pthread_mutex_lock(&allocator->lock);
+	if (allocator_is_buddy(allocator))
+		allocator_dump_buddy(allocator, f, base_time);
+	else
+		allocator_dump_partitions(allocator, f, base_time);
+	pthread_mutex_unlock(&allocator->lock);
+}
+
+void allocator_destroy(t_allocator* allocator) {
+	// Los nodos son del pool
+	list_destroy(allocator->nodes);
+	pool_destroy(allocator->node_pool);
+	free(allocator->buddy);
+	free(allocator->data);
+	pthread_mutex_destroy(&allocator->lock);
+	free(allocator);
+}
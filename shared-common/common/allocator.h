@@ -0,0 +1,165 @@
+#ifndef COMMON_ALLOCATOR_H_
+#define COMMON_ALLOCATOR_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <commons/log.h>
+#include <commons/collections/list.h>
+#include "protocols.h"
+#include "pool.h"
+
+typedef enum
+{
+	BS, PD
+} e_memory_struct;
+
+typedef enum
+{
+	FIFO, LRU
+} e_algoritmo_reemplazo;
+
+typedef enum
+{
+	FF, BF
+} e_algoritmo_particion_libre;
+
+typedef struct {
+	int tamano;
+	int tamano_minimo;
+	e_memory_struct estrategia;
+	e_algoritmo_reemplazo reemplazo;
+	e_algoritmo_particion_libre particion_libre;
+	// Busquedas fallidas entre compactaciones. Negativo compacta solo cuando
+	// no queda nada para reemplazar
+	int frecuencia_compactacion;
+} t_allocator_config;
+
+// Una particion. Con particiones dinamicas la lista tiene todas, libres y
+// ocupadas, en orden de direccion. Con buddy system solo las ocupadas; size
+// es el tamaño del mensaje y el bloque es la potencia de dos que lo contiene.
+//
+// Los nodos salen de un pool y no se liberan mientras el allocator existe: el
+// log de mensajes guarda punteros a ellos. Los que sobran al unir particiones
+// vuelven al pool y se reutilizan, por eso quien tiene un nodo tiene que
+// verificar que siga en la generacion que le devolvio allocator_save. Cola e
+// id no alcanzan: los clientes repiten ids.
+typedef struct {
+	int pointer;
+	int size;
+	t_cola cola;
+	int id;
+	time_t timestamp;
+	bool libre;
+	// Orden para FIFO (alta) o LRU (ultimo uso)
+	uint64_t uso;
+	// Cambia con cada mensaje que se guarda en la particion
+	uint64_t generacion;
+} t_nodo_memory;
+
+typedef struct {
+	uint64_t asignaciones;
+	uint64_t liberaciones;
+	uint64_t reemplazos;
+	uint64_t rechazos;
+	uint64_t compactaciones;
+	uint64_t compactacion_ns;
+	uint64_t bytes_movidos;
+} t_allocator_stats;
+
+// Se llama con cada mensaje que se reemplaza para hacer lugar. node es la
+// particion que lo tenia, para distinguirlo de otros mensajes con el mismo id;
+// ya esta liberada y no hay que leerla
+typedef void (*t_allocator_evict)(t_cola cola, uint32_t id,
+		t_nodo_memory* node, void* context);
+
+struct buddy;
+
+typedef struct {
+	char* data;
+	t_allocator_config config;
+	t_list* nodes;
+	t_pool* node_pool;
+	struct buddy* buddy;
+	uint64_t tick;
+	uint64_t generaciones;
+	t_allocator_stats stats;
+	t_allocator_evict on_evict;
+	void* context;
+	t_log* log;
+	pthread_mutex_t lock;
+} t_allocator;
+
+/**
+ * @NAME: allocator_create
+ * @DESC: Reserva la memoria de config.tamano bytes (redondeado a potencia de
+ * 		dos con buddy system). log puede ser NULL para no loguear y on_evict
+ * 		NULL si nadie necesita enterarse de los reemplazos.
+ */
+t_allocator* allocator_create(t_allocator_config config, t_log* log,
+		t_allocator_evict on_evict, void* context);
+
+/**
+ * @NAME: allocator_save
+ * @DESC: Hace lugar para size bytes, reemplazando y compactando segun la
+ * 		config, y copia data si no es NULL. Devuelve la particion o NULL si
+ * 		el mensaje es mas grande que toda la memoria. Hay que guardar
+ * 		node->generacion para accederla despues.
+ */
+t_nodo_memory* allocator_save(t_allocator* allocator, void* data,
+		uint32_t size, t_cola cola, uint32_t id);
+
+/**
+ * @NAME: allocator_access
+ * @DESC: Devuelve la posicion del mensaje si la particion sigue en la
+ * 		generacion con la que se guardo, -1 si se reemplazo o se reutilizo.
+ * 		Con LRU cuenta como uso.
+ */
+int allocator_access(t_allocator* allocator, t_nodo_memory* node,
+		uint64_t generacion);
+
+/**
+ * @NAME: allocator_peek
+ * @DESC: Como allocator_access, pero no cuenta como uso.
+ */
+int allocator_peek(t_allocator* allocator, t_nodo_memory* node,
+		uint64_t generacion);
+
+/**
+ * @NAME: allocator_free
+ * @DESC: Libera la particion si sigue en esa generacion. No llama a on_evict.
+ */
+void allocator_free(t_allocator* allocator, t_nodo_memory* node,
+		uint64_t generacion);
+
+/**
+ * @NAME: allocator_free_bytes
+ * @DESC: Bytes libres en total y, en largest, el mayor bloque libre.
+ */
+uint32_t allocator_free_bytes(t_allocator* allocator, uint32_t* largest);
+
+/**
+ * @NAME: allocator_fragmentation
+ * @DESC: Fragmentacion externa, de 0 a 1: la parte de lo libre que no esta
+ * 		en el mayor bloque libre.
+ */
+double allocator_fragmentation(t_allocator* allocator);
+
+/**
+ * @NAME: allocator_dump
+ * @DESC: Escribe las particiones en el formato del dump de memoria. base_time
+ * 		es el instante desde el que se cuenta el LRU.
+ */
+void allocator_dump(t_allocator* allocator, FILE* f, time_t base_time);
+
+/**
+ * @NAME: allocator_destroy
+ * @DESC: Libera la memoria y todos los nodos.
+ */
+void allocator_destroy(t_allocator* allocator);
+
+#endif /* COMMON_ALLOCATOR_H_ */
@@ -0,0 +1,302 @@
+#include "broker_connection.h"
+
+static void broker_connection_now(clockid_t clock, struct timespec* ts,
+		int plus_ms) {
+	clock_gettime(clock, ts);
+	ts->tv_sec += plus_ms / 1000;
+	ts->tv_nsec += (long) (plus_ms % 1000) * 1000000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+static bool broker_connection_before(struct timespec* a, struct timespec* b) {
+	return a->tv_sec < b->tv_sec
+			|| (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+t_broker_connection* broker_connection_create(char* ip, int port) {
+	t_broker_connection* connection = malloc(sizeof(t_broker_connection));
+	connection->ip = string_duplicate(ip);
+	connection->port = port;
+	connection->node = NULL;
+	connection->identity = NULL;
+	connection->fd = -1;
+	connection->readers = 0;
+	connection->connecting = false;
+	pthread_mutex_init(&connection->mutex, NULL);
+	pthread_cond_init(&connection->replies, NULL);
+	connection->pending = dictionary_create();
+	connection->next_request_id = 0;
+	connection->backoff_ms = BROKER_CONNECTION_BACKOFF_MIN_MS;
+	connection->next_attempt.tv_sec = 0;
+	connection->next_attempt.tv_nsec = 0;
+	return connection;
+}
+
+void broker_connection_identify(t_broker_connection* connection, char* ip,
+		int port) {
+	t_handshake* identity = malloc(sizeof(t_handshake));
+	identity->ip = string_duplicate(ip);
+	identity->puerto = port;
+
+	pthread_mutex_lock(&connection->mutex);
+	t_handshake* previous = connection->identity;
+	connection->identity = identity;
+	pthread_mutex_unlock(&connection->mutex);
+
+	if (previous != NULL) {
+		free(previous->ip);
+		free(previous);
+	}
+}
+
+// Se llama con el mutex tomado. El socket lo cierra siempre su hilo lector,
+// aca solo se lo despierta y se deja de usar
+static void broker_connection_drop(t_broker_connection* connection) {
+	if (connection->fd < 0)
+		return;
+	shutdown(connection->fd, SHUT_RDWR);
+	connection->fd = -1;
+}
+
+static void broker_connection_fail_pending(t_broker_connection* connection,
+		int fd) {
+	void fail(char* key, t_pending_reply* pending) {
+		if (pending->fd == fd)
+			pending->failed = true;
+	}
+	dictionary_iterator(connection->pending, (void*) fail);
+	pthread_cond_broadcast(&connection->replies);
+}
+
+typedef struct {
+	t_broker_connection* connection;
+	int fd;
+} t_broker_reader_args;
+
+static void* broker_connection_reader(void* arg) {
+	t_broker_connection* connection = ((t_broker_reader_args*) arg)->connection;
+	int fd = ((t_broker_reader_args*) arg)->fd;
+	free(arg);
+
+	t_frame_reader* reader = framing_reader_create(fd, 0);
+	int protocol;
+	void* message;
+	while (utils_receive_message(reader, &protocol, &message) > 0) {
+		if (protocol != MESSAGE_ID) {
+			// Por esta conexion no hay suscripciones, el broker solo responde IDs
+			utils_message_destroy(protocol, message);
+			continue;
+		}
+
+		t_message_id* id_rcv = message;
+		char* key = string_itoa(id_rcv->request_id);
+		pthread_mutex_lock(&connection->mutex);
+		t_pending_reply* pending = dictionary_get(connection->pending, key);
+		if (pending != NULL) {
+			pending->id = id_rcv->id;
+			pending->done = true;
+			pthread_cond_broadcast(&connection->replies);
+		}
+		pthread_mutex_unlock(&connection->mutex);
+		free(key);
+		free(id_rcv);
+	}
+	framing_reader_destroy(reader);
+
+	pthread_mutex_lock(&connection->mutex);
+	if (connection->fd == fd)
+		connection->fd = -1;
+	broker_connection_fail_pending(connection, fd);
+	connection->readers--;
+	pthread_cond_broadcast(&connection->replies);
+	pthread_mutex_unlock(&connection->mutex);
+
+	socket_close_conection(fd);
+	return NULL;
+}
+
+// Se llama con el mutex tomado. El connect se hace sin el mutex: si el
+// broker no responde, los demas hilos no esperan el timeout detras de este.
+// Mientras otro hilo se conecta se espera su resultado, asi su mensaje sale
+// por esa conexion en lugar de perderse
+static int broker_connection_ensure(t_broker_connection* connection) {
+	while (connection->connecting)
+		pthread_cond_wait(&connection->replies, &connection->mutex);
+	if (connection->fd >= 0)
+		return 0;
+
+	struct timespec now;
+	broker_connection_now(CLOCK_MONOTONIC, &now, 0);
+	if (broker_connection_before(&now, &connection->next_attempt))
+		return -1;
+
+	connection->connecting = true;
+	pthread_mutex_unlock(&connection->mutex);
+	int fd = connection->node != NULL ?
+			cluster_node_connect(connection->node) :
+			socket_connect_to_server(connection->ip, connection->port);
+	pthread_mutex_lock(&connection->mutex);
+	connection->connecting = false;
+	pthread_cond_broadcast(&connection->replies);
+
+	if (fd < 0) {
+		broker_connection_now(CLOCK_MONOTONIC, &connection->next_attempt,
+				connection->backoff_ms);
+		connection->backoff_ms = min(connection->backoff_ms * 2,
+				BROKER_CONNECTION_BACKOFF_MAX_MS);
+		return -1;
+	}
+
+	pthread_t tid;
+	t_broker_reader_args* args = malloc(sizeof(t_broker_reader_args));
+	args->connection = connection;
+	args->fd = fd;
+	if (pthread_create(&tid, NULL, broker_connection_reader, args) != 0) {
+		free(args);
+		socket_close_conection(fd);
+		return -1;
+	}
+	pthread_detach(tid);
+	connection->fd = fd;
+	connection->readers++;
+	connection->backoff_ms = BROKER_CONNECTION_BACKOFF_MIN_MS;
+
+	// Si falla, falla tambien el envio que sigue y se reintenta desde cero
+	if (connection->identity != NULL)
+		utils_serialize_and_send(fd, HANDSHAKE, connection->identity);
+	return 0;
+}
+
+// Se llama con el mutex tomado, que se suelta durante un connect. Si el envio
+// falla sobre una conexion que ya estaba abierta (p.ej. el broker se reinicio)
+// se reintenta una vez sobre una nueva. Devuelve el fd por el que salio el
+// mensaje o -1.
+static int broker_connection_send_locked(t_broker_connection* connection,
+		t_protocol protocol, void* message) {
+	for (int attempt = 0; attempt < 2; attempt++) {
+		if (broker_connection_ensure(connection) < 0)
+			return -1;
+		int fd = connection->fd;
+		if (utils_serialize_and_send(fd, protocol, message) == 0)
+			return fd;
+		broker_connection_drop(connection);
+	}
+	return -1;
+}
+
+int broker_connection_send(t_broker_connection* connection, t_protocol protocol,
+		void* message) {
+	pthread_mutex_lock(&connection->mutex);
+	int fd = broker_connection_send_locked(connection, protocol, message);
+	pthread_mutex_unlock(&connection->mutex);
+	return fd < 0 ? -1 : 0;
+}
+
+int broker_connection_request(t_broker_connection* connection,
+		t_protocol protocol, void* message, uint32_t* id) {
+	pthread_mutex_lock(&connection->mutex);
+
+	uint32_t request_id = ++connection->next_request_id;
+	if (request_id == 0)
+		request_id = ++connection->next_request_id;
+
+	switch (protocol) {
+	case GET_POKEMON:
+		((t_get_pokemon*) message)->id_correlacional = request_id;
+		break;
+	case CATCH_POKEMON:
+		((t_catch_pokemon*) message)->id_correlacional = request_id;
+		break;
+	default:
+		pthread_mutex_unlock(&connection->mutex);
+		return -1;
+	}
+
+	// El lector no puede entregar la respuesta hasta que se libere el mutex
+	// en el wait, asi que alcanza con registrar el pedido despues de enviarlo
+	int fd = broker_connection_send_locked(connection, protocol, message);
+	if (fd < 0) {
+		pthread_mutex_unlock(&connection->mutex);
+		return -1;
+	}
+
+	t_pending_reply* pending = malloc(sizeof(t_pending_reply));
+	pending->id = 0;
+	pending->fd = fd;
+	pending->done = false;
+	pending->failed = false;
+	char* key = string_itoa(request_id);
+	dictionary_put(connection->pending, key, pending);
+
+	struct timespec deadline;
+	broker_connection_now(CLOCK_REALTIME, &deadline,
+			BROKER_CONNECTION_REPLY_TIMEOUT_MS);
+	while (!pending->done && !pending->failed) {
+		if (pthread_cond_timedwait(&connection->replies, &connection->mutex,
+				&deadline) == ETIMEDOUT)
+			break;
+	}
+
+	dictionary_remove(connection->pending, key);
+	int result = pending->done ? 0 : -1;
+	if (pending->done)
+		*id = pending->id;
+	pthread_mutex_unlock(&connection->mutex);
+
+	free(key);
+	free(pending);
+	return result;
+}
+
+void broker_connection_destroy(t_broker_connection* connection) {
+	pthread_mutex_lock(&connection->mutex);
+	while (connection->connecting)
+		pthread_cond_wait(&connection->replies, &connection->mutex);
+	broker_connection_drop(connection);
+	while (connection->readers > 0)
+		pthread_cond_wait(&connection->replies, &connection->mutex);
+	pthread_mutex_unlock(&connection->mutex);
+
+	pthread_mutex_destroy(&connection->mutex);
+	pthread_cond_destroy(&connection->replies);
+	dictionary_destroy_and_destroy_elements(connection->pending, free);
+	if (connection->identity != NULL) {
+		free(connection->identity->ip);
+		free(connection->identity);
+	}
+	free(connection->ip);
+	free(connection);
+}
+
+t_broker_router* broker_router_create(t_cluster* cluster) {
+	t_broker_router* router = malloc(sizeof(t_broker_router));
+	router->cluster = cluster;
+	router->connections = list_create();
+	for (int i = 0; i < list_size(cluster->nodes); i++) {
+		t_cluster_node* node = list_get(cluster->nodes, i);
+		t_broker_connection* connection = broker_connection_create(node->ip,
+				node->port);
+		connection->node = node;
+		list_add(router->connections, connection);
+	}
+	return router;
+}
+
+void broker_router_identify(t_broker_router* router, char* ip, int port) {
+	for (int i = 0; i < list_size(router->connections); i++)
+		broker_connection_identify(list_get(router->connections, i), ip, port);
+}
+
+t_broker_connection* broker_router_get(t_broker_router* router, t_cola cola) {
+	return list_get(router->connections,
+			cluster_node_index(router->cluster, cola));
+}
+
+void broker_router_destroy(t_broker_router* router) {
+	list_destroy_and_destroy_elements(router->connections,
+			(void*) broker_connection_destroy);
+	free(router);
+}
@@ -0,0 +1,115 @@
+#ifndef COMMON_BROKER_CONNECTION_H_
+#define COMMON_BROKER_CONNECTION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <commons/string.h>
+#include <commons/collections/dictionary.h>
+#include "sockets.h"
+#include "utils.h"
+#include "cluster.h"
+
+#define BROKER_CONNECTION_BACKOFF_MIN_MS	250
+#define BROKER_CONNECTION_BACKOFF_MAX_MS	8000
+#define BROKER_CONNECTION_REPLY_TIMEOUT_MS	5000
+
+typedef struct {
+	uint32_t id;
+	int fd;
+	bool done;
+	bool failed;
+} t_pending_reply;
+
+typedef struct {
+	char* ip;
+	int port;
+	// Si esta, se conecta por cluster_node_connect y puede pasar a la replica
+	t_cluster_node* node;
+	t_handshake* identity;
+	int fd;
+	int readers;
+	// Un hilo esta en el connect, sin el mutex
+	bool connecting;
+	pthread_mutex_t mutex;
+	pthread_cond_t replies;
+	t_dictionary* pending;
+	uint32_t next_request_id;
+	int backoff_ms;
+	struct timespec next_attempt;
+} t_broker_connection;
+
+// Una conexion por nodo del cluster, en el mismo orden que cluster->nodes
+typedef struct {
+	t_cluster* cluster;
+	t_list* connections;
+} t_broker_router;
+
+/**
+ * @NAME: broker_connection_create
+ * @DESC: Crea la sesion contra el broker. No se conecta hasta el primer envio.
+ */
+t_broker_connection* broker_connection_create(char* ip, int port);
+
+/**
+ * @NAME: broker_connection_identify
+ * @DESC: Se presenta ante el broker con la ip y puerto con los que el
+ * 		proceso se suscribe, en cada conexion nueva. Asi el broker le envia
+ * 		solo a el los LOCALIZED/CAUGHT que responden a sus GET/CATCH.
+ */
+void broker_connection_identify(t_broker_connection* connection, char* ip,
+		int port);
+
+/**
+ * @NAME: broker_connection_send
+ * @DESC: Envia un mensaje por la conexion persistente, reconectando si hace
+ * 		falta. Si otro hilo se esta conectando espera a que termine y usa esa
+ * 		conexion. Mientras dura el backoff de una reconexion fallida se
+ * 		devuelve -1 sin bloquear. Devuelve 0 si se envio.
+ */
+int broker_connection_send(t_broker_connection* connection, t_protocol protocol,
+		void* message);
+
+/**
+ * @NAME: broker_connection_request
+ * @DESC: Envia un GET o CATCH y espera el ID que le asigna el broker. El
+ * 		id_correlacional del mensaje se usa para correlacionar la respuesta,
+ * 		asi varios hilos pueden tener pedidos en curso sobre la misma conexion.
+ * 		Devuelve 0 y deja el ID en *id, o -1 si no hubo respuesta.
+ */
+int broker_connection_request(t_broker_connection* connection,
+		t_protocol protocol, void* message, uint32_t* id);
+
+/**
+ * @NAME: broker_connection_destroy
+ * @DESC: Cierra la conexion, despierta los pedidos pendientes y libera todo.
+ */
+void broker_connection_destroy(t_broker_connection* connection);
+
+/**
+ * @NAME: broker_router_create
+ * @DESC: Crea una sesion por cada broker del cluster. El cluster sigue siendo
+ * 		de quien lo creo.
+ */
+t_broker_router* broker_router_create(t_cluster* cluster);
+
+/**
+ * @NAME: broker_router_identify
+ * @DESC: broker_connection_identify sobre todas las sesiones.
+ */
+void broker_router_identify(t_broker_router* router, char* ip, int port);
+
+/**
+ * @NAME: broker_router_get
+ * @DESC: Sesion contra el broker que tiene la cola.
+ */
+t_broker_connection* broker_router_get(t_broker_router* router, t_cola cola);
+
+/**
+ * @NAME: broker_router_destroy
+ * @DESC: Cierra y libera todas las sesiones.
+ */
+void broker_router_destroy(t_broker_router* router);
+
+#endif /* COMMON_BROKER_CONNECTION_H_ */
@@ -0,0 +1,170 @@
+#include "cluster.h"
+
+static t_cluster_node* cluster_node_create(char* ip, int port) {
+	t_cluster_node* node = malloc(sizeof(t_cluster_node));
+	node->ip = string_duplicate(ip);
+	node->port = port;
+	node->replica = NULL;
+	node->failed_over = 0;
+	return node;
+}
+
+static void cluster_node_destroy(t_cluster_node* node) {
+	if (node->replica != NULL)
+		cluster_node_destroy(node->replica);
+	free(node->ip);
+	free(node);
+}
+
+// "ip:puerto". Se corta en el ultimo ':' porque la ip puede ser unix:/ruta
+static t_cluster_node* cluster_parse_address(char* entry) {
+	char* separator = strrchr(entry, ':');
+	if (separator == NULL || separator == entry || separator[1] == '\0')
+		return NULL;
+
+	char* end;
+	long port = strtol(separator + 1, &end, 10);
+	if (*end != '\0' || port <= 0 || port > 65535)
+		return NULL;
+
+	char* ip = string_substring_until(entry, separator - entry);
+	string_trim(&ip);
+	t_cluster_node* node = cluster_node_create(ip, port);
+	free(ip);
+	return node;
+}
+
+// "nodo" o "nodo|replica"
+static t_cluster_node* cluster_parse_node(char* entry) {
+	char** parts = string_split(entry, "|");
+	t_cluster_node* node = NULL;
+	if (parts[0] != NULL && (parts[1] == NULL || parts[2] == NULL)) {
+		node = cluster_parse_address(parts[0]);
+		if (node != NULL && parts[1] != NULL) {
+			node->replica = cluster_parse_address(parts[1]);
+			if (node->replica == NULL) {
+				cluster_node_destroy(node);
+				node = NULL;
+			}
+		}
+	}
+	for (int i = 0; parts[i] != NULL; i++)
+		free(parts[i]);
+	free(parts);
+	return node;
+}
+
+t_cluster* cluster_create(t_config* config, char* ip, int port) {
+	t_cluster* cluster = malloc(sizeof(t_cluster));
+	cluster->nodes = list_create();
+
+	if (config != NULL && config_has_property(config, CLUSTER_KEY)) {
+		char** entries = config_get_array_value(config, CLUSTER_KEY);
+		for (int i = 0; entries[i] != NULL; i++) {
+			t_cluster_node* node = cluster_parse_node(entries[i]);
+			if (node != NULL)
+				list_add(cluster->nodes, node);
+			free(entries[i]);
+		}
+		free(entries);
+	}
+
+	if (list_is_empty(cluster->nodes)) {
+		t_cluster_node* node = cluster_node_create(ip, port);
+		if (config != NULL && config_has_property(config, CLUSTER_REPLICA_IP_KEY)
+				&& config_has_property(config, CLUSTER_REPLICA_PORT_KEY)) {
+			node->replica = cluster_node_create(
+					config_get_string_value(config, CLUSTER_REPLICA_IP_KEY),
+					config_get_int_value(config, CLUSTER_REPLICA_PORT_KEY));
+		}
+		list_add(cluster->nodes, node);
+	}
+	return cluster;
+}
+
+int cluster_queue_of(t_protocol protocol) {
+	switch (protocol) {
+	case NEW_POKEMON:
+		return NEW_QUEUE;
+	case APPEARED_POKEMON:
+		return APPEARED_QUEUE;
+	case GET_POKEMON:
+		return GET_QUEUE;
+	case LOCALIZED_POKEMON:
+		return LOCALIZED_QUEUE;
+	case CATCH_POKEMON:
+		return CATCH_QUEUE;
+	case CAUGHT_POKEMON:
+		return CAUGHT_QUEUE;
+	default:
+		return -1;
+	}
+}
+
+static int cluster_group(t_cola cola) {
+	switch (cola) {
+	case NEW_QUEUE:
+		return 0;
+	case APPEARED_QUEUE:
+		return 1;
+	case GET_QUEUE:
+	case LOCALIZED_QUEUE:
+		return 2;
+	default:
+		return CLUSTER_GROUPS - 1;
+	}
+}
+
+int cluster_node_index(t_cluster* cluster, t_cola cola) {
+	return cluster_group(cola) % list_size(cluster->nodes);
+}
+
+t_cluster_node* cluster_node(t_cluster* cluster, t_cola cola) {
+	return list_get(cluster->nodes, cluster_node_index(cluster, cola));
+}
+
+static bool cluster_is(t_cluster_node* node, char* ip, int port) {
+	return node != NULL && node->port == port
+			&& string_equals_ignore_case(node->ip, ip);
+}
+
+int cluster_node_connect(t_cluster_node* node) {
+	bool on_replica = node->replica != NULL
+			&& __atomic_load_n(&node->failed_over, __ATOMIC_ACQUIRE);
+	t_cluster_node* current = on_replica ? node->replica : node;
+	int fd = socket_connect_to_server(current->ip, current->port);
+	if (fd >= 0 || node->replica == NULL)
+		return fd;
+
+	t_cluster_node* other = on_replica ? node : node->replica;
+	fd = socket_connect_to_server(other->ip, other->port);
+	if (fd >= 0)
+		__atomic_store_n(&node->failed_over, !on_replica, __ATOMIC_RELEASE);
+	return fd;
+}
+
+int cluster_connect(t_cluster* cluster, t_cola cola) {
+	return cluster_node_connect(cluster_node(cluster, cola));
+}
+
+t_cluster_node* cluster_replica_of(t_cluster* cluster, char* ip, int port) {
+	for (int i = 0; i < list_size(cluster->nodes); i++) {
+		t_cluster_node* node = list_get(cluster->nodes, i);
+		if (cluster_is(node, ip, port) && !cluster_is(node->replica, ip, port))
+			return node->replica;
+	}
+	return NULL;
+}
+
+bool cluster_owns(t_cluster* cluster, t_cola cola, char* ip, int port) {
+	t_cluster_node* node = cluster_node(cluster, cola);
+	return cluster_is(node, ip, port) || cluster_is(node->replica, ip, port);
+}
+
+void cluster_destroy(t_cluster* cluster) {
+	if (cluster == NULL)
+		return;
+	list_destroy_and_destroy_elements(cluster->nodes,
+			(void*) cluster_node_destroy);
+	free(cluster);
+}
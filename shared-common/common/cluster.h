@@ -0,0 +1,102 @@
+#ifndef COMMON_CLUSTER_H_
+#define COMMON_CLUSTER_H_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <commons/config.h>
+#include <commons/string.h>
+#include <commons/collections/list.h>
+#include "protocols.h"
+#include "sockets.h"
+
+#define CLUSTER_KEY		"CLUSTER_BROKERS"
+#define CLUSTER_GROUPS	4
+#define CLUSTER_REPLICA_IP_KEY		"IP_BROKER_REPLICA"
+#define CLUSTER_REPLICA_PORT_KEY	"PUERTO_BROKER_REPLICA"
+
+typedef struct t_cluster_node {
+	char* ip;
+	int port;
+	// Broker en espera al que este le envia su log, NULL si no tiene
+	struct t_cluster_node* replica;
+	// 1 mientras este proceso se conecta a la replica en lugar del nodo
+	int failed_over;
+} t_cluster_node;
+
+// Tabla de ruteo estatica de los brokers. Todos los procesos leen la misma
+// lista de nodos (CLUSTER_BROKERS=[ip:puerto,...]) y reparten las colas igual:
+// NEW, APPEARED, GET+LOCALIZED y CATCH+CAUGHT son cuatro grupos que se asignan
+// en orden, el grupo i al nodo i % nodos. Las respuestas quedan en el mismo
+// broker que su pedido, asi el ruteo de LOCALIZED/CAUGHT a quien envio el
+// GET/CATCH sigue funcionando sin hablar entre brokers. Con mas de
+// CLUSTER_GROUPS nodos los que sobran no reciben ninguna cola.
+//
+// Cada nodo puede tener una replica, "ip:puerto|ip:puerto" en la lista o
+// IP_BROKER_REPLICA/PUERTO_BROKER_REPLICA si es un solo broker. Si el nodo no
+// responde los clientes pasan a la replica y se quedan ahi mientras conecte.
+typedef struct {
+	t_list* nodes;
+} t_cluster;
+
+/**
+ * @NAME: cluster_create
+ * @DESC: Lee CLUSTER_BROKERS del config. Si no esta o no tiene ningun nodo
+ * 		valido el cluster es un solo broker en (ip, port), con la replica de
+ * 		IP_BROKER_REPLICA/PUERTO_BROKER_REPLICA si esta.
+ */
+t_cluster* cluster_create(t_config* config, char* ip, int port);
+
+/**
+ * @NAME: cluster_queue_of
+ * @DESC: Cola a la que va un mensaje del protocolo, -1 si no va a ninguna.
+ */
+int cluster_queue_of(t_protocol protocol);
+
+/**
+ * @NAME: cluster_node_index
+ * @DESC: Posicion en la lista de nodos del broker que tiene la cola.
+ */
+int cluster_node_index(t_cluster* cluster, t_cola cola);
+
+/**
+ * @NAME: cluster_node
+ * @DESC: Broker al que hay que conectarse para publicar o suscribirse a la
+ * 		cola.
+ */
+t_cluster_node* cluster_node(t_cluster* cluster, t_cola cola);
+
+/**
+ * @NAME: cluster_node_connect
+ * @DESC: Se conecta al nodo o, si no responde y tiene replica, a la replica.
+ * 		Recuerda a cual conecto para el proximo intento. Devuelve el fd o -1.
+ */
+int cluster_node_connect(t_cluster_node* node);
+
+/**
+ * @NAME: cluster_connect
+ * @DESC: cluster_node_connect sobre el broker que tiene la cola.
+ */
+int cluster_connect(t_cluster* cluster, t_cola cola);
+
+/**
+ * @NAME: cluster_replica_of
+ * @DESC: Replica a la que el broker (ip, port) le tiene que enviar su log.
+ * 		NULL si no tiene o si (ip, port) es una replica.
+ */
+t_cluster_node* cluster_replica_of(t_cluster* cluster, char* ip, int port);
+
+/**
+ * @NAME: cluster_owns
+ * @DESC: Indica si la cola le corresponde al broker (ip, port), como nodo o
+ * 		como su replica.
+ */
+bool cluster_owns(t_cluster* cluster, t_cola cola, char* ip, int port);
+
+/**
+ * @NAME: cluster_destroy
+ * @DESC: Libera la tabla.
+ */
+void cluster_destroy(t_cluster* cluster);
+
+#endif /* COMMON_CLUSTER_H_ */
@@ -0,0 +1,153 @@
+#include "framing.h"
+
+t_frame_reader* framing_reader_create(int fd, int max_frame_size) {
+	t_frame_reader* reader = malloc(sizeof(t_frame_reader));
+	reader->fd = fd;
+	reader->capacity = FRAMING_INITIAL_BUFFER;
+	reader->buffer = malloc(reader->capacity);
+	reader->start = 0;
+	reader->end = 0;
+	reader->max_frame_size =
+			max_frame_size > 0 ? max_frame_size : FRAMING_MAX_FRAME_SIZE;
+	reader->state = FRAME_READING_HEADER;
+	reader->protocol = 0;
+	reader->payload_size = 0;
+	return reader;
+}
+
+void framing_reader_destroy(t_frame_reader* reader) {
+	if (reader == NULL)
+		return;
+	free(reader->buffer);
+	free(reader);
+}
+
+static int framing_available(t_frame_reader* reader) {
+	return reader->end - reader->start;
+}
+
+// Deja lugar contiguo para al menos "wanted" bytes sin consumir
+static void framing_make_room(t_frame_reader* reader, int wanted) {
+	if (reader->start == reader->end) {
+		reader->start = 0;
+		reader->end = 0;
+	}
+
+	if (reader->start > 0
+			&& (reader->end == reader->capacity
+					|| reader->capacity - reader->start < wanted)) {
+		memmove(reader->buffer, reader->buffer + reader->start,
+				framing_available(reader));
+		reader->end -= reader->start;
+		reader->start = 0;
+	}
+
+	int new_capacity = reader->capacity;
+	while (new_capacity < wanted)
+		new_capacity *= 2;
+	if (reader->end == new_capacity)
+		new_capacity *= 2;
+
+	if (new_capacity != reader->capacity) {
+		reader->buffer = realloc(reader->buffer, new_capacity);
+		reader->capacity = new_capacity;
+	}
+}
+
+int framing_reader_fill(t_frame_reader* reader) {
+	int wanted = reader->state == FRAME_READING_PAYLOAD ?
+			reader->payload_size : (int) FRAMING_HEADER_SIZE;
+	framing_make_room(reader, wanted);
+
+	for (;;) {
+		ssize_t received = socket_recv_bytes(reader->fd,
+				reader->buffer + reader->end, reader->capacity - reader->end);
+		if (received > 0) {
+			reader->end += received;
+			return received;
+		}
+		if (received == 0)
+			return FRAMING_CLOSED;
+		if (errno == EINTR)
+			continue;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return FRAMING_WOULD_BLOCK;
+		return FRAMING_ERROR;
+	}
+}
+
+int framing_reader_next(t_frame_reader* reader, t_frame* frame) {
+	if (reader->state == FRAME_READING_HEADER) {
+		if (framing_available(reader) < (int) FRAMING_HEADER_SIZE)
+			return FRAMING_INCOMPLETE;
+
+		memcpy(&reader->protocol, reader->buffer + reader->start, sizeof(int));
+		memcpy(&reader->payload_size,
+				reader->buffer + reader->start + sizeof(int), sizeof(int));
+
+		if (reader->payload_size < 0
+				|| reader->payload_size > reader->max_frame_size)
+			return FRAMING_TOO_LARGE;
+
+		reader->start += FRAMING_HEADER_SIZE;
+		reader->state = FRAME_READING_PAYLOAD;
+	}
+
+	if (framing_available(reader) < reader->payload_size)
+		return FRAMING_INCOMPLETE;
+
+	frame->protocol = reader->protocol;
+	frame->size = reader->payload_size;
+	frame->payload = reader->buffer + reader->start;
+
+	reader->start += reader->payload_size;
+	reader->state = FRAME_READING_HEADER;
+	return FRAMING_OK;
+}
+
+int framing_reader_read(t_frame_reader* reader, t_frame* frame) {
+	for (;;) {
+		int status = framing_reader_next(reader, frame);
+		if (status != FRAMING_INCOMPLETE)
+			return status;
+
+		status = framing_reader_fill(reader);
+		if (status == FRAMING_WOULD_BLOCK) {
+			struct pollfd pfd = { .fd = reader->fd, .events = POLLIN };
+			poll(&pfd, 1, -1);
+		} else if (status < 0) {
+			return status;
+		}
+	}
+}
+
+static void framing_destroy_field(t_buffer* field) {
+	free(field->stream);
+	free(field);
+}
+
+t_list* framing_frame_fields(t_frame* frame) {
+	t_list* fields = list_create();
+	int offset = 0;
+
+	while (offset < frame->size) {
+		int size = -1;
+		if (frame->size - offset >= (int) sizeof(int)) {
+			memcpy(&size, frame->payload + offset, sizeof(int));
+			offset += sizeof(int);
+		}
+		if (size < 0 || size > frame->size - offset) {
+			list_destroy_and_destroy_elements(fields,
+					(void*) framing_destroy_field);
+			return NULL;
+		}
+
+		t_buffer* field = malloc(sizeof(t_buffer));
+		field->size = size;
+		field->stream = malloc(size);
+		memcpy(field->stream, frame->payload + offset, size);
+		offset += size;
+		list_add(fields, field);
+	}
+	return fields;
+}
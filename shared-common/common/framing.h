@@ -0,0 +1,99 @@
+#ifndef COMMON_FRAMING_H_
+#define COMMON_FRAMING_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <commons/collections/list.h>
+#include "protocols.h"
+#include "sockets.h"
+
+// Cada frame es: [operation_code int][size int][payload de size bytes]
+#define FRAMING_HEADER_SIZE		(2 * sizeof(int))
+#define FRAMING_MAX_FRAME_SIZE	(4 * 1024 * 1024)
+#define FRAMING_INITIAL_BUFFER	4096
+
+#define FRAMING_OK				1
+#define FRAMING_INCOMPLETE		0
+#define FRAMING_CLOSED			-1
+#define FRAMING_ERROR			-2
+#define FRAMING_TOO_LARGE		-3
+#define FRAMING_WOULD_BLOCK		-4
+
+typedef enum {
+	FRAME_READING_HEADER,
+	FRAME_READING_PAYLOAD
+} e_frame_state;
+
+typedef struct {
+	int protocol;
+	int size;
+	void* payload;
+} t_frame;
+
+typedef struct {
+	int fd;
+	char* buffer;
+	int capacity;
+	int start;
+	int end;
+	int max_frame_size;
+	e_frame_state state;
+	int protocol;
+	int payload_size;
+} t_frame_reader;
+
+/**
+ * @NAME: framing_reader_create
+ * @DESC: Crea el buffer de lectura de una conexion. Los frames cuyo payload
+ * 		supere max_frame_size se rechazan sin reservar memoria para ellos.
+ * 		Si max_frame_size es <= 0 se usa FRAMING_MAX_FRAME_SIZE.
+ */
+t_frame_reader* framing_reader_create(int fd, int max_frame_size);
+
+/**
+ * @NAME: framing_reader_destroy
+ * @DESC: Libera el buffer de lectura. No cierra el socket.
+ */
+void framing_reader_destroy(t_frame_reader* reader);
+
+/**
+ * @NAME: framing_reader_fill
+ * @DESC: Hace un unico recv sobre el espacio libre del buffer. Devuelve la
+ * 		cantidad de bytes leidos, FRAMING_CLOSED, FRAMING_ERROR o, si el socket
+ * 		es no bloqueante y no hay datos, FRAMING_WOULD_BLOCK.
+ */
+int framing_reader_fill(t_frame_reader* reader);
+
+/**
+ * @NAME: framing_reader_next
+ * @DESC: Extrae el siguiente frame completo del buffer sin hacer syscalls.
+ * 		Devuelve FRAMING_OK, FRAMING_INCOMPLETE si falta leer del socket o
+ * 		FRAMING_TOO_LARGE si el header declara un tamaño invalido.
+ * 		frame->payload apunta al buffer interno y es valido hasta el proximo
+ * 		framing_reader_fill.
+ */
+int framing_reader_next(t_frame_reader* reader, t_frame* frame);
+
+/**
+ * @NAME: framing_reader_read
+ * @DESC: Version bloqueante de framing_reader_next: lee del socket solo cuando
+ * 		el buffer no tiene un frame completo. Con sockets no bloqueantes espera
+ * 		con poll en lugar de girar.
+ */
+int framing_reader_read(t_frame_reader* reader, t_frame* frame);
+
+/**
+ * @NAME: framing_frame_fields
+ * @DESC: Separa el payload en una lista de t_buffer ([size int][valor]...).
+ * 		Devuelve NULL si algun campo se sale del payload.
+ */
+t_list* framing_frame_fields(t_frame* frame);
+
+#endif /* COMMON_FRAMING_H_ */
@@ -0,0 +1,74 @@
+#include "pool.h"
+
+// Alineado para cualquier tipo
+static size_t pool_align(size_t size) {
+	size_t align = sizeof(max_align_t);
+	if (size == 0)
+		size = 1;
+	return (size + align - 1) / align * align;
+}
+
+t_pool* pool_create(size_t size, int por_slab) {
+	t_pool* pool = malloc(sizeof(t_pool));
+	pool->size = pool_align(size);
+	pool->por_slab = por_slab > 0 ? por_slab : POOL_POR_SLAB;
+	pool->slabs = list_create();
+	pool->libres = NULL;
+	pool->cantidad_libres = 0;
+	pool->en_uso = 0;
+	pthread_mutex_init(&pool->lock, NULL);
+	return pool;
+}
+
+// Se llama con el lock tomado y sin libres
+static void pool_grow(t_pool* pool) {
+	char* slab = malloc(pool->size * pool->por_slab);
+	list_add(pool->slabs, slab);
+	// Entran todos los objetos del pool, no hace falta volver a agrandarlo
+	// hasta el proximo slab
+	pool->libres = realloc(pool->libres,
+			sizeof(void*) * pool->por_slab * list_size(pool->slabs));
+	// Al reves, para entregar primero el principio del slab
+	for (int i = pool->por_slab - 1; i >= 0; i--)
+		pool->libres[pool->cantidad_libres++] = slab + i * pool->size;
+}
+
+void* pool_alloc(t_pool* pool) {
+	pthread_mutex_lock(&pool->lock);
+	if (pool->cantidad_libres == 0)
+		pool_grow(pool);
+	void* object = pool->libres[--pool->cantidad_libres];
+	pool->en_uso++;
+	pthread_mutex_unlock(&pool->lock);
+	return object;
+}
+
+void pool_release(t_pool* pool, void* object) {
+	if (object == NULL)
+		return;
+	pthread_mutex_lock(&pool->lock);
+	pool->libres[pool->cantidad_libres++] = object;
+	pool->en_uso--;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+int pool_in_use(t_pool* pool) {
+	pthread_mutex_lock(&pool->lock);
+	int en_uso = pool->en_uso;
+	pthread_mutex_unlock(&pool->lock);
+	return en_uso;
+}
+
+int pool_slabs(t_pool* pool) {
+	pthread_mutex_lock(&pool->lock);
+	int slabs = list_size(pool->slabs);
+	pthread_mutex_unlock(&pool->lock);
+	return slabs;
+}
+
+void pool_destroy(t_pool* pool) {
+	list_destroy_and_destroy_elements(pool->slabs, free);
+	free(pool->libres);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
@@ -0,0 +1,70 @@
+#ifndef COMMON_POOL_H_
+#define COMMON_POOL_H_
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <commons/collections/list.h>
+
+#define POOL_POR_SLAB	256
+
+// Objetos de un mismo tamaño reservados de a slabs. Es para estructuras
+// chicas que se crean y se liberan con cada mensaje: los lugares se
+// reutilizan en vez de pedirlos a malloc, asi la memoria del proceso no
+// crece con el trafico.
+//
+// Los slabs no se devuelven hasta pool_destroy y los libres se anotan aparte:
+// un objeto liberado conserva su contenido hasta que se vuelve a pedir, y un
+// puntero viejo sigue apuntando a memoria valida.
+typedef struct {
+	size_t size;
+	int por_slab;
+	t_list* slabs;
+	void** libres;
+	int cantidad_libres;
+	int en_uso;
+	pthread_mutex_t lock;
+} t_pool;
+
+/**
+ * @NAME: pool_create
+ * @DESC: Crea un pool de objetos de size bytes, reservados de a por_slab
+ * 		(POOL_POR_SLAB si es 0 o negativo).
+ */
+t_pool* pool_create(size_t size, int por_slab);
+
+/**
+ * @NAME: pool_alloc
+ * @DESC: Devuelve un objeto sin inicializar. Si no quedan libres reserva un
+ * 		slab nuevo.
+ */
+void* pool_alloc(t_pool* pool);
+
+/**
+ * @NAME: pool_release
+ * @DESC: Devuelve el objeto al pool. Tiene que haber salido de pool_alloc
+ * 		del mismo pool.
+ */
+void pool_release(t_pool* pool, void* object);
+
+/**
+ * @NAME: pool_in_use
+ * @DESC: Objetos pedidos y todavia no devueltos.
+ */
+int pool_in_use(t_pool* pool);
+
+/**
+ * @NAME: pool_slabs
+ * @DESC: Slabs reservados, nunca baja.
+ */
+int pool_slabs(t_pool* pool);
+
+/**
+ * @NAME: pool_destroy
+ * @DESC: Libera todos los slabs, esten o no devueltos sus objetos.
+ */
+void pool_destroy(t_pool* pool);
+
+#endif /* COMMON_POOL_H_ */
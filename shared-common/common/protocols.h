@@ -44,7 +44,9 @@ typedef enum {
 	GET_POKEMON,
 	LOCALIZED_POKEMON,
 	SUBSCRIBE,
-	NOOP
+	NOOP,
+	MESSAGE_ID,
+	REPLICA
 } t_protocol;
 
 typedef enum {
@@ -119,16 +121,43 @@ typedef struct {
 	t_cola cola;
 	uint32_t f_desc;
 	int32_t seconds;
+	// Opcional: solo recibir mensajes de estas especies. NULL recibe todo
+	t_list* especies;
 } t_subscribe;
 
+// LOCALIZED viaja de dos formas: expandido (posiciones, un t_position por
+// cada pokemon) o compacto (coordenadas, un t_position_aux por coordenada con
+// su cantidad). cant_elem es siempre la cantidad total de pokemones. Quien
+// arma el mensaje completa una sola de las dos listas y deja la otra en NULL.
 typedef struct {
 	uint32_t id_correlacional;
 	char* nombre_pokemon;
 	uint32_t tamanio_nombre;
 	uint32_t cant_elem;
 	t_list* posiciones;
+	t_list* coordenadas;
 } t_localized_pokemon;
 
+#define LOCALIZED_ENCODING_COMPACT	1
+
+// Respuesta del broker a un GET/CATCH: request_id es el id_correlacional
+// con el que el cliente envio el mensaje e id el que le asigno el broker
+typedef struct {
+	uint32_t request_id;
+	uint32_t id;
+} t_message_id;
+
+// Primer mensaje de una conexion de pedidos: identifica al proceso por la
+// ip y puerto con los que se suscribe, para que el broker le envie solo a el
+// las respuestas a sus GET/CATCH
+typedef struct {
+	char* ip;
+	uint32_t puerto;
+} t_handshake;
+
+// REPLICA viaja con un t_handshake (ip y puerto del broker primario) y marca
+// la conexion como el log que el primario le envia a su replica
+
 typedef struct {
 	uint32_t id;
 	uint32_t pos;
@@ -30,3 +30,44 @@ t_package* serializer_deserialize_object(void* object, int bytes)
 
 	return magic;
 }
+
+int serializer_put_varint(void* buffer, uint32_t value)
+{
+	int bytes = 0;
+	do {
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if (value != 0)
+			byte |= 0x80;
+		if (buffer != NULL)
+			((uint8_t*) buffer)[bytes] = byte;
+		bytes++;
+	} while (value != 0);
+	return bytes;
+}
+
+int serializer_get_varint(void* buffer, int size, uint32_t* value)
+{
+	uint32_t result = 0;
+	for (int i = 0; i < size && i < SERIALIZER_VARINT_MAX; i++) {
+		uint8_t byte = ((uint8_t*) buffer)[i];
+		if (i == SERIALIZER_VARINT_MAX - 1 && byte > 0x0F)
+			return -1;
+		result |= (uint32_t) (byte & 0x7F) << (7 * i);
+		if ((byte & 0x80) == 0) {
+			*value = result;
+			return i + 1;
+		}
+	}
+	return -1;
+}
+
+uint32_t serializer_zigzag(int32_t value)
+{
+	return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+int32_t serializer_unzigzag(uint32_t value)
+{
+	return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
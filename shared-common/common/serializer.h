@@ -3,9 +3,36 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include "protocols.h"
 
+// Un uint32 en varint ocupa como maximo 5 bytes
+#define SERIALIZER_VARINT_MAX	5
+
 void* serializer_serialize_package(t_package* package, int bytes);
 t_package* serializer_deserialize_object(void* object, int bytes);
 
+/**
+ * @NAME: serializer_put_varint
+ * @DESC: Escribe value en base 128 (7 bits por byte, el bit alto indica que
+ * 		sigue otro byte) y devuelve la cantidad de bytes usados. Con buffer
+ * 		NULL solo devuelve el tamaño.
+ */
+int serializer_put_varint(void* buffer, uint32_t value);
+
+/**
+ * @NAME: serializer_get_varint
+ * @DESC: Lee un varint de a lo sumo size bytes. Devuelve los bytes consumidos
+ * 		o -1 si el buffer se termina o el valor no entra en 32 bits.
+ */
+int serializer_get_varint(void* buffer, int size, uint32_t* value);
+
+/**
+ * @NAME: serializer_zigzag
+ * @DESC: Mapea enteros con signo a sin signo (0,-1,1,-2.. -> 0,1,2,3..) para
+ * 		que las diferencias chicas negativas tambien ocupen un solo byte.
+ */
+uint32_t serializer_zigzag(int32_t value);
+int32_t serializer_unzigzag(uint32_t value);
+
 #endif
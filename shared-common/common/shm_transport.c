@@ -0,0 +1,225 @@
+#include "shm_transport.h"
+
+#define SHM_DOORBELL_DRAIN	64
+#define SHM_FULL_WAIT_US	50
+// Cuanto espera el cliente a que el servidor confirme que mapeo el segmento
+#define SHM_ACCEPT_TIMEOUT_MS	5000
+// Cuanto espera el servidor el nombre del segmento. El accept corre en el
+// hilo que acepta: un cliente que conecta y no manda nada no puede frenar a
+// los que vienen atras
+#define SHM_HANDSHAKE_TIMEOUT_MS	1000
+
+static uint32_t shm_segments_created = 0;
+
+static t_shm_transport* shm_transport_create(t_shm_segment* segment,
+		int tx_index) {
+	t_shm_transport* transport = malloc(sizeof(t_shm_transport));
+	transport->segment = segment;
+	transport->tx = &segment->rings[tx_index];
+	transport->rx = &segment->rings[1 - tx_index];
+	transport->rx_eof = false;
+	transport->closed = 0;
+	pthread_mutex_init(&transport->tx_mutex, NULL);
+	return transport;
+}
+
+static t_shm_segment* shm_transport_map(char* name, bool create) {
+	int flags = create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR;
+	int shm_fd = shm_open(name, flags, 0600);
+	if (shm_fd < 0)
+		return NULL;
+
+	if (create && ftruncate(shm_fd, sizeof(t_shm_segment)) < 0) {
+		close(shm_fd);
+		shm_unlink(name);
+		return NULL;
+	}
+
+	t_shm_segment* segment = mmap(NULL, sizeof(t_shm_segment),
+			PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+	close(shm_fd);
+	if (segment == MAP_FAILED) {
+		if (create)
+			shm_unlink(name);
+		return NULL;
+	}
+	return segment;
+}
+
+t_shm_transport* shm_transport_connect(int fd) {
+	char name[SHM_NAME_MAX];
+	snprintf(name, sizeof(name), "/delibird-%d-%u", getpid(),
+			__atomic_fetch_add(&shm_segments_created, 1, __ATOMIC_RELAXED));
+
+	// ftruncate deja el segmento en cero: rings vacios y sin flags
+	t_shm_segment* segment = shm_transport_map(name, true);
+	if (segment == NULL)
+		return NULL;
+
+	// Hasta que el servidor confirma que lo mapeo, el segmento es de este
+	// lado: si el servidor no lo acepta (cerro sin aceptar, no responde) se
+	// desvincula aca y no queda en /dev/shm
+	int length = strlen(name) + 1;
+	struct pollfd ack_poll = { .fd = fd, .events = POLLIN };
+	char ack;
+	if (send(fd, &length, sizeof(int), MSG_NOSIGNAL) != sizeof(int)
+			|| send(fd, name, length, MSG_NOSIGNAL) != length
+			|| poll(&ack_poll, 1, SHM_ACCEPT_TIMEOUT_MS) != 1
+			|| recv(fd, &ack, 1, MSG_DONTWAIT) != 1) {
+		munmap(segment, sizeof(t_shm_segment));
+		shm_unlink(name);
+		return NULL;
+	}
+	// El servidor ya lo desvinculo; si no llego a hacerlo, se hace aca
+	shm_unlink(name);
+	return shm_transport_create(segment, 0);
+}
+
+t_shm_transport* shm_transport_accept(int fd) {
+	char name[SHM_NAME_MAX];
+	int length;
+	struct timeval previous;
+	socklen_t previous_size = sizeof(previous);
+	struct timeval timeout = { .tv_sec = SHM_HANDSHAKE_TIMEOUT_MS / 1000,
+			.tv_usec = (SHM_HANDSHAKE_TIMEOUT_MS % 1000) * 1000 };
+	if (getsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &previous, &previous_size) < 0
+			|| setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+					sizeof(timeout)) < 0)
+		return NULL;
+
+	// Con el timeout un MSG_WAITALL vencido devuelve lo que llego: menos bytes
+	bool received = recv(fd, &length, sizeof(int), MSG_WAITALL) == sizeof(int)
+			&& length > 1 && length <= SHM_NAME_MAX
+			&& recv(fd, name, length, MSG_WAITALL) == length
+			&& name[length - 1] == '\0';
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &previous, sizeof(previous));
+	if (!received)
+		return NULL;
+
+	t_shm_segment* segment = shm_transport_map(name, false);
+	shm_unlink(name);
+	if (segment == NULL)
+		return NULL;
+
+	char ack = 1;
+	if (send(fd, &ack, 1, MSG_NOSIGNAL) != 1) {
+		munmap(segment, sizeof(t_shm_segment));
+		return NULL;
+	}
+	return shm_transport_create(segment, 1);
+}
+
+static bool shm_transport_peer_gone(int fd) {
+	char byte;
+	return recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+
+ssize_t shm_transport_send(t_shm_transport* transport, int fd, void* buffer,
+		size_t size) {
+	t_shm_ring* ring = transport->tx;
+	size_t sent = 0;
+
+	pthread_mutex_lock(&transport->tx_mutex);
+	while (sent < size) {
+		if (__atomic_load_n(&transport->closed, __ATOMIC_ACQUIRE)
+				|| __atomic_load_n(&ring->consumer_closed, __ATOMIC_ACQUIRE)) {
+			pthread_mutex_unlock(&transport->tx_mutex);
+			return -1;
+		}
+
+		uint32_t head = ring->head;
+		uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		uint32_t space = SHM_RING_CAPACITY - (head - tail);
+		if (space == 0) {
+			if (shm_transport_peer_gone(fd)) {
+				pthread_mutex_unlock(&transport->tx_mutex);
+				return -1;
+			}
+			usleep(SHM_FULL_WAIT_US);
+			continue;
+		}
+
+		uint32_t chunk = size - sent < space ? size - sent : space;
+		uint32_t offset = head & (SHM_RING_CAPACITY - 1);
+		uint32_t first = SHM_RING_CAPACITY - offset;
+		if (first > chunk)
+			first = chunk;
+		memcpy(ring->data + offset, (char*) buffer + sent, first);
+		memcpy(ring->data, (char*) buffer + sent + first, chunk - first);
+		__atomic_store_n(&ring->head, head + chunk, __ATOMIC_RELEASE);
+		sent += chunk;
+
+		// Junto con el fence del consumidor garantiza que o el ve los datos
+		// o nosotros vemos que esta esperando
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&ring->consumer_waiting, __ATOMIC_RELAXED)
+				&& !__atomic_load_n(&transport->closed, __ATOMIC_ACQUIRE)) {
+			char bell = 1;
+			send(fd, &bell, 1, MSG_NOSIGNAL);
+		}
+	}
+	pthread_mutex_unlock(&transport->tx_mutex);
+	return sent;
+}
+
+ssize_t shm_transport_recv(t_shm_transport* transport, int fd, void* buffer,
+		size_t size) {
+	t_shm_ring* ring = transport->rx;
+
+	for (;;) {
+		uint32_t tail = ring->tail;
+		uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		uint32_t available = head - tail;
+
+		if (available > 0) {
+			uint32_t chunk = size < available ? size : available;
+			uint32_t offset = tail & (SHM_RING_CAPACITY - 1);
+			uint32_t first = SHM_RING_CAPACITY - offset;
+			if (first > chunk)
+				first = chunk;
+			memcpy(buffer, ring->data + offset, first);
+			memcpy((char*) buffer + first, ring->data, chunk - first);
+			__atomic_store_n(&ring->tail, tail + chunk, __ATOMIC_RELEASE);
+			return chunk;
+		}
+
+		if (transport->rx_eof
+				|| __atomic_load_n(&transport->closed, __ATOMIC_ACQUIRE)
+				|| __atomic_load_n(&ring->producer_closed, __ATOMIC_ACQUIRE))
+			return 0;
+
+		__atomic_store_n(&ring->consumer_waiting, 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != tail) {
+			__atomic_store_n(&ring->consumer_waiting, 0, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		char bells[SHM_DOORBELL_DRAIN];
+		ssize_t received = recv(fd, bells, sizeof(bells), 0);
+		__atomic_store_n(&ring->consumer_waiting, 0, __ATOMIC_RELAXED);
+		if (received < 0 && errno == EINTR)
+			continue;
+		if (received < 0)
+			return -1;
+		// Con el socket cerrado se vuelve a mirar el ring una vez: lo escrito
+		// antes del close sigue ahi
+		if (received == 0)
+			transport->rx_eof = true;
+	}
+}
+
+void shm_transport_shutdown(t_shm_transport* transport) {
+	__atomic_store_n(&transport->closed, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&transport->tx->producer_closed, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&transport->rx->consumer_closed, 1, __ATOMIC_RELEASE);
+}
+
+void shm_transport_destroy(t_shm_transport* transport) {
+	if (transport == NULL)
+		return;
+	shm_transport_shutdown(transport);
+	munmap(transport->segment, sizeof(t_shm_segment));
+	pthread_mutex_destroy(&transport->tx_mutex);
+	free(transport);
+}
@@ -0,0 +1,96 @@
+#ifndef COMMON_SHM_TRANSPORT_H_
+#define COMMON_SHM_TRANSPORT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#define SHM_RING_CAPACITY	(1 << 20)
+#define SHM_NAME_MAX		64
+
+// Ring de un solo productor y un solo consumidor. head y tail cuentan bytes
+// totales y se comparan modulo 2^32, la capacidad tiene que ser potencia de 2.
+typedef struct {
+	uint32_t head;
+	uint32_t tail;
+	int consumer_waiting;
+	int producer_closed;
+	int consumer_closed;
+	char data[SHM_RING_CAPACITY];
+} t_shm_ring;
+
+// rings[0]: cliente -> servidor, rings[1]: servidor -> cliente
+typedef struct {
+	t_shm_ring rings[2];
+} t_shm_segment;
+
+typedef struct {
+	t_shm_segment* segment;
+	t_shm_ring* tx;
+	t_shm_ring* rx;
+	bool rx_eof;
+	int closed;
+	pthread_mutex_t tx_mutex;
+} t_shm_transport;
+
+/**
+ * @NAME: shm_transport_connect
+ * @DESC: Lado cliente. Crea el segmento compartido y le pasa su nombre al
+ * 		servidor por fd, que queda como canal de aviso entre los dos procesos.
+ * 		Espera a que el servidor confirme que lo mapeo; si no confirma,
+ * 		desvincula el segmento y devuelve NULL.
+ */
+t_shm_transport* shm_transport_connect(int fd);
+
+/**
+ * @NAME: shm_transport_accept
+ * @DESC: Lado servidor. Lee el nombre del segmento de fd, lo mapea, lo
+ * 		desvincula, asi desaparece cuando ambos lados lo liberan, y le
+ * 		confirma al cliente. Si el nombre no llega en
+ * 		SHM_HANDSHAKE_TIMEOUT_MS devuelve NULL.
+ */
+t_shm_transport* shm_transport_accept(int fd);
+
+/**
+ * @NAME: shm_transport_send
+ * @DESC: Escribe todo el buffer en el ring de salida. Si el consumidor esta
+ * 		dormido lo despierta con un byte por fd. Devuelve size o -1 si el otro
+ * 		lado cerro.
+ */
+ssize_t shm_transport_send(t_shm_transport* transport, int fd, void* buffer,
+		size_t size);
+
+/**
+ * @NAME: shm_transport_recv
+ * @DESC: Misma semantica que recv sin flags: bloquea hasta que haya al menos
+ * 		un byte y devuelve lo disponible, 0 si el otro lado cerro o -1 si error.
+ */
+ssize_t shm_transport_recv(t_shm_transport* transport, int fd, void* buffer,
+		size_t size);
+
+/**
+ * @NAME: shm_transport_shutdown
+ * @DESC: Marca ambos rings como cerrados, para este proceso y para el otro.
+ * 		Los envios y lecturas en curso terminan sin volver a usar el fd.
+ */
+void shm_transport_shutdown(t_shm_transport* transport);
+
+/**
+ * @NAME: shm_transport_destroy
+ * @DESC: Cierra los rings y libera el mapeo. No cierra fd.
+ */
+void shm_transport_destroy(t_shm_transport* transport);
+
+#endif /* COMMON_SHM_TRANSPORT_H_ */
@@ -1,9 +1,125 @@
 #include "sockets.h"
 
+// Transporte no-TCP asociado a cada fd. NULL significa que send/recv van
+// directo al socket (TCP o AF_UNIX). Cada operacion toma una referencia, asi
+// un close desde otro hilo no libera el transporte mientras se esta usando.
+static t_transport* transports[SOCKET_MAX_FDS];
+static e_socket_scheme listener_schemes[SOCKET_MAX_FDS];
+static pthread_mutex_t transports_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static ssize_t socket_shm_send(void* state, int fd, void* buffer, size_t size) {
+	return shm_transport_send(state, fd, buffer, size);
+}
+
+static ssize_t socket_shm_recv(void* state, int fd, void* buffer, size_t size) {
+	return shm_transport_recv(state, fd, buffer, size);
+}
+
+static void socket_shm_shutdown(void* state) {
+	shm_transport_shutdown(state);
+}
+
+static void socket_shm_destroy(void* state) {
+	shm_transport_destroy(state);
+}
+
+static void socket_register_shm(int fd, t_shm_transport* shm) {
+	t_transport* transport = malloc(sizeof(t_transport));
+	transport->send = socket_shm_send;
+	transport->recv = socket_shm_recv;
+	transport->shutdown = socket_shm_shutdown;
+	transport->destroy = socket_shm_destroy;
+	transport->state = shm;
+	transport->references = 1;
+
+	pthread_mutex_lock(&transports_mutex);
+	transports[fd] = transport;
+	pthread_mutex_unlock(&transports_mutex);
+}
+
+static t_transport* socket_get_transport(int fd) {
+	if (fd < 0 || fd >= SOCKET_MAX_FDS)
+		return NULL;
+	pthread_mutex_lock(&transports_mutex);
+	t_transport* transport = transports[fd];
+	if (transport != NULL)
+		transport->references++;
+	pthread_mutex_unlock(&transports_mutex);
+	return transport;
+}
+
+static void socket_put_transport(t_transport* transport) {
+	pthread_mutex_lock(&transports_mutex);
+	int references = --transport->references;
+	pthread_mutex_unlock(&transports_mutex);
+	if (references == 0) {
+		transport->destroy(transport->state);
+		free(transport);
+	}
+}
+
+e_socket_scheme socket_parse_address(char* ip, int port, char* path) {
+	e_socket_scheme scheme;
+	char* rest;
+	if (string_starts_with(ip, "unix")) {
+		scheme = SOCKET_UNIX;
+		rest = ip + strlen("unix");
+	} else if (string_starts_with(ip, "shm")) {
+		scheme = SOCKET_SHM;
+		rest = ip + strlen("shm");
+	} else {
+		return SOCKET_TCP;
+	}
+
+	if (*rest == ':' && rest[1] != '\0')
+		snprintf(path, SOCKET_PATH_MAX, "%s", rest + 1);
+	else if (*rest == '\0' || *rest == ':')
+		snprintf(path, SOCKET_PATH_MAX, SOCKET_DEFAULT_PATH, port);
+	else
+		return SOCKET_TCP;
+	return scheme;
+}
+
+static void socket_unix_address(struct sockaddr_un* addr, char* path) {
+	memset(addr, 0, sizeof(struct sockaddr_un));
+	addr->sun_family = AF_UNIX;
+	strncpy(addr->sun_path, path, sizeof(addr->sun_path) - 1);
+}
+
+static int socket_create_unix_listener(char* path) {
+	struct sockaddr_un addr;
+	socket_unix_address(&addr, path);
+
+	int server_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server_socket == -1)
+		return -1;
+
+	// Un socket viejo de una corrida anterior haria fallar el bind
+	unlink(path);
+	if (bind(server_socket, (struct sockaddr *) &addr, sizeof(addr)) == -1
+			|| listen(server_socket, BACKLOG) == -1) {
+		close(server_socket);
+		return -1;
+	}
+	return server_socket;
+}
+
 int socket_create_listener(char* ip, int port) {
 	if (ip == NULL)
 		return -1;
 
+	char path[SOCKET_PATH_MAX];
+	e_socket_scheme scheme = socket_parse_address(ip, port, path);
+	if (scheme != SOCKET_TCP) {
+		int server_socket = socket_create_unix_listener(path);
+		if (server_socket >= 0 && server_socket < SOCKET_MAX_FDS) {
+			pthread_mutex_lock(&transports_mutex);
+			listener_schemes[server_socket] = scheme;
+			pthread_mutex_unlock(&transports_mutex);
+		}
+		return server_socket;
+	}
+
 	struct addrinfo hints;
 	struct addrinfo *server_info;
 
@@ -33,10 +149,39 @@ int socket_create_listener(char* ip, int port) {
 	return server_socket;
 }
 
+static int socket_connect_unix(char* path, e_socket_scheme scheme) {
+	struct sockaddr_un addr;
+	socket_unix_address(&addr, path);
+
+	int server_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server_socket == -1)
+		return -1;
+	if (connect(server_socket, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		close(server_socket);
+		return -1;
+	}
+
+	if (scheme == SOCKET_SHM) {
+		t_shm_transport* shm = server_socket < SOCKET_MAX_FDS ?
+				shm_transport_connect(server_socket) : NULL;
+		if (shm == NULL) {
+			close(server_socket);
+			return -1;
+		}
+		socket_register_shm(server_socket, shm);
+	}
+	return server_socket;
+}
+
 int socket_connect_to_server(char* ip, int port) {
 	if (ip == NULL)
 		return -1;
 
+	char path[SOCKET_PATH_MAX];
+	e_socket_scheme scheme = socket_parse_address(ip, port, path);
+	if (scheme != SOCKET_TCP)
+		return socket_connect_unix(path, scheme);
+
 	struct addrinfo hints;
 	struct addrinfo *server_info;
 
@@ -46,43 +191,115 @@ int socket_connect_to_server(char* ip, int port) {
 	hints.ai_socktype = SOCK_STREAM;
 
 	char* port_char = string_itoa(port);
-	getaddrinfo(ip, port_char, &hints, &server_info);
+	int info = getaddrinfo(ip, port_char, &hints, &server_info);
 	free(port_char);
+	if (info != 0)
+		return -1;
 
 	int server_socket = socket(server_info->ai_family, server_info->ai_socktype, server_info->ai_protocol);
 
-	int result = connect(server_socket, server_info->ai_addr, server_info->ai_addrlen);
+	int result = server_socket == -1 ? -1 : connect(server_socket, server_info->ai_addr, server_info->ai_addrlen);
 
 	freeaddrinfo(server_info);
 
+	// Quien reintenta conectarse en loop no puede perder un fd por intento
+	if (result < 0 && server_socket != -1)
+		close(server_socket);
+
 	return (result < 0 || server_socket == -1) ? -1 : server_socket;
 }
 
 int socket_accept_conection(int server_socket) {
-	struct sockaddr_in addr;
+	struct sockaddr_storage addr;
 	socklen_t addrlen = sizeof(addr);
 
 	int client_socket = accept(server_socket, (struct sockaddr *) &addr, &addrlen);
-	printf("%d", client_socket);
 	if (client_socket < 0) {
 		perror("Error al aceptar cliente");
 		return -1;
 	}
+
+	pthread_mutex_lock(&transports_mutex);
+	bool shm_listener = server_socket >= 0 && server_socket < SOCKET_MAX_FDS
+			&& listener_schemes[server_socket] == SOCKET_SHM;
+	pthread_mutex_unlock(&transports_mutex);
+
+	if (shm_listener) {
+		t_shm_transport* shm = client_socket < SOCKET_MAX_FDS ?
+				shm_transport_accept(client_socket) : NULL;
+		if (shm == NULL) {
+			close(client_socket);
+			return -1;
+		}
+		socket_register_shm(client_socket, shm);
+	}
 	return client_socket;
 }
 
+ssize_t socket_send_bytes(int fd, void* buffer, size_t size) {
+	t_transport* transport = socket_get_transport(fd);
+	if (transport == NULL)
+		return send(fd, buffer, size, MSG_NOSIGNAL);
+
+	ssize_t sent = transport->send(transport->state, fd, buffer, size);
+	socket_put_transport(transport);
+	return sent;
+}
+
+ssize_t socket_recv_bytes(int fd, void* buffer, size_t size) {
+	t_transport* transport = socket_get_transport(fd);
+	if (transport == NULL)
+		return recv(fd, buffer, size, 0);
+
+	ssize_t received = transport->recv(transport->state, fd, buffer, size);
+	socket_put_transport(transport);
+	return received;
+}
+
+ssize_t socket_recv_all(int fd, void* buffer, size_t size) {
+	size_t received = 0;
+	while (received < size) {
+		ssize_t res = socket_recv_bytes(fd, (char*) buffer + received,
+				size - received);
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0)
+			return res;
+		received += res;
+	}
+	return received;
+}
+
 char* socket_get_ip(int fd) {
-	struct sockaddr_in addr;
-	socklen_t addr_size = sizeof(struct sockaddr_in);
+	struct sockaddr_storage addr;
+	socklen_t addr_size = sizeof(addr);
 	int res = getpeername(fd, (struct sockaddr *) &addr, &addr_size);
 	if (res == -1)
 		return NULL;
+	if (addr.ss_family == AF_UNIX)
+		return strdup("127.0.0.1");
 	char ip_node[20];
-	strcpy(ip_node, inet_ntoa(addr.sin_addr));
+	strcpy(ip_node, inet_ntoa(((struct sockaddr_in *) &addr)->sin_addr));
 	return strdup(ip_node);
 }
 
 void socket_close_conection(int socket_client) {
-	if (socket_client > 0)
-		close(socket_client);
+	if (socket_client <= 0)
+		return;
+
+	if (socket_client < SOCKET_MAX_FDS) {
+		pthread_mutex_lock(&transports_mutex);
+		t_transport* transport = transports[socket_client];
+		transports[socket_client] = NULL;
+		listener_schemes[socket_client] = SOCKET_TCP;
+		pthread_mutex_unlock(&transports_mutex);
+
+		if (transport != NULL) {
+			// Despierta a quien este bloqueado en el ring antes de soltar el fd
+			transport->shutdown(transport->state);
+			shutdown(socket_client, SHUT_RDWR);
+			socket_put_transport(transport);
+		}
+	}
+	close(socket_client);
 }
@@ -9,6 +9,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <arpa/inet.h>
@@ -18,6 +19,7 @@
 #include <pthread.h>
 #include <commons/string.h>
 #include "protocols.h"
+#include "shm_transport.h"
 
 #define BACKLOG 10
 
@@ -25,6 +27,29 @@
 #define BIND_ERROR		-2
 #define LISTEN_ERROR	-3
 
+#define SOCKET_MAX_FDS		1024
+#define SOCKET_PATH_MAX		108
+#define SOCKET_DEFAULT_PATH	"/tmp/delibird-%d.sock"
+
+// Se elige con el valor de IP de la config: "127.0.0.1" (TCP), "unix" o
+// "unix:/ruta" (AF_UNIX) y "shm" o "shm:/ruta" (ring en memoria compartida,
+// usando el socket AF_UNIX solo como aviso). Sin ruta se usa
+// SOCKET_DEFAULT_PATH con el puerto.
+typedef enum {
+	SOCKET_TCP,
+	SOCKET_UNIX,
+	SOCKET_SHM
+} e_socket_scheme;
+
+typedef struct {
+	ssize_t (*send)(void* state, int fd, void* buffer, size_t size);
+	ssize_t (*recv)(void* state, int fd, void* buffer, size_t size);
+	void (*shutdown)(void* state);
+	void (*destroy)(void* state);
+	void* state;
+	int references;
+} t_transport;
+
 /**
  * @NAME: socket_create_listener
  * @DESC: Creo un socket de escucha y lo devuelvo, o -1 se hubo error. Me pongo a escuchar.
@@ -46,6 +71,31 @@ int socket_connect_to_server(char* ip, int port);
  */
 int socket_accept_conection(int server_socket);
 
+/**
+ * @NAME: socket_parse_address
+ * @DESC: Devuelve el esquema de una IP de config y, si no es TCP, deja en path
+ * 		(de SOCKET_PATH_MAX bytes) la ruta del socket AF_UNIX.
+ */
+e_socket_scheme socket_parse_address(char* ip, int port, char* path);
+
+/**
+ * @NAME: socket_send_bytes
+ * @DESC: send sobre el transporte del fd. Nunca genera SIGPIPE.
+ */
+ssize_t socket_send_bytes(int fd, void* buffer, size_t size);
+
+/**
+ * @NAME: socket_recv_bytes
+ * @DESC: recv sin flags sobre el transporte del fd.
+ */
+ssize_t socket_recv_bytes(int fd, void* buffer, size_t size);
+
+/**
+ * @NAME: socket_recv_all
+ * @DESC: Equivalente a recv con MSG_WAITALL sobre el transporte del fd.
+ */
+ssize_t socket_recv_all(int fd, void* buffer, size_t size);
+
 /**
  * @NAME: socket_get_ip
  * @DESC: Devuelve la IP de un socket
@@ -54,7 +104,7 @@ char* socket_get_ip(int fd);
 
 /**
  * @NAME: socket_free_conection
- * @DESC: Cierra el socket
+ * @DESC: Cierra el socket y libera su transporte
  */
 void socket_close_conection(int socket_client);
 
@@ -4,26 +4,47 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../common/alloc_trace.c \
+../common/allocator.c \
+../common/broker_connection.c \
+../common/cluster.c \
 ../common/config.c \
+../common/framing.c \
 ../common/logger.c \
+../common/pool.c \
 ../common/protocols.c \
 ../common/serializer.c \
+../common/shm_transport.c \
 ../common/sockets.c \
 ../common/utils.c 
 
 OBJS += \
+./common/alloc_trace.o \
+./common/allocator.o \
+./common/broker_connection.o \
+./common/cluster.o \
 ./common/config.o \
+./common/framing.o \
 ./common/logger.o \
+./common/pool.o \
 ./common/protocols.o \
 ./common/serializer.o \
+./common/shm_transport.o \
 ./common/sockets.o \
 ./common/utils.o 
 
 C_DEPS += \
+./common/alloc_trace.d \
+./common/allocator.d \
+./common/broker_connection.d \
+./common/cluster.d \
 ./common/config.d \
+./common/framing.d \
 ./common/logger.d \
+./common/pool.d \
 ./common/protocols.d \
 ./common/serializer.d \
+./common/shm_transport.d \
 ./common/sockets.d \
 ./common/utils.d 
 
@@ -110,20 +110,38 @@ void utils_package_destroy(t_package* package) {
 	free(package);
 }
 
-void utils_package_send_to(t_package* t_package, int client_socket) {
+int utils_package_send_to(t_package* t_package, int client_socket) {
 	int bytes = t_package->buffer->size + 2 * sizeof(int);
 	void* to_send = serializer_serialize_package(t_package, bytes);
 	//printf("----->bytes %d \n",bytes);
-	send(client_socket, to_send, bytes, 0);
+	int sent = 0;
+	while (sent < bytes) {
+		// Si el otro extremo cerro devuelve EPIPE en lugar de terminar el
+		// proceso con SIGPIPE
+		ssize_t res = socket_send_bytes(client_socket, to_send + sent,
+				bytes - sent);
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0)
+			break;
+		sent += res;
+	}
 
 	free(to_send);
+	return sent == bytes ? 0 : -1;
 }
 
-void utils_serialize_and_send(int socket, int protocol, void* package_send) {
+t_package* utils_package_from(int protocol, void* package_send) {
 	switch (protocol) {
 
-	case HANDSHAKE: {
-		break;
+	case HANDSHAKE:
+	case REPLICA: {
+		t_package* package = utils_package_create(protocol);
+		utils_package_add(package, ((t_handshake*) package_send)->ip,
+				strlen(((t_handshake*) package_send)->ip) + 1);
+		utils_package_add(package, &((t_handshake*) package_send)->puerto,
+				sizeof(uint32_t));
+		return package;
 	}
 
 	case ACK: {
@@ -140,9 +158,7 @@ void utils_serialize_and_send(int socket, int protocol, void* package_send) {
 		utils_package_add(package,
 						&((t_ack*) package_send)->port,
 						sizeof(uint32_t));
-		utils_package_send_to(package, socket);
-		utils_package_destroy(package);
-		break;
+		return package;
 	}
 
 	case NEW_POKEMON: {
@@ -162,16 +178,12 @@ void utils_serialize_and_send(int socket, int protocol, void* package_send) {
 				sizeof(uint32_t));
 		utils_package_add(package, &((t_new_pokemon*) package_send)->pos_y,
 				sizeof(uint32_t));
-		utils_package_send_to(package, socket);
-		utils_package_destroy(package);
-		break;
+		return package;
 	}
 
 	case NOOP: {
 		t_package* package = utils_package_create(protocol);
-		utils_package_send_to(package, socket);
-		utils_package_destroy(package);
-		break;
+		return package;
 	}
 
 	case SUBSCRIBE: {
@@ -188,10 +200,13 @@ void utils_serialize_and_send(int socket, int protocol, void* package_send) {
 				sizeof(uint32_t));
 		utils_package_add(package, &((t_subscribe*) package_send)->seconds,
 				sizeof(int32_t));
-		utils_package_send_to(package, socket);
-		utils_package_destroy(package);
-
-		break;
+		// Una especie por campo despues de los fijos
+		t_list* especies = ((t_subscribe*) package_send)->especies;
+		for (int i = 0; especies != NULL && i < list_size(especies); i++) {
+			char* especie = list_get(especies, i);
+			utils_package_add(package, especie, strlen(especie) + 1);
+		}
+		return package;
 	}
 
 	case CATCH_POKEMON: {
@@ -209,9 +224,7 @@ void utils_serialize_and_send(int socket, int protocol, void* package_send) {
 		utils_package_add(package,
 				&((t_catch_pokemon*) package_send)->tamanio_nombre,
 				sizeof(uint32_t));
-		utils_package_send_to(package, socket);
-		utils_package_destroy(package);
-		break;
+		return package;
 	}
 
 	case CAUGHT_POKEMON: {
@@ -221,9 +234,7 @@ void utils_serialize_and_send(int socket, int protocol, void* package_send) {
 				sizeof(uint32_t));
 		utils_package_add(package, &((t_caught_pokemon*) package_send)->result,
 				sizeof(uint32_t));
-		utils_package_send_to(package, socket);
-		utils_package_destroy(package);
-		break;
+		return package;
 	}
 
 	case APPEARED_POKEMON: {
@@ -241,9 +252,7 @@ void utils_serialize_and_send(int socket, int protocol, void* package_send) {
 				sizeof(uint32_t));
 		utils_package_add(package, &((t_appeared_pokemon*) package_send)->pos_y,
 				sizeof(uint32_t));
-		utils_package_send_to(package, socket);
-		utils_package_destroy(package);
-		break;
+		return package;
 	}
 
 	case GET_POKEMON: {
@@ -257,9 +266,16 @@ void utils_serialize_and_send(int socket, int protocol, void* package_send) {
 		utils_package_add(package,
 				&((t_get_pokemon*) package_send)->tamanio_nombre,
 				sizeof(uint32_t));
-		utils_package_send_to(package, socket);
-		utils_package_destroy(package);
-		break;
+		return package;
+	}
+
+	case MESSAGE_ID: {
+		t_package* package = utils_package_create(protocol);
+		utils_package_add(package, &((t_message_id*) package_send)->request_id,
+				sizeof(uint32_t));
+		utils_package_add(package, &((t_message_id*) package_send)->id,
+				sizeof(uint32_t));
+		return package;
 	}
 
 	case LOCALIZED_POKEMON: {
@@ -277,33 +293,105 @@ void utils_serialize_and_send(int socket, int protocol, void* package_send) {
 		utils_package_add(package,
 				&((t_localized_pokemon*) package_send)->cant_elem,
 				sizeof(uint32_t));
-		for (int i = 0; i < ((t_localized_pokemon*) package_send)->cant_elem;
-				i++) {
-			t_position *pos = malloc(sizeof(t_position));
-			pos = list_get(((t_localized_pokemon*) package_send)->posiciones,
-					i);
-			utils_package_add(package, &pos->pos_x, sizeof(int));
-			utils_package_add(package, &pos->pos_y, sizeof(int));
+		if (((t_localized_pokemon*) package_send)->coordenadas != NULL) {
+			int blob_size;
+			void* blob = utils_localized_encode(
+					((t_localized_pokemon*) package_send)->coordenadas,
+					&blob_size);
+			utils_package_add(package, blob, blob_size);
+			free(blob);
+		} else {
+			for (int i = 0;
+					i < ((t_localized_pokemon*) package_send)->cant_elem;
+					i++) {
+				t_position *pos = list_get(
+						((t_localized_pokemon*) package_send)->posiciones, i);
+				utils_package_add(package, &pos->pos_x, sizeof(int));
+				utils_package_add(package, &pos->pos_y, sizeof(int));
+			}
 		}
-		utils_package_send_to(package, socket);
-		utils_package_destroy(package);
-		break;
+		return package;
 	}
 	}
+	return NULL;
+}
+
+int utils_serialize_and_send(int socket, int protocol, void* package_send) {
+	t_package* package = utils_package_from(protocol, package_send);
+	if (package == NULL)
+		return 0;
+	int result = utils_package_send_to(package, socket);
+	utils_package_destroy(package);
+	return result;
 }
 
 void* utils_receive_and_deserialize(int socket, int package_type) {
-	void iterator(t_buffer* value) {
-		printf("%d \n", value->size);
-		int dest;
-		memcpy(&dest, value->stream, value->size);
-		printf("%d \n", dest);
+	if (package_type == NOOP)
+		return NULL;
+
+	t_list* list = utils_receive_package(socket);
+	if (list == NULL)
+		return NULL;
+
+	void* message = utils_deserialize_fields(package_type, list);
+	list_destroy_and_destroy_elements(list, (void*) utils_destroy_list);
+	return message;
+}
+
+int utils_receive_message(t_frame_reader* reader, int* protocol,
+		void** message) {
+	t_frame frame;
+	int status = framing_reader_read(reader, &frame);
+	if (status != FRAMING_OK)
+		return status;
+
+	*protocol = frame.protocol;
+	*message = NULL;
+	if (frame.protocol == NOOP)
+		return FRAMING_OK;
+
+	t_list* list = framing_frame_fields(&frame);
+	if (list == NULL)
+		return FRAMING_ERROR;
+
+	*message = utils_deserialize_fields(frame.protocol, list);
+	list_destroy_and_destroy_elements(list, (void*) utils_destroy_list);
+
+	// Un opcode conocido con campos invalidos deja de ser confiable el resto
+	// del stream; los desconocidos se devuelven sin mensaje
+	if (*message == NULL && frame.protocol > HANDSHAKE
+			&& frame.protocol <= REPLICA)
+		return FRAMING_ERROR;
+	return FRAMING_OK;
+}
+
+static bool utils_field_is_string(t_buffer* field) {
+	return field->size > 0 && ((char*) field->stream)[field->size - 1] == '\0';
+}
+
+// Valida la forma de los campos antes de copiarlos: '4' es un entero de
+// 4 bytes exactos y 's' un string terminado en '\0'
+static bool utils_fields_match(t_list* list, char* layout) {
+	int fields = strlen(layout);
+	if (list_size(list) < fields)
+		return false;
+	for (int i = 0; i < fields; i++) {
+		t_buffer* field = list_get(list, i);
+		if (layout[i] == '4' && field->size != sizeof(uint32_t))
+			return false;
+		if (layout[i] == 's' && !utils_field_is_string(field))
+			return false;
 	}
+	return true;
+}
+
+void* utils_deserialize_fields(int package_type, t_list* list) {
 	switch (package_type) {
 
 	case NEW_POKEMON: {
+		if (!utils_fields_match(list, "4s4444"))
+			return NULL;
 		t_new_pokemon *new_request = malloc(sizeof(t_new_pokemon));
-		t_list* list = utils_receive_package(socket);
 		utils_get_from_list_to(&new_request->tamanio_nombre, list, 0);
 		new_request->nombre_pokemon = malloc(utils_get_buffer_size(list, 1));
 		utils_get_from_list_to(new_request->nombre_pokemon, list, 1);
@@ -311,14 +399,14 @@ void* utils_receive_and_deserialize(int socket, int package_type) {
 		utils_get_from_list_to(&new_request->cantidad, list, 3);
 		utils_get_from_list_to(&new_request->pos_x, list, 4);
 		utils_get_from_list_to(&new_request->pos_y, list, 5);
-		list_destroy_and_destroy_elements(list, (void*) utils_destroy_list);
 		return new_request;
 	}
 
 	case APPEARED_POKEMON: {
+		if (!utils_fields_match(list, "4s444"))
+			return NULL;
 		t_appeared_pokemon *appeared_request = malloc(
 				sizeof(t_appeared_pokemon));
-		t_list* list = utils_receive_package(socket);
 
 		utils_get_from_list_to(&appeared_request->tamanio_nombre, list, 0);
 		appeared_request->nombre_pokemon = malloc(
@@ -327,31 +415,30 @@ void* utils_receive_and_deserialize(int socket, int package_type) {
 		utils_get_from_list_to(&appeared_request->id_correlacional, list, 2);
 		utils_get_from_list_to(&appeared_request->pos_x, list, 3);
 		utils_get_from_list_to(&appeared_request->pos_y, list, 4);
-		list_destroy_and_destroy_elements(list, (void*) utils_destroy_list);
 		return appeared_request;
 	}
 
 	case CATCH_POKEMON: {
+		if (!utils_fields_match(list, "4s444"))
+			return NULL;
 		t_catch_pokemon* catch_req = malloc(sizeof(t_catch_pokemon));
-		t_list* list = utils_receive_package(socket);
 		utils_get_from_list_to(&catch_req->id_correlacional, list, 0);
 		catch_req->nombre_pokemon = malloc(utils_get_buffer_size(list, 1));
 		utils_get_from_list_to(catch_req->nombre_pokemon, list, 1);
 		utils_get_from_list_to(&catch_req->pos_x, list, 2);
 		utils_get_from_list_to(&catch_req->pos_y, list, 3);
 		utils_get_from_list_to(&catch_req->tamanio_nombre, list, 4);
-		list_destroy_and_destroy_elements(list, (void*) utils_destroy_list);
 		return catch_req;
 	}
 
 	case GET_POKEMON: {
+		if (!utils_fields_match(list, "4s4"))
+			return NULL;
 		t_get_pokemon* get_req = malloc(sizeof(t_get_pokemon));
-		t_list* list = utils_receive_package(socket);
 		utils_get_from_list_to(&get_req->id_correlacional, list, 0);
 		get_req->nombre_pokemon = malloc(utils_get_buffer_size(list, 1));
 		utils_get_from_list_to(get_req->nombre_pokemon, list, 1);
 		utils_get_from_list_to(&get_req->tamanio_nombre, list, 2);
-		list_destroy_and_destroy_elements(list, (void*) utils_destroy_list);
 		return get_req;
 	}
 
@@ -360,8 +447,9 @@ void* utils_receive_and_deserialize(int socket, int package_type) {
 	}
 
 	case ACK: {
+		if (!utils_fields_match(list, "44ss4"))
+			return NULL;
 		t_ack* ack_req = malloc(sizeof(t_ack));
-		t_list* list = utils_receive_package(socket);
 		utils_get_from_list_to(&ack_req->id_corr_msg, list, 0);
 		utils_get_from_list_to(&ack_req->queue, list, 1);
 		ack_req->sender_name = malloc(utils_get_buffer_size(list, 2));
@@ -369,14 +457,18 @@ void* utils_receive_and_deserialize(int socket, int package_type) {
 		ack_req->ip = malloc(utils_get_buffer_size(list, 3));
 		utils_get_from_list_to(ack_req->ip, list, 3);
 		utils_get_from_list_to(&ack_req->port, list, 4);
-		list_destroy_and_destroy_elements(list, (void*) utils_destroy_list);
 		return ack_req;
 		break;
 	}
 
 	case SUBSCRIBE: {
+		if (!utils_fields_match(list, "s44444"))
+			return NULL;
+		for (int i = 6; i < list_size(list); i++) {
+			if (!utils_field_is_string(list_get(list, i)))
+				return NULL;
+		}
 		t_subscribe* subscribe_req = malloc(sizeof(t_subscribe));
-		t_list* list = utils_receive_package(socket);
 		subscribe_req->ip = malloc(utils_get_buffer_size(list, 0));
 		utils_get_from_list_to(subscribe_req->ip, list, 0);
 		utils_get_from_list_to(&subscribe_req->puerto, list, 1);
@@ -384,20 +476,50 @@ void* utils_receive_and_deserialize(int socket, int package_type) {
 		utils_get_from_list_to(&subscribe_req->proceso, list, 3);
 		utils_get_from_list_to(&subscribe_req->f_desc, list, 4);
 		utils_get_from_list_to(&subscribe_req->seconds, list, 5);
-		list_destroy_and_destroy_elements(list, (void*) utils_destroy_list);
+		subscribe_req->especies = NULL;
+		for (int i = 6; i < list_size(list); i++) {
+			if (subscribe_req->especies == NULL)
+				subscribe_req->especies = list_create();
+			list_add(subscribe_req->especies,
+					string_duplicate(((t_buffer*) list_get(list, i))->stream));
+		}
 		return subscribe_req;
 	}
 
-	
 	case LOCALIZED_POKEMON: {
+		if (!utils_fields_match(list, "4s44"))
+			return NULL;
 		t_localized_pokemon* localized_req = malloc(
 				sizeof(t_localized_pokemon));
-		t_list* list = utils_receive_package(socket);
 		utils_get_from_list_to(&localized_req->id_correlacional, list, 0);
 		localized_req->nombre_pokemon = malloc(utils_get_buffer_size(list, 1));
 		utils_get_from_list_to(localized_req->nombre_pokemon, list, 1);
 		utils_get_from_list_to(&localized_req->tamanio_nombre, list, 2);
 		utils_get_from_list_to(&localized_req->cant_elem, list, 3);
+		localized_req->posiciones = NULL;
+		localized_req->coordenadas = NULL;
+
+		// El compacto manda las coordenadas en un unico campo extra; el
+		// expandido siempre tiene una cantidad par de campos
+		if (list_size(list) == 5) {
+			t_buffer* blob = list_get(list, 4);
+			localized_req->coordenadas = utils_localized_decode(blob->stream,
+					blob->size, localized_req->cant_elem);
+			if (localized_req->coordenadas == NULL) {
+				utils_localized_destroy(localized_req);
+				return NULL;
+			}
+			return localized_req;
+		}
+
+		// cant_elem viene del peer: se acota antes de multiplicar, si no
+		// 0x80000000 * 2 da 0 y pasa un frame sin posiciones
+		uint32_t campos = list_size(list) - 4;
+		if (localized_req->cant_elem > campos / 2
+				|| localized_req->cant_elem * 2 != campos) {
+			utils_localized_destroy(localized_req);
+			return NULL;
+		}
 		localized_req->posiciones = list_create();
 		for (int i = 4; i < (localized_req->cant_elem * 2) + 4; i += 2) {
 			t_position* pos = malloc(sizeof(t_position));
@@ -405,22 +527,214 @@ void* utils_receive_and_deserialize(int socket, int package_type) {
 			utils_get_from_list_to(&pos->pos_y, list, i + 1);
 			list_add(localized_req->posiciones, pos);
 		}
-		list_destroy_and_destroy_elements(list, (void*) utils_destroy_list);
 		return localized_req;
 	}
 
+	case HANDSHAKE:
+	case REPLICA: {
+		if (!utils_fields_match(list, "s4"))
+			return NULL;
+		t_handshake* handshake = malloc(sizeof(t_handshake));
+		handshake->ip = malloc(utils_get_buffer_size(list, 0));
+		utils_get_from_list_to(handshake->ip, list, 0);
+		utils_get_from_list_to(&handshake->puerto, list, 1);
+		return handshake;
+	}
+
+	case MESSAGE_ID: {
+		if (!utils_fields_match(list, "44"))
+			return NULL;
+		t_message_id* id_rcv = malloc(sizeof(t_message_id));
+		utils_get_from_list_to(&id_rcv->request_id, list, 0);
+		utils_get_from_list_to(&id_rcv->id, list, 1);
+		return id_rcv;
+	}
+
 	case CAUGHT_POKEMON: {
+		if (!utils_fields_match(list, "44"))
+			return NULL;
 		t_caught_pokemon* caught_req = malloc(sizeof(t_caught_pokemon));
-		t_list* list = utils_receive_package(socket);
 		utils_get_from_list_to(&caught_req->id_correlacional, list, 0);
 		utils_get_from_list_to(&caught_req->result, list, 1);
-		list_destroy_and_destroy_elements(list, (void*) utils_destroy_list);
 		return caught_req;
 	}
 	}
 	return NULL;
 }
 
+static bool utils_position_before(t_position_aux* a, t_position_aux* b) {
+	return a->x < b->x || (a->x == b->x && a->y < b->y);
+}
+
+void* utils_localized_encode(t_list* coordenadas, int* size) {
+	t_list* sorted = list_sorted(coordenadas, (void*) utils_position_before);
+	int count = list_size(sorted);
+
+	uint8_t* blob = malloc(
+			1 + SERIALIZER_VARINT_MAX + count * 3 * SERIALIZER_VARINT_MAX);
+	int offset = 0;
+	blob[offset++] = LOCALIZED_ENCODING_COMPACT;
+	offset += serializer_put_varint(blob + offset, count);
+
+	// Ordenadas, las diferencias entre coordenadas vecinas son chicas y
+	// casi siempre entran en un byte
+	uint32_t last_x = 0;
+	uint32_t last_y = 0;
+	for (int i = 0; i < count; i++) {
+		t_position_aux* pos = list_get(sorted, i);
+		offset += serializer_put_varint(blob + offset,
+				serializer_zigzag((int32_t) (pos->x - last_x)));
+		offset += serializer_put_varint(blob + offset,
+				serializer_zigzag((int32_t) (pos->y - last_y)));
+		offset += serializer_put_varint(blob + offset, pos->cant);
+		last_x = pos->x;
+		last_y = pos->y;
+	}
+	list_destroy(sorted);
+
+	*size = offset;
+	return blob;
+}
+
+t_list* utils_localized_decode(void* blob, int size, uint32_t cant_elem) {
+	if (size < 1 || ((uint8_t*) blob)[0] != LOCALIZED_ENCODING_COMPACT)
+		return NULL;
+
+	int offset = 1;
+	uint32_t count;
+	int read = serializer_get_varint(blob + offset, size - offset, &count);
+	if (read < 0 || count > (uint32_t) size)
+		return NULL;
+	offset += read;
+
+	t_list* coordenadas = list_create();
+	uint32_t last_x = 0;
+	uint32_t last_y = 0;
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t dx, dy, cant;
+		int rx = serializer_get_varint(blob + offset, size - offset, &dx);
+		int ry = rx < 0 ? -1 :
+				serializer_get_varint(blob + offset + rx, size - offset - rx,
+						&dy);
+		int rc = ry < 0 ? -1 :
+				serializer_get_varint(blob + offset + rx + ry,
+						size - offset - rx - ry, &cant);
+		// Cada cantidad se expande despues a un t_position por pokemon
+		total += rc < 0 ? 0 : cant;
+		if (rc < 0 || total > LOCALIZED_MAX_POKEMONS) {
+			list_destroy_and_destroy_elements(coordenadas, free);
+			return NULL;
+		}
+		offset += rx + ry + rc;
+
+		t_position_aux* pos = malloc(sizeof(t_position_aux));
+		pos->x = last_x + serializer_unzigzag(dx);
+		pos->y = last_y + serializer_unzigzag(dy);
+		pos->cant = cant;
+		list_add(coordenadas, pos);
+		last_x = pos->x;
+		last_y = pos->y;
+	}
+
+	if (offset != size || total != cant_elem) {
+		list_destroy_and_destroy_elements(coordenadas, free);
+		return NULL;
+	}
+	return coordenadas;
+}
+
+uint32_t utils_localized_count(t_list* coordenadas) {
+	uint32_t total = 0;
+	for (int i = 0; i < list_size(coordenadas); i++)
+		total += ((t_position_aux*) list_get(coordenadas, i))->cant;
+	return total;
+}
+
+t_list* utils_localized_group(t_list* posiciones) {
+	t_list* coordenadas = list_create();
+	t_position_aux* last = NULL;
+	for (int i = 0; i < list_size(posiciones); i++) {
+		t_position* pos = list_get(posiciones, i);
+		// GameCard manda las repeticiones de una coordenada seguidas
+		if (last != NULL && last->x == pos->pos_x && last->y == pos->pos_y) {
+			last->cant++;
+			continue;
+		}
+		last = malloc(sizeof(t_position_aux));
+		last->x = pos->pos_x;
+		last->y = pos->pos_y;
+		last->cant = 1;
+		list_add(coordenadas, last);
+	}
+	return coordenadas;
+}
+
+t_list* utils_localized_positions(t_localized_pokemon* localized) {
+	if (localized->posiciones != NULL || localized->coordenadas == NULL)
+		return localized->posiciones;
+
+	localized->posiciones = list_create();
+	for (int i = 0; i < list_size(localized->coordenadas); i++) {
+		t_position_aux* coord = list_get(localized->coordenadas, i);
+		for (uint32_t j = 0; j < coord->cant; j++) {
+			t_position* pos = malloc(sizeof(t_position));
+			pos->pos_x = coord->x;
+			pos->pos_y = coord->y;
+			list_add(localized->posiciones, pos);
+		}
+	}
+	return localized->posiciones;
+}
+
+void utils_localized_destroy(t_localized_pokemon* localized) {
+	if (localized->posiciones != NULL)
+		list_destroy_and_destroy_elements(localized->posiciones, free);
+	if (localized->coordenadas != NULL)
+		list_destroy_and_destroy_elements(localized->coordenadas, free);
+	free(localized->nombre_pokemon);
+	free(localized);
+}
+
+void utils_message_destroy(int protocol, void* message) {
+	if (message == NULL)
+		return;
+	switch (protocol) {
+	case NEW_POKEMON:
+		free(((t_new_pokemon*) message)->nombre_pokemon);
+		break;
+	case APPEARED_POKEMON:
+		free(((t_appeared_pokemon*) message)->nombre_pokemon);
+		break;
+	case CATCH_POKEMON:
+		free(((t_catch_pokemon*) message)->nombre_pokemon);
+		break;
+	case GET_POKEMON:
+		free(((t_get_pokemon*) message)->nombre_pokemon);
+		break;
+	case LOCALIZED_POKEMON:
+		utils_localized_destroy(message);
+		return;
+	case ACK:
+		free(((t_ack*) message)->sender_name);
+		free(((t_ack*) message)->ip);
+		break;
+	case SUBSCRIBE:
+		free(((t_subscribe*) message)->ip);
+		if (((t_subscribe*) message)->especies != NULL)
+			list_destroy_and_destroy_elements(
+					((t_subscribe*) message)->especies, free);
+		break;
+	case HANDSHAKE:
+	case REPLICA:
+		free(((t_handshake*) message)->ip);
+		break;
+	default:
+		break;
+	}
+	free(message);
+}
+
 void utils_destroy_list(t_buffer *self) {
 	free(self->stream);
 	free(self);
@@ -458,33 +772,28 @@ void utils_get_from_list_to(void *parameter, t_list *list, int index) {
 void* utils_receive_buffer(int* size, int socket_cliente) {
 	void * buffer;
 
-	recv(socket_cliente, size, sizeof(int), MSG_WAITALL);
+	if (socket_recv_all(socket_cliente, size, sizeof(int)) != sizeof(int))
+		return NULL;
+	if (*size < 0 || *size > FRAMING_MAX_FRAME_SIZE)
+		return NULL;
+
 	buffer = malloc(*size);
-	recv(socket_cliente, buffer, *size, MSG_WAITALL);
+	if (*size > 0 && socket_recv_all(socket_cliente, buffer, *size) != *size) {
+		free(buffer);
+		return NULL;
+	}
 
 	return buffer;
 }
 
 t_list* utils_receive_package(int socket_cliente) {
-	int size;
-	int desplazamiento = 0;
-	void * buffer;
-	t_list* valores = list_create();
-	int tamanio = 0;
-
-	buffer = utils_receive_buffer(&size, socket_cliente);
-
-	while (desplazamiento < size) {
-		memcpy(&tamanio, buffer + desplazamiento, sizeof(int));
-		desplazamiento += sizeof(int);
-		t_buffer* valor = malloc(sizeof(t_buffer));
-		valor->stream = malloc(tamanio);
-		valor->size = tamanio;
-		memcpy(valor->stream, buffer + desplazamiento, tamanio);
-		desplazamiento += tamanio;
-		list_add(valores, valor);
-	}
-	free(buffer);
+	t_frame frame;
+
+	frame.payload = utils_receive_buffer(&frame.size, socket_cliente);
+	if (frame.payload == NULL)
+		return NULL;
+
+	t_list* valores = framing_frame_fields(&frame);
+	free(frame.payload);
 	return valores;
-	return NULL;
 }
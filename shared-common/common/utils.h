@@ -14,6 +14,7 @@
 #include <commons/collections/list.h>
 #include "sockets.h"
 #include "serializer.h"
+#include "framing.h"
 
 #define max(a,b) \
 		({ __typeof__ (a) _a = (a); \
@@ -41,10 +42,19 @@ void utils_buffer_create(t_package* package);
 t_package* utils_package_create(t_protocol code);
 void utils_package_add(t_package* package, void* value, int size);
 void utils_package_destroy(t_package* package);
-void utils_package_send_to(t_package* t_package, int client_socket);
-void utils_serialize_and_send(int socket, int package_type, void* package);
+int utils_package_send_to(t_package* t_package, int client_socket);
+
+/**
+ * @NAME: utils_package_from
+ * @DESC: Arma el paquete del mensaje sin enviarlo, para quien lo tiene que
+ * 		encolar. NULL si el protocolo no se serializa.
+ */
+t_package* utils_package_from(int protocol, void* package);
+int utils_serialize_and_send(int socket, int package_type, void* package);
 int utils_get_buffer_size(t_list *list, int index);
 void* utils_receive_and_deserialize(int socket, int package_type);
+void* utils_deserialize_fields(int package_type, t_list* list);
+int utils_receive_message(t_frame_reader* reader, int* protocol, void** message);
 t_list* utils_receive_package(int socket_cliente);
 void* utils_receive_buffer(int* size, int socket_cliente);
 void utils_get_from_list_to(void *parameter,t_list *list,int index);
@@ -52,4 +62,56 @@ void utils_get_from_list_to2(void *parameter,t_list *list,int index);
 void utils_get_from_list_to_malloc(void *parameter,t_list *list,int index);
 void utils_destroy_list(t_buffer *self);
 
+/**
+ * @NAME: utils_localized_encode
+ * @DESC: Codifica una lista de t_position_aux como
+ * 		[version][cantidad][dx dy cant]..., con las coordenadas ordenadas y
+ * 		cada diferencia en zigzag + varint. Devuelve el blob y su tamaño.
+ */
+void* utils_localized_encode(t_list* coordenadas, int* size);
+
+// Tope de pokemones de un LOCALIZED: los que entrarian expandido en un frame.
+// Un compacto declara cantidades que despues se expanden una por una
+#define LOCALIZED_MAX_POKEMONS	(FRAMING_MAX_FRAME_SIZE / (2 * sizeof(uint32_t)))
+
+/**
+ * @NAME: utils_localized_decode
+ * @DESC: Inversa de utils_localized_encode. Devuelve NULL si el blob esta mal
+ * 		formado o si sus cantidades no suman cant_elem o pasan de
+ * 		LOCALIZED_MAX_POKEMONS.
+ */
+t_list* utils_localized_decode(void* blob, int size, uint32_t cant_elem);
+
+/**
+ * @NAME: utils_localized_count
+ * @DESC: Suma las cantidades de una lista de t_position_aux.
+ */
+uint32_t utils_localized_count(t_list* coordenadas);
+
+/**
+ * @NAME: utils_localized_group
+ * @DESC: Agrupa posiciones repetidas consecutivas en t_position_aux.
+ */
+t_list* utils_localized_group(t_list* posiciones);
+
+/**
+ * @NAME: utils_localized_positions
+ * @DESC: Devuelve la lista de t_position del LOCALIZED, expandiendola desde las
+ * 		coordenadas si llego compacto. La lista queda asociada al mensaje.
+ */
+t_list* utils_localized_positions(t_localized_pokemon* localized);
+
+/**
+ * @NAME: utils_localized_destroy
+ * @DESC: Libera el mensaje con sus listas y el nombre.
+ */
+void utils_localized_destroy(t_localized_pokemon* localized);
+
+/**
+ * @NAME: utils_message_destroy
+ * @DESC: Libera un mensaje de utils_deserialize_fields con lo que tenga
+ * 		adentro (nombre, ip, listas). Acepta NULL.
+ */
+void utils_message_destroy(int protocol, void* message);
+
 #endif /* CUSTOM_UTILITARIA_H_ */
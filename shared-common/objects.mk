@@ -4,5 +4,5 @@
 
 USER_OBJS :=
 
-LIBS := -lcommons
+LIBS := -lcommons -lpthread -lrt
 
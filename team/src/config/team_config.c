@@ -11,6 +11,7 @@ void team_config_free() {
 	utils_free_array(team_config->pokemon_entrenadores);
 	utils_free_array(team_config->objetivos_entrenadores);
 	free(team_config->ip_broker);
+	cluster_destroy(team_config->cluster);
 	free(team_config->log_file);
 	free(team_config);
 }
@@ -43,6 +44,8 @@ void read_config(t_config* config_file) {
 	team_config->estimacion_inicial = config_get_int_value(config_file, "ESTIMACION_INICIAL");
 	team_config->ip_broker = string_duplicate(config_get_string_value(config_file, "IP_BROKER"));
 	team_config->puerto_broker = config_get_int_value(config_file, "PUERTO_BROKER");
+	// Opcional: sin CLUSTER_BROKERS todo va a IP_BROKER:PUERTO_BROKER
+	team_config->cluster = cluster_create(config_file, team_config->ip_broker, team_config->puerto_broker);
 	team_config->ip_team = string_duplicate(config_get_string_value(config_file, "IP_TEAM"));
 	team_config->puerto_team = config_get_int_value(config_file, "PUERTO_TEAM");
 	team_config->log_file = malloc(sizeof(char*));
@@ -81,6 +84,10 @@ void team_print_config() {
 	team_logger_info("ESTIMACION_INICIAL: %d", team_config->estimacion_inicial);
 	team_logger_info("IP_BROKER: %s", team_config->ip_broker);
 	team_logger_info("PUERTO_BROKER: %d", team_config->puerto_broker);
+	for (int i = 0; i < list_size(team_config->cluster->nodes); i++) {
+		t_cluster_node* node = list_get(team_config->cluster->nodes, i);
+		team_logger_info("CLUSTER_BROKERS[%d]: %s:%d", i, node->ip, node->port);
+	}
 	team_logger_info("LOG_FILE: %s", team_config->log_file);
 	team_logger_info("IP_TEAM: %s", team_config->ip_team);
 	team_logger_info("PUERTO_TEAM: %d", team_config->puerto_team);
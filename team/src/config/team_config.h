@@ -9,6 +9,7 @@
 
 #include "../../../shared-common/common/config.h"
 #include "../../../shared-common/common/utils.h"
+#include "../../../shared-common/common/cluster.h"
 
 #define CONFIG_FILE_PATH "team.config"
 #define FIFO_STRING "FIFO";
@@ -37,6 +38,7 @@ typedef struct
 	char* log_file;
 	char* ip_team;
 	int puerto_team;
+	t_cluster* cluster;
 } t_team_config;
 
 t_team_config* team_config;
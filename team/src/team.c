@@ -46,6 +46,8 @@ void team_init() {
 	pthread_t algoritmo_cercania_entrenadores;
 
 	team_planner_init();
+	team_broker = broker_router_create(team_config->cluster);
+	broker_router_identify(team_broker, team_config->ip_team, team_config->puerto_team);
 
 	t_cola cola_appeared = APPEARED_QUEUE;
 	pthread_create(&tid1, NULL, (void*) team_retry_connect_1, (void*) &cola_appeared);
@@ -185,6 +187,7 @@ void atrapar_pokemon(t_entrenador_pokemon* entrenador, char* pokemon_name) {
 		team_logger_info("El team se encuentra en condiciones de FINALIZAR!");
 		team_planner_print_fullfill_target();
 		team_planner_exit();
+		broker_router_destroy(team_broker);
 		socket_close_conection(team_socket);
 		exit(0);
 	}
@@ -242,24 +245,18 @@ void send_get_message() {
 }
 
 int send_message(void* paquete, t_protocol protocolo, t_list* queue) {
-	int broker_fd_send = socket_connect_to_server(team_config->ip_broker, team_config->puerto_broker);
-
-	if (broker_fd_send < 0) {
-		socket_close_conection(broker_fd_send);
+	uint32_t id_corr;
+	t_broker_connection* broker = broker_router_get(team_broker, cluster_queue_of(protocolo));
+	if (broker_connection_request(broker, protocolo, paquete, &id_corr) < 0) {
 		return -1;
-	} else {
-		utils_serialize_and_send(broker_fd_send, protocolo, paquete);
+	}
 
-		uint32_t id_corr;
-		int recibido = recv(broker_fd_send, &id_corr, sizeof(uint32_t), MSG_WAITALL);
-		if (recibido > 0 && queue != NULL) {
-			list_add(queue, (void*) id_corr);
-		}
-		if (protocolo == CATCH_POKEMON) {
-			t_catch_pokemon *catch_send = (t_catch_pokemon*) paquete;
-			catch_send->id_correlacional = id_corr;
-		}
-		socket_close_conection(broker_fd_send);
+	if (queue != NULL) {
+		list_add(queue, (void*) id_corr);
+	}
+	if (protocolo == CATCH_POKEMON) {
+		t_catch_pokemon *catch_send = (t_catch_pokemon*) paquete;
+		catch_send->id_correlacional = id_corr;
 	}
 	return 0;
 }
@@ -351,7 +348,8 @@ void move_trainers_and_catch_pokemon(t_entrenador_pokemon* entrenador) {
 
 void subscribe_to(void *arg) {
 	t_cola cola = *((int *) arg);
-	int new_broker_fd = socket_connect_to_server(team_config->ip_broker, team_config->puerto_broker);
+	// Si el broker no responde y tiene replica se pasa a ella
+	int new_broker_fd = cluster_connect(team_config->cluster, cola);
 
 	if (new_broker_fd < 0) {
 		socket_close_conection(new_broker_fd);
@@ -363,6 +361,7 @@ void subscribe_to(void *arg) {
 		sub_snd->puerto = team_config->puerto_team;
 		sub_snd->proceso = TEAM;
 		sub_snd->cola = cola;
+		sub_snd->especies = NULL;
 		utils_serialize_and_send(new_broker_fd, subscribe_protocol, sub_snd);
 
 		receive_msg(new_broker_fd, 0);
@@ -372,7 +371,7 @@ void subscribe_to(void *arg) {
 
 void subscribe_to1(void *arg) {
 	t_cola cola = *((int *) arg);
-	int new_broker_fd = socket_connect_to_server(team_config->ip_broker, team_config->puerto_broker);
+	int new_broker_fd = cluster_connect(team_config->cluster, cola);
 
 	if (new_broker_fd < 0) {
 		team_logger_warn("No se pudo conectar con BROKER porque no se encuentra activo. Se realizará la operación por DEFAULT.");
@@ -386,7 +385,10 @@ void subscribe_to1(void *arg) {
 		sub_snd->puerto = team_config->puerto_team;
 		sub_snd->proceso = TEAM;
 		sub_snd->cola = cola;
+		// Solo los APPEARED de las especies que faltan atrapar
+		sub_snd->especies = team_required_species();
 		utils_serialize_and_send(new_broker_fd, subscribe_protocol, sub_snd);
+		list_destroy(sub_snd->especies);
 
 		receive_msg(new_broker_fd, 0);
 		is_connected = true;
@@ -447,18 +449,20 @@ t_entrenador_pokemon* filter_trainer_by_id_caught(uint32_t id_corr_caught) {
 
 void *receive_msg(int fd, int send_to) {
 	int protocol;
+	void* message;
 	int is_server = send_to;
+	t_frame_reader* reader = framing_reader_create(fd, 0);
 
 	while (true) {
-		int received_bytes = recv(fd, &protocol, sizeof(int), 0);
-		if (received_bytes <= 0) {
+		if (utils_receive_message(reader, &protocol, &message) <= 0) {
+			framing_reader_destroy(reader);
 			return NULL;
 		}
 
 		switch (protocol) {
 
 		case CAUGHT_POKEMON: {
-			t_caught_pokemon *caught_rcv = utils_receive_and_deserialize(fd, protocol);
+			t_caught_pokemon *caught_rcv = message;
 			team_logger_info("Se recibió un ID CORRELACIONAL de un mensaje CAUGHT: %d. Resultado (0/1): %d", caught_rcv->id_correlacional, caught_rcv->result);
 
 			if (is_server == 0) {
@@ -497,7 +501,7 @@ void *receive_msg(int fd, int send_to) {
 		}
 
 		case LOCALIZED_POKEMON: {
-			t_localized_pokemon *loc_rcv = utils_receive_and_deserialize(fd, protocol);
+			t_localized_pokemon *loc_rcv = message;
 			team_logger_info("Se recibió un LOCALIZED! ID: %d. Nombre Pokemon: %s. Largo Nombre: %d. Cant elementos en lista: %d.",
 					loc_rcv->id_correlacional, loc_rcv->nombre_pokemon, loc_rcv->tamanio_nombre, loc_rcv->cant_elem);
 
@@ -528,8 +532,9 @@ void *receive_msg(int fd, int send_to) {
 					string_append(&pokemon->name, loc_rcv->nombre_pokemon);
 
 					pokemon->pos = list_create();
-					for (int i = 0; i < list_size(loc_rcv->posiciones); i++) {
-						t_position* pos_rcv = list_get(loc_rcv->posiciones, i);
+					t_list* posiciones = utils_localized_positions(loc_rcv);
+					for (int i = 0; i < list_size(posiciones); i++) {
+						t_position* pos_rcv = list_get(posiciones, i);
 						list_add(pokemon->pos, pos_rcv);
 					}
 
@@ -542,7 +547,7 @@ void *receive_msg(int fd, int send_to) {
 		}
 
 		case APPEARED_POKEMON: {
-			t_appeared_pokemon *appeared_rcv = utils_receive_and_deserialize(fd, protocol);
+			t_appeared_pokemon *appeared_rcv = message;
 			team_logger_info("Se recibió un APPEARED! ID: %d. Nombre Pokemon: %s. Largo Nombre: %d. Posición: (%d, %d).",
 					appeared_rcv->id_correlacional,
 					appeared_rcv->nombre_pokemon, appeared_rcv->tamanio_nombre,
@@ -668,6 +673,15 @@ bool pokemon_required(char* pokemon_name) {
 	return false;
 }
 
+t_list* team_required_species() {
+	t_list* especies = list_create();
+	for (int i = 0; i < list_size(real_targets_pokemons); i++) {
+		t_pokemon* pokemon = list_get(real_targets_pokemons, i);
+		list_add(especies, pokemon->name);
+	}
+	return especies;
+}
+
 bool pokemon_in_pokemon_to_catch(char* pokemon_name) {
 	for (int i = 0; i < list_size(pokemon_to_catch); i++) {
 		t_pokemon_received* pokemon = list_get(pokemon_to_catch, i);
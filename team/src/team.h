@@ -15,9 +15,11 @@
 #include "planner/team_planner.h"
 #include "../../shared-common/common/sockets.h"
 #include "../../shared-common/common/utils.h"
+#include "../../shared-common/common/broker_connection.h"
 
 bool is_connected;
 bool already_printed;
+t_broker_router* team_broker;
 t_list* lista_auxiliar;
 
 
@@ -42,6 +44,7 @@ void team_retry_connect_1(void*);
 void subscribe_to1(void*);
 void remover_totalmente_de_pokemon_to_catch(char*);
 bool pokemon_required(char*);
+t_list* team_required_species();
 bool pokemon_not_pendant(char*);
 bool trainer_is_in_deadlock_caught(t_entrenador_pokemon*);
 bool pokemon_in_pokemon_to_catch(char*);